@@ -21,7 +21,7 @@
 */
 
 #include "../stdafx.h"
-#include "../common.h"
+#include "../Common.h"
 #include <algorithm>
 #include "Mixer.h"
 #include "Square.h"
@@ -260,3 +260,13 @@ bool C2A03::DPCMPlaying() const
 {
 	return m_pDPCM->IsPlaying();
 }
+
+void C2A03::SerializeState(CStateArchive &State)		// // //
+{
+	State(m_iFrameSequence, m_iFrameMode);
+	m_pSquare1->SerializeState(State);
+	m_pSquare2->SerializeState(State);
+	m_pTriangle->SerializeState(State);
+	m_pNoise->SerializeState(State);
+	m_pDPCM->SerializeState(State);
+}
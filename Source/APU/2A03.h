@@ -47,6 +47,7 @@ public:
 	uint8_t Read(uint16_t Address, bool &Mapped);
 
 	double GetFreq(int Channel) const;		// // //
+	void SerializeState(CStateArchive &State);		// // //
 
 public:
 	void	ClockSequence();		// // //
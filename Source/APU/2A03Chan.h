@@ -33,6 +33,11 @@ public:
 		return m_iPeriod;
 	}
 
+	void SerializeState(CStateArchive &State) {		// // //
+		CChannel::SerializeState(State);
+		State(m_iControlReg, m_iEnabled, m_iPeriod, m_iLengthCounter, m_iCounter);
+	}
+
 protected:
 	inline void Mix(int32_t Value) {
 		if (m_iLastValue != Value) {
@@ -23,8 +23,8 @@
 
 #pragma once
 
-//#define LOGGING
-
+#include <vector>		// // //
+#include <cstdint>		// // //
 #include "../Common.h"
 #include "Mixer.h"
 
@@ -39,10 +39,7 @@ class CS5B;
 
 class CSoundChip;		// // //
 class CRegisterState;		// // //
-
-#ifdef LOGGING
-class CFile;
-#endif
+class CStateArchive;		// // //
 
 class CAPU {
 public:
@@ -78,9 +75,21 @@ public:
 	void	SetMeterDecayRate(int Type) const;		// // // 050B
 	int		GetMeterDecayRate() const;		// // // 050B
 
-#ifdef LOGGING
-	void	Log();
-#endif
+	void	SetRegisterCapture(IRegisterCapture *pCapture);		// // //
+
+	/*!	\brief Stores the settings that determine how register writes are turned into audio.
+		\details Two APUs with identical settings and identical states produce the same output
+		for the same writes. */
+	void	SaveSettings(std::vector<uint8_t> &Data);		// // //
+	/*!	\brief Stores the complete emulation state, including the settings. */
+	void	SaveState(std::vector<uint8_t> &Data);		// // //
+	/*!	\brief Restores a state previously obtained from SaveState under the same settings.
+		\details Sample memory is copied into the APU, so the original buffer need not outlive the call. */
+	void	LoadState(const std::vector<uint8_t> &Data);		// // //
+	/*!	\brief Only advances the frame timing without running the sound chips.
+		\details The register capture still receives every write and frame end, with no audio. */
+	void	SetSkipEmulation(bool bSkip);		// // //
+	uint32_t GetFrameCycles() const;		// // //
 
 public:
 	static const uint8_t	LENGTH_TABLE[];
@@ -97,6 +106,9 @@ private:
 	
 	void LogWrite(uint16_t Address, uint8_t Value);
 
+	void SerializeSettings(CStateArchive &State);		// // //
+	void SerializeState(CStateArchive &State);		// // //
+
 private:
 	CMixer		*m_pMixer;
 	IAudioCallback *m_pParent;
@@ -109,8 +121,10 @@ private:
 	CN163		*m_pN163;
 	CVRC7		*m_pVRC7;
 	CS5B		*m_pS5B;
+	std::vector<CSoundChip*> m_vExChips;			// // // Enabled chips, owned by the pointers above
 
 	uint8_t		m_iExternalSoundChip;				// External sound chip, if used
+	int			m_iMachine;							// // // Last machine passed to ChangeMachineRate
 
 	uint32_t	m_iSampleRate;						// // //
 	uint32_t	m_iFrameCycleCount;
@@ -131,12 +145,9 @@ private:
 	uint8_t		m_iSequencerCount;					// // // Step count for sequencer
 
 	float		m_fLevelVRC7;
-	// // // 050B removed
-
-#ifdef LOGGING
-	CFile		  *m_pLog;
-	int			  m_iFrame;
-//	unsigned char m_iRegs[32];
-#endif
 
+	IRegisterCapture *m_pRegisterCapture;			// // //
+	bool		m_bSkipEmulation;					// // //
+	std::vector<char> m_vSampleMemory;				// // // Sample memory restored by LoadState
+	// // // 050B removed
 };
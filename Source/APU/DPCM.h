@@ -36,6 +36,7 @@ public:
 	uint8_t	ReadControl() const;
 	void	Process(uint32_t Time);
 	double	GetFrequency() const;		// // //
+	void	SerializeState(CStateArchive &State);		// // //
 
 	uint8_t	DidIRQ() const;
 	void	Reload();
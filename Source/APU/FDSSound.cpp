@@ -1,7 +1,9 @@
 #include <cmath>
 #include <memory>
 #include <cstdint>		// // //
-#include "apu.h"
+#include <cstring>
+#include "APU.h"
+#include "FDSSound.h"		// // //
 
 // Code is from nezplug via nintendulator
 
@@ -369,3 +371,13 @@ void FDSSoundInstall3(void)
 	LogTableInitialize();
 
 }
+
+void *FDSSoundState(void)		// // //
+{
+	return &fdssound;
+}
+
+unsigned int FDSSoundStateSize(void)		// // //
+{
+	return sizeof(fdssound);
+}
@@ -1,6 +1,10 @@
 #ifndef FDSSOUND_H
 #define FDSSOUND_H
 
+#ifndef _MSC_VER		// // //
+#define __fastcall
+#endif
+
 void __fastcall FDSSoundReset(void);
 uint8_t __fastcall FDSSoundRead(uint16_t address);
 void __fastcall FDSSoundWrite(uint16_t address, uint8_t value);
@@ -8,4 +12,8 @@ int32_t __fastcall FDSSoundRender(void);
 void __fastcall FDSSoundVolume(unsigned int volume);
 void FDSSoundInstall3(void);
 
+// // // Raw emulation state, for state checkpoints
+void *FDSSoundState(void);
+unsigned int FDSSoundStateSize(void);
+
 #endif /* FDSSOUND_H */
@@ -55,9 +55,11 @@
 #include "../stdafx.h"
 #include <memory>
 #include <cmath>
+#include <cstring>		// // //
 #include "Mixer.h"
 #include "APU.h"
 #include "emu2413.h"
+#include "../StageTimer.h"		// // //
 
 //#define LINEAR_MIXING
 
@@ -298,6 +300,8 @@ int CMixer::SamplesAvail() const
 
 int CMixer::FinishBuffer(int t)
 {
+	CStageScope Timer {PERF_MIXER_FINISH_BUFFER};		// // //
+
 	BlipBuffer.end_frame(t);
 
 	for (int i = 0; i < CHANNELS; ++i) {
@@ -478,3 +482,16 @@ uint32_t CMixer::ResampleDuration(uint32_t Time) const
 {
 	return (uint32_t)BlipBuffer.resampled_duration((blip_time_t)Time);
 }
+
+void CMixer::SerializeSettings(CStateArchive &State)		// // //
+{
+	State(m_iExternalChip, m_iSampleRate, m_iLowCut, m_iHighCut, m_iHighDamp, m_fOverallVol,
+		m_fLevelAPU1, m_fLevelAPU2, m_fLevelVRC6, m_fLevelMMC5, m_fLevelFDS, m_fLevelN163, m_fLevelS5B, m_bNamcoMixing);
+}
+
+void CMixer::SerializeState(CStateArchive &State)		// // //
+{
+	// Channel levels are only used by the meters
+	BlipBuffer.serialize_state(State);
+	State(m_dSumSS, m_dSumTND, m_iChannels);
+}
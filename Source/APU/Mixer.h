@@ -25,7 +25,8 @@
 
 #include "Types.h"
 #include "../Common.h"
-#include "../Blip_Buffer/blip_buffer.h"
+#include "../Blip_Buffer/Blip_Buffer.h"
+#include "StateArchive.h"		// // //
 
 enum chip_level_t {
 	CHIP_LEVEL_APU1,
@@ -68,6 +69,9 @@ public:
 	int		GetMeterDecayRate() const;		// // // 050B
 	void	SetMeterDecayRate(int Rate);		// // // 050B
 
+	void	SerializeSettings(CStateArchive &State);		// // //
+	void	SerializeState(CStateArchive &State);		// // //
+
 private:
 	inline double CalcPin1(double Val1, double Val2);
 	inline double CalcPin2(double Val1, double Val2, double Val3);
@@ -148,3 +148,10 @@ void CNoise::EnvelopeUpdate()
 		}
 	}
 }
+
+void CNoise::SerializeState(CStateArchive &State)		// // //
+{
+	C2A03Chan::SerializeState(State);
+	State(m_iLooping, m_iEnvelopeFix, m_iEnvelopeSpeed, m_iEnvelopeVolume, m_iFixedVolume, m_iEnvelopeCounter,
+		m_iSampleRate, m_iShiftReg);
+}
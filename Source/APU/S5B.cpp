@@ -284,3 +284,17 @@ void CS5B::RunNoise(uint32_t Time)
 		m_iNoiseState >>= 1;
 	}
 }
+
+void CS5BChannel::SerializeState(CStateArchive &State)		// // //
+{
+	CChannel::SerializeState(State);
+	State(m_iVolume, m_iPeriod, m_iPeriodClock, m_bSquareHigh, m_bSquareDisable, m_bNoiseDisable);
+}
+
+void CS5B::SerializeState(CStateArchive &State)		// // //
+{
+	for (auto pChannel : m_pChannel)
+		pChannel->SerializeState(State);
+	State(m_cPort, m_iCounter, m_iNoisePeriod, m_iNoiseClock, m_iNoiseState,
+		m_iEnvelopePeriod, m_iEnvelopeClock, m_iEnvelopeLevel, m_iEnvelopeShape, m_bEnvelopeHold);
+}
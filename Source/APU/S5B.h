@@ -42,6 +42,7 @@ public:
 	void Output(uint32_t Noise, uint32_t Envelope);
 
 	double GetFrequency() const;
+	void SerializeState(CStateArchive &State);		// // //
 
 private:
 	uint8_t m_iVolume;
@@ -68,6 +69,7 @@ public:
 	void	Log(uint16_t Address, uint8_t Value);		// // //
 
 	double	GetFreq(int Channel) const;		// // //
+	void	SerializeState(CStateArchive &State);		// // //
 
 private:
 	void	WriteReg(uint8_t Port, uint8_t Value);
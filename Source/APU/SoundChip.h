@@ -27,6 +27,7 @@
 
 class CMixer;
 class CRegisterLogger;		// // //
+class CStateArchive;		// // //
 
 class CSoundChip {
 public:
@@ -42,6 +43,9 @@ public:
 
 	virtual double	GetFreq(int Channel) const;		// // //
 
+	// // // Saves or restores everything that affects the future output of the chip
+	virtual void	SerializeState(CStateArchive &State) = 0;
+
 	virtual void	Log(uint16_t Address, uint8_t Value);		// // //
 	CRegisterLogger *GetRegisterLogger() const;		// // //
 
@@ -197,3 +197,11 @@ void CSquare::EnvelopeUpdate()
 		}
 	}
 }
+
+void CSquare::SerializeState(CStateArchive &State)		// // //
+{
+	C2A03Chan::SerializeState(State);
+	State(m_iDutyLength, m_iDutyCycle, m_iLooping, m_iEnvelopeFix, m_iEnvelopeSpeed,
+		m_iEnvelopeVolume, m_iFixedVolume, m_iEnvelopeCounter,
+		m_iSweepEnabled, m_iSweepPeriod, m_iSweepMode, m_iSweepShift, m_iSweepCounter, m_iSweepResult, m_bSweepWritten);
+}
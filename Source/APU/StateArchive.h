@@ -0,0 +1,103 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/*!
+	\brief Saves or restores the emulation state of the sound chips as a flat byte sequence.
+	\details Every emulated component describes its state in a single function taking an archive,
+	so that saving and loading always visit the same members in the same order. A saved state is
+	only meaningful to the APU instance that produced it, and two states of the same instance are
+	equal exactly when their bytes are equal.
+*/
+class CStateArchive
+{
+public:
+	/*!	\brief Creates an archive that appends the visited members to a byte buffer. */
+	static CStateArchive Saving(std::vector<uint8_t> &Data) {
+		return CStateArchive {&Data, nullptr, 0};
+	}
+	/*!	\brief Creates an archive that assigns the visited members from a byte buffer. */
+	static CStateArchive Loading(const std::vector<uint8_t> &Data) {
+		return CStateArchive {nullptr, Data.data(), Data.size()};
+	}
+
+	/*!	\brief Returns whether the archive assigns the visited members. */
+	bool IsLoading() const {
+		return m_pOutput == nullptr;
+	}
+
+	/*!	\brief Saves or restores a block of memory. */
+	void Bytes(void *pData, size_t Size) {
+		if (!Size)
+			return;
+		if (m_pOutput) {
+			const uint8_t *pBytes = static_cast<const uint8_t *>(pData);
+			m_pOutput->insert(m_pOutput->end(), pBytes, pBytes + Size);
+		}
+		else {
+			if (Size > m_iSize - m_iPos)
+				throw std::runtime_error("Emulation state is truncated");
+			memcpy(pData, m_pInput + m_iPos, Size);
+			m_iPos += Size;
+		}
+	}
+
+	/*!	\brief Saves or restores values of trivially copyable types, including arrays. */
+	template <typename... T>
+	void operator()(T &... Values) {
+		static_assert((std::is_trivially_copyable<T>::value && ...), "Only plain values can be archived");
+		(Bytes(&Values, sizeof(Values)), ...);
+	}
+
+	/*!	\brief Saves or restores the size and the contents of a vector. */
+	template <typename T>
+	void Vector(std::vector<T> &Values) {
+		static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be archived");
+		uint32_t Size = static_cast<uint32_t>(Values.size());
+		(*this)(Size);
+		if (IsLoading())
+			Values.resize(Size);
+		if (Size)
+			Bytes(Values.data(), Size * sizeof(T));
+	}
+
+private:
+	CStateArchive(std::vector<uint8_t> *pOutput, const uint8_t *pInput, size_t Size) :
+		m_pOutput(pOutput), m_pInput(pInput), m_iSize(Size), m_iPos(0)
+	{
+	}
+
+private:
+	std::vector<uint8_t> *m_pOutput;
+	const uint8_t *m_pInput;
+	size_t m_iSize;
+	size_t m_iPos;
+};
@@ -151,3 +151,9 @@ void CTriangle::LinearCounterUpdate()
 	if (m_iLoop == 0)
 		m_iHalt = 0;
 }
+
+void CTriangle::SerializeState(CStateArchive &State)		// // //
+{
+	C2A03Chan::SerializeState(State);
+	State(m_iLoop, m_iLinearLoad, m_iHalt, m_iLinearCounter, m_iStepGen);
+}
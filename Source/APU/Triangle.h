@@ -39,6 +39,7 @@ public:
 	uint8_t	ReadControl();
 	void	Process(uint32_t Time);
 	double	GetFrequency() const;		// // //
+	void	SerializeState(CStateArchive &State);		// // //
 
 	void	LengthCounterUpdate();
 	void	LinearCounterUpdate();
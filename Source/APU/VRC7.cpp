@@ -19,19 +19,32 @@
 */
 
 #include "../stdafx.h"
+#include <algorithm>		// // //
+#include <cmath>		// // //
+#include <cstring>		// // //
 #include "APU.h"
 #include "VRC7.h"
 #include "../RegisterState.h"		// // //
 
 const float  CVRC7::AMPLIFY	  = 4.6f;		// Mixing amplification, VRC7 patch 14 is 4,88 times stronger than a 50% square @ v=15
 const uint32_t CVRC7::OPL_CLOCK = 3579545;	// Clock frequency
-
-CVRC7::CVRC7(CMixer *pMixer) : CSoundChip(pMixer), m_pBuffer(NULL), m_pOPLLInt(NULL), m_fVolume(1.0f), m_iMaxSamples(0), m_iSoundReg(0)
+const uint32_t CVRC7::OPL_RATE  = 49716;	// // // Native sample rate, OPL_CLOCK / 72
+
+CVRC7::CVRC7(CMixer *pMixer) :
+	CSoundChip(pMixer),
+	m_pBuffer(NULL),
+	m_pOPLLInt(OPLL_new(OPL_CLOCK, OPL_RATE)),		// // //
+	m_iResampleStep(0),
+	m_iResamplePhase(0),
+	m_fVolume(1.0f),
+	m_iMaxSamples(0),
+	m_iSoundReg(0)
 {
 	m_pRegisterLogger->AddRegisterRange(0x00, 0x07);		// // //
 	m_pRegisterLogger->AddRegisterRange(0x10, 0x15);
 	m_pRegisterLogger->AddRegisterRange(0x20, 0x25);
 	m_pRegisterLogger->AddRegisterRange(0x30, 0x35);
+	MakeFilter(OPL_RATE);		// // //
 	Reset();
 }
 
@@ -49,19 +62,22 @@ void CVRC7::Reset()
 {
 	m_iBufferPtr = 0;
 	m_iTime = 0;
+	m_iResamplePhase = 0;		// // //
+	m_iOPLLBuffer.assign(FILTER_TAPS, 0);
+	m_iLastSample = 0;
 }
 
 void CVRC7::SetSampleSpeed(uint32_t SampleRate, double ClockRate, uint32_t FrameRate)
 {
-	if (m_pOPLLInt != NULL) {
-		OPLL_delete(m_pOPLLInt);
-	}
-
-	m_pOPLLInt = OPLL_new(OPL_CLOCK, SampleRate);
-
+	// // // The OPLL always runs at its native rate, only the resampling ratio depends on the output
 	OPLL_reset(m_pOPLLInt);
 	OPLL_reset_patch(m_pOPLLInt, 1);
 
+	m_iResampleStep = (static_cast<uint64_t>(OPL_RATE) << 32) / SampleRate;
+	m_iResamplePhase = 0;
+	m_iOPLLBuffer.assign(FILTER_TAPS, 0);
+	MakeFilter(SampleRate);
+
 	m_iMaxSamples = (SampleRate / FrameRate) * 2;	// Allow some overflow
 
 	SAFE_RELEASE_ARRAY(m_pBuffer);
@@ -103,18 +119,28 @@ void CVRC7::EndFrame()
 {
 	uint32_t WantSamples = m_pMixer->GetMixSampleCount(m_iTime);
 
-	static int32_t LastSample = 0;
-
-	// Generate VRC7 samples
-	while (m_iBufferPtr < WantSamples) {
+	// // // Synthesize the whole frame at the native rate first, so that the FM synthesis cost
+	// does not depend on the output rate
+	const uint32_t OutputSamples = m_iBufferPtr < WantSamples ? WantSamples - m_iBufferPtr : 0;
+	const size_t NativeSamples = static_cast<size_t>((m_iResamplePhase + m_iResampleStep * OutputSamples) >> 32);
+	m_iOPLLBuffer.resize(FILTER_TAPS + NativeSamples);
+	for (size_t i = FILTER_TAPS; i < m_iOPLLBuffer.size(); ++i) {
 		int32_t RawSample = OPLL_calc(m_pOPLLInt);
-		
+
 		// Clipping is slightly asymmetric
 		if (RawSample > 3600)
 			RawSample = 3600;
 		if (RawSample < -3200)
 			RawSample = -3200;
 
+		m_iOPLLBuffer[i] = static_cast<int16_t>(RawSample);
+	}
+
+	// Generate VRC7 samples, each filtered from the latest FILTER_TAPS native samples
+	const int16_t *pNative = m_iOPLLBuffer.data();
+	while (m_iBufferPtr < WantSamples) {
+		const int32_t RawSample = Resample(pNative, static_cast<uint32_t>(m_iResamplePhase));
+
 		// Apply volume
 		int32_t Sample = int(float(RawSample) * m_fVolume);
 
@@ -123,10 +149,18 @@ void CVRC7::EndFrame()
 		if (Sample < -32768)
 			Sample = -32768;
 
-		m_pBuffer[m_iBufferPtr++] = int16_t((Sample + LastSample) >> 1);
-		LastSample = Sample;
+		m_pBuffer[m_iBufferPtr++] = int16_t((Sample + m_iLastSample) >> 1);
+		m_iLastSample = Sample;
+
+		m_iResamplePhase += m_iResampleStep;
+		pNative += m_iResamplePhase >> 32;
+		m_iResamplePhase &= 0xFFFFFFFF;
 	}
 
+	// The latest native samples are the filter history of the next frame
+	std::copy(m_iOPLLBuffer.end() - FILTER_TAPS, m_iOPLLBuffer.end(), m_iOPLLBuffer.begin());
+	m_iOPLLBuffer.resize(FILTER_TAPS);
+
 	m_pMixer->MixSamples((blip_sample_t*)m_pBuffer, WantSamples);
 
 	m_iBufferPtr -= WantSamples;
@@ -139,6 +173,63 @@ void CVRC7::Process(uint32_t Time)
 	m_iTime += Time;
 }
 
+void CVRC7::MakeFilter(uint32_t SampleRate)		// // //
+{
+	// Kaiser windowed sinc, cut off below the Nyquist frequency of the lower of both rates. Each row
+	// holds the taps for one fraction of a native sample between the two middle taps
+	const double BETA = 8.;
+	const double Cutoff = .46 * std::min(1., static_cast<double>(SampleRate) / OPL_RATE);		// Cycles per native sample
+
+	const auto BesselI0 = [] (double x) {
+		double Sum = 1., Term = 1.;
+		for (int k = 1; k < 32; ++k) {
+			Term *= (x / (2 * k)) * (x / (2 * k));
+			Sum += Term;
+		}
+		return Sum;
+	};
+
+	m_iFilter.resize((FILTER_PHASES + 1) * FILTER_TAPS);
+	for (int p = 0; p <= FILTER_PHASES; ++p) {
+		double Taps[FILTER_TAPS];
+		double Sum = 0.;
+		for (int i = 0; i < FILTER_TAPS; ++i) {
+			const double d = i - (FILTER_TAPS / 2 - 1) - static_cast<double>(p) / FILTER_PHASES;
+			const double x = d / (FILTER_TAPS / 2);
+			const double Window = x * x < 1. ? BesselI0(BETA * std::sqrt(1. - x * x)) / BesselI0(BETA) : 0.;
+			const double Sinc = d == 0. ? 1. : std::sin(2. * PI * Cutoff * d) / (2. * PI * Cutoff * d);
+			Taps[i] = Sinc * Window;
+			Sum += Taps[i];
+		}
+
+		// Unity gain at DC, the rounding error goes to the largest tap
+		int16_t *pRow = &m_iFilter[p * FILTER_TAPS];
+		int Total = 0, Largest = 0;
+		for (int i = 0; i < FILTER_TAPS; ++i) {
+			pRow[i] = static_cast<int16_t>(std::lround(Taps[i] / Sum * (1 << 15)));
+			Total += pRow[i];
+			if (pRow[i] > pRow[Largest])
+				Largest = i;
+		}
+		pRow[Largest] += (1 << 15) - Total;
+	}
+}
+
+int32_t CVRC7::Resample(const int16_t *pNative, uint32_t Frac) const		// // //
+{
+	// Linear interpolation between the two nearest filter phases
+	const int16_t *pLo = &m_iFilter[(Frac >> (32 - FILTER_PHASE_BITS)) * FILTER_TAPS];
+	const int16_t *pHi = pLo + FILTER_TAPS;
+	const int32_t t = (Frac >> (16 - FILTER_PHASE_BITS)) & 0xFFFF;
+
+	int32_t Lo = 0, Hi = 0;
+	for (int i = 0; i < FILTER_TAPS; ++i) {
+		Lo += pLo[i] * pNative[i];
+		Hi += pHi[i] * pNative[i];
+	}
+	return static_cast<int32_t>((Lo + ((static_cast<int64_t>(Hi - Lo) * t) >> 16)) >> 15);
+}
+
 double CVRC7::GetFreq(int Channel) const		// // //
 {
 	if (Channel < 0 || Channel >= 6) return 0.;
@@ -148,3 +239,13 @@ double CVRC7::GetFreq(int Channel) const		// // //
 	Hi >>= 1;
 	return 49716. * Lo / (1 << (19 - Hi));
 }
+
+void CVRC7::SerializeState(CStateArchive &State)		// // //
+{
+	// The OPLL only points into itself and into static tables, so it is copied as a whole
+	State.Bytes(m_pOPLLInt, sizeof(OPLL));
+	State(m_iTime, m_iBufferPtr, m_iSoundReg, m_fVolume);
+	State(m_iResamplePhase, m_iLastSample);
+	State.Bytes(m_iOPLLBuffer.data(), sizeof(int16_t) * FILTER_TAPS);
+	State.Bytes(m_pBuffer, sizeof(int16_t) * m_iBufferPtr);
+}
@@ -23,6 +23,7 @@
 
 #include "SoundChip.h"
 #include "emu2413.h"
+#include <vector>		// // //
 
 class CVRC7 : public CSoundChip {
 public:
@@ -40,13 +41,29 @@ public:
 	void Process(uint32_t Time);
 	
 	double GetFreq(int Channel) const;		// // //
+	void SerializeState(CStateArchive &State);		// // //
 
 protected:
 	static const float  AMPLIFY;
 	static const uint32_t OPL_CLOCK;
+	static const uint32_t OPL_RATE;		// // //
+
+	// // // Polyphase resampling filter
+	static const int FILTER_TAPS = 48;
+	static const int FILTER_PHASE_BITS = 8;
+	static const int FILTER_PHASES = 1 << FILTER_PHASE_BITS;
+
+private:
+	void	MakeFilter(uint32_t SampleRate);		// // //
+	int32_t	Resample(const int16_t *pNative, uint32_t Frac) const;		// // //
 
 private:
 	OPLL	*m_pOPLLInt;
+	std::vector<int16_t> m_iOPLLBuffer;		// // // Filter history followed by the native rate samples of the current frame
+	std::vector<int16_t> m_iFilter;		// // // FILTER_PHASES + 1 rows of FILTER_TAPS coefficients, 1.15 fixed point
+	uint64_t	m_iResampleStep;		// // // Native samples per output sample, 32.32 fixed point
+	uint64_t	m_iResamplePhase;		// // // Position after the latest consumed native sample
+	int32_t	m_iLastSample;		// // //
 	uint32_t	m_iTime;
 	uint32_t	m_iMaxSamples;
 
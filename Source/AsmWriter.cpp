@@ -0,0 +1,150 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#include "AsmWriter.h"
+#include <cstring>
+#include <utility>
+
+namespace {
+
+const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+// Two-digit upper-case hexadecimal representations of all bytes
+struct stHexTable {
+	char Digits[0x100][2];
+	stHexTable() {
+		for (int i = 0; i < 0x100; ++i) {
+			Digits[i][0] = HEX_DIGITS[i >> 4];
+			Digits[i][1] = HEX_DIGITS[i & 0x0F];
+		}
+	}
+};
+
+const stHexTable HEX_TABLE;
+
+} // namespace
+
+CAsmWriter::CAsmWriter(sink_t Sink, std::size_t FlushSize) :
+	m_Sink(std::move(Sink)),
+	m_iFlushSize(FlushSize)
+{
+	m_Buffer.reserve(FlushSize + 0x100);
+}
+
+void CAsmWriter::Write(const char *pStr)
+{
+	Write(pStr, std::strlen(pStr));
+}
+
+void CAsmWriter::Write(const char *pData, std::size_t Size)
+{
+	m_Buffer.append(pData, Size);
+	CheckFlush();
+}
+
+void CAsmWriter::Write(char ch)
+{
+	m_Buffer.push_back(ch);
+	CheckFlush();
+}
+
+void CAsmWriter::WriteDec(int Value)
+{
+	char Str[12];
+	char *p = Str + sizeof(Str);
+	unsigned int x = Value < 0 ? 0u - static_cast<unsigned int>(Value) : static_cast<unsigned int>(Value);
+	do {
+		*--p = static_cast<char>('0' + x % 10);
+		x /= 10;
+	} while (x);
+	if (Value < 0)
+		*--p = '-';
+	Write(p, Str + sizeof(Str) - p);
+}
+
+void CAsmWriter::WriteHex(unsigned int Value, unsigned int Digits)
+{
+	if (Value < 0x100 && Digits == 2) {
+		Write(HEX_TABLE.Digits[Value], 2);
+		return;
+	}
+
+	char Str[16];
+	char *p = Str + sizeof(Str);
+	do {
+		*--p = HEX_DIGITS[Value & 0x0F];
+		Value >>= 4;
+	} while (Value);
+	while (p > Str && static_cast<unsigned int>(Str + sizeof(Str) - p) < Digits)
+		*--p = '0';
+	Write(p, Str + sizeof(Str) - p);
+}
+
+void CAsmWriter::WriteByteList(const unsigned char *pData, std::size_t Count, unsigned int LineBreak)
+{
+	static const char PREFIX[] = "\t.byte ";
+	const std::size_t PREFIX_SIZE = sizeof(PREFIX) - 1;
+
+	if (!Count) {
+		Write(PREFIX, PREFIX_SIZE);
+		Write('\n');
+		return;
+	}
+
+	// Every line has the same layout, so each one is formatted in place into the reserved space
+	for (std::size_t Pos = 0; Pos < Count; Pos += LineBreak) {
+		const std::size_t Values = Count - Pos < LineBreak ? Count - Pos : LineBreak;
+		const std::size_t Offset = m_Buffer.size();
+		m_Buffer.resize(Offset + PREFIX_SIZE + Values * 5);
+
+		char *p = &m_Buffer[Offset];
+		std::memcpy(p, PREFIX, PREFIX_SIZE);
+		p += PREFIX_SIZE;
+		for (std::size_t i = 0; i < Values; ++i) {
+			const char *pHex = HEX_TABLE.Digits[pData[Pos + i]];
+			p[0] = '$';
+			p[1] = pHex[0];
+			p[2] = pHex[1];
+			p[3] = ',';
+			p[4] = ' ';
+			p += 5;
+		}
+		p[-2] = '\n';		// Replaces the separator after the last value
+		m_Buffer.pop_back();
+		CheckFlush();
+	}
+}
+
+void CAsmWriter::Flush()
+{
+	if (!m_Buffer.empty()) {
+		m_Sink(m_Buffer.data(), m_Buffer.size());
+		m_Buffer.clear();
+	}
+}
+
+void CAsmWriter::CheckFlush()
+{
+	if (m_Buffer.size() >= m_iFlushSize)
+		Flush();
+}
@@ -0,0 +1,97 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+/*!
+	\brief Builds assembly source text in a growing buffer and writes it out in large blocks.
+	\details Numbers are formatted by hand with the same results as the printf conversions the
+	text renderer used before: %i for WriteDec and %0*X for WriteHex. Byte lists are written one
+	line at a time with a fixed number of values per line.
+*/
+class CAsmWriter
+{
+public:
+	/*!	\brief Receives the written text. */
+	using sink_t = std::function<void(const char *pData, std::size_t Size)>;
+
+	/*!	\brief The default number of buffered bytes that triggers a write to the sink. */
+	static const std::size_t DEFAULT_FLUSH_SIZE = 0x40000;
+
+	/*!	\brief Constructs the writer.
+		\param Sink The destination of the text.
+		\param FlushSize The number of buffered bytes that triggers a write to the sink.
+	*/
+	explicit CAsmWriter(sink_t Sink, std::size_t FlushSize = DEFAULT_FLUSH_SIZE);
+
+	/*!	\brief Writes a null-terminated string. */
+	void Write(const char *pStr);
+	void Write(const char *pData, std::size_t Size);
+	void Write(char ch);
+	/*!	\brief Writes a signed decimal number. */
+	void WriteDec(int Value);
+	/*!	\brief Writes an upper-case hexadecimal number of at least Digits digits. */
+	void WriteHex(unsigned int Value, unsigned int Digits);
+
+	/*!	\brief Writes a list of bytes as .byte lines.
+		\details The output is "\t.byte $XX, $XX\n", with a new .byte line started after every
+		LineBreak values. An empty list produces a .byte line without values.
+	*/
+	void WriteByteList(const unsigned char *pData, std::size_t Count, unsigned int LineBreak);
+	/*!	\brief Writes a list of values as .byte lines, formatted in the same way as WriteByteList.
+		\param Get Returns the value at an index; values above $FF are written with more digits.
+	*/
+	template <typename F>
+	void WriteByteList(std::size_t Count, unsigned int LineBreak, F Get);
+
+	/*!	\brief Writes all buffered text to the sink.
+		\details The sink may throw, so the destructor does not flush; text that has not been
+		flushed is discarded. */
+	void Flush();
+
+private:
+	void CheckFlush();
+
+private:
+	sink_t m_Sink;
+	std::size_t m_iFlushSize;
+	std::string m_Buffer;
+};
+
+template <typename F>
+void CAsmWriter::WriteByteList(std::size_t Count, unsigned int LineBreak, F Get)
+{
+	Write("\t.byte ", 7);
+	for (std::size_t i = 0; i < Count; ++i) {
+		Write('$');
+		WriteHex(Get(i), 2);
+		if (i + 1 < Count)
+			Write(i % LineBreak == LineBreak - 1 ? "\n\t.byte " : ", ");
+	}
+	Write('\n');
+}
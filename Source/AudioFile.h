@@ -0,0 +1,47 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+
+#pragma once
+
+#include <cstdint>
+
+/*!
+	\brief Interface of the audio file formats written by the sound generator while rendering.
+*/
+class IAudioFile
+{
+public:
+	virtual ~IAudioFile() = default;
+
+	/*!	\brief Appends 16-bit samples, converting them to the sample format of the file.
+		\param pSamples The interleaved samples.
+		\param Count The number of samples, counting each channel separately.
+	*/
+	virtual void WriteSamples(const int16_t *pSamples, unsigned int Count) = 0;
+	/*!	\brief Writes all pending samples, finalizes the headers and closes the file.
+		\return Whether every write succeeded.
+	*/
+	virtual bool CloseFile() = 0;
+};
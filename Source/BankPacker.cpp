@@ -0,0 +1,266 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#include "BankPacker.h"
+#include <algorithm>
+#include <map>
+
+int CBankPacker::AddItem(unsigned int Size, int Group)
+{
+	m_vItems.push_back({Size, Group});
+	return m_vItems.size() - 1;
+}
+
+void CBankPacker::AddAccess(const std::vector<int> &Items)
+{
+	m_vAccesses.push_back(Items);
+}
+
+std::vector<std::vector<int>> CBankPacker::Pack(unsigned int FirstCapacity, unsigned int Capacity) const
+{
+	const int Count = m_vItems.size();
+	std::vector<int> Bank(Count, -1);
+	std::vector<int> Free {static_cast<int>(FirstCapacity)};		// Free space of each bank, negative if a single item is too large
+
+	const auto Place = [&] (int Item, int b) {
+		Bank[Item] = b;
+		Free[b] -= m_vItems[Item].Size;
+	};
+	const auto FindBank = [&] (unsigned int Size, int Preferred) {
+		if (Preferred >= 0 && Free[Preferred] >= static_cast<int>(Size))
+			return Preferred;
+		for (size_t b = 0; b < Free.size(); ++b)
+			if (Free[b] >= static_cast<int>(Size))
+				return static_cast<int>(b);
+		return -1;
+	};
+	const auto NewBank = [&] {
+		Free.push_back(Capacity);
+		return static_cast<int>(Free.size()) - 1;
+	};
+
+	// Items and accesses of each group
+	std::map<int, std::vector<int>> Groups;
+	for (int i = 0; i < Count; ++i)
+		Groups[m_vItems[i].Group].push_back(i);
+	std::vector<std::vector<int>> ItemAccesses(Count);
+	for (size_t i = 0; i < m_vAccesses.size(); ++i)
+		for (int x : m_vAccesses[i])
+			ItemAccesses[x].push_back(i);
+
+	std::vector<std::pair<unsigned int, const std::vector<int> *>> Order;
+	for (const auto &x : Groups) {
+		unsigned int Size = 0;
+		for (int i : x.second)
+			Size += m_vItems[i].Size;
+		Order.emplace_back(Size, &x.second);
+	}
+	std::stable_sort(Order.begin(), Order.end(), [] (const auto &a, const auto &b) { return a.first > b.first; });
+
+	// Pass 1, first-fit-decreasing over whole groups
+	for (const auto &x : Order) {
+		const std::vector<int> &Items = *x.second;
+		int b = FindBank(x.first, -1);
+		if (b < 0 && x.first <= Capacity)
+			b = NewBank();
+		if (b >= 0) {
+			for (int i : Items)
+				Place(i, b);
+			continue;
+		}
+
+		// The group does not fit in one bank, split it into the items read by each frame
+		const int Group = m_vItems[Items[0]].Group;
+		std::vector<std::vector<int>> Clusters;
+		for (const auto &Access : m_vAccesses) {
+			std::vector<int> Cluster;
+			for (int i : Access)
+				if (Bank[i] == -1 && m_vItems[i].Group == Group &&
+					std::find(Cluster.begin(), Cluster.end(), i) == Cluster.end()) {
+					Cluster.push_back(i);
+					Bank[i] = -2;		// Claimed by a cluster
+				}
+			if (!Cluster.empty())
+				Clusters.push_back(std::move(Cluster));
+		}
+		for (int i : Items)
+			if (Bank[i] == -1)
+				Clusters.push_back({i});
+
+		int Last = -1;
+		for (auto &Cluster : Clusters) {
+			unsigned int Size = 0;
+			for (int i : Cluster)
+				Size += m_vItems[i].Size;
+			int b = FindBank(Size, Last);
+			if (b < 0 && Size <= Capacity)
+				b = NewBank();
+			if (b >= 0) {
+				for (int i : Cluster)
+					Place(i, b);
+				Last = b;
+				continue;
+			}
+			// Not even the items of one frame fit in a bank
+			std::stable_sort(Cluster.begin(), Cluster.end(), [&] (int a, int b) { return m_vItems[a].Size > m_vItems[b].Size; });
+			for (int i : Cluster) {
+				int b = FindBank(m_vItems[i].Size, Last);
+				if (b < 0)
+					b = NewBank();
+				Place(i, b);
+				Last = b;
+			}
+		}
+	}
+
+	// Number of accesses reading an item together with data in each bank
+	const auto GetVotes = [&] (int Item) {
+		std::map<int, int> Votes;
+		for (int a : ItemAccesses[Item]) {
+			const auto &Access = m_vAccesses[a];
+			if (Access[0] == Item) {
+				for (size_t j = 1; j < Access.size(); ++j)
+					if (Access[j] != Item)
+						++Votes[Bank[Access[j]]];
+			}
+			else
+				for (size_t j = 1; j < Access.size(); ++j)
+					if (Access[j] == Item)
+						++Votes[Bank[Access[0]]];
+		}
+		return Votes;
+	};
+
+	// Pass 2, move the items of the last banks into the free space of other banks
+	for (int Last = static_cast<int>(Free.size()) - 1; Last > 0; --Last) {
+		std::vector<int> Items;
+		for (int i = 0; i < Count; ++i)
+			if (Bank[i] == Last)
+				Items.push_back(i);
+		std::stable_sort(Items.begin(), Items.end(), [&] (int a, int b) { return m_vItems[a].Size > m_vItems[b].Size; });
+
+		std::vector<int> Target(Items.size(), -1);
+		std::vector<int> Space(Free);
+		bool Success = true;
+		for (size_t j = 0; j < Items.size() && Success; ++j) {
+			const int Size = m_vItems[Items[j]].Size;
+			const auto Votes = GetVotes(Items[j]);
+			int Best = -1;
+			for (int b = 0; b < static_cast<int>(Space.size()); ++b) {
+				if (b == Last || Space[b] < Size)
+					continue;
+				if (Best < 0 || (Votes.count(b) ? Votes.at(b) : 0) > (Votes.count(Best) ? Votes.at(Best) : 0))
+					Best = b;
+			}
+			if (Best < 0)
+				Success = false;
+			else {
+				Target[j] = Best;
+				Space[Best] -= Size;
+			}
+		}
+		if (!Success)
+			continue;
+
+		// Remove the emptied bank
+		for (size_t j = 0; j < Items.size(); ++j)
+			Bank[Items[j]] = Target[j];
+		Free = Space;
+		Free.erase(Free.begin() + Last);
+		for (int &b : Bank)
+			if (b > Last)
+				--b;
+	}
+
+	// Pass 3, move items to the bank they are read together with the most
+	for (int Pass = 0; Pass < 4; ++Pass) {
+		bool Moved = false;
+		for (int i = 0; i < Count; ++i) {
+			const auto Votes = GetVotes(i);
+			const int Current = Votes.count(Bank[i]) ? Votes.at(Bank[i]) : 0;
+			int Best = Bank[i], BestVotes = Current;
+			for (const auto &x : Votes)
+				if (x.second > BestVotes && Free[x.first] >= static_cast<int>(m_vItems[i].Size)) {
+					Best = x.first;
+					BestVotes = x.second;
+				}
+			if (Best != Bank[i]) {
+				Free[Bank[i]] += m_vItems[i].Size;
+				Place(i, Best);
+				Moved = true;
+			}
+		}
+		if (!Moved)
+			break;
+	}
+
+	std::vector<std::vector<int>> Banks(Free.size());
+	for (int i = 0; i < Count; ++i)
+		Banks[Bank[i]].push_back(i);
+	return Banks;
+}
+
+int CBankPacker::CountSequentialBanks(unsigned int FirstCapacity, unsigned int Capacity) const
+{
+	if (m_vItems.empty())
+		return 0;
+
+	int Banks = 1;
+	unsigned int Free = FirstCapacity;
+	for (const auto &x : m_vItems) {
+		if (x.Size > Free) {
+			++Banks;
+			Free = Capacity;
+		}
+		Free -= std::min(x.Size, Free);
+	}
+	return Banks;
+}
+
+double CBankPacker::GetSwitchesPerFrame(const std::vector<std::vector<int>> &Banks) const
+{
+	if (m_vAccesses.empty())
+		return 0.;
+
+	std::vector<int> Bank(m_vItems.size());
+	for (size_t b = 0; b < Banks.size(); ++b)
+		for (int i : Banks[b])
+			Bank[i] = b;
+
+	// The driver maps the bank of the frame list before reading the pattern of each channel
+	int Switches = 0;
+	for (const auto &Access : m_vAccesses) {
+		int Current = Bank[Access[0]];
+		for (size_t j = 1; j < Access.size(); ++j) {
+			if (j > 1 && Current != Bank[Access[0]]) {
+				Current = Bank[Access[0]];
+				++Switches;
+			}
+			if (Current != Bank[Access[j]]) {
+				Current = Bank[Access[j]];
+				++Switches;
+			}
+		}
+	}
+	return static_cast<double>(Switches) / m_vAccesses.size();
+}
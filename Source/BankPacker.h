@@ -0,0 +1,72 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+
+#pragma once
+
+#include <vector>
+
+/*!
+	\brief Assigns the bankswitched data of an NSF to 4 KiB banks.
+	\details Items are pieces of data that must not be split, such as a pattern or the frame list of
+	a song together with its frames. Each item belongs to a group, the song that stores it, and the
+	items read together in a frame are recorded as accesses. Groups are packed whole by
+	first-fit-decreasing where they fit in a bank, larger groups are split into the items of
+	consecutive frames, and a refinement pass then moves items next to the data they are read
+	with and tries to empty the last banks.
+*/
+class CBankPacker
+{
+public:
+	/*!	\brief Adds an item.
+		\param Size Size of the item in bytes.
+		\param Group Group of the item, items of a group are kept in the same bank where possible.
+		\return The index of the item. */
+	int AddItem(unsigned int Size, int Group);
+	/*!	\brief Records the items read by a frame.
+		\param Items The frame list item of the song, followed by the pattern item of each channel. */
+	void AddAccess(const std::vector<int> &Items);
+
+	/*!	\brief Packs all items.
+		\param FirstCapacity Free space of the first bank, which is shared with the fixed data.
+		\param Capacity Size of the other banks.
+		\return The items of each bank, in the order they were added. */
+	std::vector<std::vector<int>> Pack(unsigned int FirstCapacity, unsigned int Capacity) const;
+
+	/*!	\brief Returns the number of banks used if the items are stored in the order they were added. */
+	int CountSequentialBanks(unsigned int FirstCapacity, unsigned int Capacity) const;
+	/*!	\brief Returns the average number of times the driver changes the bank mapping while reading a
+		row of each frame.
+		\param Banks Banks as returned by Pack. */
+	double GetSwitchesPerFrame(const std::vector<std::vector<int>> &Banks) const;
+
+private:
+	struct stItem {
+		unsigned int Size;
+		int Group;
+	};
+
+	std::vector<stItem> m_vItems;
+	std::vector<std::vector<int>> m_vAccesses;
+};
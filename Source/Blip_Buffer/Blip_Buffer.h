@@ -82,6 +82,10 @@ public:
 	blip_resampled_time_t resampled_duration( int t ) const     { return t * factor_; }
 	blip_resampled_time_t resampled_time( blip_time_t t ) const { return t * factor_ + offset_; }
 	blip_resampled_time_t clock_rate_factor( long clock_rate ) const;
+	
+	// // // Save or restore the unread samples and the filter state
+	template<class Archive>
+	void serialize_state( Archive& );
 public:
 	Blip_Buffer();
 	~Blip_Buffer();
@@ -253,6 +257,7 @@ private:
 
 
 #include <assert.h>
+#include <string.h>
 
 // Compatibility with older version
 const long blip_unscaled = 65535;
@@ -350,5 +355,18 @@ inline int Blip_Reader::begin( Blip_Buffer& blip_buf )
 int const blip_max_length = 0;
 int const blip_default_length = 250;
 
+// // // Everything past the unread samples and the pending impulses is silent
+template<class Archive>
+void Blip_Buffer::serialize_state( Archive& ar )
+{
+	ar( factor_, offset_, reader_accum, bass_shift );
+	if ( !buffer_ )
+		return;
+	long const extra = blip_widest_impulse_ + 2;
+	if ( ar.IsLoading() )
+		memset( buffer_, 0, (buffer_size_ + extra) * sizeof *buffer_ );
+	ar.Bytes( buffer_, (samples_avail() + extra) * sizeof *buffer_ );
+}
+
 #endif
 
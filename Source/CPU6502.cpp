@@ -0,0 +1,508 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#include "CPU6502.h"
+
+namespace {
+
+const uint8_t FLAG_C = 0x01;
+const uint8_t FLAG_Z = 0x02;
+const uint8_t FLAG_I = 0x04;
+const uint8_t FLAG_D = 0x08;
+const uint8_t FLAG_B = 0x10;
+const uint8_t FLAG_U = 0x20;
+const uint8_t FLAG_V = 0x40;
+const uint8_t FLAG_N = 0x80;
+
+const uint16_t VECTOR_NMI	= 0xFFFA;
+const uint16_t VECTOR_RESET	= 0xFFFC;
+const uint16_t VECTOR_IRQ	= 0xFFFE;
+
+const uint8_t OP_RTI = 0x40;
+
+// Base cycle count of each opcode, zero for undefined opcodes
+const unsigned char CYCLE_TABLE[0x100] = {
+	7, 6, 0, 0, 0, 3, 5, 0, 3, 2, 2, 0, 0, 4, 6, 0,
+	2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0,
+	6, 6, 0, 0, 3, 3, 5, 0, 4, 2, 2, 0, 4, 4, 6, 0,
+	2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0,
+	6, 6, 0, 0, 0, 3, 5, 0, 3, 2, 2, 0, 3, 4, 6, 0,
+	2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0,
+	6, 6, 0, 0, 0, 3, 5, 0, 4, 2, 2, 0, 5, 4, 6, 0,
+	2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0,
+	0, 6, 0, 0, 3, 3, 3, 0, 2, 0, 2, 0, 4, 4, 4, 0,
+	2, 6, 0, 0, 4, 4, 4, 0, 2, 5, 2, 0, 0, 5, 0, 0,
+	2, 6, 2, 0, 3, 3, 3, 0, 2, 2, 2, 0, 4, 4, 4, 0,
+	2, 5, 0, 0, 4, 4, 4, 0, 2, 4, 2, 0, 4, 4, 4, 0,
+	2, 6, 0, 0, 3, 3, 5, 0, 2, 2, 2, 0, 4, 4, 6, 0,
+	2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0,
+	2, 6, 0, 0, 3, 3, 5, 0, 2, 2, 2, 0, 4, 4, 6, 0,
+	2, 5, 0, 0, 0, 4, 6, 0, 2, 4, 0, 0, 0, 4, 7, 0,
+};
+
+bool CrossesPage(uint16_t Base, uint16_t Address) {
+	return (Base ^ Address) & 0xFF00;
+}
+
+} // namespace
+
+CCPU6502::CCPU6502(ICPUBus &Bus) :
+	m_Bus(Bus),
+	m_iPC(0),
+	m_iA(0),
+	m_iX(0),
+	m_iY(0),
+	m_iSP(0xFD),
+	m_iP(FLAG_U | FLAG_I),
+	m_iCycles(0),
+	m_iExtraCycles(0),
+	m_bHalted(false)
+{
+}
+
+void CCPU6502::Reset()
+{
+	m_iA = m_iX = m_iY = 0;
+	m_iSP = 0xFD;
+	m_iP = FLAG_U | FLAG_I;
+	m_bHalted = false;
+	m_iPC = Read16(VECTOR_RESET);
+	m_iCycles += 7;
+}
+
+bool CCPU6502::Call(uint16_t Address, uint16_t ReturnAddress, uint64_t MaxCycles)
+{
+	// RTS adds one to the pulled address
+	const uint16_t Pushed = ReturnAddress - 1;
+	Push(Pushed >> 8);
+	Push(Pushed & 0xFF);
+	m_iPC = Address;
+	return RunUntil([&] { return m_iPC == ReturnAddress; }, MaxCycles);
+}
+
+bool CCPU6502::NMI(uint64_t MaxCycles)
+{
+	const uint8_t SP = m_iSP;
+	const uint16_t PC = m_iPC;
+	Interrupt(VECTOR_NMI, false);
+	return RunUntil([&] { return m_iSP == SP && m_iPC == PC; }, MaxCycles);
+}
+
+uint64_t CCPU6502::GetCycles() const
+{
+	return m_iCycles;
+}
+
+bool CCPU6502::IsHalted() const
+{
+	return m_bHalted;
+}
+
+uint16_t CCPU6502::GetPC() const
+{
+	return m_iPC;
+}
+
+void CCPU6502::SetA(uint8_t Value)
+{
+	m_iA = Value;
+}
+
+void CCPU6502::SetX(uint8_t Value)
+{
+	m_iX = Value;
+}
+
+void CCPU6502::SetY(uint8_t Value)
+{
+	m_iY = Value;
+}
+
+uint8_t CCPU6502::Fetch()
+{
+	return m_Bus.Read(m_iPC++);
+}
+
+uint16_t CCPU6502::Fetch16()
+{
+	const uint8_t Lo = Fetch();
+	return Lo | (Fetch() << 8);
+}
+
+uint16_t CCPU6502::Read16(uint16_t Address)
+{
+	return m_Bus.Read(Address) | (m_Bus.Read(Address + 1) << 8);
+}
+
+uint16_t CCPU6502::Read16Bug(uint16_t Address)
+{
+	// The high byte of an indirect pointer does not cross pages
+	const uint16_t Hi = (Address & 0xFF00) | ((Address + 1) & 0x00FF);
+	return m_Bus.Read(Address) | (m_Bus.Read(Hi) << 8);
+}
+
+void CCPU6502::Push(uint8_t Value)
+{
+	m_Bus.Write(0x100 | m_iSP--, Value);
+}
+
+uint8_t CCPU6502::Pop()
+{
+	return m_Bus.Read(0x100 | ++m_iSP);
+}
+
+void CCPU6502::Interrupt(uint16_t Vector, bool Break)
+{
+	Push(m_iPC >> 8);
+	Push(m_iPC & 0xFF);
+	Push(m_iP | FLAG_U | (Break ? FLAG_B : 0));
+	m_iP |= FLAG_I;
+	m_iPC = Read16(Vector);
+	m_iCycles += 7;
+}
+
+uint16_t CCPU6502::AddrZeroPage(uint8_t Index)
+{
+	return static_cast<uint8_t>(Fetch() + Index);
+}
+
+uint16_t CCPU6502::AddrAbsolute(uint8_t Index, bool Penalty)
+{
+	const uint16_t Base = Fetch16();
+	const uint16_t Address = Base + Index;
+	if (Penalty && CrossesPage(Base, Address))
+		++m_iExtraCycles;
+	return Address;
+}
+
+uint16_t CCPU6502::AddrIndirectX()
+{
+	return Read16Bug(static_cast<uint8_t>(Fetch() + m_iX));
+}
+
+uint16_t CCPU6502::AddrIndirectY(bool Penalty)
+{
+	const uint16_t Base = Read16Bug(Fetch());
+	const uint16_t Address = Base + m_iY;
+	if (Penalty && CrossesPage(Base, Address))
+		++m_iExtraCycles;
+	return Address;
+}
+
+void CCPU6502::SetNZ(uint8_t Value)
+{
+	SetFlag(FLAG_Z, Value == 0);
+	SetFlag(FLAG_N, (Value & 0x80) != 0);
+}
+
+void CCPU6502::SetFlag(uint8_t Flag, bool Set)
+{
+	if (Set)
+		m_iP |= Flag;
+	else
+		m_iP &= ~Flag;
+}
+
+void CCPU6502::Branch(bool Cond)
+{
+	const int8_t Offset = static_cast<int8_t>(Fetch());
+	if (Cond) {
+		const uint16_t Target = m_iPC + Offset;
+		m_iExtraCycles += CrossesPage(m_iPC, Target) ? 2 : 1;
+		m_iPC = Target;
+	}
+}
+
+void CCPU6502::Compare(uint8_t Reg, uint8_t Value)
+{
+	SetFlag(FLAG_C, Reg >= Value);
+	SetNZ(Reg - Value);
+}
+
+void CCPU6502::ADC(uint8_t Value)
+{
+	const unsigned int Sum = m_iA + Value + (m_iP & FLAG_C);
+	SetFlag(FLAG_C, Sum > 0xFF);
+	SetFlag(FLAG_V, (~(m_iA ^ Value) & (m_iA ^ Sum) & 0x80) != 0);
+	m_iA = static_cast<uint8_t>(Sum);
+	SetNZ(m_iA);
+}
+
+uint8_t CCPU6502::ASL(uint8_t Value)
+{
+	SetFlag(FLAG_C, (Value & 0x80) != 0);
+	Value <<= 1;
+	SetNZ(Value);
+	return Value;
+}
+
+uint8_t CCPU6502::LSR(uint8_t Value)
+{
+	SetFlag(FLAG_C, (Value & 0x01) != 0);
+	Value >>= 1;
+	SetNZ(Value);
+	return Value;
+}
+
+uint8_t CCPU6502::ROL(uint8_t Value)
+{
+	const uint8_t Carry = m_iP & FLAG_C;
+	SetFlag(FLAG_C, (Value & 0x80) != 0);
+	Value = (Value << 1) | Carry;
+	SetNZ(Value);
+	return Value;
+}
+
+uint8_t CCPU6502::ROR(uint8_t Value)
+{
+	const uint8_t Carry = (m_iP & FLAG_C) << 7;
+	SetFlag(FLAG_C, (Value & 0x01) != 0);
+	Value = (Value >> 1) | Carry;
+	SetNZ(Value);
+	return Value;
+}
+
+void CCPU6502::BIT(uint8_t Value)
+{
+	SetFlag(FLAG_Z, (m_iA & Value) == 0);
+	SetFlag(FLAG_V, (Value & 0x40) != 0);
+	SetFlag(FLAG_N, (Value & 0x80) != 0);
+}
+
+template <typename F>
+void CCPU6502::Modify(uint16_t Address, F Op)
+{
+	const uint8_t Value = m_Bus.Read(Address);
+	m_Bus.Write(Address, Value);		// dummy write of read-modify-write instructions
+	m_Bus.Write(Address, Op(Value));
+}
+
+unsigned int CCPU6502::Step()
+{
+	if (m_bHalted)
+		return 0;
+
+	const uint8_t Opcode = Fetch();
+	const unsigned int Cycles = CYCLE_TABLE[Opcode];
+	if (!Cycles) {
+		--m_iPC;
+		m_bHalted = true;
+		return 0;
+	}
+	m_iExtraCycles = 0;
+
+	const auto Load = [&] (uint8_t &Reg, uint8_t Value) { Reg = Value; SetNZ(Value); };
+	const auto SBC = [&] (uint8_t Value) { ADC(~Value); };
+	const auto DEC = [&] (uint8_t Value) -> uint8_t { SetNZ(--Value); return Value; };
+	const auto INC = [&] (uint8_t Value) -> uint8_t { SetNZ(++Value); return Value; };
+	const auto Rd = [&] (uint16_t Address) { return m_Bus.Read(Address); };
+	const auto Wr = [&] (uint16_t Address, uint8_t Value) { m_Bus.Write(Address, Value); };
+
+	switch (Opcode) {
+	// Loads and stores
+	case 0xA9: Load(m_iA, Fetch()); break;
+	case 0xA5: Load(m_iA, Rd(AddrZeroPage(0))); break;
+	case 0xB5: Load(m_iA, Rd(AddrZeroPage(m_iX))); break;
+	case 0xAD: Load(m_iA, Rd(AddrAbsolute(0, false))); break;
+	case 0xBD: Load(m_iA, Rd(AddrAbsolute(m_iX, true))); break;
+	case 0xB9: Load(m_iA, Rd(AddrAbsolute(m_iY, true))); break;
+	case 0xA1: Load(m_iA, Rd(AddrIndirectX())); break;
+	case 0xB1: Load(m_iA, Rd(AddrIndirectY(true))); break;
+	case 0xA2: Load(m_iX, Fetch()); break;
+	case 0xA6: Load(m_iX, Rd(AddrZeroPage(0))); break;
+	case 0xB6: Load(m_iX, Rd(AddrZeroPage(m_iY))); break;
+	case 0xAE: Load(m_iX, Rd(AddrAbsolute(0, false))); break;
+	case 0xBE: Load(m_iX, Rd(AddrAbsolute(m_iY, true))); break;
+	case 0xA0: Load(m_iY, Fetch()); break;
+	case 0xA4: Load(m_iY, Rd(AddrZeroPage(0))); break;
+	case 0xB4: Load(m_iY, Rd(AddrZeroPage(m_iX))); break;
+	case 0xAC: Load(m_iY, Rd(AddrAbsolute(0, false))); break;
+	case 0xBC: Load(m_iY, Rd(AddrAbsolute(m_iX, true))); break;
+	case 0x85: Wr(AddrZeroPage(0), m_iA); break;
+	case 0x95: Wr(AddrZeroPage(m_iX), m_iA); break;
+	case 0x8D: Wr(AddrAbsolute(0, false), m_iA); break;
+	case 0x9D: Wr(AddrAbsolute(m_iX, false), m_iA); break;
+	case 0x99: Wr(AddrAbsolute(m_iY, false), m_iA); break;
+	case 0x81: Wr(AddrIndirectX(), m_iA); break;
+	case 0x91: Wr(AddrIndirectY(false), m_iA); break;
+	case 0x86: Wr(AddrZeroPage(0), m_iX); break;
+	case 0x96: Wr(AddrZeroPage(m_iY), m_iX); break;
+	case 0x8E: Wr(AddrAbsolute(0, false), m_iX); break;
+	case 0x84: Wr(AddrZeroPage(0), m_iY); break;
+	case 0x94: Wr(AddrZeroPage(m_iX), m_iY); break;
+	case 0x8C: Wr(AddrAbsolute(0, false), m_iY); break;
+
+	// Transfers and stack
+	case 0xAA: Load(m_iX, m_iA); break;
+	case 0xA8: Load(m_iY, m_iA); break;
+	case 0x8A: Load(m_iA, m_iX); break;
+	case 0x98: Load(m_iA, m_iY); break;
+	case 0xBA: Load(m_iX, m_iSP); break;
+	case 0x9A: m_iSP = m_iX; break;
+	case 0x48: Push(m_iA); break;
+	case 0x08: Push(m_iP | FLAG_U | FLAG_B); break;
+	case 0x68: Load(m_iA, Pop()); break;
+	case 0x28: m_iP = (Pop() & ~FLAG_B) | FLAG_U; break;
+
+	// Arithmetic and logic
+	case 0x69: ADC(Fetch()); break;
+	case 0x65: ADC(Rd(AddrZeroPage(0))); break;
+	case 0x75: ADC(Rd(AddrZeroPage(m_iX))); break;
+	case 0x6D: ADC(Rd(AddrAbsolute(0, false))); break;
+	case 0x7D: ADC(Rd(AddrAbsolute(m_iX, true))); break;
+	case 0x79: ADC(Rd(AddrAbsolute(m_iY, true))); break;
+	case 0x61: ADC(Rd(AddrIndirectX())); break;
+	case 0x71: ADC(Rd(AddrIndirectY(true))); break;
+	case 0xE9: SBC(Fetch()); break;
+	case 0xE5: SBC(Rd(AddrZeroPage(0))); break;
+	case 0xF5: SBC(Rd(AddrZeroPage(m_iX))); break;
+	case 0xED: SBC(Rd(AddrAbsolute(0, false))); break;
+	case 0xFD: SBC(Rd(AddrAbsolute(m_iX, true))); break;
+	case 0xF9: SBC(Rd(AddrAbsolute(m_iY, true))); break;
+	case 0xE1: SBC(Rd(AddrIndirectX())); break;
+	case 0xF1: SBC(Rd(AddrIndirectY(true))); break;
+	case 0x29: Load(m_iA, m_iA & Fetch()); break;
+	case 0x25: Load(m_iA, m_iA & Rd(AddrZeroPage(0))); break;
+	case 0x35: Load(m_iA, m_iA & Rd(AddrZeroPage(m_iX))); break;
+	case 0x2D: Load(m_iA, m_iA & Rd(AddrAbsolute(0, false))); break;
+	case 0x3D: Load(m_iA, m_iA & Rd(AddrAbsolute(m_iX, true))); break;
+	case 0x39: Load(m_iA, m_iA & Rd(AddrAbsolute(m_iY, true))); break;
+	case 0x21: Load(m_iA, m_iA & Rd(AddrIndirectX())); break;
+	case 0x31: Load(m_iA, m_iA & Rd(AddrIndirectY(true))); break;
+	case 0x09: Load(m_iA, m_iA | Fetch()); break;
+	case 0x05: Load(m_iA, m_iA | Rd(AddrZeroPage(0))); break;
+	case 0x15: Load(m_iA, m_iA | Rd(AddrZeroPage(m_iX))); break;
+	case 0x0D: Load(m_iA, m_iA | Rd(AddrAbsolute(0, false))); break;
+	case 0x1D: Load(m_iA, m_iA | Rd(AddrAbsolute(m_iX, true))); break;
+	case 0x19: Load(m_iA, m_iA | Rd(AddrAbsolute(m_iY, true))); break;
+	case 0x01: Load(m_iA, m_iA | Rd(AddrIndirectX())); break;
+	case 0x11: Load(m_iA, m_iA | Rd(AddrIndirectY(true))); break;
+	case 0x49: Load(m_iA, m_iA ^ Fetch()); break;
+	case 0x45: Load(m_iA, m_iA ^ Rd(AddrZeroPage(0))); break;
+	case 0x55: Load(m_iA, m_iA ^ Rd(AddrZeroPage(m_iX))); break;
+	case 0x4D: Load(m_iA, m_iA ^ Rd(AddrAbsolute(0, false))); break;
+	case 0x5D: Load(m_iA, m_iA ^ Rd(AddrAbsolute(m_iX, true))); break;
+	case 0x59: Load(m_iA, m_iA ^ Rd(AddrAbsolute(m_iY, true))); break;
+	case 0x41: Load(m_iA, m_iA ^ Rd(AddrIndirectX())); break;
+	case 0x51: Load(m_iA, m_iA ^ Rd(AddrIndirectY(true))); break;
+	case 0xC9: Compare(m_iA, Fetch()); break;
+	case 0xC5: Compare(m_iA, Rd(AddrZeroPage(0))); break;
+	case 0xD5: Compare(m_iA, Rd(AddrZeroPage(m_iX))); break;
+	case 0xCD: Compare(m_iA, Rd(AddrAbsolute(0, false))); break;
+	case 0xDD: Compare(m_iA, Rd(AddrAbsolute(m_iX, true))); break;
+	case 0xD9: Compare(m_iA, Rd(AddrAbsolute(m_iY, true))); break;
+	case 0xC1: Compare(m_iA, Rd(AddrIndirectX())); break;
+	case 0xD1: Compare(m_iA, Rd(AddrIndirectY(true))); break;
+	case 0xE0: Compare(m_iX, Fetch()); break;
+	case 0xE4: Compare(m_iX, Rd(AddrZeroPage(0))); break;
+	case 0xEC: Compare(m_iX, Rd(AddrAbsolute(0, false))); break;
+	case 0xC0: Compare(m_iY, Fetch()); break;
+	case 0xC4: Compare(m_iY, Rd(AddrZeroPage(0))); break;
+	case 0xCC: Compare(m_iY, Rd(AddrAbsolute(0, false))); break;
+	case 0x24: BIT(Rd(AddrZeroPage(0))); break;
+	case 0x2C: BIT(Rd(AddrAbsolute(0, false))); break;
+
+	// Increments and shifts
+	case 0xE8: Load(m_iX, m_iX + 1); break;
+	case 0xC8: Load(m_iY, m_iY + 1); break;
+	case 0xCA: Load(m_iX, m_iX - 1); break;
+	case 0x88: Load(m_iY, m_iY - 1); break;
+	case 0xE6: Modify(AddrZeroPage(0), INC); break;
+	case 0xF6: Modify(AddrZeroPage(m_iX), INC); break;
+	case 0xEE: Modify(AddrAbsolute(0, false), INC); break;
+	case 0xFE: Modify(AddrAbsolute(m_iX, false), INC); break;
+	case 0xC6: Modify(AddrZeroPage(0), DEC); break;
+	case 0xD6: Modify(AddrZeroPage(m_iX), DEC); break;
+	case 0xCE: Modify(AddrAbsolute(0, false), DEC); break;
+	case 0xDE: Modify(AddrAbsolute(m_iX, false), DEC); break;
+	case 0x0A: m_iA = ASL(m_iA); break;
+	case 0x06: Modify(AddrZeroPage(0), [&] (uint8_t x) { return ASL(x); }); break;
+	case 0x16: Modify(AddrZeroPage(m_iX), [&] (uint8_t x) { return ASL(x); }); break;
+	case 0x0E: Modify(AddrAbsolute(0, false), [&] (uint8_t x) { return ASL(x); }); break;
+	case 0x1E: Modify(AddrAbsolute(m_iX, false), [&] (uint8_t x) { return ASL(x); }); break;
+	case 0x4A: m_iA = LSR(m_iA); break;
+	case 0x46: Modify(AddrZeroPage(0), [&] (uint8_t x) { return LSR(x); }); break;
+	case 0x56: Modify(AddrZeroPage(m_iX), [&] (uint8_t x) { return LSR(x); }); break;
+	case 0x4E: Modify(AddrAbsolute(0, false), [&] (uint8_t x) { return LSR(x); }); break;
+	case 0x5E: Modify(AddrAbsolute(m_iX, false), [&] (uint8_t x) { return LSR(x); }); break;
+	case 0x2A: m_iA = ROL(m_iA); break;
+	case 0x26: Modify(AddrZeroPage(0), [&] (uint8_t x) { return ROL(x); }); break;
+	case 0x36: Modify(AddrZeroPage(m_iX), [&] (uint8_t x) { return ROL(x); }); break;
+	case 0x2E: Modify(AddrAbsolute(0, false), [&] (uint8_t x) { return ROL(x); }); break;
+	case 0x3E: Modify(AddrAbsolute(m_iX, false), [&] (uint8_t x) { return ROL(x); }); break;
+	case 0x6A: m_iA = ROR(m_iA); break;
+	case 0x66: Modify(AddrZeroPage(0), [&] (uint8_t x) { return ROR(x); }); break;
+	case 0x76: Modify(AddrZeroPage(m_iX), [&] (uint8_t x) { return ROR(x); }); break;
+	case 0x6E: Modify(AddrAbsolute(0, false), [&] (uint8_t x) { return ROR(x); }); break;
+	case 0x7E: Modify(AddrAbsolute(m_iX, false), [&] (uint8_t x) { return ROR(x); }); break;
+
+	// Jumps and branches
+	case 0x4C: m_iPC = Fetch16(); break;
+	case 0x6C: m_iPC = Read16Bug(Fetch16()); break;
+	case 0x20: {
+		const uint16_t Target = Fetch16();
+		const uint16_t Return = m_iPC - 1;
+		Push(Return >> 8);
+		Push(Return & 0xFF);
+		m_iPC = Target;
+		break;
+	}
+	case 0x60: {
+		const uint8_t Lo = Pop();
+		m_iPC = (Lo | (Pop() << 8)) + 1;
+		break;
+	}
+	case OP_RTI: {
+		m_iP = (Pop() & ~FLAG_B) | FLAG_U;
+		const uint8_t Lo = Pop();
+		m_iPC = Lo | (Pop() << 8);
+		break;
+	}
+	case 0x00:
+		++m_iPC;
+		Interrupt(VECTOR_IRQ, true);
+		m_iCycles -= 7;		// included in the cycle table
+		break;
+	case 0x10: Branch(!(m_iP & FLAG_N)); break;
+	case 0x30: Branch((m_iP & FLAG_N) != 0); break;
+	case 0x50: Branch(!(m_iP & FLAG_V)); break;
+	case 0x70: Branch((m_iP & FLAG_V) != 0); break;
+	case 0x90: Branch(!(m_iP & FLAG_C)); break;
+	case 0xB0: Branch((m_iP & FLAG_C) != 0); break;
+	case 0xD0: Branch(!(m_iP & FLAG_Z)); break;
+	case 0xF0: Branch((m_iP & FLAG_Z) != 0); break;
+
+	// Flags
+	case 0x18: m_iP &= ~FLAG_C; break;
+	case 0x38: m_iP |= FLAG_C; break;
+	case 0x58: m_iP &= ~FLAG_I; break;
+	case 0x78: m_iP |= FLAG_I; break;
+	case 0xB8: m_iP &= ~FLAG_V; break;
+	case 0xD8: m_iP &= ~FLAG_D; break;
+	case 0xF8: m_iP |= FLAG_D; break;
+	case 0xEA: break;
+	}
+
+	m_iCycles += Cycles + m_iExtraCycles;
+	return Cycles + m_iExtraCycles;
+}
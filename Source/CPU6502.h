@@ -0,0 +1,141 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+
+#pragma once
+
+#include <cstdint>
+
+/*!
+	\brief Memory bus of the emulated 6502.
+*/
+class ICPUBus
+{
+public:
+	virtual uint8_t Read(uint16_t Address) = 0;
+	virtual void Write(uint16_t Address, uint8_t Value) = 0;
+};
+
+/*!
+	\brief An instruction-level emulator of the 2A03 CPU core.
+	\details All official 6502 instructions are emulated, without the decimal mode which the 2A03
+	lacks. Cycle counts include the page crossing and taken branch penalties, but bus accesses are
+	not timed individually; every access of an instruction happens at its first cycle. Undefined
+	opcodes halt the CPU.
+*/
+class CCPU6502
+{
+public:
+	CCPU6502(ICPUBus &Bus);
+
+	/*!	\brief Resets the registers and jumps to the reset vector. */
+	void Reset();
+
+	/*!	\brief Executes a single instruction.
+		\return The number of cycles taken by the instruction, or zero if the CPU is halted.
+	*/
+	unsigned int Step();
+
+	/*!	\brief Calls a subroutine as if it were called by a JSR instruction.
+		\param Address The address of the subroutine.
+		\param ReturnAddress An address that is never executed, used to detect the return.
+		\param MaxCycles The number of cycles after which the call is abandoned.
+		\return Whether the subroutine returned in time.
+	*/
+	bool Call(uint16_t Address, uint16_t ReturnAddress, uint64_t MaxCycles);
+
+	/*!	\brief Triggers a non-maskable interrupt and runs until its handler returns.
+		\param MaxCycles The number of cycles after which the interrupt is abandoned.
+		\return Whether the handler returned in time.
+	*/
+	bool NMI(uint64_t MaxCycles);
+
+	/*!	\brief Runs until the condition is satisfied after an instruction.
+		\param Cond A function taking no arguments, called after each instruction.
+		\param MaxCycles The number of cycles after which execution is abandoned.
+		\return Whether the condition was satisfied in time.
+	*/
+	template <typename F>
+	bool RunUntil(F Cond, uint64_t MaxCycles) {
+		const uint64_t Limit = m_iCycles + MaxCycles;
+		while (!m_bHalted && m_iCycles < Limit) {
+			Step();
+			if (Cond())
+				return true;
+		}
+		return false;
+	}
+
+	/*!	\brief Returns the number of cycles executed since the CPU was constructed. */
+	uint64_t GetCycles() const;
+	/*!	\brief Returns whether the CPU has encountered an undefined opcode. */
+	bool IsHalted() const;
+	uint16_t GetPC() const;
+
+	void SetA(uint8_t Value);
+	void SetX(uint8_t Value);
+	void SetY(uint8_t Value);
+
+private:
+	uint8_t Fetch();
+	uint16_t Fetch16();
+	uint16_t Read16(uint16_t Address);
+	uint16_t Read16Bug(uint16_t Address);
+	void Push(uint8_t Value);
+	uint8_t Pop();
+	void Interrupt(uint16_t Vector, bool Break);
+
+	uint16_t AddrZeroPage(uint8_t Index);
+	uint16_t AddrAbsolute(uint8_t Index, bool Penalty);
+	uint16_t AddrIndirectX();
+	uint16_t AddrIndirectY(bool Penalty);
+
+	void SetNZ(uint8_t Value);
+	void SetFlag(uint8_t Flag, bool Set);
+	void Branch(bool Cond);
+	void Compare(uint8_t Reg, uint8_t Value);
+	void ADC(uint8_t Value);
+	uint8_t ASL(uint8_t Value);
+	uint8_t LSR(uint8_t Value);
+	uint8_t ROL(uint8_t Value);
+	uint8_t ROR(uint8_t Value);
+	void BIT(uint8_t Value);
+
+	template <typename F>
+	void Modify(uint16_t Address, F Op);
+
+private:
+	ICPUBus &m_Bus;
+
+	uint16_t m_iPC;
+	uint8_t m_iA;
+	uint8_t m_iX;
+	uint8_t m_iY;
+	uint8_t m_iSP;
+	uint8_t m_iP;
+
+	uint64_t m_iCycles;
+	unsigned int m_iExtraCycles;
+	bool m_bHalted;
+};
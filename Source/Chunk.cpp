@@ -20,28 +20,65 @@
 
 #include <map>
 #include "stdafx.h"
+#include <algorithm>		// // //
 #include "chunk.h"
 
+/**
+ * CChunkLabelTable - Interns typed chunk labels
+ *
+ */
+
+int CChunkLabelTable::Intern(chunk_label_t Kind, int A, int B, int C)
+{
+	ASSERT(A >= 0 && A < 0x10000 && B >= 0 && B < 0x10000 && C >= 0 && C < 0x10000);
+	const unsigned long long Key = (static_cast<unsigned long long>(Kind) << 48) |
+		(static_cast<unsigned long long>(A) << 32) | (static_cast<unsigned long long>(B) << 16) | C;
+
+	auto it = m_mLabelIDs.find(Key);
+	if (it != m_mLabelIDs.end())
+		return it->second;
+
+	const int ID = static_cast<int>(m_vLabels.size());
+	m_vLabels.push_back({Kind, {A, B, C}});
+	m_mLabelIDs.emplace(Key, ID);
+	return ID;
+}
+
+const stChunkLabel &CChunkLabelTable::GetLabel(int ID) const
+{
+	return m_vLabels[ID];
+}
+
+int CChunkLabelTable::GetCount() const
+{
+	return static_cast<int>(m_vLabels.size());
+}
+
+void CChunkLabelTable::Clear()
+{
+	m_mLabelIDs.clear();
+	m_vLabels.clear();
+}
+
 /**
  * CChunk - Stores NSF data
  *
  */
 
-CChunk::CChunk(chunk_type_t Type, CStringA label) : m_iType(Type), m_strLabel(label), m_iBank(0)
+CChunk::CChunk(chunk_type_t Type, int Label, CChunkLabelTable &Labels) :		// // //
+	m_Labels(Labels), m_iLabel(Label), m_iBank(0), m_iType(Type)
 {
 }
 
 CChunk::~CChunk()
 {
-	Clear();
 }
 
 void CChunk::Clear()
 {
-	for (auto x : m_vChunkData)
-		delete x;
-
-	m_vChunkData.clear();
+	m_vData.clear();		// // //
+	m_vItems.clear();
+	m_vFixups.clear();
 }
 
 chunk_type_t CChunk::GetType() const
@@ -49,9 +86,9 @@ chunk_type_t CChunk::GetType() const
 	return m_iType;
 }
 
-LPCSTR CChunk::GetLabel() const
+int CChunk::GetLabelID() const		// // //
 {
-	return m_strLabel;
+	return m_iLabel;
 }
 
 void CChunk::SetBank(unsigned char Bank)
@@ -67,107 +104,140 @@ unsigned char CChunk::GetBank() const
 int CChunk::GetLength() const
 {
 	// Return number of data items in the collection
-	return m_vChunkData.size();
+	return m_vItems.size();
 }
 
 unsigned short CChunk::GetData(int index) const
 {
-	return m_vChunkData[index]->GetData();
+	const stChunkItem &Item = m_vItems[index];		// // //
+	switch (Item.Type) {
+	case CHUNK_DATA_BYTE: case CHUNK_DATA_BANK:
+		return m_vData[Item.Offset];
+	case CHUNK_DATA_WORD: case CHUNK_DATA_REFERENCE:
+		return m_vData[Item.Offset] | (m_vData[Item.Offset + 1] << 8);
+	default:
+		return 0;	// Invalid for strings
+	}
+}
+
+unsigned int CChunk::GetDataSize(int index) const
+{
+	const unsigned int End = (index + 1 < (int)m_vItems.size()) ? m_vItems[index + 1].Offset : m_vData.size();		// // //
+	return End - m_vItems[index].Offset;
 }
 
-unsigned short CChunk::GetDataSize(int index) const
+void CChunk::AddFixup(int Label)		// // //
 {
-	return m_vChunkData[index]->GetSize();
+	m_vFixups.push_back({static_cast<int>(m_vItems.size()) - 1, Label});
+}
+
+const CChunk::stChunkFixup *CChunk::FindFixup(int index) const		// // //
+{
+	auto it = std::lower_bound(m_vFixups.begin(), m_vFixups.end(), index, [] (const stChunkFixup &a, int b) {
+		return a.Item < b;
+	});
+	return it != m_vFixups.end() && it->Item == index ? &*it : nullptr;
 }
 
 void CChunk::StoreByte(unsigned char data)
 {
-	m_vChunkData.push_back(new CChunkDataByte(data));
+	m_vItems.push_back({static_cast<unsigned int>(m_vData.size()), CHUNK_DATA_BYTE});		// // //
+	m_vData.push_back(data);
 }
 
 void CChunk::StoreWord(unsigned short data)
 {
-	m_vChunkData.push_back(new CChunkDataWord(data));
+	m_vItems.push_back({static_cast<unsigned int>(m_vData.size()), CHUNK_DATA_WORD});		// // //
+	m_vData.push_back(data & 0xFF);
+	m_vData.push_back(data >> 8);
 }
 
-void CChunk::StoreReference(CStringA refName)
+void CChunk::StoreReference(chunk_label_t Kind, int A, int B, int C)
 {
-	m_vChunkData.push_back(new CChunkDataReference(refName));
+	// // // Unresolved references read as $FFFF until labels are assigned
+	m_vItems.push_back({static_cast<unsigned int>(m_vData.size()), CHUNK_DATA_REFERENCE});
+	m_vData.push_back(0xFF);
+	m_vData.push_back(0xFF);
+	AddFixup(m_Labels.Intern(Kind, A, B, C));
 }
 
-void CChunk::StoreBankReference(CStringA refName, int bank)
+void CChunk::StoreBankReference(int Label, int bank)
 {
-	m_vChunkData.push_back(new CChunkDataBank(refName, bank));
+	m_vItems.push_back({static_cast<unsigned int>(m_vData.size()), CHUNK_DATA_BANK});		// // //
+	m_vData.push_back(static_cast<unsigned char>(bank));
+	AddFixup(Label);
 }
 
 void CChunk::StoreString(const std::vector<char> &data)
 {
-	m_vChunkData.push_back(new CChunkDataString(data));
+	m_vItems.push_back({static_cast<unsigned int>(m_vData.size()), CHUNK_DATA_STRING});		// // //
+	m_vData.insert(m_vData.end(), data.begin(), data.end());
 }
 
 void CChunk::ChangeByte(int index, unsigned char data)
 {
-	ASSERT(index < (int)m_vChunkData.size());
-	static_cast<CChunkDataByte*>(m_vChunkData[index])->m_data = data;
+	ASSERT(index < (int)m_vItems.size() && m_vItems[index].Type == CHUNK_DATA_BYTE);		// // //
+	m_vData[m_vItems[index].Offset] = data;
 }
 
 void CChunk::SetupBankData(int index, unsigned char bank)
 {
-	ASSERT(index < (int)m_vChunkData.size());
-	static_cast<CChunkDataBank*>(m_vChunkData[index])->m_bank = bank;
+	ASSERT(index < (int)m_vItems.size() && m_vItems[index].Type == CHUNK_DATA_BANK);		// // //
+	m_vData[m_vItems[index].Offset] = bank;
 }
 
 unsigned char CChunk::GetStringData(int index, int pos) const
 {
-	return static_cast<CChunkDataString*>(m_vChunkData[index])->m_vData[pos];
+	return m_vData[m_vItems[index].Offset + pos];		// // //
 }
 
-const std::vector<char> &CChunk::GetStringData(int index) const
+const char *CChunk::GetStringData(int index) const		// // //
 {
-	return (static_cast<CChunkDataString*>(m_vChunkData[index]))->m_vData;
+	return reinterpret_cast<const char*>(m_vData.data() + m_vItems[index].Offset);
 }
 
-LPCSTR CChunk::GetDataRefName(int index) const
-{	
-	CChunkDataReference *pChunkData = dynamic_cast<CChunkDataReference*>(m_vChunkData[index]);
+const unsigned char *CChunk::GetBinaryData() const		// // //
+{
+	return m_vData.data();
+}
 
-	if (pChunkData != NULL)
-		return pChunkData->m_refName;
+int CChunk::GetDataRefID(int index) const		// // //
+{
+	if (m_vItems[index].Type == CHUNK_DATA_REFERENCE)
+		return FindFixup(index)->Label;
 
-	return "";
+	return -1;
 }
 
-void CChunk::UpdateDataRefName(int index, CStringA &name)
+void CChunk::UpdateDataRef(int index, int Label)		// // //
 {
-	CChunkDataReference *pChunkData = dynamic_cast<CChunkDataReference*>(m_vChunkData[index]);
-
-	if (pChunkData != NULL)
-		pChunkData->m_refName = name;
+	if (m_vItems[index].Type == CHUNK_DATA_REFERENCE)
+		const_cast<stChunkFixup*>(FindFixup(index))->Label = Label;
 }
 
 bool CChunk::IsDataReference(int index) const 
 {
-	return dynamic_cast<CChunkDataReference*>(m_vChunkData[index]) != NULL;
+	return m_vItems[index].Type == CHUNK_DATA_REFERENCE;		// // //
 }
 
 bool CChunk::IsDataBank(int index) const
 {
-	return dynamic_cast<CChunkDataBank*>(m_vChunkData[index]) != NULL;
+	return m_vItems[index].Type == CHUNK_DATA_BANK;		// // //
 }
 
 unsigned int CChunk::CountDataSize() const
 {
-	// Count sizes of all data items
-	int Size = 0;
-
-	for (const auto pChunk : m_vChunkData)
-		Size += pChunk->GetSize();
-
-	return Size;
+	return m_vData.size();		// // //
 }
 
-void CChunk::AssignLabels(CMap<CStringA, LPCSTR, int, int> &labelMap)
+void CChunk::AssignLabels(const std::vector<int> &Addresses)		// // //
 {
-	for (auto x : m_vChunkData) if (auto pChunkData = dynamic_cast<CChunkDataReference*>(x))
-		pChunkData->ref = labelMap[pChunkData->m_refName];
+	for (const auto &Fixup : m_vFixups) {
+		const stChunkItem &Item = m_vItems[Fixup.Item];
+		if (Item.Type == CHUNK_DATA_REFERENCE) {
+			const int Address = Fixup.Label < (int)Addresses.size() ? Addresses[Fixup.Label] : 0;
+			m_vData[Item.Offset] = Address & 0xFF;
+			m_vData[Item.Offset + 1] = (Address >> 8) & 0xFF;
+		}
+	}
 }
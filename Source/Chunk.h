@@ -24,70 +24,66 @@
 
 // std::vector is required by this header file
 #include <vector>		// // //
+#include <unordered_map>		// // //
 
 
 // Helper classes/objects for NSF compiling
 
-//
-// Chunk data classes
-//
-
-class CChunkData
-{
-public:
-	CChunkData() {}
-	virtual ~CChunkData() {}
-	virtual int GetSize() const = 0;
-	virtual unsigned short GetData() const = 0;
+// // // Label kinds, names are only formatted by the text renderer
+
+enum chunk_label_t {
+	CHUNK_LABEL_NONE,
+	CHUNK_LABEL_SONG_LIST,
+	CHUNK_LABEL_INSTRUMENT_LIST,
+	CHUNK_LABEL_SAMPLES_LIST,
+	CHUNK_LABEL_SAMPLES,
+	CHUNK_LABEL_GROOVE_LIST,
+	CHUNK_LABEL_GROOVE,				// Groove index
+	CHUNK_LABEL_WAVETABLE,
+	CHUNK_LABEL_SAMPLE,				// Sample index
+	CHUNK_LABEL_WAVES,				// Instrument index
+	CHUNK_LABEL_SEQ_2A03,			// Sequence index
+	CHUNK_LABEL_SEQ_VRC6,			// Sequence index
+	CHUNK_LABEL_SEQ_FDS,			// Sequence index
+	CHUNK_LABEL_SEQ_N163,			// Sequence index
+	CHUNK_LABEL_SEQ_S5B,			// Sequence index
+	CHUNK_LABEL_INSTRUMENT,			// Instrument index
+	CHUNK_LABEL_SONG,				// Track
+	CHUNK_LABEL_SONG_FRAMES,		// Track
+	CHUNK_LABEL_SONG_FRAME,			// Track, frame
+	CHUNK_LABEL_PATTERN,			// Track, pattern, channel
+	CHUNK_LABEL_COUNT
 };
 
-class CChunkDataByte : public CChunkData
-{
-public:
-	CChunkDataByte(unsigned char data) : CChunkData(), m_data(data) {}
-	int GetSize() const { return 1; }
-	unsigned short GetData() const { return m_data; };
-	unsigned char m_data;
+struct stChunkLabel {
+	chunk_label_t Kind;
+	int Args[3];
 };
 
-class CChunkDataWord : public CChunkData
-{
-public:
-	CChunkDataWord(unsigned short data) : CChunkData(), m_data(data) {}
-	int GetSize() const { return 2; }
-	unsigned short GetData() const { return m_data; };
-	unsigned short m_data;
-};
+// // // Symbol table, assigns a dense integer ID to each chunk label
 
-class CChunkDataReference : public CChunkData
+class CChunkLabelTable
 {
 public:
-	CChunkDataReference(CStringA refName) : CChunkData(), m_refName(refName), ref(-1) {}
-	int GetSize() const { return 2; }
-	unsigned short GetData() const { return ref; };
-	CStringA m_refName;
-	unsigned short ref;
-};
+	int				Intern(chunk_label_t Kind, int A = 0, int B = 0, int C = 0);
+	const stChunkLabel &GetLabel(int ID) const;
+	int				GetCount() const;
+	void			Clear();
 
-class CChunkDataBank : public CChunkData
-{
-public:
-	CChunkDataBank(CStringA bankOf, int bank) : CChunkData(), m_bankOf(bankOf), m_bank(bank) {}
-	int GetSize() const { return 1; }
-	unsigned short GetData() const { return m_bank; };
-	CStringA m_bankOf;	// Reference to a label which belongs to the bank this data should point to
-	unsigned int m_bank;
+private:
+	std::unordered_map<unsigned long long, int> m_mLabelIDs;		// Keyed by packed kind and arguments
+	std::vector<stChunkLabel> m_vLabels;
 };
 
-class CChunkDataString : public CChunkData
-{
-public:
-	CChunkDataString(const std::vector<char> &data) : CChunkData(), m_vData(data) {}
-	int GetSize() const { return m_vData.size(); }
-	unsigned short GetData() const { return 0; };	// Invalid for this type
-	std::vector<char> m_vData;
-};
+// // // Chunk data item types
 
+enum chunk_data_t {
+	CHUNK_DATA_BYTE,
+	CHUNK_DATA_WORD,
+	CHUNK_DATA_REFERENCE,		// Word containing the address of a label
+	CHUNK_DATA_BANK,			// Byte containing the bank of a label
+	CHUNK_DATA_STRING
+};
 
 enum chunk_type_t { 
 	CHUNK_HEADER,
@@ -116,47 +112,66 @@ enum chunk_type_t {
 class CChunk
 {
 public:
-	CChunk(chunk_type_t Type, CStringA label);
+	CChunk(chunk_type_t Type, int Label, CChunkLabelTable &Labels);		// // //
 	~CChunk();
 
 	void			Clear();
 
 	chunk_type_t	GetType() const;
-	LPCSTR			GetLabel() const;
+	int				GetLabelID() const;		// // //
 	void			SetBank(unsigned char Bank);
 	unsigned char	GetBank() const;
 
 	int				GetLength() const;
 	unsigned short	GetData(int index) const;
-	unsigned short	GetDataSize(int index) const;
+	unsigned int	GetDataSize(int index) const;		// // //
 
 	void			StoreByte(unsigned char data);
 	void			StoreWord(unsigned short data);
-	void			StoreReference(CStringA refName);
-	void			StoreBankReference(CStringA refName, int bank);
+	void			StoreReference(chunk_label_t Kind, int A = 0, int B = 0, int C = 0);		// // //
+	void			StoreBankReference(int Label, int bank);		// // //
 	void			StoreString(const std::vector<char> &data);
 
 	void			ChangeByte(int index, unsigned char data);
 	void			SetupBankData(int index, unsigned char bank);
 
 	unsigned char	GetStringData(int index, int pos) const;
-	LPCSTR			GetDataRefName(int index) const;
+	int				GetDataRefID(int index) const;		// // //
 	
 	bool			IsDataReference(int index) const;
 	bool			IsDataBank(int index) const;
 
-	const std::vector<char> &GetStringData(int index) const;
+	const char		*GetStringData(int index) const;		// // //
+	const unsigned char *GetBinaryData() const;		// // //
 
-	void			UpdateDataRefName(int index, CStringA &name);
+	void			UpdateDataRef(int index, int Label);		// // //
 
 	unsigned int	CountDataSize() const;
 
-	void			AssignLabels(CMap<CStringA, LPCSTR, int, int> &labelMap);
+	void			AssignLabels(const std::vector<int> &Addresses);		// // // indexed by label ID
+
+private:
+	// // // Items refer to offsets in the byte buffer, labels are stored in a separate fix-up table
+	struct stChunkItem {
+		unsigned int Offset;
+		chunk_data_t Type;
+	};
+
+	struct stChunkFixup {
+		int Item;		// Index of the reference or bank item
+		int Label;		// Label ID of the referenced chunk
+	};
+
+	void			AddFixup(int Label);
+	const stChunkFixup *FindFixup(int index) const;
 
 private:
-	std::vector<CChunkData*> m_vChunkData;	// List of data stored in this chunk
+	std::vector<unsigned char> m_vData;		// // // Contiguous binary contents of this chunk
+	std::vector<stChunkItem> m_vItems;		// // //
+	std::vector<stChunkFixup> m_vFixups;	// // // Sorted by item index
 
-	CStringA m_strLabel;		// Label of this chunk
+	CChunkLabelTable &m_Labels;		// // //
+	int m_iLabel;				// Label of this chunk
 	unsigned char m_iBank;		// The bank this chunk will be stored in
 	chunk_type_t m_iType;		// Chunk type
 };
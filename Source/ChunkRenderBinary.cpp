@@ -81,17 +81,8 @@ void CChunkRenderBinary::StoreSamples(const std::vector<const CDSample*> &Sample
 
 void CChunkRenderBinary::StoreChunk(CChunk *pChunk)
 {
-	for (int i = 0; i < pChunk->GetLength(); ++i) {
-		if (pChunk->GetType() == CHUNK_PATTERN) {
-			const std::vector<char> &vec = pChunk->GetStringData(CCompiler::PATTERN_CHUNK_INDEX);
-			Store(&vec.front(), vec.size());
-		}
-		else {
-			unsigned short data = pChunk->GetData(i);
-			unsigned short size = pChunk->GetDataSize(i);
-			Store(&data, size);
-		}
-	}
+	// // // Chunks are stored contiguously with resolved labels
+	Store(pChunk->GetBinaryData(), pChunk->CountDataSize());
 }
 
 void CChunkRenderBinary::StoreSample(const CDSample *pDSample)
@@ -180,7 +171,7 @@ void CChunkRenderNSF::StoreSampleBankswitched(const CDSample *pDSample)
 {
 	unsigned int SampleSize = pDSample->GetSize();
 
-	if (m_iSampleAddr + SampleSize >= (unsigned)CCompiler::DPCM_SWITCH_ADDRESS) {
+	if (m_iSampleAddr + SampleSize >= (unsigned)CCompiler::DPCM_SWITCH_ADDRESS) {		// // // same rule as CSamplePacker
 		// Allocate new bank
 		if (GetRemainingSize() != 0x1000)	// Skip if already on beginning of new bank
 			AllocateNewBank();
@@ -215,17 +206,7 @@ void CChunkRenderNSF::StoreChunkBankswitched(const CChunk *pChunk)
 
 void CChunkRenderNSF::StoreChunk(const CChunk *pChunk)
 {
-	for (int i = 0; i < pChunk->GetLength(); ++i) {
-		if (pChunk->GetType() == CHUNK_PATTERN) {
-			const std::vector<char> &vec = pChunk->GetStringData(CCompiler::PATTERN_CHUNK_INDEX);
-			Store(&vec.front(), vec.size());			
-		}
-		else {
-			unsigned short data = pChunk->GetData(i);
-			unsigned short size = pChunk->GetDataSize(i);
-			Store(&data, size);
-		}
-	}
+	Store(pChunk->GetBinaryData(), pChunk->CountDataSize());		// // //
 }
 
 int CChunkRenderNSF::GetRemainingSize() const
@@ -20,6 +20,7 @@
 ** must bear this legend.
 */
 
+#include <algorithm>		// // //
 #include <map>
 #include <vector>
 #include "stdafx.h"
@@ -77,56 +78,89 @@ const stChunkRenderFunc CChunkRenderText::RENDER_FUNCTIONS[] = {
 	{CHUNK_WAVES,			&CChunkRenderText::StoreWavesChunk}
 };
 
-CChunkRenderText::CChunkRenderText(CFile *pFile) : m_pFile(pFile)
+// // // Label formats indexed by chunk_label_t
+const char *const CChunkRenderText::LABEL_FORMATS[] = {
+	"",
+	LABEL_SONG_LIST,
+	LABEL_INSTRUMENT_LIST,
+	LABEL_SAMPLES_LIST,
+	LABEL_SAMPLES,
+	LABEL_GROOVE_LIST,
+	LABEL_GROOVE,
+	LABEL_WAVETABLE,
+	LABEL_SAMPLE,
+	LABEL_WAVES,
+	LABEL_SEQ_2A03,
+	LABEL_SEQ_VRC6,
+	LABEL_SEQ_FDS,
+	LABEL_SEQ_N163,
+	LABEL_SEQ_S5B,
+	LABEL_INSTRUMENT,
+	LABEL_SONG,
+	LABEL_SONG_FRAMES,
+	LABEL_SONG_FRAME,
+	LABEL_PATTERN,
+};
+
+CChunkRenderText::CChunkRenderText(CFile *pFile, const CChunkLabelTable &Labels) :		// // //
+	m_Writer([pFile] (const char *pData, std::size_t Size) { pFile->Write(pData, static_cast<UINT>(Size)); })
 {
+	static_assert(sizeof(LABEL_FORMATS) / sizeof(*LABEL_FORMATS) == CHUNK_LABEL_COUNT, "Missing label format");
+
+	// Label names are only needed for the assembly output
+	m_vLabelNames.resize(Labels.GetCount());
+	for (int i = 0; i < Labels.GetCount(); ++i) {
+		const stChunkLabel &Label = Labels.GetLabel(i);
+		m_vLabelNames[i].Format(LABEL_FORMATS[Label.Kind], Label.Args[0], Label.Args[1], Label.Args[2]);
+	}
 }
 
 void CChunkRenderText::StoreChunks(const std::vector<CChunk*> &Chunks)
 {
-	// Generate strings
-	for (const auto pChunk : Chunks)
-		for (int j = 0; j < sizeof(RENDER_FUNCTIONS) / sizeof(stChunkRenderFunc); ++j)
-			if (pChunk->GetType() == RENDER_FUNCTIONS[j].type)
-				CALL_MEMBER_FN(this, RENDER_FUNCTIONS[j].function)(pChunk, m_pFile);
-
-	// Write strings to file
-	WriteFileString(CStringA("; " APP_NAME " exported music data: "), m_pFile);
-	WriteFileString(CFamiTrackerDoc::GetDoc()->GetTitle(), m_pFile);
-	WriteFileString(CStringA("\n;\n\n"), m_pFile);
+	// // // Chunks are written one section at a time, in the order they appear in each section
+	m_Writer.Write("; " APP_NAME " exported music data: ");
+	m_Writer.Write(CStringA(CFamiTrackerDoc::GetDoc()->GetTitle()));
+	m_Writer.Write("\n;\n\n");
 
 	// Module header
-	DumpStrings(CStringA("; Module header\n"), CStringA("\n"), m_headerStrings, m_pFile);
+	DumpChunks("; Module header\n", "\n", Chunks, {CHUNK_HEADER});
 
 	// Instrument list
-	DumpStrings(CStringA("; Instrument pointer list\n"), CStringA("\n"), m_instrumentListStrings, m_pFile);
-	DumpStrings(CStringA("; Instruments\n"), CStringA(""), m_instrumentStrings, m_pFile);
+	DumpChunks("; Instrument pointer list\n", "\n", Chunks, {CHUNK_INSTRUMENT_LIST});
+	DumpChunks("; Instruments\n", "", Chunks, {CHUNK_INSTRUMENT});
 
 	// Sequences
-	DumpStrings(CStringA("; Sequences\n"), CStringA("\n"), m_sequenceStrings, m_pFile);
+	DumpChunks("; Sequences\n", "\n", Chunks, {CHUNK_SEQUENCE});
 
 	// Waves (FDS & N163)
-	if (m_wavetableStrings.IsEmpty() == FALSE) {
-		DumpStrings(CStringA("; FDS waves\n"), CStringA("\n"), m_wavetableStrings, m_pFile);
+	const auto HasChunk = [&Chunks] (chunk_type_t Type) {
+		return std::any_of(Chunks.begin(), Chunks.end(), [Type] (const CChunk *pChunk) { return pChunk->GetType() == Type; });
+	};
+
+	if (HasChunk(CHUNK_WAVETABLE)) {
+		DumpChunks("; FDS waves\n", "\n", Chunks, {CHUNK_WAVETABLE});
 	}
 
-	if (m_wavesStrings.IsEmpty() == FALSE) {
-		DumpStrings(CStringA("; N163 waves\n"), CStringA("\n"), m_wavesStrings, m_pFile);
+	if (HasChunk(CHUNK_WAVES)) {
+		DumpChunks("; N163 waves\n", "\n", Chunks, {CHUNK_WAVES});
 	}
 
 	// Samples
-	DumpStrings(CStringA("; DPCM instrument list (pitch, sample index)\n"), CStringA("\n"), m_sampleListStrings, m_pFile);
-	DumpStrings(CStringA("; DPCM samples list (location, size, bank)\n"), CStringA("\n"), m_samplePointersStrings, m_pFile);
+	DumpChunks("; DPCM instrument list (pitch, sample index)\n", "\n", Chunks, {CHUNK_SAMPLE_LIST});
+	DumpChunks("; DPCM samples list (location, size, bank)\n", "\n", Chunks, {CHUNK_SAMPLE_POINTERS});
 
 	// // // Grooves
-	DumpStrings(CStringA("; Groove list\n"), CStringA(""), m_grooveListStrings, m_pFile);
-	DumpStrings(CStringA("; Grooves (size, terms)\n"), CStringA("\n"), m_grooveStrings, m_pFile);
+	DumpChunks("; Groove list\n", "", Chunks, {CHUNK_GROOVE_LIST});
+	DumpChunks("; Grooves (size, terms)\n", "\n", Chunks, {CHUNK_GROOVE});
 
 	// Songs
-	DumpStrings(CStringA("; Song pointer list\n"), CStringA("\n"), m_songListStrings, m_pFile);
-	DumpStrings(CStringA("; Song info\n"), CStringA("\n"), m_songStrings, m_pFile);
+	DumpChunks("; Song pointer list\n", "\n", Chunks, {CHUNK_SONG_LIST});
+	DumpChunks("; Song info\n", "\n", Chunks, {CHUNK_SONG});
 
 	// Song data
-	DumpStrings(CStringA(";\n; Pattern and frame data for all songs below\n;\n\n"), CStringA(""), m_songDataStrings, m_pFile);
+	DumpChunks(";\n; Pattern and frame data for all songs below\n;\n\n", "", Chunks, {CHUNK_FRAME_LIST, CHUNK_FRAME, CHUNK_PATTERN});
+
+	m_Writer.Flush();
 
 	// Actual DPCM samples are stored later
 }
@@ -134,13 +168,10 @@ void CChunkRenderText::StoreChunks(const std::vector<CChunk*> &Chunks)
 void CChunkRenderText::StoreSamples(const std::vector<const CDSample*> &Samples)
 {
 	// Store DPCM samples in file, assembly format
-	CStringA str;
-	str.Format("\n; DPCM samples (located at DPCM segment)\n");
-	WriteFileString(str, m_pFile);
+	m_Writer.Write("\n; DPCM samples (located at DPCM segment)\n");
 
 	if (Samples.size() > 0) {
-		str.Format("\n\t.segment \"DPCM\"\n");
-		WriteFileString(str, m_pFile);
+		m_Writer.Write("\n\t.segment \"DPCM\"\n");
 	}
 
 	unsigned int Address = CCompiler::PAGE_SAMPLES;
@@ -150,360 +181,297 @@ void CChunkRenderText::StoreSamples(const std::vector<const CDSample*> &Samples)
 		
 		CStringA label;
 		label.Format(LABEL_SAMPLE, i);		// // //
-		str.Format("%s: ; %s\n", LPCSTR(label), pDSample->GetName());
-		StoreByteString(pData, SampleSize, str, DEFAULT_LINE_BREAK);
+		m_Writer.Write(label);
+		m_Writer.Write(": ; ");
+		m_Writer.Write(pDSample->GetName());
+		m_Writer.Write('\n');
+		m_Writer.WriteByteList(reinterpret_cast<const unsigned char*>(pData), SampleSize, DEFAULT_LINE_BREAK);
 		Address += SampleSize;
 
 		// Adjust if necessary
 		if ((Address & 0x3F) > 0) {
 			int PadSize = 0x40 - (Address & 0x3F);
 			Address	+= PadSize;
-			str.Append("\n\t.align 64\n");
+			m_Writer.Write("\n\t.align 64\n");
 		}
 
-		str.Append("\n");
-		WriteFileString(str, m_pFile);
+		m_Writer.Write('\n');
 	}
+
+	m_Writer.Flush();
 }
 
-void CChunkRenderText::DumpStrings(const CStringA &preStr, const CStringA &postStr, CStringArray &stringArray, CFile *pFile) const
+void CChunkRenderText::DumpChunks(const char *preStr, const char *postStr, const std::vector<CChunk*> &Chunks, std::initializer_list<chunk_type_t> Types)		// // //
 {
-	WriteFileString(preStr, pFile);
+	m_Writer.Write(preStr);
 
-	for (int i = 0; i < stringArray.GetCount(); ++i) {
-		WriteFileString(stringArray[i], pFile);
-	}
+	for (const auto pChunk : Chunks)
+		if (std::find(Types.begin(), Types.end(), pChunk->GetType()) != Types.end())
+			for (const auto &x : RENDER_FUNCTIONS)
+				if (pChunk->GetType() == x.type)
+					CALL_MEMBER_FN(this, x.function)(pChunk);
 
-	WriteFileString(postStr, pFile);
+	m_Writer.Write(postStr);
 }
 
-void CChunkRenderText::StoreHeaderChunk(CChunk *pChunk, CFile *pFile)
+void CChunkRenderText::StoreHeaderChunk(const CChunk *pChunk)
 {
-	CStringA str;
-	int len = pChunk->GetLength();
 	int i = 0;
 
-	str.AppendFormat("\t.word %s\n", pChunk->GetDataRefName(i++));
-	str.AppendFormat("\t.word %s\n", pChunk->GetDataRefName(i++));
-	str.AppendFormat("\t.word %s\n", pChunk->GetDataRefName(i++));
-	str.AppendFormat("\t.word %s\n", pChunk->GetDataRefName(i++));
-	str.AppendFormat("\t.word %s\n", pChunk->GetDataRefName(i++));		// // // Groove
-	str.AppendFormat("\t.byte %i ; flags\n", pChunk->GetData(i++));
-	if (pChunk->IsDataReference(i))
-		str.AppendFormat("\t.word %s\n", pChunk->GetDataRefName(i++));	// FDS waves
-	str.AppendFormat("\t.word %i ; NTSC speed\n", pChunk->GetData(i++));
-	str.AppendFormat("\t.word %i ; PAL speed\n", pChunk->GetData(i++));
-	if (i < pChunk->GetLength())
-		str.AppendFormat("\t.word %i ; N163 channels\n", pChunk->GetData(i++));	// N163 channels
-
-	m_headerStrings.Add(str);
+	m_Writer.Write("\t.word ");
+	m_Writer.Write(GetDataRefName(pChunk, i++));
+	m_Writer.Write("\n\t.word ");
+	m_Writer.Write(GetDataRefName(pChunk, i++));
+	m_Writer.Write("\n\t.word ");
+	m_Writer.Write(GetDataRefName(pChunk, i++));
+	m_Writer.Write("\n\t.word ");
+	m_Writer.Write(GetDataRefName(pChunk, i++));
+	m_Writer.Write("\n\t.word ");
+	m_Writer.Write(GetDataRefName(pChunk, i++));		// // // Groove
+	m_Writer.Write("\n\t.byte ");
+	m_Writer.WriteDec(pChunk->GetData(i++));
+	m_Writer.Write(" ; flags\n");
+	if (pChunk->IsDataReference(i)) {
+		m_Writer.Write("\t.word ");
+		m_Writer.Write(GetDataRefName(pChunk, i++));	// FDS waves
+		m_Writer.Write('\n');
+	}
+	m_Writer.Write("\t.word ");
+	m_Writer.WriteDec(pChunk->GetData(i++));
+	m_Writer.Write(" ; NTSC speed\n\t.word ");
+	m_Writer.WriteDec(pChunk->GetData(i++));
+	m_Writer.Write(" ; PAL speed\n");
+	if (i < pChunk->GetLength()) {
+		m_Writer.Write("\t.word ");
+		m_Writer.WriteDec(pChunk->GetData(i++));	// N163 channels
+		m_Writer.Write(" ; N163 channels\n");
+	}
 }
 
-void CChunkRenderText::StoreInstrumentListChunk(CChunk *pChunk, CFile *pFile)
+void CChunkRenderText::StoreInstrumentListChunk(const CChunk *pChunk)
 {
-	CString str;
-
 	// Store instrument pointers
-	str.Format(_T("%s:\n"), pChunk->GetLabel());
-
-	for (int i = 0; i < pChunk->GetLength(); ++i) {
-		str.AppendFormat(_T("\t.word %s\n"), pChunk->GetDataRefName(i));
-	}
-
-	m_instrumentListStrings.Add(str);
+	WriteLabel(pChunk);
+	WriteDataRefs(pChunk);
 }
 
-void CChunkRenderText::StoreInstrumentChunk(CChunk *pChunk, CFile *pFile)
+void CChunkRenderText::StoreInstrumentChunk(const CChunk *pChunk)
 {
-	CStringA str;
 	int len = pChunk->GetLength();
 
-	str.Format("%s:\n\t.byte %i\n", pChunk->GetLabel(), pChunk->GetData(0));
+	WriteLabel(pChunk);
+	m_Writer.Write("\t.byte ");
+	m_Writer.WriteDec(pChunk->GetData(0));
+	m_Writer.Write('\n');
 
 	for (int i = 1; i < len; ++i) {
 		if (pChunk->IsDataReference(i)) {
-			str.AppendFormat("\t.word %s\n", pChunk->GetDataRefName(i));
+			m_Writer.Write("\t.word ");
+			m_Writer.Write(GetDataRefName(pChunk, i));
 		}
 		else {
 			if (pChunk->GetDataSize(i) == 1) {
-				str.AppendFormat("\t.byte $%02X\n", pChunk->GetData(i));
+				m_Writer.Write("\t.byte $");
+				m_Writer.WriteHex(pChunk->GetData(i), 2);
 			}
 			else {
-				str.AppendFormat("\t.word $%04X\n", pChunk->GetData(i));
+				m_Writer.Write("\t.word $");
+				m_Writer.WriteHex(pChunk->GetData(i), 4);
 			}
 		}
+		m_Writer.Write('\n');
 	}
 
-	str.Append("\n");
-
-	m_instrumentStrings.Add(str);
+	m_Writer.Write('\n');
 }
 
-void CChunkRenderText::StoreSequenceChunk(CChunk *pChunk, CFile *pFile)
+void CChunkRenderText::StoreSequenceChunk(const CChunk *pChunk)
 {
-	CStringA str;
-
-	str.Format("%s:\n", pChunk->GetLabel());
-	StoreByteString(pChunk, str, DEFAULT_LINE_BREAK);
-
-	m_sequenceStrings.Add(str);
+	WriteLabel(pChunk);
+	WriteByteString(pChunk, DEFAULT_LINE_BREAK);
 }
 
-void CChunkRenderText::StoreSampleListChunk(CChunk *pChunk, CFile *pFile)
+void CChunkRenderText::StoreSampleListChunk(const CChunk *pChunk)
 {
-	CStringA str;
-
 	// Store sample list
-	str.Format("%s:\n", pChunk->GetLabel());
+	WriteLabel(pChunk);
 
 	for (int i = 0; i < pChunk->GetLength(); i += 3) {
-		str.AppendFormat("\t.byte %i, %i, %i\n", pChunk->GetData(i + 0), pChunk->GetData(i + 1), pChunk->GetData(i + 2));
+		m_Writer.Write("\t.byte ");
+		m_Writer.WriteDec(pChunk->GetData(i + 0));
+		m_Writer.Write(", ");
+		m_Writer.WriteDec(pChunk->GetData(i + 1));
+		m_Writer.Write(", ");
+		m_Writer.WriteDec(pChunk->GetData(i + 2));
+		m_Writer.Write('\n');
 	}
-
-	m_sampleListStrings.Add(str);
 }
 
-void CChunkRenderText::StoreSamplePointersChunk(CChunk *pChunk, CFile *pFile)
+void CChunkRenderText::StoreSamplePointersChunk(const CChunk *pChunk)
 {
-	CStringA str;
 	int len = pChunk->GetLength();
 
 	// Store sample pointer
-	str.Format("%s:\n", pChunk->GetLabel());
+	WriteLabel(pChunk);
 
 	if (len > 0) {
-		str.Append("\t.byte ");
+		m_Writer.Write("\t.byte ");
 
-		int len = pChunk->GetLength();
 		for (int i = 0; i < len; ++i) {
-			str.AppendFormat("%i%s", pChunk->GetData(i), (i < len - 1) && (i % 3 != 2) ? ", " : "");
+			m_Writer.WriteDec(pChunk->GetData(i));
+			if ((i < len - 1) && (i % 3 != 2))
+				m_Writer.Write(", ");
 			if (i % 3 == 2 && i < (len - 1))
-				str.Append("\n\t.byte ");
+				m_Writer.Write("\n\t.byte ");
 		}
 	}
 
-	str.Append("\n");
-
-	m_samplePointersStrings.Add(str);
+	m_Writer.Write('\n');
 }
 
-void CChunkRenderText::StoreGrooveListChunk(CChunk *pChunk, CFile *pFile)		// // //
+void CChunkRenderText::StoreGrooveListChunk(const CChunk *pChunk)		// // //
 {
-	CStringA str;
-	
-	str.Format("%s:\n", pChunk->GetLabel());
+	WriteLabel(pChunk);
 	
 	for (int i = 0; i < pChunk->GetLength(); ++i) {
-		str.AppendFormat("\t.byte $%02X\n", pChunk->GetData(i));
+		m_Writer.Write("\t.byte $");
+		m_Writer.WriteHex(pChunk->GetData(i), 2);
+		m_Writer.Write('\n');
 	}
-
-	m_grooveListStrings.Add(str);
 }
 
-void CChunkRenderText::StoreGrooveChunk(CChunk *pChunk, CFile *pFile)		// // //
+void CChunkRenderText::StoreGrooveChunk(const CChunk *pChunk)		// // //
 {
-	CStringA str;
-	
-	// str.Format("%s:\n", pChunk->GetLabel());
-	StoreByteString(pChunk, str, DEFAULT_LINE_BREAK);
-
-	m_grooveStrings.Add(str);
+	// WriteLabel(pChunk);
+	WriteByteString(pChunk, DEFAULT_LINE_BREAK);
 }
 
-void CChunkRenderText::StoreSongListChunk(CChunk *pChunk, CFile *pFile)
+void CChunkRenderText::StoreSongListChunk(const CChunk *pChunk)
 {
-	CStringA str;
-
-	str.Format("%s:\n", pChunk->GetLabel());
-
-	for (int i = 0; i < pChunk->GetLength(); ++i) {
-		str.AppendFormat("\t.word %s\n", pChunk->GetDataRefName(i));
-	}
-
-	m_songListStrings.Add(str);
+	WriteLabel(pChunk);
+	WriteDataRefs(pChunk);
 }
 
-void CChunkRenderText::StoreSongChunk(CChunk *pChunk, CFile *pFile)
+void CChunkRenderText::StoreSongChunk(const CChunk *pChunk)
 {
-	CStringA str;
+	static const char *const FIELDS[] = {
+		"\t; frame count\n",
+		"\t; pattern length\n",
+		"\t; speed\n",
+		"\t; tempo\n",
+		"\t; groove position\n",		// // //
+		"\t; initial bank\n",
+	};
 
-	str.Format("%s:\n", pChunk->GetLabel());
+	WriteLabel(pChunk);
 
 	for (int i = 0; i < pChunk->GetLength();) {
-		str.AppendFormat("\t.word %s\n", pChunk->GetDataRefName(i++));
-		str.AppendFormat("\t.byte %i\t; frame count\n", pChunk->GetData(i++));
-		str.AppendFormat("\t.byte %i\t; pattern length\n", pChunk->GetData(i++));
-		str.AppendFormat("\t.byte %i\t; speed\n", pChunk->GetData(i++));
-		str.AppendFormat("\t.byte %i\t; tempo\n", pChunk->GetData(i++));
-		str.AppendFormat("\t.byte %i\t; groove position\n", pChunk->GetData(i++));		// // //
-		str.AppendFormat("\t.byte %i\t; initial bank\n", pChunk->GetData(i++));
+		m_Writer.Write("\t.word ");
+		m_Writer.Write(GetDataRefName(pChunk, i++));
+		m_Writer.Write('\n');
+		for (const char *pField : FIELDS) {
+			m_Writer.Write("\t.byte ");
+			m_Writer.WriteDec(pChunk->GetData(i++));
+			m_Writer.Write(pField);
+		}
 	}
 
-	str.Append("\n");
-
-	m_songStrings.Add(str);
+	m_Writer.Write('\n');
 }
 
-void CChunkRenderText::StoreFrameListChunk(CChunk *pChunk, CFile *pFile)
+void CChunkRenderText::StoreFrameListChunk(const CChunk *pChunk)
 {
-	CStringA str;
-
 	// Pointers to frames
-	str.Format("; Bank %i\n", pChunk->GetBank());
-	str.AppendFormat("%s:\n", pChunk->GetLabel());
-
-	for (int i = 0; i < pChunk->GetLength(); ++i) {
-		str.AppendFormat("\t.word %s\n", pChunk->GetDataRefName(i));
-	}
-
-	m_songDataStrings.Add(str);
+	m_Writer.Write("; Bank ");
+	m_Writer.WriteDec(pChunk->GetBank());
+	m_Writer.Write('\n');
+	WriteLabel(pChunk);
+	WriteDataRefs(pChunk);
 }
 
-void CChunkRenderText::StoreFrameChunk(CChunk *pChunk, CFile *pFile)
+void CChunkRenderText::StoreFrameChunk(const CChunk *pChunk)
 {
-	CStringA str;
 	int len = pChunk->GetLength();
 
 	// Frame list
-	str.Format("%s:\n\t.word ", pChunk->GetLabel());
+	WriteLabel(pChunk);
+	m_Writer.Write("\t.word ");
 
 	for (int i = 0, j = 0; i < len; ++i) {
-		if (pChunk->IsDataReference(i))
-			str.AppendFormat("%s%s", (j++ > 0) ? _T(", ") : _T(""), pChunk->GetDataRefName(i));
+		if (pChunk->IsDataReference(i)) {
+			if (j++ > 0)
+				m_Writer.Write(", ");
+			m_Writer.Write(GetDataRefName(pChunk, i));
+		}
 	}
 
 	// Bank values
 	for (int i = 0, j = 0; i < len; ++i) {
 		if (pChunk->IsDataBank(i)) {
-			if (j == 0) {
-				str.AppendFormat("\n\t.byte ", pChunk->GetLabel());
-			}
-			str.AppendFormat("%s$%02X", (j++ > 0) ? _T(", ") : _T(""), pChunk->GetData(i));
+			m_Writer.Write(j++ > 0 ? ", $" : "\n\t.byte $");
+			m_Writer.WriteHex(pChunk->GetData(i), 2);
 		}
 	}
 
-	str.Append("\n");
-
-	m_songDataStrings.Add(str);
+	m_Writer.Write('\n');
 }
 
-void CChunkRenderText::StorePatternChunk(CChunk *pChunk, CFile *pFile)
+void CChunkRenderText::StorePatternChunk(const CChunk *pChunk)
 {
-	CStringA str;
-	int len = pChunk->GetLength();
-
 	// Patterns
-	str.Format("; Bank %i\n", pChunk->GetBank());
-	str.AppendFormat("%s:\n", pChunk->GetLabel());
-
-	const std::vector<char> &vec = pChunk->GetStringData(0);
-	len = vec.size();
-
-	StoreByteString(&vec.front(), vec.size(), str, DEFAULT_LINE_BREAK);
-/*
-	for (int i = 0; i < len; ++i) {
-		str.AppendFormat("$%02X", (unsigned char)vec[i]);
-		if ((i % 20 == 19) && (i < len - 1))
-			str.Append("\n\t.byte ");
-		else {
-			if (i < len - 1)
-				str.Append(", ");
-		}
-	}
-*/
-	str.Append("\n");
-
-	m_songDataStrings.Add(str);
+	m_Writer.Write("; Bank ");
+	m_Writer.WriteDec(pChunk->GetBank());
+	m_Writer.Write('\n');
+	WriteLabel(pChunk);
+
+	const char *pData = pChunk->GetStringData(0);		// // //
+	m_Writer.WriteByteList(reinterpret_cast<const unsigned char*>(pData), pChunk->GetDataSize(0), DEFAULT_LINE_BREAK);
+	m_Writer.Write('\n');
 }
 
-void CChunkRenderText::StoreWavetableChunk(CChunk *pChunk, CFile *pFile)
+void CChunkRenderText::StoreWavetableChunk(const CChunk *pChunk)
 {
-	CStringA str;
-	int len = pChunk->GetLength();
-
 	// FDS waves
-	str.Format("%s:\n", pChunk->GetLabel());
-	str.Append("\t.byte ");
-
-	for (int i = 0; i < len; ++i) {
-		str.AppendFormat("$%02X", pChunk->GetData(i));
-		if ((i % 64 == 63) && (i < len - 1))
-			str.Append("\n\t.byte ");
-		else {
-			if (i < len - 1)
-				str.Append(", ");
-		}
-	}
-
-	str.Append("\n");
-
-	m_wavetableStrings.Add(str);
+	WriteLabel(pChunk);
+	WriteByteString(pChunk, 64);
 }
 
-void CChunkRenderText::StoreWavesChunk(CChunk *pChunk, CFile *pFile)
+void CChunkRenderText::StoreWavesChunk(const CChunk *pChunk)
 {
-	CStringA str;
-	int len = pChunk->GetLength();
-
-//				int waves = pChunk->GetData(0);
-	int wave_len = 16;//(len - 1) / waves;
-
 	// Namco waves
-	str.Format("%s:\n", pChunk->GetLabel());
-//				str.AppendFormat("\t.byte %i\n", waves);
-	
-	str.Append("\t.byte ");
-
-	for (int i = 0; i < len; ++i) {
-		str.AppendFormat("$%02X", pChunk->GetData(i));
-		if ((i % wave_len == (wave_len - 1)) && (i < len - 1))
-			str.Append("\n\t.byte ");
-		else {
-			if (i < len - 1)
-				str.Append(", ");
-		}
-	}
-
-	str.Append("\n");
-
-	m_wavesStrings.Add(str);
+	WriteLabel(pChunk);
+	WriteByteString(pChunk, 16);
 }
 
-void CChunkRenderText::WriteFileString(const CStringA &str, CFile *pFile) const
+void CChunkRenderText::WriteLabel(const CChunk *pChunk)		// // //
 {
-	pFile->Write(const_cast<CStringA&>(str).GetBuffer(), str.GetLength());
+	m_Writer.Write(GetLabel(pChunk));
+	m_Writer.Write(":\n");
 }
 
-void CChunkRenderText::StoreByteString(const char *pData, int Len, CStringA &str, int LineBreak) const
-{	
-	str.Append("\t.byte ");
-
-	for (int i = 0; i < Len; ++i) {
-		str.AppendFormat("$%02X", (unsigned char)pData[i]);
-
-		if ((i % LineBreak == (LineBreak - 1)) && (i < Len - 1))
-			str.Append("\n\t.byte ");
-		else if (i < Len - 1)
-			str.Append(", ");
+void CChunkRenderText::WriteDataRefs(const CChunk *pChunk)		// // //
+{
+	for (int i = 0; i < pChunk->GetLength(); ++i) {
+		m_Writer.Write("\t.word ");
+		m_Writer.Write(GetDataRefName(pChunk, i));
+		m_Writer.Write('\n');
 	}
-
-	str.Append("\n");
 }
 
-void CChunkRenderText::StoreByteString(const CChunk *pChunk, CStringA &str, int LineBreak) const
+void CChunkRenderText::WriteByteString(const CChunk *pChunk, unsigned int LineBreak)		// // //
 {
-	int len = pChunk->GetLength();
-	
-	str.Append("\t.byte ");
-
-	for (int i = 0; i < len; ++i) {
-		str.AppendFormat("$%02X", pChunk->GetData(i));
+	m_Writer.WriteByteList(pChunk->GetLength(), LineBreak, [pChunk] (std::size_t i) {
+		return pChunk->GetData(static_cast<int>(i));
+	});
+}
 
-		if ((i % LineBreak == (LineBreak - 1)) && (i < len - 1))
-			str.Append("\n\t.byte ");
-		else if (i < len - 1)
-			str.Append(", ");
-	}
+LPCSTR CChunkRenderText::GetLabel(const CChunk *pChunk) const		// // //
+{
+	return m_vLabelNames[pChunk->GetLabelID()];
+}
 
-	str.Append("\n");
+LPCSTR CChunkRenderText::GetDataRefName(const CChunk *pChunk, int index) const		// // //
+{
+	const int Label = pChunk->GetDataRefID(index);
+	return Label != -1 ? LPCSTR(m_vLabelNames[Label]) : "";
 }
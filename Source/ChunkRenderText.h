@@ -22,14 +22,18 @@
 
 #pragma once
 
+#include <initializer_list>		// // //
+#include "AsmWriter.h"		// // //
+
 //
 // Text chunk renderer
 //
 
 class CChunkRenderText;
 class CDSample;		// // //
+class CChunkLabelTable;		// // //
 
-typedef void (CChunkRenderText::*renderFunc_t)(CChunk *pChunk, CFile *pFile);
+typedef void (CChunkRenderText::*renderFunc_t)(const CChunk *pChunk);		// // //
 
 struct stChunkRenderFunc {
 	chunk_type_t type;
@@ -39,7 +43,7 @@ struct stChunkRenderFunc {
 class CChunkRenderText
 {
 public:
-	CChunkRenderText(CFile *pFile);
+	CChunkRenderText(CFile *pFile, const CChunkLabelTable &Labels);		// // //
 	void StoreChunks(const std::vector<CChunk*> &Chunks);
 	void StoreSamples(const std::vector<const CDSample*> &Samples);
 
@@ -67,44 +71,35 @@ public:
 
 private:
 	static const stChunkRenderFunc RENDER_FUNCTIONS[];
+	static const char *const LABEL_FORMATS[];		// // //
 
 private:
-	void DumpStrings(const CStringA &preStr, const CStringA &postStr, CStringArray &stringArray, CFile *pFile) const;
-	void WriteFileString(const CStringA &str, CFile *pFile) const;
-	void StoreByteString(const char *pData, int Len, CStringA &str, int LineBreak) const;
-	void StoreByteString(const CChunk *pChunk, CStringA &str, int LineBreak) const;
+	void DumpChunks(const char *preStr, const char *postStr, const std::vector<CChunk*> &Chunks, std::initializer_list<chunk_type_t> Types);		// // //
+	void WriteLabel(const CChunk *pChunk);		// // //
+	void WriteDataRefs(const CChunk *pChunk);		// // //
+	void WriteByteString(const CChunk *pChunk, unsigned int LineBreak);		// // //
+	LPCSTR GetLabel(const CChunk *pChunk) const;		// // //
+	LPCSTR GetDataRefName(const CChunk *pChunk, int index) const;		// // //
 
 private:
-	void StoreHeaderChunk(CChunk *pChunk, CFile *pFile);
-	void StoreInstrumentListChunk(CChunk *pChunk, CFile *pFile);
-	void StoreInstrumentChunk(CChunk *pChunk, CFile *pFile);
-	void StoreSequenceChunk(CChunk *pChunk, CFile *pFile);
-	void StoreSampleListChunk(CChunk *pChunk, CFile *pFile);
-	void StoreSamplePointersChunk(CChunk *pChunk, CFile *pFile);
-	void StoreGrooveListChunk(CChunk *pChunk, CFile *pFile);		// // //
-	void StoreGrooveChunk(CChunk *pChunk, CFile *pFile);		// // //
-	void StoreSongListChunk(CChunk *pChunk, CFile *pFile);
-	void StoreSongChunk(CChunk *pChunk, CFile *pFile);
-	void StoreFrameListChunk(CChunk *pChunk, CFile *pFile);
-	void StoreFrameChunk(CChunk *pChunk, CFile *pFile);
-	void StorePatternChunk(CChunk *pChunk, CFile *pFile);
-	void StoreWavetableChunk(CChunk *pChunk, CFile *pFile);
-	void StoreWavesChunk(CChunk *pChunk, CFile *pFile);
+	void StoreHeaderChunk(const CChunk *pChunk);
+	void StoreInstrumentListChunk(const CChunk *pChunk);
+	void StoreInstrumentChunk(const CChunk *pChunk);
+	void StoreSequenceChunk(const CChunk *pChunk);
+	void StoreSampleListChunk(const CChunk *pChunk);
+	void StoreSamplePointersChunk(const CChunk *pChunk);
+	void StoreGrooveListChunk(const CChunk *pChunk);		// // //
+	void StoreGrooveChunk(const CChunk *pChunk);		// // //
+	void StoreSongListChunk(const CChunk *pChunk);
+	void StoreSongChunk(const CChunk *pChunk);
+	void StoreFrameListChunk(const CChunk *pChunk);
+	void StoreFrameChunk(const CChunk *pChunk);
+	void StorePatternChunk(const CChunk *pChunk);
+	void StoreWavetableChunk(const CChunk *pChunk);
+	void StoreWavesChunk(const CChunk *pChunk);
 
 private:
-	CStringArray m_headerStrings;
-	CStringArray m_instrumentListStrings;
-	CStringArray m_instrumentStrings;
-	CStringArray m_sequenceStrings;
-	CStringArray m_sampleListStrings;
-	CStringArray m_samplePointersStrings;
-	CStringArray m_grooveListStrings;		// // //
-	CStringArray m_grooveStrings;		// // //
-	CStringArray m_songListStrings;
-	CStringArray m_songStrings;
-	CStringArray m_songDataStrings;
-	CStringArray m_wavetableStrings;
-	CStringArray m_wavesStrings;
+	std::vector<CStringA> m_vLabelNames;		// // // Indexed by label ID
 
-	CFile *m_pFile;
+	CAsmWriter m_Writer;		// // // Chunks are rendered straight into the output file
 };
@@ -29,6 +29,15 @@
 #include "TextExporter.h"
 #include "CustomExporters.h"
 #include "DocumentWrapper.h"
+#include "EmulationBenchmark.h"		// // //
+#include "ModuleGenerator.h"		// // //
+#include "VGMExport.h"		// // //
+#include "ExportVerifier.h"		// // //
+#include "DriverProfiler.h"		// // //
+#include "LoudnessMeter.h"		// // //
+#include "version.h"
+#include <chrono>
+#include <fstream>
 
 // Command line export logger
 class CCommandLineLog : public CCompilerLog
@@ -217,3 +226,372 @@ void CCommandLineExport::CommandLineExport(const CString& fileIn, const CString&
 	}
 	return;
 }
+
+// // // Command line benchmark function
+
+namespace {
+
+const int BENCHMARK_ITERATIONS = 3;
+const unsigned int BENCHMARK_EMULATION_FRAMES = 600;
+const unsigned int BENCHMARK_SYNTHETIC_TRACKS = 64;		// Tracks of the generated module
+const unsigned int BENCHMARK_SYNTHETIC_FRAMES = 32;		// Frames per track of the generated module
+const unsigned int BENCHMARK_SYNTHETIC_ROWS = 64;		// Pattern length of the generated module
+
+// Runs a function several times, returns the shortest time in milliseconds or a negative number
+// if the function fails
+template <typename F>
+double TimeMilliseconds(F f) {
+	double Best = -1.;
+	for (int i = 0; i < BENCHMARK_ITERATIONS; ++i) {
+		const auto Start = std::chrono::steady_clock::now();
+		if (!f())
+			return -1.;
+		const double t = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+		if (Best < 0. || t < Best)
+			Best = t;
+	}
+	return Best;
+}
+
+CFamiTrackerDoc *CreateDocument() {
+	CObject *pObject = RUNTIME_CLASS(CFamiTrackerDoc)->CreateObject();
+	if (pObject == NULL || !pObject->IsKindOf(RUNTIME_CLASS(CFamiTrackerDoc))) {
+		delete pObject;
+		return NULL;
+	}
+	return static_cast<CFamiTrackerDoc*>(pObject);
+}
+
+} // namespace
+
+void CCommandLineExport::CommandLineBenchmark(const CString& fileOut, const CStringArray& modules)
+{
+	TCHAR TempPath[MAX_PATH];
+	if (!GetTempPath(MAX_PATH, TempPath))
+		return;
+	const CString TempFTM = CString(TempPath) + _T("0CC-benchmark.0cc");
+	const CString TempNSF = CString(TempPath) + _T("0CC-benchmark.nsf");
+	const CString TempASM = CString(TempPath) + _T("0CC-benchmark.asm");
+
+	const auto TimeExports = [&] (CFamiTrackerDoc *pDoc, nlohmann::json &Result) {		// // //
+		theApp.GetSoundGenerator()->GenerateVibratoTable(pDoc->GetVibratoStyle());
+		Result["tracks"] = pDoc->GetTrackCount();
+		Result["chips"] = pDoc->GetExpansionChip();
+		Result["save_ms"] = TimeMilliseconds([&] {
+			return pDoc->OnSaveDocument(TempFTM) != FALSE;
+		});
+		Result["nsf_ms"] = TimeMilliseconds([&] {
+			CCompiler compiler(pDoc, NULL);
+			compiler.ExportNSF(TempNSF, pDoc->GetMachine());
+			return true;
+		});
+		Result["asm_ms"] = TimeMilliseconds([&] {
+			CCompiler compiler(pDoc, NULL);
+			compiler.ExportASM(TempASM);
+			return true;
+		});
+	};
+
+	nlohmann::json Modules = nlohmann::json::array();
+	for (int i = 0; i < modules.GetCount(); ++i) {
+		const CString &Path = modules[i];
+		nlohmann::json Result = {{"file", std::string(Path)}};
+
+		CFamiTrackerDoc *pDoc = NULL;
+		Result["open_ms"] = TimeMilliseconds([&] {
+			delete pDoc;
+			pDoc = CreateDocument();
+			return pDoc && pDoc->OnOpenDocument(Path);
+		});
+
+		if (pDoc && pDoc->IsFileLoaded())
+			TimeExports(pDoc, Result);
+
+		delete pDoc;
+		Modules.push_back(Result);
+	}
+
+	// // // Synthetic module with many tracks, which mostly exercises the assembly text renderer
+	if (CFamiTrackerDoc *pDoc = CreateDocument()) {
+		if (pDoc->OnNewDocument()) {
+			stGeneratorSettings Settings;
+			Settings.Tracks = BENCHMARK_SYNTHETIC_TRACKS;
+			Settings.Frames = BENCHMARK_SYNTHETIC_FRAMES;
+			Settings.Rows = BENCHMARK_SYNTHETIC_ROWS;
+			CModuleGenerator {Settings}.Generate(pDoc);
+
+			nlohmann::json Result = {{"file", "synthetic"}};
+			TimeExports(pDoc, Result);
+			Modules.push_back(Result);
+		}
+		delete pDoc;
+	}
+
+	DeleteFile(TempFTM);
+	DeleteFile(TempNSF);
+	DeleteFile(TempASM);
+
+	const int SampleRate = 44100;
+	CEmulationBenchmark Benchmark {SampleRate, BENCHMARK_EMULATION_FRAMES};
+	nlohmann::json Emulation = nlohmann::json::array();
+	for (const auto &x : Benchmark.RunAll())
+		Emulation.push_back(CEmulationBenchmark::ToJSON(x));
+
+	nlohmann::json Report = {
+		{"version", APP_NAME_VERSION},
+		{"sample_rate", SampleRate},
+		{"emulation", Emulation},
+		{"modules", Modules},
+	};
+
+	if (auto file = std::fstream {fileOut, std::ios_base::out})
+		file << Report.dump(1, '\t') << std::endl;
+}
+
+// // // Command line module generator
+
+void CCommandLineExport::CommandLineGenerate(const CString& fileOut, const CString& fileLog, const CStringArray& options)
+{
+	CStdioFile fLog;
+	const bool bLog = fileLog.GetLength() > 0 && fLog.Open(fileLog, CFile::modeCreate | CFile::modeWrite | CFile::typeText, NULL);
+
+	stGeneratorSettings Settings;
+	for (int i = 0; i < options.GetCount(); ++i)
+		if (!CModuleGenerator::ParseOption(Settings, options[i]) && bLog)
+			fLog.WriteString(_T("Error: unknown generator setting: ") + options[i] + _T("\n"));
+
+	CFamiTrackerDoc *pDoc = CreateDocument();
+	if (pDoc == NULL || !pDoc->OnNewDocument()) {
+		if (bLog) fLog.WriteString(_T("Error: unable to create CFamiTrackerDoc\n"));
+		delete pDoc;
+		return;
+	}
+
+	CModuleGenerator {Settings}.Generate(pDoc);
+
+	CString result;
+	if (fileOut.Right(4).CompareNoCase(_T(".txt")) == 0) {
+		CTextExport textExport;
+		result = textExport.ExportFile(fileOut, pDoc);
+	}
+	else if (!pDoc->OnSaveDocument(fileOut))
+		result = _T("unable to save ") + fileOut;
+
+	if (bLog)
+		fLog.WriteString(result.GetLength() > 0 ? _T("Error: ") + result + _T("\n") : _T("Generated: ") + fileOut + _T("\n"));
+
+	delete pDoc;
+}
+
+// // // Command line VGM export, the module is already loaded into the active document
+
+void CCommandLineExport::CommandLineExportVGM(const CString& fileOut, const CString& fileLog)
+{
+	CStdioFile fLog;
+	const bool bLog = fileLog.GetLength() > 0 && fLog.Open(fileLog, CFile::modeCreate | CFile::modeWrite | CFile::typeText, NULL);
+
+	CFamiTrackerDoc *pDoc = CFamiTrackerDoc::GetDoc();
+	if (pDoc == NULL || !pDoc->IsFileLoaded()) {
+		if (bLog) fLog.WriteString(_T("Error: unable to open document\n"));
+		return;
+	}
+
+	CVGMExport exporter(pDoc, bLog ? new CCommandLineLog(&fLog) : NULL);
+	const bool bResult = exporter.ExportAll(fileOut);
+	if (bLog)
+		fLog.WriteString(bResult ? _T("\nVGM export complete.\n") : _T("\nVGM export failed.\n"));
+}
+
+bool CCommandLineExport::RequiresSoundGenerator(const CString& fileOut)
+{
+	return fileOut.Right(4).CompareNoCase(_T(".vgm")) == 0 || IsAudioRender(fileOut);
+}
+
+// // // Command line export verification, the module is already loaded into the active document
+
+namespace {
+
+const unsigned int VERIFY_MAX_FRAMES = 36000;		// Ten minutes at 60 Hz
+const DWORD RENDER_START_TIMEOUT = 5000;		// Milliseconds to wait for the sound thread to begin rendering
+
+} // namespace
+
+void CCommandLineExport::CommandLineVerifyExport(const CString& fileOut, const CString& fileLog)
+{
+	// The export has been written before the sound thread started, append to its log or write
+	// to the standard output if there is none
+	CStdioFile fLog, fStdout {stdout};
+	CStdioFile *pLog = &fStdout;
+	if (fileLog.GetLength() > 0 &&
+		fLog.Open(fileLog, CFile::modeCreate | CFile::modeNoTruncate | CFile::modeWrite | CFile::typeText, NULL)) {
+		fLog.SeekToEnd();
+		pLog = &fLog;
+	}
+	pLog->WriteString(_T("\nVerifying exported file...\n"));
+
+	CFamiTrackerDoc *pDoc = CFamiTrackerDoc::GetDoc();
+	if (pDoc == NULL || !pDoc->IsFileLoaded()) {
+		pLog->WriteString(_T("Error: unable to open document\n"));
+		return;
+	}
+
+	// NES files only contain the first track and do not support expansion chips
+	const bool bNES = fileOut.Right(4).CompareNoCase(_T(".nes")) == 0;
+	if (bNES && pDoc->GetExpansionChip() != SNDCHIP_NONE) {
+		pLog->WriteString(_T("Skipped, the module uses expansion chips\n"));
+		return;
+	}
+
+	CSoundGen *pSoundGen = theApp.GetSoundGenerator();
+	const unsigned int Tracks = bNES ? 1 : pDoc->GetTrackCount();
+	for (unsigned int i = 0; i < Tracks; ++i) {
+		CString str;
+		const auto pReference = std::make_shared<CRegisterSnapshotLog>(VERIFY_MAX_FRAMES);
+		if (!pSoundGen->RenderSongToLog(*pReference, i)) {
+			str.Format(_T("Track %u: error: the sound generator did not start rendering\n"), i + 1);
+			pLog->WriteString(str);
+			continue;
+		}
+
+		const stVerifyResult Result = pSoundGen->VerifyExport(fileOut, i, pReference);
+		switch (Result.Status) {
+		case VERIFY_MATCH:
+			str.Format(_T("Track %u: %u frames match the tracker\n"), i + 1, Result.Frames);
+			break;
+		case VERIFY_MISMATCH:
+			str.Format(_T("Track %u: first mismatch at frame %u (export offset %+d), %s is $%02X, tracker wrote $%02X\n"),
+				i + 1, Result.Frame, Result.FrameOffset, (LPCTSTR)CString(CRegisterSnapshotLog::GetRegisterName(Result.Register).c_str()),
+				Result.Actual, Result.Expected);
+			break;
+		case VERIFY_LOAD_FAILED:
+			str.Format(_T("Track %u: error: unable to load the exported file\n"), i + 1);
+			break;
+		case VERIFY_INIT_FAILED:
+			str.Format(_T("Track %u: error: the init routine did not return\n"), i + 1);
+			break;
+		case VERIFY_PLAY_FAILED:
+			str.Format(_T("Track %u: error: the play routine did not return at frame %u\n"), i + 1, Result.Frame);
+			break;
+		case VERIFY_TIMEOUT:
+			str.Format(_T("Track %u: error: the verification did not finish\n"), i + 1);
+			break;
+		}
+		pLog->WriteString(str);
+	}
+}
+
+// // // Command line driver profiling of a verified export, written as JSON
+
+void CCommandLineExport::CommandLineProfileExport(const CString& fileOut, const CString& fileReport)
+{
+	CFamiTrackerDoc *pDoc = CFamiTrackerDoc::GetDoc();
+	if (pDoc == NULL || !pDoc->IsFileLoaded())
+		return;
+
+	static const char *const STATUS_NAMES[] = {"ok", "mismatch", "load_failed", "init_failed", "play_failed", "timeout"};
+
+	CSoundGen *pSoundGen = theApp.GetSoundGenerator();
+	const bool bNES = fileOut.Right(4).CompareNoCase(_T(".nes")) == 0;
+	const unsigned int Tracks = bNES ? 1 : pDoc->GetTrackCount();
+
+	nlohmann::json Results = nlohmann::json::array();
+	for (unsigned int i = 0; i < Tracks; ++i) {
+		nlohmann::json Result = {{"track", i + 1}};
+		const auto pReference = std::make_shared<CSongPositionLog>(VERIFY_MAX_FRAMES, [pSoundGen] {
+			return stSongPosition {pSoundGen->GetPlayerFrame(), pSoundGen->GetPlayerRow()};
+		});
+		if (!pSoundGen->RenderSongToLog(*pReference, i))
+			Result["status"] = STATUS_NAMES[VERIFY_TIMEOUT];
+		else {
+			const stDriverProfile Profile = pSoundGen->ProfileExport(fileOut, i, pReference);
+			Result["status"] = STATUS_NAMES[Profile.Status];
+			Result.update(CDriverProfiler::ToJSON(Profile));
+		}
+		Results.push_back(Result);
+	}
+
+	nlohmann::json Report = {
+		{"version", APP_NAME_VERSION},
+		{"file", std::string(fileOut)},
+		{"tracks", Results},
+	};
+
+	if (auto file = std::fstream {fileReport, std::ios_base::out})
+		file << Report.dump(1, '\t') << std::endl;
+}
+
+bool CCommandLineExport::IsVerifiedExport(const CString& fileOut)
+{
+	return fileOut.Right(4).CompareNoCase(_T(".nsf")) == 0 ||
+		fileOut.Right(5).CompareNoCase(_T(".nsfe")) == 0 ||
+		fileOut.Right(4).CompareNoCase(_T(".nes")) == 0;
+}
+
+// // // Command line audio rendering, the module is already loaded into the active document
+
+void CCommandLineExport::CommandLineRenderAudio(const CString& fileOut, const CString& fileLog)
+{
+	CStdioFile fLog;
+	const bool bLog = fileLog.GetLength() > 0 && fLog.Open(fileLog, CFile::modeCreate | CFile::modeWrite | CFile::typeText, NULL);
+
+	CFamiTrackerDoc *pDoc = CFamiTrackerDoc::GetDoc();
+	if (pDoc == NULL || !pDoc->IsFileLoaded()) {
+		if (bLog) fLog.WriteString(_T("Error: unable to open document\n"));
+		return;
+	}
+
+	// Every track is played once, multiple tracks are numbered like the VGM export
+	CString Base = fileOut;
+	CString Ext;
+	const int Pos = Base.ReverseFind(_T('.'));
+	Ext = Base.Mid(Pos);
+	Base = Base.Left(Pos);
+
+	CSoundGen *pSoundGen = theApp.GetSoundGenerator();
+	const unsigned int Tracks = pDoc->GetTrackCount();
+	for (unsigned int i = 0; i < Tracks; ++i) {
+		CString Name = fileOut;
+		if (Tracks > 1)
+			Name.Format(_T("%s - %02u%s"), (LPCTSTR)Base, i + 1, (LPCTSTR)Ext);
+		if (!pSoundGen->RenderToFile(Name, SONG_LOOP_LIMIT, 1, i)) {
+			if (bLog) fLog.WriteString(_T("Error: unable to create ") + Name + _T("\n"));
+			continue;
+		}
+
+		// The loudness result is set when the file has been closed
+		stLoudnessResult Loudness;
+		const DWORD Start = GetTickCount();
+		bool bDone;
+		while (!(bDone = pSoundGen->GetRenderLoudness(Loudness))) {
+			MSG msg;
+			while (::PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+				::TranslateMessage(&msg);
+				::DispatchMessage(&msg);
+			}
+			if (!pSoundGen->IsRendering() && GetTickCount() - Start > RENDER_START_TIMEOUT)
+				break;
+			Sleep(1);
+		}
+
+		if (bLog) {
+			CString str;
+			if (bDone && pSoundGen->HasRenderFailed())
+				str.Format(_T("Error: %s could not be written and has been removed\n"), (LPCTSTR)Name);
+			else if (bDone && CLoudnessMeter::IsSilent(Loudness))		// // //
+				str.Format(_T("Rendered %s: silent\n"), (LPCTSTR)Name);
+			else if (bDone)
+				str.Format(_T("Rendered %s: %s, %s, %llu clipped samples\n"), (LPCTSTR)Name,
+					CLoudnessMeter::FormatLevel(Loudness.Integrated, "LUFS").c_str(),
+					CLoudnessMeter::FormatLevel(Loudness.TruePeak, "dBTP").c_str(), Loudness.ClippedSamples);
+			else
+				str.Format(_T("Error: the sound generator did not render %s\n"), (LPCTSTR)Name);
+			fLog.WriteString(str);
+		}
+	}
+}
+
+bool CCommandLineExport::IsAudioRender(const CString& fileOut)
+{
+	return fileOut.Right(4).CompareNoCase(_T(".wav")) == 0 ||
+		fileOut.Right(5).CompareNoCase(_T(".flac")) == 0;
+}
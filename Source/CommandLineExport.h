@@ -24,4 +24,17 @@ class CCommandLineExport
 {
 public:
 	void CommandLineExport(const CString& fileIn, const CString& fileOut, const CString& fileLog,  const CString& fileDPCM);
+	void CommandLineBenchmark(const CString& fileOut, const CStringArray& modules);		// // //
+	void CommandLineGenerate(const CString& fileOut, const CString& fileLog, const CStringArray& options);		// // //
+	void CommandLineExportVGM(const CString& fileOut, const CString& fileLog);		// // //
+	void CommandLineVerifyExport(const CString& fileOut, const CString& fileLog);		// // //
+	void CommandLineRenderAudio(const CString& fileOut, const CString& fileLog);		// // //
+	void CommandLineProfileExport(const CString& fileOut, const CString& fileReport);		// // //
+
+	// // // Whether an export renders through the sound generator and must wait until it is running
+	static bool RequiresSoundGenerator(const CString& fileOut);
+	// // // Whether an export is played back and compared against the tracker after it is written
+	static bool IsVerifiedExport(const CString& fileOut);
+	// // // Whether an export renders the module into a WAV or FLAC file
+	static bool IsAudioRender(const CString& fileOut);
 };
@@ -44,6 +44,24 @@ public:
 	virtual void FlushBuffer(int16_t *Buffer, uint32_t Size) = 0;
 };
 
+// // // Receives every register write and the audio of every frame from the emulation
+class IRegisterCapture {
+public:
+	virtual void OnWrite(uint16_t Address, uint8_t Value, uint32_t Cycle) = 0;
+	virtual void OnEndFrame(uint32_t Cycles, const int16_t *Buffer, uint32_t Size) = 0;
+	// // // Called when a DPCM sample is mapped into the sample memory at $C000
+	virtual void OnSampleMemory(const char *pData, int Size) { }
+	// // // Called when the sample memory is unmapped and when the emulation is reset
+	virtual void OnClearSample() { }
+	virtual void OnReset() { }
+	// // // Called before each slice of emulated time, with the frame cycle at the end of the slice
+	virtual void OnProcess(uint32_t Cycle) { }
+	// // // Song position events of a rendered song, each called before the writes of its frame
+	virtual void OnSongStart() { }
+	virtual void OnLoopPoint() { }
+	virtual void OnSongEnd() { }
+};
+
 
 // class for simulating CPU memory, used by the DPCM channel
 class CSampleMem 
@@ -71,6 +89,14 @@ public:
 		m_iMemSize = 0;
 	}
 
+	const char *GetMem() const {		// // //
+		return reinterpret_cast<const char*>(m_pMemory);
+	}
+
+	int GetSize() const {		// // //
+		return m_iMemSize;
+	}
+
 private:
 	const uint8_t *m_pMemory;
 	uint16_t m_iMemSize;
@@ -22,6 +22,10 @@
 
 #include <map>
 #include <vector>
+#include <algorithm>		// // //
+#include <atomic>		// // //
+#include <thread>		// // //
+#include <unordered_set>		// // //
 #include "stdafx.h"
 #include "version.h"		// // //
 #include "FamiTracker.h"
@@ -31,6 +35,7 @@
 #include "InstrumentFDS.h"		// // //
 #include "InstrumentN163.h"		// // //
 #include "PatternCompiler.h"
+#include "BankPacker.h"		// // //
 #include "DSample.h"		// // //
 #include "Compiler.h"
 #include "Chunk.h"
@@ -121,6 +126,8 @@ const int CCompiler::FLAG_LINEARPITCH	= 1 << 2;		// // //
 
 CCompiler *CCompiler::pCompiler = NULL;
 
+CPatternCache CCompiler::PatternCache;		// // //
+
 CCompiler *CCompiler::GetCompiler()
 {
 	return pCompiler;
@@ -142,7 +149,8 @@ CCompiler::CCompiler(CFamiTrackerDoc *pDoc, CCompilerLog *pLogger) :
 	m_pHeaderChunk(NULL),
 	m_pDriverData(NULL),
 	m_iLastBank(0),
-	m_iHashCollisions(0)
+	m_iHashCollisions(0),
+	m_pLabels(new CChunkLabelTable())		// // //
 {
 	ASSERT(CCompiler::pCompiler == NULL);
 	CCompiler::pCompiler = this;
@@ -204,7 +212,7 @@ bool CCompiler::OpenFile(LPCTSTR lpszFileName, CFile &file) const
 	return true;
 }
 
-void CCompiler::ExportNSF(LPCTSTR lpszFileName, int MachineType)
+bool CCompiler::ExportNSF(LPCTSTR lpszFileName, int MachineType)		// // //
 {
 	ClearLog();
 
@@ -212,7 +220,7 @@ void CCompiler::ExportNSF(LPCTSTR lpszFileName, int MachineType)
 	if (!CompileData()) {
 		// Failed
 		Cleanup();
-		return;
+		return false;
 	}
 
 	if (m_bBankSwitched) {
@@ -220,7 +228,7 @@ void CCompiler::ExportNSF(LPCTSTR lpszFileName, int MachineType)
 		AddBankswitching();
 		if (!ResolveLabelsBankswitched()) {
 			Cleanup();
-			return;
+			return false;
 		}
 		// Write bank data
 		UpdateFrameBanks();
@@ -280,7 +288,7 @@ void CCompiler::ExportNSF(LPCTSTR lpszFileName, int MachineType)
 	if (!OpenFile(lpszFileName, OutputFile)) {
 		Print(_T("Error: Could not open output file\n"));
 		Cleanup();
-		return;
+		return false;
 	}
 
 	// Create NSF header
@@ -334,6 +342,7 @@ void CCompiler::ExportNSF(LPCTSTR lpszFileName, int MachineType)
 	OutputFile.Close();
 
 	Cleanup();
+	return true;
 }
 
 void CCompiler::ExportNSFE(LPCTSTR lpszFileName, int MachineType)		// // //
@@ -1023,7 +1032,6 @@ void CCompiler::UpdateSamplePointers(unsigned int Origin)
 
 	ASSERT(m_pSamplePointersChunk != NULL);
 
-	unsigned int Address = Origin;
 	unsigned int Bank = m_iFirstSampleBank;
 
 	if (!m_bBankSwitched)
@@ -1031,32 +1039,37 @@ void CCompiler::UpdateSamplePointers(unsigned int Origin)
 
 	m_pSamplePointersChunk->Clear();
 
-	// The list is stored in the same order as the samples vector
+	// // // Samples are packed into the DPCM bank windows, the stored order changes accordingly
+	if (m_bBankSwitched) {
+		const unsigned int WindowSize = DPCM_SWITCH_ADDRESS - PAGE_SAMPLES;
+		m_SamplePacker.Pack(WindowSize);
+		m_vSamples.clear();
+		for (int i : m_SamplePacker.GetStoredSamples())
+			m_vSamples.push_back(m_pDocument->GetSample(m_iSampleBank[i]));
+		Print(_T(" * DPCM sample banks: %i (%i if stored in order)\n"),
+			  m_SamplePacker.GetWindowCount() * DPCM_PAGE_WINDOW, m_SamplePacker.GetSequentialWindowCount(WindowSize) * DPCM_PAGE_WINDOW);
+	}
 
-	for (auto pDSample : m_vSamples) {
+	// The list is stored in the same order as the sample list
+	for (unsigned int i = 0; i < m_iSamplesUsed; ++i) {
+		const CDSample *pDSample = m_pDocument->GetSample(m_iSampleBank[i]);
 		unsigned int Size = pDSample->GetSize();
-
-		if (m_bBankSwitched) {
-			if ((Address + Size) >= DPCM_SWITCH_ADDRESS) {
-				Address = PAGE_SAMPLES;
-				Bank += DPCM_PAGE_WINDOW;
-			}
-		}
+		const stSampleLocation Location = m_SamplePacker.GetLocation(i);
+		unsigned int Address = Origin + Location.Offset;
+		unsigned int SampleBank = m_bBankSwitched ? Bank + Location.Window * DPCM_PAGE_WINDOW : Bank;
 
 		// Store
 		m_pSamplePointersChunk->StoreByte(Address >> 6);
 		m_pSamplePointersChunk->StoreByte(Size >> 4);
-		m_pSamplePointersChunk->StoreByte(Bank);
+		m_pSamplePointersChunk->StoreByte(SampleBank);
 
 #ifdef _DEBUG
-		Print(_T(" * DPCM sample %s: $%04X, bank %i (%i bytes)\n"), pDSample->GetName(), Address, Bank, Size);
+		Print(_T(" * DPCM sample %s: $%04X, bank %i (%i bytes)\n"), pDSample->GetName(), Address, SampleBank, Size);
 #endif
-		Address += Size;
-		Address += AdjustSampleAddress(Address);
 	}
-#ifdef _DEBUG
-	Print(_T(" * DPCM sample banks: %i\n"), Bank - m_iFirstSampleBank + DPCM_PAGE_WINDOW);
-#endif
+
+	if (m_bBankSwitched && m_SamplePacker.GetWindowCount() > 1)
+		Bank += (m_SamplePacker.GetWindowCount() - 1) * DPCM_PAGE_WINDOW;
 
 	// Save last bank number for NSF header
 	m_iLastBank = Bank + 1;
@@ -1072,7 +1085,7 @@ void CCompiler::UpdateFrameBanks()
 		if (pChunk->GetType() == CHUNK_FRAME) {
 			// Add bank data
 			for (int j = 0; j < Channels; ++j) {
-				unsigned char bank = GetObjectByRef(pChunk->GetDataRefName(j))->GetBank();
+				unsigned char bank = GetObjectByRef(pChunk->GetDataRefID(j))->GetBank();		// // //
 				if (bank < PATTERN_SWITCH_BANK)
 					bank = PATTERN_SWITCH_BANK;
 				pChunk->SetupBankData(j + Channels, bank);
@@ -1085,7 +1098,7 @@ void CCompiler::UpdateSongBanks()
 {
 	// Write bank numbers to song lists (can only be used when bankswitching is used)
 	for (CChunk *pChunk : m_vSongChunks) {
-		int bank = GetObjectByRef(pChunk->GetDataRefName(0))->GetBank();
+		int bank = GetObjectByRef(pChunk->GetDataRefID(0))->GetBank();		// // //
 		if (bank < PATTERN_SWITCH_BANK)
 			bank = PATTERN_SWITCH_BANK;
 		pChunk->SetupBankData(m_iSongBankReference, bank);
@@ -1111,7 +1124,7 @@ void CCompiler::EnableBankswitching()
 void CCompiler::ResolveLabels()
 {
 	// Resolve label addresses, no banks since bankswitching is disabled
-	CMap<CStringA, LPCSTR, int, int> labelMap;
+	std::vector<int> labelMap(m_pLabels->GetCount());		// // // indexed by label ID
 
 	// Pass 1, collect labels
 	CollectLabels(labelMap);
@@ -1123,7 +1136,7 @@ void CCompiler::ResolveLabels()
 bool CCompiler::ResolveLabelsBankswitched()
 {
 	// Resolve label addresses and banks
-	CMap<CStringA, LPCSTR, int, int> labelMap;
+	std::vector<int> labelMap(m_pLabels->GetCount());		// // // indexed by label ID
 
 	// Pass 1, collect labels
 	if (!CollectLabelsBankswitched(labelMap))
@@ -1135,17 +1148,17 @@ bool CCompiler::ResolveLabelsBankswitched()
 	return true;
 }
 
-void CCompiler::CollectLabels(CMap<CStringA, LPCSTR, int, int> &labelMap) const
+void CCompiler::CollectLabels(std::vector<int> &labelMap) const		// // //
 {
 	// Collect labels and assign offsets
 	int Offset = 0;
 	for (const CChunk *pChunk : m_vChunks) {
-		labelMap[pChunk->GetLabel()] = Offset;
+		labelMap[pChunk->GetLabelID()] = Offset;
 		Offset += pChunk->CountDataSize();
 	}
 }
 
-bool CCompiler::CollectLabelsBankswitched(CMap<CStringA, LPCSTR, int, int> &labelMap)
+bool CCompiler::CollectLabelsBankswitched(std::vector<int> &labelMap)		// // //
 {
 	int Offset = 0;
 	int Bank = PATTERN_SWITCH_BANK;
@@ -1160,7 +1173,7 @@ bool CCompiler::CollectLabelsBankswitched(CMap<CStringA, LPCSTR, int, int> &labe
 			case CHUNK_PATTERN:
 				break;
 			default:
-				labelMap[pChunk->GetLabel()] = Offset;
+				labelMap[pChunk->GetLabelID()] = Offset;
 				Offset += Size;
 		}
 	}
@@ -1171,38 +1184,70 @@ bool CCompiler::CollectLabelsBankswitched(CMap<CStringA, LPCSTR, int, int> &labe
 		return false;
 	}
 
-	unsigned int Track = 0;
+	// // // Split the switchable chunks into items that must stay in one bank
+	CBankPacker Packer;
+	std::vector<std::vector<CChunk*>> ItemChunks;
+	std::unordered_map<const CChunk*, int> ItemMap;
+	std::vector<CChunk*> Chunks;
+	int Track = -1;
 
-	// The switchable area is $B000-$C000
 	for (CChunk *pChunk : m_vChunks) {
 		int Size = pChunk->CountDataSize();
 
 		switch (pChunk->GetType()) {
 			case CHUNK_FRAME_LIST:
-				// Make sure the entire frame list will fit, if not then allocate a new bank
-				if (Offset + m_iDriverSize + m_iTrackFrameSize[Track++] > 0x4000) {
-					Offset = 0x3000 - m_iDriverSize;
-					++Bank;
-				}
+				// The frame list is placed together with all frames of the track
+				ItemMap[pChunk] = Packer.AddItem(m_iTrackFrameSize[++Track], Track);
+				ItemChunks.push_back({pChunk});
+				break;
 			case CHUNK_FRAME:
-				labelMap[pChunk->GetLabel()] = Offset;
-				pChunk->SetBank(Bank < 4 ? ((Offset + m_iDriverSize) >> 12) : Bank);
-				Offset += Size;
+				ItemMap[pChunk] = ItemChunks.size() - 1;
+				ItemChunks.back().push_back(pChunk);
 				break;
 			case CHUNK_PATTERN:
-				// Make sure entire pattern will fit
-				if (Offset + m_iDriverSize + Size > 0x4000) {
-					Offset = 0x3000 - m_iDriverSize;
-					++Bank;
-				}
-				labelMap[pChunk->GetLabel()] = Offset;
-				pChunk->SetBank(Bank < 4 ? ((Offset + m_iDriverSize) >> 12) : Bank);
-				Offset += Size;
-			default:
+				ItemMap[pChunk] = Packer.AddItem(Size, Track);
+				ItemChunks.push_back({pChunk});
 				break;
+			default:
+				Chunks.push_back(pChunk);
+		}
+	}
+
+	// Each frame reads the frame list of its track and one pattern per channel
+	const int Channels = m_pDocument->GetAvailableChannels();
+	for (const CChunk *pChunk : m_vChunks) {
+		if (pChunk->GetType() != CHUNK_FRAME)
+			continue;
+		std::vector<int> Access {ItemMap[pChunk]};
+		for (int j = 0; j < Channels; ++j)
+			Access.push_back(ItemMap[GetObjectByRef(pChunk->GetDataRefID(j))]);
+		Packer.AddAccess(Access);
+	}
+
+	// The switchable area is $B000-$C000
+	const unsigned int FirstCapacity = 0x4000 - m_iDriverSize - Offset;
+	const auto Banks = Packer.Pack(FirstCapacity, 0x1000);
+
+	for (size_t b = 0; b < Banks.size(); ++b) {
+		if (b > 0) {
+			Offset = 0x3000 - m_iDriverSize;
+			++Bank;
 		}
+		for (int Item : Banks[b])
+			for (CChunk *pChunk : ItemChunks[Item]) {
+				labelMap[pChunk->GetLabelID()] = Offset;
+				pChunk->SetBank(Bank < 4 ? ((Offset + m_iDriverSize) >> 12) : Bank);
+				Offset += pChunk->CountDataSize();
+				Chunks.push_back(pChunk);
+			}
 	}
 
+	// Chunks are rendered in the order of their banks
+	m_vChunks = std::move(Chunks);
+
+	Print(_T(" * Pattern banks: %i (%i if stored in order), %.2f bank switches per frame\n"),
+		  static_cast<int>(Banks.size()), Packer.CountSequentialBanks(FirstCapacity, 0x1000), Packer.GetSwitchesPerFrame(Banks));
+
 	if (m_bBankSwitched)
 		m_iFirstSampleBank = ((Bank < 4) ? ((Offset + m_iDriverSize) >> 12) : Bank) + 1;
 
@@ -1211,7 +1256,7 @@ bool CCompiler::CollectLabelsBankswitched(CMap<CStringA, LPCSTR, int, int> &labe
 	return true;
 }
 
-void CCompiler::AssignLabels(CMap<CStringA, LPCSTR, int, int> &labelMap)
+void CCompiler::AssignLabels(const std::vector<int> &labelMap)		// // //
 {
 	// Pass 2: assign addresses to labels
 	for (CChunk *pChunk : m_vChunks)
@@ -1324,6 +1369,7 @@ bool CCompiler::CompileData()
 	CreateMainHeader();
 	CreateSequenceList();
 	CreateInstrumentList();
+	MergeDuplicateChunks();		// // //
 	CreateSampleList();
 	StoreSamples();
 	StoreGrooves();		// // //
@@ -1371,12 +1417,16 @@ void CCompiler::Cleanup()
 		delete pChunk;
 
 	m_vChunks.clear();
+	m_pLabels->Clear();		// // //
+	m_vLabelChunks.clear();
 	m_vSequenceChunks.clear();
 	m_vInstrumentChunks.clear();
 	m_vGrooveChunks.clear();		// // //
 	m_vSongChunks.clear();
 	m_vFrameChunks.clear();
 	m_vPatternChunks.clear();
+	m_PatternMap.clear();		// // //
+	m_DuplicateMap.clear();
 
 	m_pSamplePointersChunk = NULL;	// This pointer is also stored in m_vChunks
 	m_pHeaderChunk = NULL;
@@ -1400,7 +1450,7 @@ void CCompiler::AddBankswitching()
 			int Length = pChunk->GetLength();
 			// Bank data is located at end
 			for (int j = 0; j < Length; ++j) {
-				pChunk->StoreBankReference(pChunk->GetDataRefName(j), 0);
+				pChunk->StoreBankReference(pChunk->GetDataRefID(j), 0);		// // //
 			}
 		}
 	}
@@ -1433,8 +1483,10 @@ void CCompiler::ScanSong()
 	static const inst_type_t inst[] = {INST_2A03, INST_VRC6, INST_N163, INST_S5B};		// // //
 	bool *used[] = {*m_bSequencesUsed2A03, *m_bSequencesUsedVRC6, *m_bSequencesUsedN163, *m_bSequencesUsedS5B};
 
+	const std::bitset<MAX_INSTRUMENTS> InPatterns = GetInstrumentsInPatterns();		// // //
+
 	for (int i = 0; i < MAX_INSTRUMENTS; ++i) {
-		if (m_pDocument->IsInstrumentUsed(i) && IsInstrumentInPattern(i)) {
+		if (m_pDocument->IsInstrumentUsed(i) && InPatterns[i]) {
 			
 			// List of used instruments
 			m_iAssignedInstruments[m_iInstruments++] = i;
@@ -1478,9 +1530,10 @@ void CCompiler::ScanSong()
 	}
 }
 
-bool CCompiler::IsInstrumentInPattern(int index) const
+std::bitset<MAX_INSTRUMENTS> CCompiler::GetInstrumentsInPatterns() const		// // //
 {
-	// Returns true if the instrument is used in a pattern
+	// Returns the instruments used in any pattern, the module is scanned once for all instruments
+	std::bitset<MAX_INSTRUMENTS> Used;
 
 	const int TrackCount = m_pDocument->GetTrackCount();
 	const int Channels = m_pDocument->GetAvailableChannels();
@@ -1493,14 +1546,14 @@ bool CCompiler::IsInstrumentInPattern(int index) const
 				for (int l = 0; l < PatternLength; ++l) {
 					stChanNote Note;
 					m_pDocument->GetDataAtPattern(i, k, j, l, &Note);
-					if (Note.Instrument == index)
-						return true;
+					if (Note.Instrument < MAX_INSTRUMENTS)
+						Used.set(Note.Instrument);
 				}
 			}
 		}
 	}	
 
-	return false;
+	return Used;
 }
 
 void CCompiler::CreateMainHeader()
@@ -1513,7 +1566,7 @@ void CCompiler::CreateMainHeader()
 
 	unsigned short DividerNTSC, DividerPAL;
 
-	CChunk *pChunk = CreateChunk(CHUNK_HEADER, "");
+	CChunk *pChunk = CreateChunk(CHUNK_HEADER, m_pLabels->Intern(CHUNK_LABEL_NONE));
 
 	if (TicksPerSec == 0) {
 		// Default
@@ -1532,18 +1585,18 @@ void CCompiler::CreateMainHeader()
 
 	// Write header
 
-	pChunk->StoreReference(CChunkRenderText::LABEL_SONG_LIST);
-	pChunk->StoreReference(CChunkRenderText::LABEL_INSTRUMENT_LIST);
-	pChunk->StoreReference(CChunkRenderText::LABEL_SAMPLES_LIST);
-	pChunk->StoreReference(CChunkRenderText::LABEL_SAMPLES);
-	pChunk->StoreReference(CChunkRenderText::LABEL_GROOVE_LIST);		// // //
+	pChunk->StoreReference(CHUNK_LABEL_SONG_LIST);		// // //
+	pChunk->StoreReference(CHUNK_LABEL_INSTRUMENT_LIST);
+	pChunk->StoreReference(CHUNK_LABEL_SAMPLES_LIST);
+	pChunk->StoreReference(CHUNK_LABEL_SAMPLES);
+	pChunk->StoreReference(CHUNK_LABEL_GROOVE_LIST);		// // //
 	
 	m_iHeaderFlagOffset = pChunk->GetLength();		// Save the flags offset
 	pChunk->StoreByte(Flags);
 
 	// FDS table, only if FDS is enabled
 	if (m_pDocument->ExpansionEnabled(SNDCHIP_FDS) || bMultichip)
-		pChunk->StoreReference(CChunkRenderText::LABEL_WAVETABLE);
+		pChunk->StoreReference(CHUNK_LABEL_WAVETABLE);		// // //
 
 	pChunk->StoreWord(DividerNTSC);
 	pChunk->StoreWord(DividerPAL);
@@ -1568,21 +1621,18 @@ void CCompiler::CreateSequenceList()
 	unsigned int Size = 0, StoredCount = 0;
 	static const inst_type_t inst[] = {INST_2A03, INST_VRC6, INST_N163, INST_S5B};
 	const bool *used[] = {*m_bSequencesUsed2A03, *m_bSequencesUsedVRC6, *m_bSequencesUsedN163, *m_bSequencesUsedS5B};
-	static const char *format[] = {
-		CChunkRenderText::LABEL_SEQ_2A03, CChunkRenderText::LABEL_SEQ_VRC6,
-		CChunkRenderText::LABEL_SEQ_N163, CChunkRenderText::LABEL_SEQ_S5B
+	static const chunk_label_t label[] = {		// // //
+		CHUNK_LABEL_SEQ_2A03, CHUNK_LABEL_SEQ_VRC6,
+		CHUNK_LABEL_SEQ_N163, CHUNK_LABEL_SEQ_S5B
 	};
 
 	// TODO: use the CSeqInstrument::GetSequence
-	// TODO: merge identical sequences from all chips
 	for (size_t c = 0; c < sizeof(inst) / sizeof(inst_type_t); c++) {
 		for (int i = 0; i < MAX_SEQUENCES; ++i)  for (int j = 0; j < SEQ_COUNT; ++j) {
 			CSequence* pSeq = m_pDocument->GetSequence(inst[c], i, j);
 			int Index = i * SEQ_COUNT + j;
 			if (*(used[c] + Index) && pSeq->GetItemCount() > 0) {
-				CStringA label;
-				label.Format(format[c], Index);
-				Size += StoreSequence(pSeq, label);
+				Size += StoreSequence(pSeq, m_pLabels->Intern(label[c], Index));		// // //
 				++StoredCount;
 			}
 		}
@@ -1594,9 +1644,7 @@ void CCompiler::CreateSequenceList()
 				const CSequence* pSeq = pInstrument->GetSequence(j);		// // //
 				if (pSeq->GetItemCount() > 0) {
 					int Index = i * SEQ_COUNT + j;
-					CStringA label;
-					label.Format(CChunkRenderText::LABEL_SEQ_FDS, Index);
-					Size += StoreSequence(pSeq, label);
+					Size += StoreSequence(pSeq, m_pLabels->Intern(CHUNK_LABEL_SEQ_FDS, Index));		// // //
 					++StoredCount;
 				}
 			}
@@ -1606,9 +1654,9 @@ void CCompiler::CreateSequenceList()
 	Print(_T(" * Sequences used: %i (%i bytes)\n"), StoredCount, Size);
 }
 
-int CCompiler::StoreSequence(const CSequence *pSeq, CStringA &label)
+int CCompiler::StoreSequence(const CSequence *pSeq, int Label)		// // //
 {
-	CChunk *pChunk = CreateChunk(CHUNK_SEQUENCE, label);
+	CChunk *pChunk = CreateChunk(CHUNK_SEQUENCE, Label);
 	m_vSequenceChunks.push_back(pChunk);
 
 	// Store the sequence
@@ -1654,10 +1702,10 @@ void CCompiler::CreateInstrumentList()
 	CChunk *pWavesChunk = NULL;		// N163
 	int iWaveSize = 0;				// N163 waves size
 
-	CChunk *pInstListChunk = CreateChunk(CHUNK_INSTRUMENT_LIST, CChunkRenderText::LABEL_INSTRUMENT_LIST);
+	CChunk *pInstListChunk = CreateChunk(CHUNK_INSTRUMENT_LIST, m_pLabels->Intern(CHUNK_LABEL_INSTRUMENT_LIST));		// // //
 	
 	if (m_pDocument->ExpansionEnabled(SNDCHIP_FDS)) {
-		pWavetableChunk = CreateChunk(CHUNK_WAVETABLE, CChunkRenderText::LABEL_WAVETABLE);
+		pWavetableChunk = CreateChunk(CHUNK_WAVETABLE, m_pLabels->Intern(CHUNK_LABEL_WAVETABLE));		// // //
 	}
 
 	memset(m_iWaveBanks, -1, MAX_INSTRUMENTS * sizeof(int));
@@ -1679,9 +1727,7 @@ void CCompiler::CreateInstrumentList()
 			if (m_iWaveBanks[i] == -1) {
 				m_iWaveBanks[i] = iIndex;
 				// Store wave
-				CStringA label;
-				label.Format(CChunkRenderText::LABEL_WAVES, iIndex);
-				pWavesChunk = CreateChunk(CHUNK_WAVES, label);
+				pWavesChunk = CreateChunk(CHUNK_WAVES, m_pLabels->Intern(CHUNK_LABEL_WAVES, iIndex));		// // //
 				// Store waves
 				iWaveSize += pInstrument->StoreWave(pWavesChunk);
 			}
@@ -1691,13 +1737,11 @@ void CCompiler::CreateInstrumentList()
 	// Store instruments
 	for (unsigned int i = 0; i < m_iInstruments; ++i) {
 		// Add reference to instrument list
-		CStringA label;
-		label.Format(CChunkRenderText::LABEL_INSTRUMENT, i);
-		pInstListChunk->StoreReference(label);
+		pInstListChunk->StoreReference(CHUNK_LABEL_INSTRUMENT, i);		// // //
 		iTotalSize += 2;
 
 		// Actual instrument
-		CChunk *pChunk = CreateChunk(CHUNK_INSTRUMENT, label);
+		CChunk *pChunk = CreateChunk(CHUNK_INSTRUMENT, m_pLabels->Intern(CHUNK_LABEL_INSTRUMENT, i));
 		m_vInstrumentChunks.push_back(pChunk);
 
 		int iIndex = m_iAssignedInstruments[i];
@@ -1723,8 +1767,7 @@ void CCompiler::CreateInstrumentList()
 		// // // Check if FDS
 		if (pInstrument->GetType() == INST_FDS && pWavetableChunk != NULL) {
 			// Store wave
-			AddWavetable(std::static_pointer_cast<CInstrumentFDS>(pInstrument).get(), pWavetableChunk);
-			pChunk->StoreByte(m_iWaveTables - 1);
+			pChunk->StoreByte(AddWavetable(std::static_pointer_cast<CInstrumentFDS>(pInstrument).get(), pWavetableChunk));		// // //
 		}
 	}
 
@@ -1734,6 +1777,63 @@ void CCompiler::CreateInstrumentList()
 		Print(_T(" * N163 waves size: %i bytes\n"), iWaveSize);
 }
 
+void CCompiler::MergeDuplicateChunks()		// // //
+{
+	// Merge sequences, N163 waves and instruments with identical contents; sequences and waves are
+	// merged first so that instruments referring to merged data compare equal as well
+	static const chunk_type_t TYPES[] = {CHUNK_SEQUENCE, CHUNK_WAVES, CHUNK_INSTRUMENT};
+
+	int Count = 0;
+	unsigned int Size = 0;
+
+	for (const chunk_type_t Type : TYPES) {
+		std::unordered_map<std::string, const CChunk*> Stored;		// Keyed by data and referenced labels
+		std::unordered_map<int, int> Duplicates;		// Label IDs of duplicate chunks
+		std::unordered_set<const CChunk*> Removed;
+
+		for (CChunk *pChunk : m_vChunks) {
+			if (pChunk->GetType() != Type)
+				continue;
+			std::string Key(reinterpret_cast<const char*>(pChunk->GetBinaryData()), pChunk->CountDataSize());
+			for (int i = 0; i < pChunk->GetLength(); ++i)
+				if (pChunk->IsDataReference(i)) {
+					const int Label = pChunk->GetDataRefID(i);
+					Key.append(reinterpret_cast<const char*>(&Label), sizeof(Label));
+				}
+			auto it = Stored.emplace(std::move(Key), pChunk);
+			if (!it.second) {
+				Duplicates[pChunk->GetLabelID()] = it.first->second->GetLabelID();
+				m_vLabelChunks[pChunk->GetLabelID()] = const_cast<CChunk*>(it.first->second);
+				Removed.insert(pChunk);
+				Size += pChunk->CountDataSize();
+				++Count;
+			}
+		}
+
+		if (Duplicates.empty())
+			continue;
+
+		// Update references to duplicates
+		for (CChunk *pChunk : m_vChunks)
+			for (int i = 0; i < pChunk->GetLength(); ++i)
+				if (pChunk->IsDataReference(i)) {
+					auto it = Duplicates.find(pChunk->GetDataRefID(i));
+					if (it != Duplicates.end())
+						pChunk->UpdateDataRef(i, it->second);
+				}
+
+		const auto IsRemoved = [&Removed] (const CChunk *pChunk) { return Removed.count(pChunk) != 0; };
+		m_vSequenceChunks.erase(std::remove_if(m_vSequenceChunks.begin(), m_vSequenceChunks.end(), IsRemoved), m_vSequenceChunks.end());
+		m_vInstrumentChunks.erase(std::remove_if(m_vInstrumentChunks.begin(), m_vInstrumentChunks.end(), IsRemoved), m_vInstrumentChunks.end());
+		m_vChunks.erase(std::remove_if(m_vChunks.begin(), m_vChunks.end(), IsRemoved), m_vChunks.end());
+		for (const CChunk *pChunk : Removed)
+			delete pChunk;
+	}
+
+	if (Count > 0)
+		Print(_T(" * %i duplicated sequence(s) and instrument(s) removed (%i bytes saved)\n"), Count, Size);
+}
+
 // Samples
 
 void CCompiler::CreateSampleList()
@@ -1750,7 +1850,7 @@ void CCompiler::CreateSampleList()
 	// Clear the sample list
 	memset(m_iSampleBank, 0xFF, MAX_DSAMPLES);
 	
-	CChunk *pChunk = CreateChunk(CHUNK_SAMPLE_LIST, CChunkRenderText::LABEL_SAMPLES_LIST);
+	CChunk *pChunk = CreateChunk(CHUNK_SAMPLE_LIST, m_pLabels->Intern(CHUNK_LABEL_SAMPLES_LIST));		// // //
 
 	// Store sample instruments
 	unsigned int Item = 0;
@@ -1794,47 +1894,36 @@ void CCompiler::StoreSamples()
 	 *
 	 */
 
-	unsigned int iAddedSamples = 0;
-	unsigned int iSampleAddress = 0x0000;
-
-	// Get sample start address
-	m_iSamplesSize = 0;
-
-	CChunk *pChunk = CreateChunk(CHUNK_SAMPLE_POINTERS, CChunkRenderText::LABEL_SAMPLES);
+	CChunk *pChunk = CreateChunk(CHUNK_SAMPLE_POINTERS, m_pLabels->Intern(CHUNK_LABEL_SAMPLES));		// // //
 	m_pSamplePointersChunk = pChunk;
 
-	// Store DPCM samples in a separate array
+	// // // Pointers are written once the layout is known, samples sharing data with another one are not stored
+	m_SamplePacker.Clear();
+	std::vector<const CDSample*> Samples;
 	for (unsigned int i = 0; i < m_iSamplesUsed; ++i) {
-
 		unsigned int iIndex = m_iSampleBank[i];
 		ASSERT(iIndex != 0xFF);
 		const CDSample *pDSample = m_pDocument->GetSample(iIndex);
-		unsigned int iSize = pDSample->GetSize();
-
-		if (iSize > 0) {
-			// Fill sample list
-			unsigned char iSampleAddr = iSampleAddress >> 6;
-			unsigned char iSampleSize = iSize >> 4;
-			unsigned char iSampleBank = 0;
-
-			// Update SAMPLE_ITEM_WIDTH here
-			pChunk->StoreByte(iSampleAddr);
-			pChunk->StoreByte(iSampleSize);
-			pChunk->StoreByte(iSampleBank);
+		m_SamplePacker.AddSample(pDSample->GetData(), pDSample->GetSize());
+		Samples.push_back(pDSample);
 
-			// Add this sample to storage
-			m_vSamples.push_back(pDSample);
+		// Update SAMPLE_ITEM_WIDTH here
+		pChunk->StoreByte(0);
+		pChunk->StoreByte(0);
+		pChunk->StoreByte(0);
+	}
 
-			// Pad end of samples
-			unsigned int iAdjust = AdjustSampleAddress(iSampleAddress + iSize);
+	m_SamplePacker.Merge();
+	m_SamplePacker.Pack(0);
 
-			iAddedSamples++;
-			iSampleAddress += iSize + iAdjust;
-			m_iSamplesSize += iSize + iAdjust;
-		}
-	}
+	// Store DPCM samples in a separate array
+	for (int i : m_SamplePacker.GetStoredSamples())
+		m_vSamples.push_back(Samples[i]);
+	m_iSamplesSize = m_SamplePacker.GetStoredSize();
 
 	Print(_T(" * DPCM samples used: %i (%i bytes)\n"), m_iSamplesUsed, m_iSamplesSize);
+	if (int Shared = m_SamplePacker.GetSharedCount())		// // //
+		Print(_T(" * %i DPCM sample(s) shared (%i bytes saved)\n"), Shared, m_SamplePacker.GetSequentialSize() - m_iSamplesSize);
 }
 
 int CCompiler::GetSampleIndex(int SampleNumber)
@@ -1864,7 +1953,7 @@ void CCompiler::StoreGrooves()
 
 	unsigned int Size = 1, Count = 0;
 	
-	CChunk *pGrooveListChunk = CreateChunk(CHUNK_GROOVE_LIST, CChunkRenderText::LABEL_GROOVE_LIST);
+	CChunk *pGrooveListChunk = CreateChunk(CHUNK_GROOVE_LIST, m_pLabels->Intern(CHUNK_LABEL_GROOVE_LIST));		// // //
 	pGrooveListChunk->StoreByte(0); // padding; possibly used to disable groove
 
 	for (int i = 0; i < MAX_GROOVE; i++) {
@@ -1872,11 +1961,9 @@ void CCompiler::StoreGrooves()
 		CGroove *Groove = m_pDocument->GetGroove(i);
 		if (Groove == NULL) continue;
 		
-		CStringA label;
-		label.Format(CChunkRenderText::LABEL_GROOVE, i);
-		// pGrooveListChunk->StoreReference(label);
+		// pGrooveListChunk->StoreReference(CHUNK_LABEL_GROOVE, i);
 
-		CChunk *pChunk = CreateChunk(CHUNK_GROOVE, label);
+		CChunk *pChunk = CreateChunk(CHUNK_GROOVE, m_pLabels->Intern(CHUNK_LABEL_GROOVE, i));		// // //
 		m_vGrooveChunks.push_back(pChunk);
 		for (int j = 0; j < Groove->GetSize(); j++) {
 			pChunk->StoreByte(Groove->GetEntry(j));
@@ -1902,24 +1989,22 @@ void CCompiler::StoreSongs()
 
 	const int TrackCount = m_pDocument->GetTrackCount();
 
-	CChunk *pSongListChunk = CreateChunk(CHUNK_SONG_LIST, CChunkRenderText::LABEL_SONG_LIST);
+	CChunk *pSongListChunk = CreateChunk(CHUNK_SONG_LIST, m_pLabels->Intern(CHUNK_LABEL_SONG_LIST));		// // //
 
 	m_iDuplicatePatterns = 0;
+	m_iDuplicateBytes = 0;		// // //
 
 	// Store song info
 	for (int i = 0; i < TrackCount; ++i) {
 		// Add reference to song list
-		CStringA label;
-		label.Format(CChunkRenderText::LABEL_SONG, i);
-		pSongListChunk->StoreReference(label);
+		pSongListChunk->StoreReference(CHUNK_LABEL_SONG, i);		// // //
 
 		// Create song
-		CChunk *pChunk = CreateChunk(CHUNK_SONG, label);
+		CChunk *pChunk = CreateChunk(CHUNK_SONG, m_pLabels->Intern(CHUNK_LABEL_SONG, i));
 		m_vSongChunks.push_back(pChunk);
 
 		// Store reference to song
-		label.Format(CChunkRenderText::LABEL_SONG_FRAMES, i);
-		pChunk->StoreReference(label);
+		pChunk->StoreReference(CHUNK_LABEL_SONG_FRAMES, i);
 		pChunk->StoreByte(m_pDocument->GetFrameCount(i));
 		pChunk->StoreByte(m_pDocument->GetPatternLength(i));
 
@@ -1939,11 +2024,14 @@ void CCompiler::StoreSongs()
 		}
 		else pChunk->StoreByte(0);
 
-		pChunk->StoreBankReference(label, 0);
+		pChunk->StoreBankReference(m_pLabels->Intern(CHUNK_LABEL_SONG_FRAMES, i), 0);		// // //
 	}
 
 	m_iSongBankReference = m_vSongChunks[0]->GetLength() - 1;	// Save bank value position (all songs are equal)
 
+	// // // Compile pattern data of all songs at once
+	CompilePatterns();
+
 	// Store actual songs
 	for (int i = 0; i < TrackCount; ++i) {
 		Print(_T(" * Song %i: "), i);
@@ -1953,11 +2041,13 @@ void CCompiler::StoreSongs()
 		StorePatterns(i);
 	}
 
+	m_vCompiledPatterns.clear();		// // //
+
 	if (m_iDuplicatePatterns > 0)
-		Print(_T(" * %i duplicated pattern(s) removed\n"), m_iDuplicatePatterns);
+		Print(_T(" * %i duplicated pattern(s) removed (%i bytes saved)\n"), m_iDuplicatePatterns, m_iDuplicateBytes);		// // //
 	
 #ifdef _DEBUG
-	Print(_T("Hash collisions: %i (of %i items)\r\n"), m_iHashCollisions, m_PatternMap.GetCount());
+	Print(_T("Hash collisions: %i (of %i items)\r\n"), m_iHashCollisions, static_cast<int>(m_PatternMap.size()));
 #endif
 }
 
@@ -1988,29 +2078,25 @@ void CCompiler::CreateFrameList(unsigned int Track)
 	const int ChannelCount = m_pDocument->GetAvailableChannels();
 
 	// Create frame list
-	CStringA label;
-	label.Format(CChunkRenderText::LABEL_SONG_FRAMES, Track);
-	CChunk *pFrameListChunk = CreateChunk(CHUNK_FRAME_LIST, label);
+	CChunk *pFrameListChunk = CreateChunk(CHUNK_FRAME_LIST, m_pLabels->Intern(CHUNK_LABEL_SONG_FRAMES, Track));		// // //
 
 	unsigned int TotalSize = 0;
 
 	// Store addresses to patterns
 	for (int i = 0; i < FrameCount; ++i) {
 		// Add reference to frame list
-		label.Format(CChunkRenderText::LABEL_SONG_FRAME, Track, i);
-		pFrameListChunk->StoreReference(label);
+		pFrameListChunk->StoreReference(CHUNK_LABEL_SONG_FRAME, Track, i);		// // //
 		TotalSize += 2;
 
 		// Store frame item
-		CChunk *pChunk = CreateChunk(CHUNK_FRAME, label);
+		CChunk *pChunk = CreateChunk(CHUNK_FRAME, m_pLabels->Intern(CHUNK_LABEL_SONG_FRAME, Track, i));
 		m_vFrameChunks.push_back(pChunk);
 
 		// Pattern pointers
 		for (int j = 0; j < ChannelCount; ++j) {
 			int Chan = m_vChanOrder[j];
 			int Pattern = m_pDocument->GetPatternAtFrame(Track, i, Chan);
-			label.Format(CChunkRenderText::LABEL_PATTERN, Track, Pattern, Chan);
-			pChunk->StoreReference(label);
+			pChunk->StoreReference(CHUNK_LABEL_PATTERN, Track, Pattern, Chan);		// // //
 			TotalSize += 2;
 		}
 	}
@@ -2022,6 +2108,95 @@ void CCompiler::CreateFrameList(unsigned int Track)
 
 // Patterns
 
+namespace {
+
+// // // Collects the messages of one pattern so that they are logged in the order of a serial build
+class CCompilerLogBuffer : public CCompilerLog
+{
+public:
+	void WriteLog(LPCTSTR text) override { m_strText += text; }
+	void Clear() override { m_strText.Empty(); }
+	const CString &GetText() const { return m_strText; }
+
+private:
+	CString m_strText;
+};
+
+} // namespace
+
+void CCompiler::CompilePatterns()		// // //
+{
+	/*
+	 * Compile the used patterns of all songs on all cores, every pattern only reads the document
+	 * and the instrument and sample tables built before; patterns compiled from the same input
+	 * in the last export are reused
+	 *
+	 */
+
+	const int TrackCount = m_pDocument->GetTrackCount();
+	const int Channels = m_pDocument->GetAvailableChannels();
+
+	// List used patterns in the order they are stored
+	std::vector<stPatternJob *> Jobs;
+	std::vector<int> JobTracks;
+	m_vCompiledPatterns.assign(TrackCount, std::vector<stPatternJob>());
+
+	for (int t = 0; t < TrackCount; ++t) {
+		ScanPatternUsage(t);
+		auto &Patterns = m_vCompiledPatterns[t];
+		for (int i = 0; i < MAX_PATTERN; ++i)
+			for (int j = 0; j < Channels; ++j)
+				if (IsPatternAddressed(i, j))
+					Patterns.push_back({i, j});
+	}
+	for (int t = 0; t < TrackCount; ++t)
+		for (auto &x : m_vCompiledPatterns[t]) {
+			Jobs.push_back(&x);
+			JobTracks.push_back(t);
+		}
+
+	std::string Context;
+	CPatternCompiler(m_pDocument, m_iAssignedInstruments, (DPCM_List_t*)&m_iSamplesLookUp, NULL).GetContextKey(Context);
+	PatternCache.Begin(Context);
+
+	std::atomic<size_t> Next {0};
+	std::atomic<int> Reused {0};
+	const auto Worker = [&] {
+		CCompilerLogBuffer Log;
+		CPatternCompiler PatternCompiler(m_pDocument, m_iAssignedInstruments, (DPCM_List_t*)&m_iSamplesLookUp, &Log);
+		for (size_t i; (i = Next++) < Jobs.size(); ) {
+			stPatternJob &Job = *Jobs[i];
+			PatternCompiler.GetPatternKey(JobTracks[i], Job.Pattern, Job.Channel, Job.Key);
+			if (const stCompiledPattern *pCached = PatternCache.Find(Job.Key)) {
+				Job.Result = *pCached;
+				++Reused;
+				continue;
+			}
+			Log.Clear();
+			PatternCompiler.CompileData(JobTracks[i], Job.Pattern, Job.Channel);
+			Job.Result.Data = PatternCompiler.GetData();
+			Job.Result.Hash = PatternCompiler.GetHash();
+			Job.Result.Log = Log.GetText();
+		}
+	};
+
+	const size_t Threads = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), Jobs.size());
+	std::vector<std::thread> Workers;
+	for (size_t i = 1; i < Threads; ++i)
+		Workers.emplace_back(Worker);
+	Worker();
+	for (auto &x : Workers)
+		x.join();
+
+	// Keep the patterns of this export for the next one
+	for (const auto x : Jobs)
+		PatternCache.Store(x->Key, x->Result);
+	PatternCache.Finish();
+
+	if (Reused > 0)
+		Print(_T(" * %i of %i patterns reused from the last export\n"), static_cast<int>(Reused), static_cast<int>(Jobs.size()));
+}
+
 void CCompiler::StorePatterns(unsigned int Track)
 {
 	/* 
@@ -2031,119 +2206,152 @@ void CCompiler::StorePatterns(unsigned int Track)
 
 	const int iChannels = m_pDocument->GetAvailableChannels();
 
-	CPatternCompiler PatternCompiler(m_pDocument, m_iAssignedInstruments, (DPCM_List_t*)&m_iSamplesLookUp, m_pLogger);
-
 	int PatternCount = 0;
 	int PatternSize = 0;
 
-	// Iterate through all patterns
-	for (int i = 0; i < MAX_PATTERN; ++i) {
-		for (int j = 0; j < iChannels; ++j) {
-			// And store only used ones
-			if (IsPatternAddressed(Track, i, j)) {
+	// // // Find used patterns in a single pass over the frame list
+	ScanPatternUsage(Track);
+	std::vector<std::pair<int, int>> Duplicates;		// Pattern and channel of each duplicate in this track
 
-				// Compile pattern data
-				PatternCompiler.CompileData(Track, i, j);
+	// // // Iterate through the used patterns, compiled in the same order
+	for (const auto &Job : m_vCompiledPatterns[Track]) {
+		const stCompiledPattern &Compiled = Job.Result;
+		const int i = Job.Pattern;
+		const int j = Job.Channel;
 
-				CStringA label;
-				label.Format(CChunkRenderText::LABEL_PATTERN, Track, i, j);
+		if (m_pLogger != NULL && !Compiled.Log.IsEmpty())
+			m_pLogger->WriteLog(Compiled.Log);
 
-				bool StoreNew = true;
+		const int Label = m_pLabels->Intern(CHUNK_LABEL_PATTERN, Track, i, j);		// // //
+
+		bool StoreNew = true;
 
 #ifdef REMOVE_DUPLICATE_PATTERNS
-				unsigned int Hash = PatternCompiler.GetHash();
-				
-				// Check for duplicate patterns
-				CChunk *pDuplicate = m_PatternMap[Hash];
-
-				if (pDuplicate != NULL) {
-					// Hash only indicates that patterns may be equal, check exact data
-					if (PatternCompiler.CompareData(pDuplicate->GetStringData(PATTERN_CHUNK_INDEX))) {
-						// Duplicate was found, store a reference to existing pattern
-						m_DuplicateMap[label] = pDuplicate->GetLabel();
-						++m_iDuplicatePatterns;
-						StoreNew = false;
-					}
-				}
+		// // // Check for duplicate patterns of any track and channel; patterns are compiled for
+		// their own channel first, so channel-specific encodings never compare equal
+		const uint64_t Hash = Compiled.Hash;
+		const auto Range = m_PatternMap.equal_range(Hash);
+
+		for (auto it = Range.first; it != Range.second; ++it) {
+			const CChunk *pDuplicate = it->second;
+			// Hash only indicates that patterns may be equal, check exact data
+			if (Compiled.Data.size() == pDuplicate->GetDataSize(PATTERN_CHUNK_INDEX) &&
+				std::equal(Compiled.Data.begin(), Compiled.Data.end(), pDuplicate->GetStringData(PATTERN_CHUNK_INDEX))) {		// // //
+				// Duplicate was found, store a reference to existing pattern
+				m_DuplicateMap[Label] = pDuplicate->GetLabelID();		// // //
+				Duplicates.emplace_back(i, j);
+				++m_iDuplicatePatterns;
+				m_iDuplicateBytes += Compiled.Data.size();
+				StoreNew = false;
+				break;
+			}
+		}
 #endif /* REMOVE_DUPLICATE_PATTERNS */
 
-				if (StoreNew) {
-					// Store new pattern
-					CChunk *pChunk = CreateChunk(CHUNK_PATTERN, label);
-					m_vPatternChunks.push_back(pChunk);
+		if (StoreNew) {
+			// Store new pattern
+			CChunk *pChunk = CreateChunk(CHUNK_PATTERN, Label);
+			m_vPatternChunks.push_back(pChunk);
 
 #ifdef REMOVE_DUPLICATE_PATTERNS
-					if (m_PatternMap[Hash] != NULL)
-						m_iHashCollisions++;
-					m_PatternMap[Hash] = pChunk;
+			if (Range.first != Range.second)
+				m_iHashCollisions++;
+			m_PatternMap.emplace(Hash, pChunk);		// // // Colliding patterns are all kept
 #endif /* REMOVE_DUPLICATE_PATTERNS */
-					
-					// Store pattern data as string
-					pChunk->StoreString(PatternCompiler.GetData());
+			
+			// Store pattern data as string
+			pChunk->StoreString(Compiled.Data);
 
-					PatternSize += PatternCompiler.GetDataSize();
-					++PatternCount;
-				}
-			}
+			PatternSize += Compiled.Data.size();
+			++PatternCount;
 		}
 	}
 
 #ifdef REMOVE_DUPLICATE_PATTERNS
-	// Update references to duplicates
-	for (const auto pChunk : m_vFrameChunks) {
-		for (int j = 0, n = pChunk->GetLength(); j < n; ++j) {
-			CStringA str = m_DuplicateMap[pChunk->GetDataRefName(j)];
-			if (str.GetLength() != 0) {
-				// Update reference
-				pChunk->UpdateDataRefName(j, str);
-			}
+	// // // Update references to duplicates, only the frames using them are visited
+	std::vector<int> FrameItem(iChannels, -1);		// Reference index of each channel in frame chunks
+	for (int j = 0; j < iChannels; ++j)
+		FrameItem[m_vChanOrder[j]] = j;
+
+	for (const auto &x : Duplicates) {
+		const int Duplicate = m_DuplicateMap[m_pLabels->Intern(CHUNK_LABEL_PATTERN, Track, x.first, x.second)];
+		const int Index = x.second * MAX_PATTERN + x.first;
+		for (unsigned int k = m_vPatternFrameStart[Index]; k < m_vPatternFrameStart[Index + 1]; ++k) {
+			CChunk *pChunk = GetObjectByRef(m_pLabels->Intern(CHUNK_LABEL_SONG_FRAME, Track, m_vPatternFrames[k]));
+			// Update reference
+			pChunk->UpdateDataRef(FrameItem[x.second], Duplicate);
 		}
 	}
 #endif /* REMOVE_DUPLICATE_PATTERNS */
 
 #ifdef LOCAL_DUPLICATE_PATTERN_REMOVAL
 	// Forget patterns when one whole track is stored
-	m_PatternMap.RemoveAll();
-	m_DuplicateMap.RemoveAll();
+	m_PatternMap.clear();		// // //
+	m_DuplicateMap.clear();		// // //
 #endif /* LOCAL_DUPLICATE_PATTERN_REMOVAL */
 
 	Print(_T("%i patterns (%i bytes)\r\n"), PatternCount, PatternSize);
 }
 
-bool CCompiler::IsPatternAddressed(unsigned int Track, int Pattern, int Channel) const
+void CCompiler::ScanPatternUsage(unsigned int Track)		// // //
 {
-	// Scan the frame list to see if a pattern is accessed for that frame
+	// Builds the pattern usage bitmap and the reverse index from patterns to frames
 	const int FrameCount = m_pDocument->GetFrameCount(Track);
-	
-	for (int i = 0; i < FrameCount; ++i) {
-		if (m_pDocument->GetPatternAtFrame(Track, i, Channel) == Pattern)
-			return true;
-	}
+	const int Channels = m_pDocument->GetAvailableChannels();
+
+	std::vector<int> Patterns(FrameCount * Channels);
+	m_vPatternUsed.assign(Channels, std::bitset<MAX_PATTERN>());
+	m_vPatternFrameStart.assign(Channels * MAX_PATTERN + 1, 0);
 
-	return false;
+	for (int i = 0; i < FrameCount; ++i)
+		for (int j = 0; j < Channels; ++j) {
+			const int Pattern = m_pDocument->GetPatternAtFrame(Track, i, j);
+			Patterns[i * Channels + j] = Pattern;
+			m_vPatternUsed[j].set(Pattern);
+			++m_vPatternFrameStart[j * MAX_PATTERN + Pattern + 1];
+		}
+
+	for (size_t i = 1; i < m_vPatternFrameStart.size(); ++i)
+		m_vPatternFrameStart[i] += m_vPatternFrameStart[i - 1];
+
+	std::vector<unsigned int> Next(m_vPatternFrameStart.begin(), m_vPatternFrameStart.end() - 1);
+	m_vPatternFrames.resize(FrameCount * Channels);
+	for (int i = 0; i < FrameCount; ++i)
+		for (int j = 0; j < Channels; ++j)
+			m_vPatternFrames[Next[j * MAX_PATTERN + Patterns[i * Channels + j]]++] = i;
 }
 
-void CCompiler::AddWavetable(CInstrumentFDS *pInstrument, CChunk *pChunk)
+bool CCompiler::IsPatternAddressed(int Pattern, int Channel) const		// // //
 {
-	// TODO Find equal existing waves
-	/*
-	for (int i = 0; i < m_iWaveTables; ++i) {
-		if (!memcmp(Wave, m_iWaveTable[i], 64))
+	// Check if a pattern is accessed by any frame of the scanned track
+	return m_vPatternUsed[Channel].test(Pattern);
+}
+
+int CCompiler::AddWavetable(CInstrumentFDS *pInstrument, CChunk *pChunk)		// // //
+{
+	unsigned char Wave[64];
+	for (int i = 0; i < 64; ++i)
+		Wave[i] = pInstrument->GetSample(i);
+
+	// Find equal existing waves
+	const unsigned char *pData = pChunk->GetBinaryData();
+	const int Count = pChunk->CountDataSize() / 64;
+	for (int i = 0; i < Count; ++i)
+		if (!memcmp(Wave, pData + i * 64, 64))
 			return i;
-	}
-	*/
 
 	// Allocate new wave
 	for (int i = 0; i < 64; ++i)
-		pChunk->StoreByte(pInstrument->GetSample(i));
+		pChunk->StoreByte(Wave[i]);
 
 	m_iWaveTables++;
+	return Count;
 }
 
 void CCompiler::WriteAssembly(CFile *pFile)
 {
 	// Dump all chunks and samples as assembly text
-	CChunkRenderText Render(pFile);
+	CChunkRenderText Render(pFile, *m_pLabels);		// // //
 	Render.StoreChunks(m_vChunks);
 	Print(_T(" * Music data size: %i bytes\n"), m_iMusicDataSize);
 	Render.StoreSamples(m_vSamples);
@@ -2168,10 +2376,14 @@ void CCompiler::WriteSamplesBinary(CFile *pFile)
 
 // Object list functions
 
-CChunk *CCompiler::CreateChunk(chunk_type_t Type, CStringA label)
+CChunk *CCompiler::CreateChunk(chunk_type_t Type, int Label)		// // //
 {
-	CChunk *pChunk = new CChunk(Type, label);
+	CChunk *pChunk = new CChunk(Type, Label, *m_pLabels);
 	m_vChunks.push_back(pChunk);
+	if (Label >= (int)m_vLabelChunks.size())
+		m_vLabelChunks.resize(Label + 1, nullptr);
+	if (m_vLabelChunks[Label] == nullptr)		// Keep the first chunk with a given label
+		m_vLabelChunks[Label] = pChunk;
 	return pChunk;
 }
 
@@ -2186,19 +2398,16 @@ int CCompiler::CountData() const
 	return Offset;
 }
 
-CChunk *CCompiler::GetObjectByRef(CStringA label) const
+CChunk *CCompiler::GetObjectByRef(int Label) const		// // //
 {
-	for (const auto pChunk : m_vChunks)
-		if (!label.Compare(pChunk->GetLabel()))
-			return pChunk;
-	return nullptr;
+	return Label >= 0 && Label < (int)m_vLabelChunks.size() ? m_vLabelChunks[Label] : nullptr;
 }
 
 #if 0
 
 void CCompiler::WriteChannelMap()
 {
-	CChunk *pChunk = CreateChunk(CHUNK_CHANNEL_MAP, "");
+	CChunk *pChunk = CreateChunk(CHUNK_CHANNEL_MAP, m_pLabels->Intern(CHUNK_LABEL_NONE));
 	
 	pChunk->StoreByte(CHANID_SQUARE1 + 1);
 	pChunk->StoreByte(CHANID_SQUARE2 + 1);
@@ -2248,7 +2457,7 @@ void CCompiler::WriteChannelTypes()
 	const int TYPE_N163 = 10;
 	const int TYPE_S5B	= 12;
 
-	CChunk *pChunk = CreateChunk(CHUNK_CHANNEL_TYPES, "");
+	CChunk *pChunk = CreateChunk(CHUNK_CHANNEL_TYPES, m_pLabels->Intern(CHUNK_LABEL_NONE));
 	
 	for (int i = 0; i < 4; ++i)
 		pChunk->StoreByte(TYPE_2A03);
@@ -22,6 +22,13 @@
 
 #pragma once
 
+#include <cstdint>		// // //
+#include <bitset>		// // //
+#include <memory>		// // //
+#include <unordered_map>		// // //
+#include "PatternCache.h"		// // //
+#include "SamplePacker.h"		// // //
+
 // NSF file header
 struct stNSFHeader {
 	unsigned char	Ident[5];
@@ -61,6 +68,7 @@ struct stNSFeHeader {		// // //
 
 struct driver_t;
 class CChunk;
+class CChunkLabelTable;		// // //
 enum chunk_type_t;
 class CDSample;		 // // //
 class CFamiTrackerDoc;		// // //
@@ -87,7 +95,7 @@ public:
 	CCompiler(CFamiTrackerDoc *pDoc, CCompilerLog *pLogger);
 	~CCompiler();
 	
-	void	ExportNSF(LPCTSTR lpszFileName, int MachineType);
+	bool	ExportNSF(LPCTSTR lpszFileName, int MachineType);		// // //
 	void	ExportNSFE(LPCTSTR lpszFileName, int MachineType);		// // //
 	void	ExportNES(LPCTSTR lpszFileName, bool EnablePAL);
 	void	ExportBIN(LPCTSTR lpszBIN_File, LPCTSTR lpszDPCM_File);
@@ -113,27 +121,30 @@ private:
 	bool	CompileData();
 	void	ResolveLabels();
 	bool	ResolveLabelsBankswitched();
-	void	CollectLabels(CMap<CStringA, LPCSTR, int, int> &labelMap) const;
-	bool	CollectLabelsBankswitched(CMap<CStringA, LPCSTR, int, int> &labelMap);
-	void	AssignLabels(CMap<CStringA, LPCSTR, int, int> &labelMap);
+	void	CollectLabels(std::vector<int> &labelMap) const;		// // //
+	bool	CollectLabelsBankswitched(std::vector<int> &labelMap);
+	void	AssignLabels(const std::vector<int> &labelMap);
 	void	AddBankswitching();
 	void	Cleanup();
 
 	void	ScanSong();
 	int		GetSampleIndex(int SampleNumber);
-	bool	IsPatternAddressed(unsigned int Track, int Pattern, int Channel) const;
-	bool	IsInstrumentInPattern(int index) const;
+	void	ScanPatternUsage(unsigned int Track);		// // //
+	bool	IsPatternAddressed(int Pattern, int Channel) const;		// // //
+	std::bitset<MAX_INSTRUMENTS> GetInstrumentsInPatterns() const;		// // //
 
 	void	CreateMainHeader();
 	void	CreateSequenceList();
 	void	CreateInstrumentList();
+	void	MergeDuplicateChunks();		// // //
 	void	CreateSampleList();
 	void	CreateFrameList(unsigned int Track);
 
-	int		StoreSequence(const CSequence *pSeq, CStringA &label);
+	int		StoreSequence(const CSequence *pSeq, int Label);		// // //
 	void	StoreSamples();
 	void	StoreGrooves();		// // //
 	void	StoreSongs();
+	void	CompilePatterns();		// // //
 	void	StorePatterns(unsigned int Track);
 
 	// Bankswitching functions
@@ -144,7 +155,7 @@ private:
 	void	EnableBankswitching();
 
 	// FDS
-	void	AddWavetable(CInstrumentFDS *pInstrument, CChunk *pChunk);
+	int		AddWavetable(CInstrumentFDS *pInstrument, CChunk *pChunk);		// // //
 
 	// File writing
 	void	WriteAssembly(CFile *pFile);
@@ -152,8 +163,8 @@ private:
 	void	WriteSamplesBinary(CFile *pFile);
 
 	// Object list functions
-	CChunk	*CreateChunk(chunk_type_t Type, CStringA label);
-	CChunk	*GetObjectByRef(CStringA label) const;
+	CChunk	*CreateChunk(chunk_type_t Type, int Label);		// // //
+	CChunk	*GetObjectByRef(int Label) const;
 	int		CountData() const;
 
 	// Debugging
@@ -194,6 +205,8 @@ private:
 
 	// Object lists
 	std::vector<CChunk*> m_vChunks;
+	std::unique_ptr<CChunkLabelTable> m_pLabels;		// // // Labels of all chunks
+	std::vector<CChunk*> m_vLabelChunks;		// // // Chunks indexed by label ID
 	std::vector<CChunk*> m_vSequenceChunks;
 	std::vector<CChunk*> m_vInstrumentChunks;
 	std::vector<CChunk*> m_vGrooveChunks;		// // //
@@ -232,6 +245,7 @@ private:
 	unsigned char	m_iSampleBank[MAX_DSAMPLES];
 	unsigned int	m_iSampleStart;
 	unsigned int	m_iSamplesUsed;
+	CSamplePacker	m_SamplePacker;		// // // Layout of the stored samples
 
 	// General
 	unsigned int	m_iMusicDataSize;		// All music data
@@ -248,6 +262,7 @@ private:
 	unsigned int	m_iSongBankReference;	// Offset to bank value in song header
 
 	unsigned int	m_iDuplicatePatterns;	// Number of duplicated patterns removed
+	unsigned int	m_iDuplicateBytes;		// // // Pattern bytes saved by removing duplicates
 
 	std::vector<int> m_vChanOrder;			// Channel order list
 
@@ -266,8 +281,24 @@ private:
 	int				m_iActualNamcoChannels;
 
 	// Optimization
-	CMap<UINT, UINT, CChunk*, CChunk*> m_PatternMap;
-	CMap<CStringA, LPCSTR, CStringA, LPCSTR> m_DuplicateMap;
+	std::unordered_multimap<uint64_t, CChunk*> m_PatternMap;		// // // Stored patterns by content hash
+	std::unordered_map<int, int> m_DuplicateMap;		// // // Label IDs of duplicate patterns
+
+	// // // Pattern data compiled in parallel, stored in the same order as a serial build
+	struct stPatternJob {
+		int Pattern;
+		int Channel;
+		std::string Key;		// Input of the pattern compiler
+		stCompiledPattern Result;
+	};
+	std::vector<std::vector<stPatternJob>> m_vCompiledPatterns;		// Indexed by track
+
+	static CPatternCache PatternCache;		// // // Compiled patterns of the last export in this session
+
+	// // // Pattern usage of the track being compiled
+	std::vector<std::bitset<MAX_PATTERN>> m_vPatternUsed;	// Indexed by channel
+	std::vector<unsigned int> m_vPatternFrameStart;		// Start of each pattern's frames, indexed by channel * MAX_PATTERN + pattern
+	std::vector<unsigned int> m_vPatternFrames;			// Frames using each pattern
 
 	// Debugging
 	CCompilerLog	*m_pLogger;
@@ -24,6 +24,7 @@
 #include "FamiTrackerView.h"
 #include "MainFrm.h"
 #include "SoundGen.h"
+#include "Settings.h"		// // //
 #include "TrackerChannel.h"
 #include "WavProgressDlg.h"
 #include "CreateWaveDlg.h"
@@ -104,7 +105,9 @@ void CCreateWaveDlg::OnBnClickedBegin()
 	}
 
 	CWavProgressDlg ProgressDlg;
-	CString fileFilter = LoadDefaultFilter(IDS_FILTER_WAV, _T(".wav"));	
+	CString wavFilter;		// // // the output format is chosen by the extension
+	wavFilter.LoadString(IDS_FILTER_WAV);
+	CString fileFilter = wavFilter + _T("|*.wav|") + LoadDefaultFilter(IDS_FILTER_FLAC, _T(".flac"));
 	CFileDialog SaveDialog(FALSE, _T("wav"), FileName, OFN_HIDEREADONLY | OFN_OVERWRITEPROMPT, fileFilter);
 
 	// Close this dialog
@@ -124,6 +127,9 @@ void CCreateWaveDlg::OnBnClickedBegin()
 		EndParam = GetTimeLimit();
 	}
 
+	static const int SAMPLE_SIZES[] = {8, 16, 24, 32};		// // //
+	theApp.GetSettings()->Sound.iRenderSampleSize = SAMPLE_SIZES[m_ctlSampleFormat.GetCurSel()];
+
 	pView->UnmuteAllChannels();
 
 	// Mute selected channels
@@ -172,6 +178,19 @@ BOOL CCreateWaveDlg::OnInitDialog()
 	CMainFrame *pMainFrm = static_cast<CMainFrame*>(theApp.GetMainWnd());
 	m_ctlTracks.SetCurSel(pMainFrm->GetSelectedTrack());
 
+	// // // Sample format of the wave file, the mixer output has 16-bit precision in any case
+	m_ctlSampleFormat.SubclassDlgItem(IDC_SAMPLE_FORMAT, this);
+	m_ctlSampleFormat.AddString(_T("8-bit PCM"));
+	m_ctlSampleFormat.AddString(_T("16-bit PCM"));
+	m_ctlSampleFormat.AddString(_T("24-bit PCM (16-bit padded)"));
+	m_ctlSampleFormat.AddString(_T("32-bit float (16-bit values)"));
+	switch (theApp.GetSettings()->Sound.iRenderSampleSize) {
+	case 8:  m_ctlSampleFormat.SetCurSel(0); break;
+	case 24: m_ctlSampleFormat.SetCurSel(2); break;
+	case 32: m_ctlSampleFormat.SetCurSel(3); break;
+	default: m_ctlSampleFormat.SetCurSel(1); break;
+	}
+
 	return TRUE;  // return TRUE unless you set the focus to a control
 	// EXCEPTION: OCX Property Pages should return FALSE
 }
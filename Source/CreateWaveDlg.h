@@ -44,6 +44,7 @@ protected:
 
 	CCheckListBox m_ctlChannelList;
 	CComboBox	  m_ctlTracks;
+	CComboBox	  m_ctlSampleFormat;		// // //
 
 	DECLARE_MESSAGE_MAP()
 public:
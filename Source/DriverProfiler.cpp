@@ -0,0 +1,162 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#include "DriverProfiler.h"
+#include <algorithm>
+#include "APU/APU.h"
+#include "APU/Types.h"
+#include "NSFPlayer.h"
+
+namespace {
+
+class CNullAudio : public IAudioCallback
+{
+public:
+	void FlushBuffer(int16_t *Buffer, uint32_t Size) override { }
+};
+
+} // namespace
+
+CSongPositionLog::CSongPositionLog(unsigned int MaxFrames, std::function<stSongPosition()> GetPosition) :
+	CRegisterSnapshotLog(MaxFrames),
+	m_GetPosition(std::move(GetPosition))
+{
+}
+
+stSongPosition CSongPositionLog::GetPosition(unsigned int Frame) const
+{
+	return Frame < m_vPositions.size() ? m_vPositions[Frame] : stSongPosition {-1, -1};
+}
+
+void CSongPositionLog::OnEndFrame(uint32_t Cycles, const int16_t *Buffer, uint32_t Size)
+{
+	const unsigned int Count = GetFrameCount();
+	CRegisterSnapshotLog::OnEndFrame(Cycles, Buffer, Size);
+	if (GetFrameCount() > Count)
+		m_vPositions.push_back(m_GetPosition ? m_GetPosition() : stSongPosition {-1, -1});
+}
+
+void CSongPositionLog::OnSongStart()
+{
+	CRegisterSnapshotLog::OnSongStart();
+	m_vPositions.clear();
+}
+
+CDriverProfiler::CDriverProfiler(int SampleRate) : m_iSampleRate(SampleRate)
+{
+}
+
+stDriverProfile CDriverProfiler::Profile(const char *pFile, unsigned int Song, const CSongPositionLog &Reference) const
+{
+	stDriverProfile Result = { };
+
+	CNSFPlayer Player;
+	if (!Player.LoadFile(pFile) || Song >= Player.GetSongCount()) {
+		Result.Status = VERIFY_LOAD_FAILED;
+		return Result;
+	}
+
+	CNullAudio Audio;
+	CAPU APU {&Audio};
+	APU.SetupSound(m_iSampleRate, 1, Player.GetMachine());
+	APU.ChangeMachineRate(Player.GetMachine(), Player.GetFrameRate());
+	APU.SetupMixer(30, 12000, 24, 100);
+	APU.SetExternalSound(Player.GetExpansionChip());
+
+	const unsigned int Frames = Reference.GetFrameCount() + CExportVerifier::MAX_FRAME_OFFSET;
+	CRegisterSnapshotLog Log {Frames};
+	APU.SetRegisterCapture(&Log);
+
+	if (!Player.Init(&APU, Song)) {
+		Result.Status = VERIFY_INIT_FAILED;
+		return Result;
+	}
+
+	std::vector<unsigned int> Cycles;
+	Cycles.reserve(Frames);
+	for (unsigned int i = 0; i < Frames; ++i) {
+		if (!Player.RunFrame()) {
+			Result.Status = VERIFY_PLAY_FAILED;
+			break;
+		}
+		Cycles.push_back(Player.GetFrameCycles());
+	}
+	APU.SetRegisterCapture(nullptr);
+
+	const uint32_t BaseFreq = Player.GetMachine() == MACHINE_PAL ? CAPU::BASE_FREQ_PAL : CAPU::BASE_FREQ_NTSC;
+	Result.Budget = BaseFreq / Player.GetFrameRate();
+	Result.Frames = Cycles.size();
+	Result.Overruns = Player.GetOverrunCount();
+	if (Cycles.empty())
+		return Result;
+
+	uint64_t Total = 0;
+	Result.MinCycles = Cycles[0];
+	for (unsigned int x : Cycles) {
+		Result.MinCycles = std::min(Result.MinCycles, x);
+		Result.MaxCycles = std::max(Result.MaxCycles, x);
+		Total += x;
+	}
+	Result.MeanCycles = static_cast<double>(Total) / Cycles.size();
+
+	// Export frames lag behind or lead the tracker by the offset that matches the most frames
+	const int Offset = CExportVerifier::Compare(Reference, Log).FrameOffset;
+
+	std::vector<unsigned int> Order(Cycles.size());
+	for (size_t i = 0; i < Order.size(); ++i)
+		Order[i] = i;
+	const size_t Count = std::min<size_t>(WORST_FRAME_COUNT, Order.size());
+	std::partial_sort(Order.begin(), Order.begin() + Count, Order.end(), [&Cycles] (unsigned int a, unsigned int b) {
+		return Cycles[a] > Cycles[b] || (Cycles[a] == Cycles[b] && a < b);
+	});
+	for (size_t i = 0; i < Count; ++i) {
+		const int Frame = static_cast<int>(Order[i]) - Offset;
+		Result.WorstFrames.push_back({Order[i], Cycles[Order[i]],
+			Frame >= 0 ? Reference.GetPosition(Frame) : stSongPosition {-1, -1}});
+	}
+
+	return Result;
+}
+
+nlohmann::json CDriverProfiler::ToJSON(const stDriverProfile &Profile)
+{
+	nlohmann::json Worst = nlohmann::json::array();
+	for (const auto &x : Profile.WorstFrames) {
+		nlohmann::json Frame = {{"frame", x.Frame}, {"cycles", x.Cycles}};
+		if (x.Position.Frame >= 0) {
+			Frame["pattern_frame"] = x.Position.Frame;
+			Frame["row"] = x.Position.Row;
+		}
+		Worst.push_back(Frame);
+	}
+
+	return {
+		{"frames", Profile.Frames},
+		{"budget_cycles", Profile.Budget},
+		{"min_cycles", Profile.MinCycles},
+		{"mean_cycles", Profile.MeanCycles},
+		{"max_cycles", Profile.MaxCycles},
+		{"overruns", Profile.Overruns},
+		{"worst_frames", Worst},
+	};
+}
@@ -0,0 +1,118 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "ExportVerifier.h"
+#include "json/json.hpp"
+
+/*!
+	\brief A position in a song.
+*/
+struct stSongPosition {
+	int Frame;		// Frame index, -1 if unknown
+	int Row;
+};
+
+/*!
+	\brief Records the register state and the song position at the end of every frame.
+	\details The position is queried from the thread producing the frames, once for every frame
+	recorded by the register snapshot log.
+*/
+class CSongPositionLog : public CRegisterSnapshotLog
+{
+public:
+	/*!	\brief Constructs an empty log.
+		\param MaxFrames The maximum number of recorded frames.
+		\param GetPosition Returns the position of the frame that has just ended.
+	*/
+	CSongPositionLog(unsigned int MaxFrames, std::function<stSongPosition()> GetPosition);
+
+	/*!	\brief Returns the position of a recorded frame. */
+	stSongPosition GetPosition(unsigned int Frame) const;
+
+	void OnEndFrame(uint32_t Cycles, const int16_t *Buffer, uint32_t Size) override;
+	void OnSongStart() override;
+
+private:
+	std::function<stSongPosition()> m_GetPosition;
+	std::vector<stSongPosition> m_vPositions;
+};
+
+/*!
+	\brief CPU usage of the play routine in a single frame.
+*/
+struct stProfileFrame {
+	unsigned int Frame;			// Frame index of the export
+	unsigned int Cycles;
+	stSongPosition Position;	// Song position of the corresponding tracker frame
+};
+
+/*!
+	\brief CPU usage of the play routine over a whole song.
+*/
+struct stDriverProfile {
+	verify_status_t Status;		// VERIFY_MATCH if the song could be played, regardless of its register state
+	unsigned int Frames;		// Number of profiled frames
+	unsigned int Budget;		// CPU cycles available per frame
+	unsigned int MinCycles;
+	unsigned int MaxCycles;
+	double MeanCycles;
+	unsigned int Overruns;		// Number of frames exceeding the budget
+	std::vector<stProfileFrame> WorstFrames;		// Most expensive frames, in decreasing order of cycles
+};
+
+/*!
+	\brief Measures the CPU cycles taken by the play routine of an exported NSF, NSFe or NES file.
+	\details The file is run on the same emulated CPU as the export verifier. Frames are matched
+	with the tracker's own playback of the song to find the song position of each frame. As with
+	the verifier, profiling must not run while another APU is emulated.
+*/
+class CDriverProfiler
+{
+public:
+	/*!	\brief The number of most expensive frames reported. */
+	static const unsigned int WORST_FRAME_COUNT = 10;
+
+	/*!	\brief Constructs the profiler.
+		\param SampleRate The sample rate of the emulated APU.
+	*/
+	explicit CDriverProfiler(int SampleRate);
+
+	/*!	\brief Profiles a single song of an exported file.
+		\param pFile The file name.
+		\param Song The zero-based song index.
+		\param Reference The register states and positions of the song played by the tracker.
+	*/
+	stDriverProfile Profile(const char *pFile, unsigned int Song, const CSongPositionLog &Reference) const;
+
+	/*!	\brief Converts a profile into a JSON object. */
+	static nlohmann::json ToJSON(const stDriverProfile &Profile);
+
+private:
+	int m_iSampleRate;
+};
@@ -0,0 +1,322 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#include "EmulationBenchmark.h"
+#include <algorithm>
+#include <chrono>
+#include "APU/APU.h"
+#include "APU/Types.h"
+#include "AudioFile.h"		// // //
+
+namespace {
+
+// Counts the generated audio, then passes it to a file if there is one
+class CNullAudio : public IAudioCallback
+{
+public:
+	explicit CNullAudio(IAudioFile *pFile) : m_pFile(pFile) {		// // //
+	}
+	void FlushBuffer(int16_t *Buffer, uint32_t Size) override {
+		m_iSamples += Size;
+		if (m_pFile) {
+			const auto Start = std::chrono::steady_clock::now();
+			m_pFile->WriteSamples(Buffer, Size);
+			m_WriteTime += std::chrono::steady_clock::now() - Start;
+		}
+	}
+	uint64_t GetSamples() const {
+		return m_iSamples;
+	}
+	double GetWriteSeconds() const {
+		return std::chrono::duration<double>(m_WriteTime).count();
+	}
+private:
+	IAudioFile *m_pFile;
+	uint64_t m_iSamples = 0;
+	std::chrono::steady_clock::duration m_WriteTime {0};
+};
+
+const int DPCM_SIZE = 0xFF1;		// longest sample, $4013 = $FF
+
+struct stChipConfig {
+	const char *Name;
+	uint8_t Chips;
+};
+
+const stChipConfig CHIP_CONFIGS[] = {
+	{"2A03", SNDCHIP_NONE},
+	{"VRC6", SNDCHIP_VRC6},
+	{"VRC7", SNDCHIP_VRC7},
+	{"FDS", SNDCHIP_FDS},
+	{"MMC5", SNDCHIP_MMC5},
+	{"N163", SNDCHIP_N163},
+	{"5B", SNDCHIP_S5B},
+	{"All", SNDCHIP_VRC6 | SNDCHIP_VRC7 | SNDCHIP_FDS | SNDCHIP_MMC5 | SNDCHIP_N163 | SNDCHIP_S5B},
+};
+
+void WriteN163(CAPU &APU, uint8_t Addr, uint8_t Value) {
+	APU.Write(0xF800, Addr);
+	APU.Write(0x4800, Value);
+}
+
+void WriteOPLL(CAPU &APU, uint8_t Reg, uint8_t Value) {
+	APU.Write(0x9010, Reg);
+	APU.Write(0x9030, Value);
+}
+
+void WriteS5B(CAPU &APU, uint8_t Reg, uint8_t Value) {
+	APU.Write(0xC000, Reg);
+	APU.Write(0xE000, Value);
+}
+
+// Sets up the parts of the chips that do not change between frames
+void InitChips(CAPU &APU, uint8_t Chips, const char *pSample) {
+	APU.Write(0x4015, 0x0F);
+	APU.Write(0x4017, 0x00);
+	APU.Write(0x4000, 0xBF);
+	APU.Write(0x4004, 0x7F);
+	APU.Write(0x4008, 0xFF);
+	APU.Write(0x400C, 0x3F);
+	APU.WriteSample(pSample, DPCM_SIZE);
+	APU.Write(0x4010, 0x4F);
+	APU.Write(0x4012, 0x00);
+	APU.Write(0x4013, 0xFF);
+	APU.Write(0x4015, 0x1F);
+
+	if (Chips & SNDCHIP_VRC6) {
+		APU.Write(0x9000, 0x7F);
+		APU.Write(0xA000, 0x3F);
+		APU.Write(0xB000, 0x2A);
+	}
+	if (Chips & SNDCHIP_MMC5) {
+		APU.Write(0x5015, 0x03);
+		APU.Write(0x5000, 0xBF);
+		APU.Write(0x5004, 0x7F);
+	}
+	if (Chips & SNDCHIP_FDS) {
+		APU.Write(0x4023, 0x83);
+		APU.Write(0x4089, 0x80);
+		for (int i = 0; i < 0x40; ++i)
+			APU.Write(0x4040 + i, (i < 0x20 ? i : 0x3F - i) * 2);
+		APU.Write(0x4089, 0x00);
+		APU.Write(0x4080, 0xA0);
+		APU.Write(0x4084, 0x84);
+		APU.Write(0x4086, 0x10);
+		APU.Write(0x4087, 0x00);
+	}
+	if (Chips & SNDCHIP_N163) {
+		APU.Write(0xF800, 0x80);
+		for (int i = 0; i < 0x20; ++i)
+			APU.Write(0x4800, static_cast<uint8_t>(i * 0x11 ^ 0x0F));
+		for (int i = 0; i < 8; ++i) {
+			const uint8_t Base = 0x40 + i * 8;
+			WriteN163(APU, Base + 6, 0x00);
+			WriteN163(APU, Base + 7, i == 7 ? 0x7F : 0x0F);
+		}
+	}
+	if (Chips & SNDCHIP_VRC7)
+		for (int i = 0; i < 6; ++i)
+			WriteOPLL(APU, 0x30 + i, static_cast<uint8_t>(((i + 1) << 4) | 0x02));
+	if (Chips & SNDCHIP_S5B) {
+		WriteS5B(APU, 0x07, 0x30);
+		WriteS5B(APU, 0x06, 0x0F);
+		WriteS5B(APU, 0x08, 0x0F);
+		WriteS5B(APU, 0x09, 0x0F);
+		WriteS5B(APU, 0x0A, 0x10);
+		WriteS5B(APU, 0x0B, 0x40);
+		WriteS5B(APU, 0x0C, 0x00);
+		WriteS5B(APU, 0x0D, 0x0E);
+	}
+}
+
+// Changes the pitch of every channel, similar to a module with vibrato on all channels
+void UpdateChips(CAPU &APU, uint8_t Chips, unsigned int Frame) {
+	const unsigned int Pitch = 0x100 + (Frame * 37 & 0xFF);
+
+	APU.Write(0x4002, Pitch & 0xFF);
+	APU.Write(0x4003, (Pitch >> 8) | 0x08);
+	APU.Write(0x4006, (Pitch >> 1) & 0xFF);
+	APU.Write(0x4007, (Pitch >> 9) | 0x08);
+	APU.Write(0x400A, Pitch & 0xFF);
+	APU.Write(0x400B, (Pitch >> 8) | 0x08);
+	APU.Write(0x400E, Frame & 0x0F);
+	APU.Write(0x400F, 0x08);
+	if (!APU.DPCMPlaying())
+		APU.Write(0x4015, 0x1F);
+
+	if (Chips & SNDCHIP_VRC6) {
+		APU.Write(0x9001, Pitch & 0xFF);
+		APU.Write(0x9002, 0x80 | (Pitch >> 8));
+		APU.Write(0xA001, (Pitch >> 1) & 0xFF);
+		APU.Write(0xA002, 0x80 | (Pitch >> 9));
+		APU.Write(0xB001, Pitch & 0xFF);
+		APU.Write(0xB002, 0x80 | (Pitch >> 8));
+	}
+	if (Chips & SNDCHIP_MMC5) {
+		APU.Write(0x5002, Pitch & 0xFF);
+		APU.Write(0x5003, (Pitch >> 8) | 0x08);
+		APU.Write(0x5006, (Pitch >> 1) & 0xFF);
+		APU.Write(0x5007, (Pitch >> 9) | 0x08);
+	}
+	if (Chips & SNDCHIP_FDS) {
+		APU.Write(0x4082, (Pitch << 1) & 0xFF);
+		APU.Write(0x4083, (Pitch >> 7) & 0x0F);
+	}
+	if (Chips & SNDCHIP_N163)
+		for (int i = 0; i < 8; ++i) {
+			const uint8_t Base = 0x40 + i * 8;
+			const unsigned int Freq = (Pitch << 6) + (i << 8);
+			WriteN163(APU, Base + 0, Freq & 0xFF);
+			WriteN163(APU, Base + 2, (Freq >> 8) & 0xFF);
+			WriteN163(APU, Base + 4, 0xE0 | ((Freq >> 16) & 0x03));
+		}
+	if (Chips & SNDCHIP_VRC7)
+		for (int i = 0; i < 6; ++i) {
+			WriteOPLL(APU, 0x10 + i, Pitch & 0xFF);
+			WriteOPLL(APU, 0x20 + i, 0x30 | ((i % 4 + 2) << 1) | ((Pitch >> 8) & 0x01));
+		}
+	if (Chips & SNDCHIP_S5B)
+		for (int i = 0; i < 3; ++i) {
+			WriteS5B(APU, i * 2, (Pitch >> i) & 0xFF);
+			WriteS5B(APU, i * 2 + 1, (Pitch >> (i + 8)) & 0x0F);
+		}
+}
+
+stStageStats GetFrameStats(std::vector<uint64_t> &Times) {
+	stStageStats Stats = { };
+	Stats.Count = static_cast<unsigned int>(Times.size());
+	if (Times.empty())
+		return Stats;
+	std::sort(Times.begin(), Times.end());
+	uint64_t Total = 0;
+	for (uint64_t t : Times)
+		Total += t;
+	Stats.Min = Times.front() / 1000.;
+	Stats.Mean = Total / 1000. / Times.size();
+	Stats.P99 = Times[(Times.size() - 1) * 99 / 100] / 1000.;
+	Stats.Max = Times.back() / 1000.;
+	return Stats;
+}
+
+} // namespace
+
+CEmulationBenchmark::CEmulationBenchmark(int SampleRate, unsigned int Frames) :
+	m_iSampleRate(SampleRate), m_iFrames(Frames), m_pCapture(nullptr), m_pAudioFile(nullptr)
+{
+}
+
+void CEmulationBenchmark::SetRegisterCapture(IRegisterCapture *pCapture)		// // //
+{
+	m_pCapture = pCapture;
+}
+
+void CEmulationBenchmark::SetAudioFile(IAudioFile *pFile)		// // //
+{
+	m_pAudioFile = pFile;
+}
+
+stEmulationResult CEmulationBenchmark::Run(const char *Name, uint8_t Chips) const
+{
+	using clock_t = std::chrono::steady_clock;
+
+	CNullAudio Audio {m_pAudioFile};		// // //
+	CAPU APU {&Audio};
+	APU.SetupSound(m_iSampleRate, 1, MACHINE_NTSC);
+	APU.SetupMixer(30, 12000, 24, 100);
+	APU.SetExternalSound(Chips);
+	APU.Reset();
+	APU.SetRegisterCapture(m_pCapture);		// // //
+
+	std::vector<char> Sample(DPCM_SIZE);
+	for (int i = 0; i < DPCM_SIZE; ++i)
+		Sample[i] = static_cast<char>(i * 0x9D >> 3);
+	InitChips(APU, Chips, Sample.data());
+
+	const uint32_t FrameCycles = CAPU::BASE_FREQ_NTSC / CAPU::FRAME_RATE_NTSC;
+	std::vector<uint64_t> Times;
+	Times.reserve(m_iFrames);
+
+	CStageTimer::Clear();
+	const auto Start = clock_t::now();
+	for (unsigned int i = 0; i < m_iFrames; ++i) {
+		const auto FrameStart = clock_t::now();
+		UpdateChips(APU, Chips, i);
+		APU.AddTime(FrameCycles);
+		APU.Process();
+		Times.push_back(static_cast<uint64_t>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t::now() - FrameStart).count()));
+	}
+	const auto End = clock_t::now();
+
+	stEmulationResult Result;
+	Result.Name = Name;
+	Result.Chips = Chips;
+	Result.Frames = m_iFrames;
+	Result.EmulatedSeconds = static_cast<double>(Audio.GetSamples()) / m_iSampleRate;
+	Result.WallSeconds = std::chrono::duration<double>(End - Start).count();
+	Result.WriteSeconds = Audio.GetWriteSeconds();		// // //
+	Result.FrameCost = GetFrameStats(Times);
+	for (int i = 0; i < PERF_STAGE_COUNT; ++i)
+		Result.Stages[i] = CStageTimer::Collect(static_cast<perf_stage_t>(i));
+	return Result;
+}
+
+std::vector<stEmulationResult> CEmulationBenchmark::RunAll() const
+{
+	std::vector<stEmulationResult> Results;
+	for (const auto &x : CHIP_CONFIGS)
+		Results.push_back(Run(x.Name, x.Chips));
+	return Results;
+}
+
+nlohmann::json CEmulationBenchmark::ToJSON(const stEmulationResult &Result)
+{
+	nlohmann::json Stages = nlohmann::json::object();
+	for (int i = 0; i < PERF_STAGE_COUNT; ++i)
+		if (Result.Stages[i].Count)
+			Stages[CStageTimer::GetStageName(static_cast<perf_stage_t>(i))] = ToJSON(Result.Stages[i]);
+
+	return {
+		{"name", Result.Name},
+		{"chips", Result.Chips},
+		{"frames", Result.Frames},
+		{"emulated_seconds", Result.EmulatedSeconds},
+		{"wall_seconds", Result.WallSeconds},
+		{"write_seconds", Result.WriteSeconds},
+		{"speed", Result.WallSeconds > 0. ? Result.EmulatedSeconds / Result.WallSeconds : 0.},
+		{"frame_us", ToJSON(Result.FrameCost)},
+		{"stages_us", Stages},
+	};
+}
+
+nlohmann::json CEmulationBenchmark::ToJSON(const stStageStats &Stats)
+{
+	return {
+		{"count", Stats.Count},
+		{"min", Stats.Min},
+		{"mean", Stats.Mean},
+		{"p99", Stats.P99},
+		{"max", Stats.Max},
+	};
+}
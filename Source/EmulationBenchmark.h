@@ -0,0 +1,88 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Common.h"
+#include "StageTimer.h"
+#include "json/json.hpp"
+
+class IAudioFile;		// // //
+
+/*!
+	\brief Result of a single sound emulation benchmark run.
+*/
+struct stEmulationResult {
+	const char *Name;			// Name of the chip combination
+	uint8_t Chips;				// Expansion chip flags
+	unsigned int Frames;		// Number of emulated frames
+	double EmulatedSeconds;		// Duration of the generated audio
+	double WallSeconds;			// Time taken to generate the audio
+	double WriteSeconds;		// // // Part of the wall time spent passing the audio to the attached file
+	stStageStats FrameCost;		// Time taken per frame, in microseconds
+	stStageStats Stages[PERF_STAGE_COUNT];		// Stage timer statistics of the run
+};
+
+/*!
+	\brief Measures the speed of the sound emulation core without a document or an audio device.
+	\details Each run drives a CAPU instance with a synthetic register write pattern that keeps
+	every channel of the selected chips audible and changes their pitch on every frame. The stage
+	timers are reset before every run.
+*/
+class CEmulationBenchmark
+{
+public:
+	/*!	\brief Constructs the benchmark.
+		\param SampleRate The output sample rate.
+		\param Frames The number of NTSC frames emulated in each run.
+	*/
+	CEmulationBenchmark(int SampleRate, unsigned int Frames);
+
+	/*!	\brief Runs the benchmark on a single chip combination.
+		\param Name A human-readable name of the combination.
+		\param Chips The expansion chip flags.
+	*/
+	stEmulationResult Run(const char *Name, uint8_t Chips) const;
+
+	/*!	\brief Attaches a register capture to the APU of every following run. */
+	void SetRegisterCapture(IRegisterCapture *pCapture);
+	/*!	\brief Streams the audio of every following run into a file, or discards it if null. */
+	void SetAudioFile(IAudioFile *pFile);		// // //
+
+	/*!	\brief Runs the benchmark on the 2A03 alone, each expansion chip, and all chips. */
+	std::vector<stEmulationResult> RunAll() const;
+
+	/*!	\brief Converts a benchmark result into a JSON object. */
+	static nlohmann::json ToJSON(const stEmulationResult &Result);
+	/*!	\brief Converts a timing summary into a JSON object. */
+	static nlohmann::json ToJSON(const stStageStats &Stats);
+
+private:
+	int m_iSampleRate;
+	unsigned int m_iFrames;
+	IRegisterCapture *m_pCapture;
+	IAudioFile *m_pAudioFile;		// // //
+};
@@ -36,6 +36,9 @@
 #include "CustomExporters.h"
 #include "DocumentWrapper.h"
 #include "MainFrm.h"
+#include "VGMExport.h"		// // //
+#include "SoundGen.h"		// // //
+#include "DriverProfiler.h"		// // //
 
 // Define internal exporters
 const LPTSTR CExportDialog::DEFAULT_EXPORT_NAMES[] = {
@@ -45,6 +48,7 @@ const LPTSTR CExportDialog::DEFAULT_EXPORT_NAMES[] = {
 	_T("PRG - Clean 32kB ROM image"),
 	_T("ASM - Assembly source"),
 	_T("NSFe - Extended Nintendo Sound File"),		// // //
+	_T("VGM - Video Game Music"),		// // //
 };
 
 const exportFunc_t CExportDialog::DEFAULT_EXPORT_FUNCS[] = {
@@ -54,9 +58,10 @@ const exportFunc_t CExportDialog::DEFAULT_EXPORT_FUNCS[] = {
 	&CExportDialog::CreatePRG,
 	&CExportDialog::CreateASM,
 	&CExportDialog::CreateNSFe,		// // //
+	&CExportDialog::CreateVGM,		// // //
 };
 
-const int CExportDialog::DEFAULT_EXPORTERS = 6;		// // //
+const int CExportDialog::DEFAULT_EXPORTERS = 7;		// // //
 
 // Remember last option when dialog is closed
 int CExportDialog::m_iExportOption = 0;
@@ -69,6 +74,7 @@ LPCTSTR CExportDialog::DPCMS_FILTER[] = { _T("DPCM sample bank (*.bin)"), _T(".b
 LPCTSTR CExportDialog::PRG_FILTER[]   = { _T("NES program bank (*.prg)"), _T(".prg") };
 LPCTSTR CExportDialog::ASM_FILTER[]	  = { _T("Assembly text (*.asm)"), _T(".asm") };
 LPCTSTR CExportDialog::NSFE_FILTER[]  = { _T("NSFe file (*.nsfe)"), _T(".nsfe") };		// // //
+LPCTSTR CExportDialog::VGM_FILTER[]   = { _T("VGM file (*.vgm)"), _T(".vgm") };		// // //
 
 // Compiler logger
 
@@ -96,6 +102,14 @@ void CEditLog::Clear()
 	m_pEdit->RedrawWindow();
 }
 
+// // // Driver profiling
+
+namespace {
+
+const unsigned int PROFILE_MAX_FRAMES = 36000;		// Ten minutes at 60 Hz
+
+} // namespace
+
 // CExportDialog dialog
 
 IMPLEMENT_DYNAMIC(CExportDialog, CDialog)
@@ -118,6 +132,7 @@ BEGIN_MESSAGE_MAP(CExportDialog, CDialog)
 	ON_BN_CLICKED(IDC_CLOSE, OnBnClickedClose)
 	ON_BN_CLICKED(IDC_EXPORT, &CExportDialog::OnBnClickedExport)
 	ON_BN_CLICKED(IDC_PLAY, OnBnClickedPlay)
+	ON_BN_CLICKED(IDC_PROFILE, &CExportDialog::OnBnClickedProfile)		// // //
 END_MESSAGE_MAP()
 
 
@@ -280,6 +295,40 @@ void CExportDialog::CreateNSFe()		// // //
 	theApp.GetSettings()->SetPath(FileDialog.GetPathName(), PATH_NSF);
 }
 
+void CExportDialog::CreateVGM()		// // //
+{
+	CFamiTrackerDoc *pDoc = CFamiTrackerDoc::GetDoc();
+	CString	DefFileName = pDoc->GetFileTitle();
+	CVGMExport Exporter(pDoc, new CEditLog(GetDlgItem(IDC_OUTPUT)));
+	CString Name, Artist, Copyright;
+	CString filter = LoadDefaultFilter(VGM_FILTER[0], VGM_FILTER[1]);
+
+	// Collect header info
+	GetDlgItemText(IDC_NAME, Name);
+	GetDlgItemText(IDC_ARTIST, Artist);
+	GetDlgItemText(IDC_COPYRIGHT, Copyright);
+
+	USES_CONVERSION;
+
+	pDoc->SetSongName(T2A(Name.GetBuffer()));
+	pDoc->SetSongArtist(T2A(Artist.GetBuffer()));
+	pDoc->SetSongCopyright(T2A(Copyright.GetBuffer()));
+
+	CFileDialog FileDialog(FALSE, VGM_FILTER[1], DefFileName, OFN_HIDEREADONLY | OFN_OVERWRITEPROMPT, filter);
+
+	FileDialog.m_pOFN->lpstrInitialDir = theApp.GetSettings()->GetPath(PATH_NSF);
+
+	if (FileDialog.DoModal() == IDCANCEL)
+		return;
+
+	// Display wait cursor
+	CWaitCursor wait;
+
+	Exporter.ExportAll(FileDialog.GetPathName());
+
+	theApp.GetSettings()->SetPath(FileDialog.GetPathName(), PATH_NSF);
+}
+
 void CExportDialog::CreateNES()
 {
 	CFamiTrackerDoc *pDoc = CFamiTrackerDoc::GetDoc();
@@ -433,3 +482,59 @@ void CExportDialog::OnBnClickedPlay()
 
 #endif
 }
+
+void CExportDialog::OnBnClickedProfile()		// // //
+{
+	CFamiTrackerDoc *pDoc = CFamiTrackerDoc::GetDoc();
+	CSoundGen *pSoundGen = theApp.GetSoundGenerator();
+
+	TCHAR TempPath[MAX_PATH], TempFile[MAX_PATH];
+	if (!GetTempPath(MAX_PATH, TempPath) || !GetTempFileName(TempPath, _T("0cc"), 0, TempFile))
+		return;
+
+	// Display wait cursor
+	CWaitCursor wait;
+
+	CCompiler Compiler(pDoc, new CEditLog(GetDlgItem(IDC_OUTPUT)));
+	if (!Compiler.ExportNSF(TempFile, IsDlgButtonChecked(IDC_PAL) != 0)) {
+		// The compiler has already written the error to the log
+		DeleteFile(TempFile);
+		return;
+	}
+
+	CEditLog Log(GetDlgItem(IDC_OUTPUT));
+	CString str;
+	Log.WriteLog(_T("Profiling driver...\r\n"));
+
+	const unsigned int Tracks = pDoc->GetTrackCount();
+	for (unsigned int i = 0; i < Tracks; ++i) {
+		const auto pReference = std::make_shared<CSongPositionLog>(PROFILE_MAX_FRAMES, [pSoundGen] {
+			return stSongPosition {pSoundGen->GetPlayerFrame(), pSoundGen->GetPlayerRow()};
+		});
+		if (!pSoundGen->RenderSongToLog(*pReference, i)) {
+			str.Format(_T(" * Track %u: could not render song\r\n"), i + 1);
+			Log.WriteLog(str);
+			continue;
+		}
+
+		const stDriverProfile Profile = pSoundGen->ProfileExport(TempFile, i, pReference);
+		if (Profile.Status != VERIFY_MATCH || !Profile.Frames) {
+			str.Format(_T(" * Track %u: could not run exported song\r\n"), i + 1);
+			Log.WriteLog(str);
+			continue;
+		}
+
+		str.Format(_T(" * Track %u: %u / %.0f / %u cycles (min / mean / max) of %u, %u frame(s) over budget\r\n"),
+			i + 1, Profile.MinCycles, Profile.MeanCycles, Profile.MaxCycles, Profile.Budget, Profile.Overruns);
+		Log.WriteLog(str);
+		for (const auto &Frame : Profile.WorstFrames) {
+			if (Frame.Position.Frame < 0)
+				str.Format(_T("   %u cycles at export frame %u\r\n"), Frame.Cycles, Frame.Frame);
+			else
+				str.Format(_T("   %u cycles at frame %02X, row %02X\r\n"), Frame.Cycles, Frame.Position.Frame, Frame.Position.Row);
+			Log.WriteLog(str);
+		}
+	}
+
+	DeleteFile(TempFile);
+}
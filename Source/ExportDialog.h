@@ -54,6 +54,7 @@ protected:
 	static LPCTSTR PRG_FILTER[2];
 	static LPCTSTR ASM_FILTER[2];
 	static LPCTSTR NSFE_FILTER[2];		// // //
+	static LPCTSTR VGM_FILTER[2];		// // //
 
 #ifdef _DEBUG
 	CString m_strFile;
@@ -67,6 +68,7 @@ protected:
 	void CreatePRG();
 	void CreateASM();
 	void CreateNSFe();		// // //
+	void CreateVGM();		// // //
 	void CreateCustom( CString name );
 
 	DECLARE_MESSAGE_MAP()
@@ -75,4 +77,5 @@ public:
 	afx_msg void OnBnClickedClose();
 	afx_msg void OnBnClickedExport();
 	afx_msg void OnBnClickedPlay();
+	afx_msg void OnBnClickedProfile();		// // //
 };
@@ -0,0 +1,252 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#include "ExportVerifier.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "APU/APU.h"
+#include "APU/Types.h"
+#include "NSFPlayer.h"
+
+namespace {
+
+// Register index layout of the snapshots
+const unsigned int INDEX_2A03 = 0x000;		// $4000 - $409F, includes the FDS
+const unsigned int INDEX_MMC5 = 0x0A0;		// $5000 - $5015
+const unsigned int INDEX_VRC6 = 0x0C0;		// $9000 - $9003, $A000 - $A002, $B000 - $B002
+const unsigned int INDEX_N163 = 0x100;		// Sound RAM
+const unsigned int INDEX_VRC7 = 0x180;
+const unsigned int INDEX_S5B  = 0x1C0;
+
+class CNullAudio : public IAudioCallback
+{
+public:
+	void FlushBuffer(int16_t *Buffer, uint32_t Size) override { }
+};
+
+} // namespace
+
+CRegisterSnapshotLog::CRegisterSnapshotLog(unsigned int MaxFrames) :
+	m_iMaxFrames(MaxFrames),
+	m_iN163Address(0),
+	m_iVRC7Address(0),
+	m_iS5BAddress(0),
+	m_bStopped(false),
+	m_bFinished(false)
+{
+	memset(m_iState, 0, sizeof(m_iState));
+}
+
+unsigned int CRegisterSnapshotLog::GetFrameCount() const
+{
+	return static_cast<unsigned int>(m_vFrames.size() / REGISTER_COUNT);
+}
+
+const uint8_t *CRegisterSnapshotLog::GetFrame(unsigned int Frame) const
+{
+	return &m_vFrames[Frame * REGISTER_COUNT];
+}
+
+bool CRegisterSnapshotLog::IsSongFinished() const
+{
+	return m_bFinished;
+}
+
+bool CRegisterSnapshotLog::IsCompared(unsigned int Index)
+{
+	switch (Index) {
+	case INDEX_2A03 + 0x12:		// DPCM sample address
+	case INDEX_2A03 + 0x14:
+	case INDEX_2A03 + 0x15:		// channel enable and DPCM start
+	case INDEX_2A03 + 0x16:
+	case INDEX_2A03 + 0x17:		// frame counter
+	case INDEX_2A03 + 0x23:		// FDS I/O enable
+	case INDEX_MMC5 + 0x15:		// channel enable
+		return false;
+	}
+	return Index < REGISTER_COUNT;
+}
+
+std::string CRegisterSnapshotLog::GetRegisterName(unsigned int Index)
+{
+	char Name[16] = { };
+	if (Index >= INDEX_S5B)
+		snprintf(Name, sizeof(Name), "5B $%02X", Index - INDEX_S5B);
+	else if (Index >= INDEX_VRC7)
+		snprintf(Name, sizeof(Name), "VRC7 $%02X", Index - INDEX_VRC7);
+	else if (Index >= INDEX_N163)
+		snprintf(Name, sizeof(Name), "N163 $%02X", Index - INDEX_N163);
+	else if (Index >= INDEX_VRC6)
+		snprintf(Name, sizeof(Name), "$%04X", 0x9000 + ((Index - INDEX_VRC6) / 4 << 12) + (Index - INDEX_VRC6) % 4);
+	else if (Index >= INDEX_MMC5)
+		snprintf(Name, sizeof(Name), "$%04X", 0x5000 + Index - INDEX_MMC5);
+	else
+		snprintf(Name, sizeof(Name), "$%04X", 0x4000 + Index);
+	return Name;
+}
+
+int CRegisterSnapshotLog::DecodeWrite(uint16_t Address, uint8_t Value)
+{
+	if (Address >= 0x4000 && Address < 0x40A0)
+		return INDEX_2A03 + Address - 0x4000;
+	if (Address >= 0x5000 && Address <= 0x5015)
+		return INDEX_MMC5 + Address - 0x5000;
+
+	switch (Address) {
+	case 0x9000: case 0x9001: case 0x9002: case 0x9003:
+	case 0xA000: case 0xA001: case 0xA002:
+	case 0xB000: case 0xB001: case 0xB002:
+		return INDEX_VRC6 + ((Address >> 12) - 0x9) * 4 + (Address & 0x03);
+	case 0xF800:
+		m_iN163Address = Value;
+		return -1;
+	case 0x4800: {
+		const int Index = INDEX_N163 + (m_iN163Address & 0x7F);
+		if (m_iN163Address & 0x80)
+			m_iN163Address = ((m_iN163Address + 1) & 0x7F) | 0x80;
+		return Index;
+	}
+	case 0x9010:
+		m_iVRC7Address = Value & 0x3F;
+		return -1;
+	case 0x9030:
+		return INDEX_VRC7 + m_iVRC7Address;
+	case 0xC000:
+		m_iS5BAddress = Value & 0x0F;
+		return -1;
+	case 0xE000:
+		return INDEX_S5B + m_iS5BAddress;
+	}
+
+	return -1;
+}
+
+void CRegisterSnapshotLog::OnWrite(uint16_t Address, uint8_t Value, uint32_t Cycle)
+{
+	const int Index = DecodeWrite(Address, Value);
+	if (Index >= 0)
+		m_iState[Index] = Value;
+}
+
+void CRegisterSnapshotLog::OnEndFrame(uint32_t Cycles, const int16_t *Buffer, uint32_t Size)
+{
+	if (m_bStopped || GetFrameCount() >= m_iMaxFrames)
+		return;
+	m_vFrames.insert(m_vFrames.end(), m_iState, m_iState + REGISTER_COUNT);
+}
+
+void CRegisterSnapshotLog::OnSongStart()
+{
+	m_vFrames.clear();
+	m_bStopped = false;
+	m_bFinished = false;
+}
+
+void CRegisterSnapshotLog::OnSongEnd()
+{
+	m_bStopped = true;
+	m_bFinished = true;
+}
+
+CExportVerifier::CExportVerifier(int SampleRate) : m_iSampleRate(SampleRate)
+{
+}
+
+stVerifyResult CExportVerifier::Verify(const char *pFile, unsigned int Song, const CRegisterSnapshotLog &Reference) const
+{
+	stVerifyResult Result = { };
+
+	CNSFPlayer Player;
+	if (!Player.LoadFile(pFile) || Song >= Player.GetSongCount()) {
+		Result.Status = VERIFY_LOAD_FAILED;
+		return Result;
+	}
+
+	CNullAudio Audio;
+	CAPU APU {&Audio};
+	APU.SetupSound(m_iSampleRate, 1, Player.GetMachine());
+	APU.ChangeMachineRate(Player.GetMachine(), Player.GetFrameRate());
+	APU.SetupMixer(30, 12000, 24, 100);
+	APU.SetExternalSound(Player.GetExpansionChip());
+
+	const unsigned int Frames = Reference.GetFrameCount() + MAX_FRAME_OFFSET;
+	CRegisterSnapshotLog Log {Frames};
+	APU.SetRegisterCapture(&Log);
+
+	if (!Player.Init(&APU, Song)) {
+		Result.Status = VERIFY_INIT_FAILED;
+		return Result;
+	}
+
+	for (unsigned int i = 0; i < Frames; ++i)
+		if (!Player.RunFrame()) {
+			Result.Status = VERIFY_PLAY_FAILED;
+			Result.Frame = i;
+			return Result;
+		}
+
+	APU.SetRegisterCapture(nullptr);
+	return Compare(Reference, Log);
+}
+
+stVerifyResult CExportVerifier::Compare(const CRegisterSnapshotLog &Expected, const CRegisterSnapshotLog &Actual)
+{
+	stVerifyResult Best = { };
+	bool bFound = false;
+
+	for (int Offset = 0; Offset <= MAX_FRAME_OFFSET * 2; ++Offset) {
+		// Try the offsets nearest to zero first, later offsets must match strictly more frames
+		const int d = Offset % 2 ? -(Offset + 1) / 2 : Offset / 2;
+
+		stVerifyResult Result = { };
+		Result.Status = VERIFY_MATCH;
+		Result.FrameOffset = d;
+
+		const int First = std::max(0, -d);
+		const int Last = std::min<int>(Expected.GetFrameCount(), Actual.GetFrameCount() - d);
+		for (int f = First; f < Last && Result.Status == VERIFY_MATCH; ++f) {
+			const uint8_t *pExpected = Expected.GetFrame(f);
+			const uint8_t *pActual = Actual.GetFrame(f + d);
+			for (unsigned int i = 0; i < CRegisterSnapshotLog::REGISTER_COUNT; ++i)
+				if (pExpected[i] != pActual[i] && CRegisterSnapshotLog::IsCompared(i)) {
+					Result.Status = VERIFY_MISMATCH;
+					Result.Frame = f;
+					Result.Register = i;
+					Result.Expected = pExpected[i];
+					Result.Actual = pActual[i];
+					break;
+				}
+		}
+		Result.Frames = std::max((Result.Status == VERIFY_MATCH ? Last : static_cast<int>(Result.Frame)) - First, 0);
+
+		if (Result.Status == VERIFY_MATCH)
+			return Result;
+		if (!bFound || Result.Frames > Best.Frames) {
+			Best = Result;
+			bFound = true;
+		}
+	}
+
+	return Best;
+}
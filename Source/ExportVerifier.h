@@ -0,0 +1,140 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Common.h"
+
+/*!
+	\brief Records the state of the sound registers at the end of every frame.
+	\details Registers behind an address port, such as the N163 sound RAM and the VRC7 and 5B
+	registers, are tracked through their port writes. Frames before the start of a rendered song
+	are discarded, and recording stops at the end of the song or after a fixed number of frames.
+*/
+class CRegisterSnapshotLog : public IRegisterCapture
+{
+public:
+	/*!	\brief The number of tracked registers. */
+	static const unsigned int REGISTER_COUNT = 0x1D0;
+
+	/*!	\brief Constructs an empty log.
+		\param MaxFrames The maximum number of recorded frames.
+	*/
+	explicit CRegisterSnapshotLog(unsigned int MaxFrames);
+
+	unsigned int GetFrameCount() const;
+	/*!	\brief Returns the register state at the end of a frame, REGISTER_COUNT bytes. */
+	const uint8_t *GetFrame(unsigned int Frame) const;
+	/*!	\brief Returns whether a rendered song has ended. Can be called from any thread. */
+	bool IsSongFinished() const;
+
+	/*!	\brief Returns whether a register is compared between two logs. Status registers and the
+		DPCM sample address, which depends on the location of the samples, are not compared.
+	*/
+	static bool IsCompared(unsigned int Index);
+	/*!	\brief Returns a human-readable name of a register. */
+	static std::string GetRegisterName(unsigned int Index);
+
+	void OnWrite(uint16_t Address, uint8_t Value, uint32_t Cycle) override;
+	void OnEndFrame(uint32_t Cycles, const int16_t *Buffer, uint32_t Size) override;
+	void OnSongStart() override;
+	void OnSongEnd() override;
+
+private:
+	int DecodeWrite(uint16_t Address, uint8_t Value);
+
+private:
+	unsigned int m_iMaxFrames;
+	std::vector<uint8_t> m_vFrames;
+	uint8_t m_iState[REGISTER_COUNT];
+	uint8_t m_iN163Address;
+	uint8_t m_iVRC7Address;
+	uint8_t m_iS5BAddress;
+	bool m_bStopped;
+	std::atomic<bool> m_bFinished;
+};
+
+/*!
+	\brief Outcome of an export verification.
+*/
+enum verify_status_t {
+	VERIFY_MATCH,				// All compared frames are identical
+	VERIFY_MISMATCH,			// A frame differs from the reference
+	VERIFY_LOAD_FAILED,			// The exported file could not be loaded
+	VERIFY_INIT_FAILED,			// The init routine did not return
+	VERIFY_PLAY_FAILED,			// The play routine did not return
+	VERIFY_TIMEOUT,				// The verification did not finish in time
+};
+
+/*!
+	\brief Result of an export verification.
+*/
+struct stVerifyResult {
+	verify_status_t Status;
+	unsigned int Frames;		// Number of matching frames before the first difference
+	int FrameOffset;			// Number of frames by which the export lags behind the reference
+	unsigned int Frame;			// Reference frame of the first difference or failed play call
+	unsigned int Register;		// Index of the first differing register
+	uint8_t Expected;			// Register value of the reference
+	uint8_t Actual;				// Register value of the export
+};
+
+/*!
+	\brief Checks that an exported NSF, NSFe or NES file plays the same as the tracker.
+	\details The file is run on an emulated CPU, with its register writes going through a separate
+	CAPU instance. The register state at the end of every frame is compared against a reference
+	recorded from the tracker's own playback. The export may lag behind or lead the reference by
+	a few frames; the offset that matches the most frames is used. The sound chip emulation shares
+	some global state between CAPU instances, so a verification must not run while another APU
+	is emulated.
+*/
+class CExportVerifier
+{
+public:
+	/*!	\brief The maximum number of frames by which the export may be misaligned. */
+	static const int MAX_FRAME_OFFSET = 2;
+
+	/*!	\brief Constructs the verifier.
+		\param SampleRate The sample rate of the emulated APU.
+	*/
+	explicit CExportVerifier(int SampleRate);
+
+	/*!	\brief Verifies a single song of an exported file.
+		\param pFile The file name.
+		\param Song The zero-based song index.
+		\param Reference The register states of the song played by the tracker.
+	*/
+	stVerifyResult Verify(const char *pFile, unsigned int Song, const CRegisterSnapshotLog &Reference) const;
+
+	/*!	\brief Compares two register logs. */
+	static stVerifyResult Compare(const CRegisterSnapshotLog &Expected, const CRegisterSnapshotLog &Actual);
+
+private:
+	int m_iSampleRate;
+};
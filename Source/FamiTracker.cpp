@@ -38,6 +38,8 @@
 #include "CustomExporters.h"
 #include "CommandLineExport.h"
 #include "WinSDK/VersionHelpers.h"		// // //
+#include "TraceLog.h"		// // //
+#include "RegressionTest.h"		// // //
 
 #include "WinInet.h"		// // //
 #pragma comment(lib, "wininet.lib")
@@ -108,6 +110,7 @@ BOOL CFamiTrackerApp::InitInstance()
 	CWinApp::InitInstance();
 
 	TRACE("App: InitInstance\n");
+	CTraceLog::SetThreadName("User interface");		// // //
 
 	if (!AfxOleInit()) {
 		TRACE("OLE initialization failed\n");
@@ -214,9 +217,21 @@ BOOL CFamiTrackerApp::InitInstance()
 #endif
 
 	// Handle command line export
-	if (cmdInfo.m_bExport) {
+	if (cmdInfo.m_bExport && !CCommandLineExport::RequiresSoundGenerator(cmdInfo.m_strExportFile)) {		// // //
 		CCommandLineExport exporter;
 		exporter.CommandLineExport(cmdInfo.m_strFileName, cmdInfo.m_strExportFile, cmdInfo.m_strExportLogFile, cmdInfo.m_strExportDPCMFile);
+		// // // NSF, NSFe and NES exports are verified once the sound thread is running
+		if (!CCommandLineExport::IsVerifiedExport(cmdInfo.m_strExportFile))
+			ExitProcess(0);
+	}
+	if (cmdInfo.m_bBenchmark) {		// // //
+		CCommandLineExport exporter;
+		exporter.CommandLineBenchmark(cmdInfo.m_strBenchmarkFile, cmdInfo.m_strBenchmarkModules);
+		ExitProcess(0);
+	}
+	if (cmdInfo.m_bGenerate) {		// // //
+		CCommandLineExport exporter;
+		exporter.CommandLineGenerate(cmdInfo.m_strGenerateFile, cmdInfo.m_strGenerateLogFile, cmdInfo.m_strGenerateOptions);
 		ExitProcess(0);
 	}
 
@@ -255,10 +270,39 @@ BOOL CFamiTrackerApp::InitInstance()
 	
 	// Initialize midi unit
 	m_pMIDI->Init();
+
+	// // // Log all register writes of this session
+	if (cmdInfo.m_bLog && !m_pSoundGenerator->OpenRegisterLog(_T("apu_log.bin")))
+		AfxMessageBox(_T("Could not create the register log file."), MB_ICONERROR);
 	
 	if (cmdInfo.m_bPlay)
 		theApp.StartPlayer(MODE_PLAY);
 
+	// // // VGM export, audio rendering and export verification, require the sound thread and the loaded module
+	if (cmdInfo.m_bExport) {
+		CCommandLineExport exporter;
+		if (CCommandLineExport::IsAudioRender(cmdInfo.m_strExportFile))
+			exporter.CommandLineRenderAudio(cmdInfo.m_strExportFile, cmdInfo.m_strExportLogFile);
+		else if (CCommandLineExport::RequiresSoundGenerator(cmdInfo.m_strExportFile))
+			exporter.CommandLineExportVGM(cmdInfo.m_strExportFile, cmdInfo.m_strExportLogFile);
+		else {
+			exporter.CommandLineVerifyExport(cmdInfo.m_strExportFile, cmdInfo.m_strExportLogFile);
+			if (cmdInfo.m_bProfile)		// // //
+				exporter.CommandLineProfileExport(cmdInfo.m_strExportFile, cmdInfo.m_strProfileFile);
+		}
+		ExitProcess(0);
+	}
+
+	// // // Regression test, requires the sound thread and the main window
+	if (cmdInfo.m_bRegression) {
+		CRegressionTest Test {cmdInfo.m_strRegressionPath, cmdInfo.m_bRegressionUpdate, stdout};
+		for (int i = 0; i < cmdInfo.m_strRegressionModules.GetCount(); ++i)
+			Test.RunModule(cmdInfo.m_strRegressionModules[i]);
+		fprintf(stdout, "%i of %i modules failed\n", Test.GetFailureCount(), static_cast<int>(cmdInfo.m_strRegressionModules.GetCount()));
+		fflush(stdout);
+		ExitProcess(Test.GetFailureCount() ? 1 : 0);
+	}
+
 	// Save the main window handle
 	RegisterSingleInstance();
 
@@ -927,6 +971,11 @@ CFTCommandLineInfo::CFTCommandLineInfo() : CCommandLineInfo(),
 	m_bLog(false), 
 	m_bExport(false), 
 	m_bPlay(false),
+	m_bBenchmark(false),		// // //
+	m_bGenerate(false),		// // //
+	m_bRegression(false),		// // //
+	m_bRegressionUpdate(false),
+	m_bProfile(false),		// // //
 	m_strExportFile(_T("")),
 	m_strExportLogFile(_T("")),
 	m_strExportDPCMFile(_T(""))
@@ -941,6 +990,31 @@ void CFTCommandLineInfo::ParseParam(const TCHAR* pszParam, BOOL bFlag, BOOL bLas
 			m_bExport = true;
 			return;
 		}
+		// // // Benchmark (/benchmark), followed by the report file name and the modules
+		else if (!_tcsicmp(pszParam, _T("benchmark"))) {
+			m_bBenchmark = true;
+			return;
+		}
+		// // // Module generator (/generate), followed by the output file name, the log file name and the settings
+		else if (!_tcsicmp(pszParam, _T("generate"))) {
+			m_bGenerate = true;
+			return;
+		}
+		// // // Regression test (/regress), followed by the golden file directory and the modules
+		else if (!_tcsicmp(pszParam, _T("regress"))) {
+			m_bRegression = true;
+			return;
+		}
+		// // // Rewrite the golden files of the regression test (/update)
+		else if (!_tcsicmp(pszParam, _T("update"))) {
+			m_bRegressionUpdate = true;
+			return;
+		}
+		// // // Driver profile of a verified export (/profile), followed by the report file name
+		else if (!_tcsicmp(pszParam, _T("profile"))) {
+			m_bProfile = true;
+			return;
+		}
 		// Auto play (/play or /p)
 		else if (!_tcsicmp(pszParam, _T("play")) || !_tcsicmp(pszParam, _T("p"))) {
 			m_bPlay = true;
@@ -953,12 +1027,10 @@ void CFTCommandLineInfo::ParseParam(const TCHAR* pszParam, BOOL bFlag, BOOL bLas
 #endif
 			return;
 		}
-		// Enable register logger (/log), available in debug mode only
-		else if (!_tcsicmp(pszParam, _T("log"))) {
-#ifdef _DEBUG
+		// Enable register logger (/log)
+		else if (!_tcsicmp(pszParam, _T("log"))) {		// // //
 			m_bLog = true;
 			return;
-#endif
 		}
 		// Enable console output (TODO)
 		// This is intended for a small helper program that avoids the problem with console on win32 programs,
@@ -973,6 +1045,33 @@ void CFTCommandLineInfo::ParseParam(const TCHAR* pszParam, BOOL bFlag, BOOL bLas
 		}
 	}
 	else {
+		if (m_bBenchmark) {		// // //
+			if (m_strBenchmarkFile.IsEmpty())
+				m_strBenchmarkFile = pszParam;
+			else
+				m_strBenchmarkModules.Add(pszParam);
+			return;
+		}
+		if (m_bGenerate) {		// // //
+			if (m_strGenerateFile.IsEmpty())
+				m_strGenerateFile = pszParam;
+			else if (m_strGenerateLogFile.IsEmpty() && m_strGenerateOptions.IsEmpty() && !_tcschr(pszParam, _T('=')))
+				m_strGenerateLogFile = pszParam;
+			else
+				m_strGenerateOptions.Add(pszParam);
+			return;
+		}
+		if (m_bRegression) {		// // //
+			if (m_strRegressionPath.IsEmpty())
+				m_strRegressionPath = pszParam;
+			else
+				m_strRegressionModules.Add(pszParam);
+			return;
+		}
+		if (m_bProfile && m_strProfileFile.IsEmpty()) {		// // //
+			m_strProfileFile = pszParam;
+			return;
+		}
 		// Store NSF name, then log filename
 		if (m_bExport == true) {
 			if (m_strExportFile.GetLength() == 0)
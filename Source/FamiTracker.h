@@ -52,9 +52,22 @@ public:
 	bool m_bLog;
 	bool m_bExport;
 	bool m_bPlay;
+	bool m_bBenchmark;		// // //
+	bool m_bGenerate;		// // //
+	bool m_bRegression;		// // //
+	bool m_bRegressionUpdate;
+	bool m_bProfile;		// // //
 	CString m_strExportFile;
 	CString m_strExportLogFile;
 	CString m_strExportDPCMFile;
+	CString m_strBenchmarkFile;		// // //
+	CStringArray m_strBenchmarkModules;
+	CString m_strGenerateFile;		// // //
+	CString m_strGenerateLogFile;
+	CStringArray m_strGenerateOptions;
+	CString m_strRegressionPath;		// // //
+	CStringArray m_strRegressionModules;
+	CString m_strProfileFile;		// // //
 };
 
 
@@ -74,6 +74,7 @@
 #include "BookmarkManager.h"		// // //
 #include "APU/APU.h"
 #include "str_conv/str_conv.hpp"
+#include "TraceLog.h"		// // //
 
 using json = nlohmann::json;
 
@@ -243,6 +244,7 @@ CFamiTrackerDoc *CFamiTrackerDoc::GetDoc()
 // Synchronization
 BOOL CFamiTrackerDoc::LockDocument() const
 {
+	CTraceScope Trace {"LockDocument wait"};		// // //
 	return m_csDocumentLock.Lock();
 }
 
@@ -3444,8 +3446,7 @@ void CFamiTrackerDoc::GetDataAtPattern(unsigned int Track, unsigned int Pattern,
 	ASSERT(pData != NULL);
 
 	// Get note from a direct pattern
-	CPatternData *pTrack = GetTrack(Track);
-	memcpy(pData, pTrack->GetPatternData(Channel, Pattern, Row), sizeof(stChanNote));
+	GetTrack(Track)->GetNoteData(Channel, Pattern, Row, pData);		// // //
 }
 
 bool CFamiTrackerDoc::InsertRow(unsigned int Track, unsigned int Frame, unsigned int Channel, unsigned int Row)
@@ -77,6 +77,10 @@ const int MAX_TEMPO	= 255;
 // Min speed
 const int MIN_SPEED = 1;
 
+// // // Custom engine speed range, in Hz
+const int RATE_MIN = 16;
+const int RATE_MAX = 400;
+
 // // // Maximum number of grooves
 const int MAX_GROOVE = 32;
 
@@ -0,0 +1,831 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "FlacCodec.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+const unsigned int RICE_PARAM_MAX = 30;			// 31 is the escape code of 5-bit parameters
+const unsigned int RICE4_PARAM_MAX = 14;		// 15 is the escape code of 4-bit parameters
+
+enum : unsigned int {
+	SUBFRAME_CONSTANT = 0x00,
+	SUBFRAME_VERBATIM = 0x01,
+	SUBFRAME_FIXED = 0x08,
+	SUBFRAME_LPC = 0x20,
+};
+
+template <typename T, unsigned int Poly>
+std::array<T, 256> MakeCRCTable()
+{
+	std::array<T, 256> Table;
+	const unsigned int Top = (sizeof(T) * 8) - 8;
+	for (unsigned int i = 0; i < 256; ++i) {
+		T x = static_cast<T>(i << Top);
+		for (int j = 0; j < 8; ++j)
+			x = static_cast<T>((x & (T(1) << (Top + 7))) ? (x << 1) ^ Poly : x << 1);
+		Table[i] = x;
+	}
+	return Table;
+}
+
+const auto CRC8_TABLE = MakeCRCTable<uint8_t, 0x07>();
+const auto CRC16_TABLE = MakeCRCTable<uint16_t, 0x8005>();
+
+uint8_t CRC8(const uint8_t *pData, size_t Size)
+{
+	uint8_t CRC = 0;
+	for (size_t i = 0; i < Size; ++i)
+		CRC = CRC8_TABLE[CRC ^ pData[i]];
+	return CRC;
+}
+
+uint16_t CRC16(const uint8_t *pData, size_t Size)
+{
+	uint16_t CRC = 0;
+	for (size_t i = 0; i < Size; ++i)
+		CRC = static_cast<uint16_t>((CRC << 8) ^ CRC16_TABLE[(CRC >> 8) ^ pData[i]]);
+	return CRC;
+}
+
+uint32_t ZigZag(int32_t x)
+{
+	return x < 0 ? ~(static_cast<uint32_t>(x) << 1) : static_cast<uint32_t>(x) << 1;
+}
+
+class CBitWriter
+{
+public:
+	void Write(uint32_t Value, unsigned int Bits) {
+		m_iAcc = (m_iAcc << Bits) | (Value & ((uint64_t(1) << Bits) - 1));
+		m_iBits += Bits;
+		while (m_iBits >= 8) {
+			m_iBits -= 8;
+			m_vData.push_back(static_cast<uint8_t>(m_iAcc >> m_iBits));
+		}
+	}
+	void WriteSigned(int32_t Value, unsigned int Bits) {
+		Write(static_cast<uint32_t>(Value), Bits);
+	}
+	void WriteUnary(uint32_t Zeros) {
+		for (; Zeros >= 32; Zeros -= 32)
+			Write(0, 32);
+		Write(1, Zeros + 1);
+	}
+	void WriteRice(int32_t Value, unsigned int Param) {
+		const uint32_t u = ZigZag(Value);
+		const uint32_t q = u >> Param;
+		if (q + 1 + Param <= 32)		// the terminator and the remainder in one step
+			Write((uint32_t(1) << Param) | (u & ((uint32_t(1) << Param) - 1)), q + 1 + Param);
+		else {
+			WriteUnary(q);
+			Write(u, Param);
+		}
+	}
+	void Align() {
+		if (m_iBits)
+			Write(0, 8 - m_iBits);
+	}
+	void Reserve(size_t Size) {
+		m_vData.reserve(Size);
+	}
+	std::vector<uint8_t> &GetData() {
+		return m_vData;
+	}
+
+private:
+	std::vector<uint8_t> m_vData;
+	uint64_t m_iAcc = 0;
+	unsigned int m_iBits = 0;
+};
+
+unsigned int CountLeadingZeros(uint64_t x)
+{
+	if (!x)
+		return 64;
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long Index;
+	_BitScanReverse64(&Index, x);
+	return 63 - Index;
+#elif defined(__GNUC__)
+	return static_cast<unsigned int>(__builtin_clzll(x));
+#else
+	unsigned int n = 0;
+	for (unsigned int Step = 32; Step; Step >>= 1)
+		if (!(x >> (64 - Step))) {
+			x <<= Step;
+			n += Step;
+		}
+	return n;
+#endif
+}
+
+class CBitReader
+{
+public:
+	CBitReader(const uint8_t *pData, size_t Size) : m_pData(pData), m_iSize(Size) { }
+
+	uint32_t Read(unsigned int Bits) {
+		if (!Bits)
+			return 0;
+		if (m_iCacheBits < Bits)
+			Fill();
+		const uint32_t x = static_cast<uint32_t>(m_iCache >> (64 - Bits));
+		Consume(Bits);
+		return x;
+	}
+	int32_t ReadSigned(unsigned int Bits) {
+		if (!Bits)
+			return 0;
+		const uint32_t x = Read(Bits);
+		return Bits < 32 && (x >> (Bits - 1)) ? static_cast<int32_t>(x - (uint32_t(1) << Bits)) : static_cast<int32_t>(x);
+	}
+	uint32_t ReadUnary() {
+		uint32_t Zeros = 0;
+		while (true) {
+			if (!m_iCacheBits)
+				Fill();
+			if (m_bError)
+				return Zeros;
+			// Bits beyond the cached ones are always zero
+			const unsigned int Leading = CountLeadingZeros(m_iCache);
+			if (Leading < m_iCacheBits) {
+				Consume(Leading + 1);
+				return Zeros + Leading;
+			}
+			Zeros += m_iCacheBits;
+			Consume(m_iCacheBits);
+		}
+	}
+	int32_t ReadRice(unsigned int Param) {
+		// Most codes fit in the cache, those are read in one step
+		if (m_iCacheBits < 32)
+			Fill();
+		const unsigned int Leading = CountLeadingZeros(m_iCache);
+		if (Leading + 1 + Param <= m_iCacheBits) {
+			const uint64_t Rest = m_iCache << Leading << 1;
+			const uint32_t u = (Leading << Param) | (Param ? static_cast<uint32_t>(Rest >> (64 - Param)) : 0);
+			Consume(Leading + 1 + Param);
+			return (u & 1) ? -static_cast<int32_t>(u >> 1) - 1 : static_cast<int32_t>(u >> 1);
+		}
+		const uint32_t u = (ReadUnary() << Param) | Read(Param);
+		return (u & 1) ? -static_cast<int32_t>(u >> 1) - 1 : static_cast<int32_t>(u >> 1);
+	}
+	void Align() {
+		Read((8 - m_iConsumed % 8) % 8);
+	}
+	size_t GetBytePos() const {
+		return static_cast<size_t>(m_iConsumed / 8);
+	}
+	bool HasError() const {
+		return m_bError;
+	}
+
+private:
+	void Fill() {
+		// The cache is left-aligned, missing bytes past the end read as zero
+		while (m_iCacheBits <= 56) {
+			const uint64_t Byte = m_iBytePos < m_iSize ? m_pData[m_iBytePos] : 0;
+			m_iCache |= Byte << (56 - m_iCacheBits);
+			m_iCacheBits += 8;
+			++m_iBytePos;
+		}
+	}
+	void Consume(unsigned int Bits) {
+		m_iCache = Bits < 64 ? m_iCache << Bits : 0;
+		m_iCacheBits -= Bits;
+		m_iConsumed += Bits;
+		if (m_iConsumed > uint64_t(m_iSize) * 8)
+			m_bError = true;
+	}
+
+	const uint8_t *m_pData;
+	size_t m_iSize;
+	size_t m_iBytePos = 0;
+	uint64_t m_iCache = 0;
+	unsigned int m_iCacheBits = 0;
+	uint64_t m_iConsumed = 0;
+	bool m_bError = false;
+};
+
+// Rice coding of a residual, the partitions always cover the whole block
+
+struct stRiceCoding {
+	unsigned int PartitionOrder;
+	std::vector<unsigned int> Params;
+	uint64_t Bits;
+};
+
+stRiceCoding ChooseRiceCoding(const int32_t *pResidual, unsigned int BlockSize, unsigned int Order)
+{
+	unsigned int MaxOrder = 0;
+	while (MaxOrder < CFlacEncoder::MAX_PARTITION_ORDER && !(BlockSize & (1u << MaxOrder)) &&
+		(BlockSize >> (MaxOrder + 1)) > Order)
+		++MaxOrder;
+
+	// Sums of the finest partitions, merged pairwise for the coarser ones
+	const unsigned int Count = 1u << MaxOrder;
+	std::vector<uint64_t> Sums(Count);
+	const int32_t *p = pResidual;
+	for (unsigned int i = 0; i < Count; ++i) {
+		const unsigned int Length = (BlockSize >> MaxOrder) - (i ? 0 : Order);
+		uint64_t Sum = 0;
+		for (unsigned int j = 0; j < Length; ++j)
+			Sum += ZigZag(*p++);
+		Sums[i] = Sum;
+	}
+
+	stRiceCoding Best = {0, { }, UINT64_MAX};
+	for (unsigned int PartitionOrder = MaxOrder + 1; PartitionOrder-- > 0; ) {
+		const unsigned int Partitions = 1u << PartitionOrder;
+		if (PartitionOrder < MaxOrder)
+			for (unsigned int i = 0; i < Partitions; ++i)
+				Sums[i] = Sums[i * 2] + Sums[i * 2 + 1];
+
+		stRiceCoding Coding = {PartitionOrder, std::vector<unsigned int>(Partitions), 6};
+		unsigned int MaxParam = 0;
+		for (unsigned int i = 0; i < Partitions; ++i) {
+			const uint64_t Length = (BlockSize >> PartitionOrder) - (i ? 0 : Order);
+			// Estimate the size as the quotients of the mean plus the unary terminators
+			unsigned int Param = 0;
+			while (Param < RICE_PARAM_MAX && (Length << (Param + 1)) < Sums[i])
+				++Param;
+			uint64_t Bits = Length * (Param + 1) + (Sums[i] >> Param);
+			if (Param) {
+				const uint64_t Lower = Length * Param + (Sums[i] >> (Param - 1));
+				if (Lower < Bits) {
+					Bits = Lower;
+					--Param;
+				}
+			}
+			Coding.Params[i] = Param;
+			Coding.Bits += Bits;
+			MaxParam = std::max(MaxParam, Param);
+		}
+		Coding.Bits += Partitions * (MaxParam > RICE4_PARAM_MAX ? 5 : 4);
+		if (Coding.Bits < Best.Bits)
+			Best = std::move(Coding);
+	}
+	return Best;
+}
+
+void WriteResidual(CBitWriter &Writer, const int32_t *pResidual, unsigned int BlockSize, unsigned int Order, const stRiceCoding &Coding)
+{
+	const bool bRice5 = *std::max_element(Coding.Params.begin(), Coding.Params.end()) > RICE4_PARAM_MAX;
+	Writer.Write(bRice5 ? 1 : 0, 2);
+	Writer.Write(Coding.PartitionOrder, 4);
+	for (size_t i = 0; i < Coding.Params.size(); ++i) {
+		const unsigned int Param = Coding.Params[i];
+		Writer.Write(Param, bRice5 ? 5 : 4);
+		const unsigned int Length = (BlockSize >> Coding.PartitionOrder) - (i ? 0 : Order);
+		for (unsigned int j = 0; j < Length; ++j)
+			Writer.WriteRice(*pResidual++, Param);
+	}
+}
+
+// Predictors
+
+void FixedResidual(const int32_t *x, unsigned int n, unsigned int Order, int32_t *r)
+{
+	for (unsigned int i = Order; i < n; ++i) {
+		switch (Order) {
+		case 0: *r++ = x[i]; break;
+		case 1: *r++ = x[i] - x[i - 1]; break;
+		case 2: *r++ = x[i] - 2 * x[i - 1] + x[i - 2]; break;
+		case 3: *r++ = x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3]; break;
+		case 4: *r++ = x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4]; break;
+		}
+	}
+}
+
+unsigned int ChooseFixedOrder(const int32_t *x, unsigned int n)
+{
+	uint64_t Error[5] = { };
+	for (unsigned int i = 4; i < n; ++i) {
+		const int64_t e0 = x[i];
+		const int64_t e1 = e0 - x[i - 1];
+		const int64_t e2 = e1 - (int64_t(x[i - 1]) - x[i - 2]);
+		const int64_t e3 = e2 - (int64_t(x[i - 1]) - 2 * int64_t(x[i - 2]) + x[i - 3]);
+		const int64_t e4 = e3 - (int64_t(x[i - 1]) - 3 * int64_t(x[i - 2]) + 3 * int64_t(x[i - 3]) - x[i - 4]);
+		Error[0] += std::llabs(e0);
+		Error[1] += std::llabs(e1);
+		Error[2] += std::llabs(e2);
+		Error[3] += std::llabs(e3);
+		Error[4] += std::llabs(e4);
+	}
+	return static_cast<unsigned int>(std::min_element(std::begin(Error), std::end(Error)) - std::begin(Error));
+}
+
+bool QuantizeLPC(const double *Coefs, unsigned int Order, int32_t *Quantized, int &Shift)
+{
+	const int QMax = (1 << (CFlacEncoder::LPC_PRECISION - 1)) - 1;
+	const int QMin = -(1 << (CFlacEncoder::LPC_PRECISION - 1));
+
+	double CMax = 0.;
+	for (unsigned int i = 0; i < Order; ++i)
+		CMax = std::max(CMax, std::abs(Coefs[i]));
+	if (!(CMax > 0.))
+		return false;
+
+	int Log2CMax;
+	std::frexp(CMax, &Log2CMax);
+	Shift = std::min(static_cast<int>(CFlacEncoder::LPC_PRECISION) - Log2CMax - 1, 15);
+	if (Shift < 0)
+		return false;
+
+	// Error feedback keeps the rounding errors from accumulating
+	double Error = 0.;
+	for (unsigned int i = 0; i < Order; ++i) {
+		Error += Coefs[i] * (1 << Shift);
+		const long q = std::lround(Error);
+		Quantized[i] = static_cast<int32_t>(std::min<long>(std::max<long>(q, QMin), QMax));
+		Error -= Quantized[i];
+	}
+	return true;
+}
+
+bool LPCResidual(const int32_t *x, unsigned int n, const int32_t *Coefs, unsigned int Order, int Shift, int32_t *r)
+{
+	for (unsigned int i = Order; i < n; ++i) {
+		int64_t Sum = 0;
+		for (unsigned int j = 0; j < Order; ++j)
+			Sum += int64_t(Coefs[j]) * x[i - j - 1];
+		const int64_t e = x[i] - (Sum >> Shift);
+		if (e > INT32_MAX / 2 || e < INT32_MIN / 2)
+			return false;
+		*r++ = static_cast<int32_t>(e);
+	}
+	return true;
+}
+
+void EncodeSubframe(CBitWriter &Writer, const int32_t *pSamples, unsigned int n, unsigned int Bits, const std::vector<double> &Window)
+{
+	// Constant subframe
+	if (std::all_of(pSamples, pSamples + n, [&] (int32_t x) { return x == pSamples[0]; })) {
+		Writer.Write(SUBFRAME_CONSTANT << 1, 8);
+		Writer.WriteSigned(pSamples[0], Bits);
+		return;
+	}
+
+	// Wasted bits are shifted out, this makes 24-bit output of 16-bit samples as cheap as 16-bit
+	int32_t Or = 0;
+	for (unsigned int i = 0; i < n; ++i)
+		Or |= pSamples[i];
+	unsigned int Wasted = 0;
+	while (!(Or & 1)) {
+		Or >>= 1;
+		++Wasted;
+	}
+	std::vector<int32_t> x(pSamples, pSamples + n);
+	if (Wasted)
+		for (auto &s : x)
+			s >>= Wasted;
+	Bits -= Wasted;
+
+	// Verbatim size, then the best fixed predictor
+	uint64_t BestBits = uint64_t(n) * Bits;
+	unsigned int BestType = SUBFRAME_VERBATIM;
+	unsigned int BestOrder = 0;
+
+	std::vector<int32_t> Residual(n), BestResidual;
+	stRiceCoding BestCoding;
+	if (n > 4) {
+		const unsigned int Order = ChooseFixedOrder(x.data(), n);
+		FixedResidual(x.data(), n, Order, Residual.data());
+		stRiceCoding Coding = ChooseRiceCoding(Residual.data(), n, Order);
+		const uint64_t Size = Order * Bits + Coding.Bits;
+		if (Size < BestBits) {
+			BestBits = Size;
+			BestType = SUBFRAME_FIXED;
+			BestOrder = Order;
+			BestCoding = std::move(Coding);
+			BestResidual.swap(Residual);
+			Residual.resize(n);
+		}
+	}
+
+	// LPC, the order is estimated from the prediction error of the Levinson-Durbin recursion
+	int32_t QCoefs[CFlacEncoder::MAX_LPC_ORDER] = { };
+	int BestShift = 0;
+	const unsigned int MaxOrder = n / 2 < CFlacEncoder::MAX_LPC_ORDER ? n / 2 : CFlacEncoder::MAX_LPC_ORDER;
+	if (MaxOrder) {
+		// The windowed samples are preceded by zeros, so that all lags are summed in the same pass
+		// with independent accumulators
+		const unsigned int Pad = CFlacEncoder::MAX_LPC_ORDER;
+		std::vector<double> y(Pad + n);
+		for (unsigned int i = 0; i < n; ++i)
+			y[Pad + i] = x[i] * (Window.size() == n ? Window[i] : 1.);
+		double R[CFlacEncoder::MAX_LPC_ORDER + 1] = { };
+		for (unsigned int i = Pad; i < Pad + n; ++i)
+			for (unsigned int l = 0; l <= CFlacEncoder::MAX_LPC_ORDER; ++l)
+				R[l] += y[i] * y[i - l];
+
+		if (R[0] > 0.) {
+			double Coefs[CFlacEncoder::MAX_LPC_ORDER][CFlacEncoder::MAX_LPC_ORDER];
+			double a[CFlacEncoder::MAX_LPC_ORDER] = { };
+			double Error = R[0];
+			unsigned int Order = 0;
+			double OrderBits = 0.;
+			for (unsigned int m = 0; m < MaxOrder && Error > 0.; ++m) {
+				double k = -R[m + 1];
+				for (unsigned int j = 0; j < m; ++j)
+					k -= a[j] * R[m - j];
+				k /= Error;
+				double Next[CFlacEncoder::MAX_LPC_ORDER];
+				for (unsigned int j = 0; j < m; ++j)
+					Next[j] = a[j] + k * a[m - 1 - j];
+				Next[m] = k;
+				std::copy(Next, Next + m + 1, a);
+				Error *= 1. - k * k;
+				for (unsigned int j = 0; j <= m; ++j)
+					Coefs[m][j] = -a[j];
+
+				const double PerSample = std::max(0., .5 * std::log2(.5 / n * std::max(Error, 1e-30)));
+				const double Estimate = PerSample * (n - m - 1) + (m + 1) * (Bits + CFlacEncoder::LPC_PRECISION);
+				if (!Order || Estimate < OrderBits) {
+					Order = m + 1;
+					OrderBits = Estimate;
+				}
+			}
+
+			int32_t q[CFlacEncoder::MAX_LPC_ORDER];
+			int Shift;
+			if (Order && QuantizeLPC(Coefs[Order - 1], Order, q, Shift) &&
+				LPCResidual(x.data(), n, q, Order, Shift, Residual.data())) {
+				stRiceCoding Coding = ChooseRiceCoding(Residual.data(), n, Order);
+				const uint64_t Size = Order * (Bits + CFlacEncoder::LPC_PRECISION) + 4 + 5 + Coding.Bits;
+				if (Size < BestBits) {
+					BestBits = Size;
+					BestType = SUBFRAME_LPC;
+					BestOrder = Order;
+					BestShift = Shift;
+					std::copy(q, q + Order, QCoefs);
+					BestCoding = std::move(Coding);
+					BestResidual.swap(Residual);
+				}
+			}
+		}
+	}
+
+	const unsigned int Type = BestType == SUBFRAME_FIXED ? SUBFRAME_FIXED | BestOrder :
+		BestType == SUBFRAME_LPC ? SUBFRAME_LPC | (BestOrder - 1) : BestType;
+	Writer.Write((Type << 1) | (Wasted ? 1 : 0), 8);
+	if (Wasted)
+		Writer.WriteUnary(Wasted - 1);
+
+	if (BestType == SUBFRAME_VERBATIM) {
+		for (unsigned int i = 0; i < n; ++i)
+			Writer.WriteSigned(x[i], Bits);
+		return;
+	}
+
+	for (unsigned int i = 0; i < BestOrder; ++i)
+		Writer.WriteSigned(x[i], Bits);
+	if (BestType == SUBFRAME_LPC) {
+		Writer.Write(CFlacEncoder::LPC_PRECISION - 1, 4);
+		Writer.WriteSigned(BestShift, 5);
+		for (unsigned int i = 0; i < BestOrder; ++i)
+			Writer.WriteSigned(QCoefs[i], CFlacEncoder::LPC_PRECISION);
+	}
+	WriteResidual(Writer, BestResidual.data(), n, BestOrder, BestCoding);
+}
+
+bool DecodeSubframe(CBitReader &Reader, int32_t *x, unsigned int n, unsigned int Bits)
+{
+	if (Reader.Read(1))
+		return false;
+	const unsigned int Type = Reader.Read(6);
+	unsigned int Wasted = 0;
+	if (Reader.Read(1))
+		Wasted = Reader.ReadUnary() + 1;
+	if (Wasted >= Bits)
+		return false;
+	Bits -= Wasted;
+
+	if (Type == SUBFRAME_CONSTANT)
+		std::fill(x, x + n, Reader.ReadSigned(Bits));
+	else if (Type == SUBFRAME_VERBATIM)
+		for (unsigned int i = 0; i < n; ++i)
+			x[i] = Reader.ReadSigned(Bits);
+	else {
+		unsigned int Order;
+		int32_t Coefs[32];
+		unsigned int Precision = 0;
+		int Shift = 0;
+		if (Type >= SUBFRAME_LPC) {
+			Order = (Type & 0x1F) + 1;
+		}
+		else if (Type >= SUBFRAME_FIXED && Type <= (SUBFRAME_FIXED | 4))
+			Order = Type & 0x07;
+		else
+			return false;
+		if (Order > n)
+			return false;
+
+		for (unsigned int i = 0; i < Order; ++i)
+			x[i] = Reader.ReadSigned(Bits);
+		if (Type >= SUBFRAME_LPC) {
+			Precision = Reader.Read(4) + 1;
+			Shift = Reader.ReadSigned(5);
+			if (Precision == 16 || Shift < 0)
+				return false;
+			for (unsigned int i = 0; i < Order; ++i)
+				Coefs[i] = Reader.ReadSigned(Precision);
+		}
+
+		// Residual
+		const unsigned int Method = Reader.Read(2);
+		if (Method > 1)
+			return false;
+		const unsigned int ParamBits = Method ? 5 : 4;
+		const unsigned int Escape = (1u << ParamBits) - 1;
+		const unsigned int PartitionOrder = Reader.Read(4);
+		if ((n >> PartitionOrder) << PartitionOrder != n || (n >> PartitionOrder) < Order)
+			return false;
+		int32_t *r = x + Order;
+		for (unsigned int i = 0; i < (1u << PartitionOrder); ++i) {
+			const unsigned int Param = Reader.Read(ParamBits);
+			const unsigned int Length = (n >> PartitionOrder) - (i ? 0 : Order);
+			if (Param == Escape) {
+				const unsigned int Raw = Reader.Read(5);
+				for (unsigned int j = 0; j < Length; ++j)
+					*r++ = Reader.ReadSigned(Raw);
+			}
+			else
+				for (unsigned int j = 0; j < Length; ++j)
+					*r++ = Reader.ReadRice(Param);
+			if (Reader.HasError())
+				return false;
+		}
+
+		// Prediction
+		if (Type >= SUBFRAME_LPC)
+			for (unsigned int i = Order; i < n; ++i) {
+				int64_t Sum = 0;
+				for (unsigned int j = 0; j < Order; ++j)
+					Sum += int64_t(Coefs[j]) * x[i - j - 1];
+				x[i] = static_cast<int32_t>(x[i] + (Sum >> Shift));
+			}
+		else for (unsigned int i = Order; i < n; ++i) {
+			int64_t Sum = 0;
+			switch (Order) {
+			case 1: Sum = x[i - 1]; break;
+			case 2: Sum = 2 * int64_t(x[i - 1]) - x[i - 2]; break;
+			case 3: Sum = 3 * int64_t(x[i - 1]) - 3 * int64_t(x[i - 2]) + x[i - 3]; break;
+			case 4: Sum = 4 * int64_t(x[i - 1]) - 6 * int64_t(x[i - 2]) + 4 * int64_t(x[i - 3]) - x[i - 4]; break;
+			}
+			x[i] = static_cast<int32_t>(x[i] + Sum);
+		}
+	}
+
+	if (Wasted)
+		for (unsigned int i = 0; i < n; ++i)
+			x[i] = static_cast<int32_t>(static_cast<uint32_t>(x[i]) << Wasted);
+	return !Reader.HasError();
+}
+
+unsigned int GetSampleRateCode(unsigned int Rate)
+{
+	static const unsigned int RATES[] = {0, 88200, 176400, 192000, 8000, 16000, 22050, 24000, 32000, 44100, 48000, 96000};
+	for (unsigned int i = 1; i < std::size(RATES); ++i)
+		if (RATES[i] == Rate)
+			return i;
+	if (Rate % 1000 == 0 && Rate / 1000 < 256)
+		return 12;
+	if (Rate < 65536)
+		return 13;
+	if (Rate % 10 == 0 && Rate / 10 < 65536)
+		return 14;
+	return 0;
+}
+
+unsigned int GetSampleSizeCode(unsigned int Bits)
+{
+	switch (Bits) {
+	case 8:  return 1;
+	case 12: return 2;
+	case 16: return 4;
+	case 20: return 5;
+	case 24: return 6;
+	}
+	return 0;
+}
+
+} // namespace
+
+CFlacEncoder::CFlacEncoder(const stFlacFormat &Format, unsigned int BlockSize) :
+	m_Format(Format),
+	m_vWindow(BlockSize)
+{
+	// Tukey window with half of the block tapered
+	const double Taper = .5 * (BlockSize - 1) / 2.;
+	for (unsigned int i = 0; i < BlockSize; ++i) {
+		const double d = std::min<double>(i, BlockSize - 1 - i);
+		m_vWindow[i] = d < Taper ? .5 - .5 * std::cos(PI * d / Taper) : 1.;
+	}
+}
+
+std::vector<uint8_t> CFlacEncoder::EncodeFrame(const int32_t *pSamples, unsigned int Count, uint64_t Frame) const
+{
+	CBitWriter Writer;
+	Writer.Reserve(size_t(Count) * m_Format.Channels * m_Format.BitsPerSample / 8 + 64);
+
+	// Frame header
+	const unsigned int SizeCode = Count == 4096 ? 12 : Count == 4608 ? 5 : 7;
+	const unsigned int RateCode = GetSampleRateCode(m_Format.SampleRate);
+	Writer.Write(0x3FFE, 14);
+	Writer.Write(0, 1);
+	Writer.Write(0, 1);		// Fixed block size
+	Writer.Write(SizeCode, 4);
+	Writer.Write(RateCode, 4);
+	Writer.Write(m_Format.Channels - 1, 4);
+	Writer.Write(GetSampleSizeCode(m_Format.BitsPerSample), 3);
+	Writer.Write(0, 1);
+
+	// Frame number in the extended UTF-8 coding
+	if (Frame < 0x80)
+		Writer.Write(static_cast<uint32_t>(Frame), 8);
+	else {
+		unsigned int Bytes = 2;
+		while (Bytes < 7 && Frame >= (uint64_t(1) << (5 * Bytes + 1)))
+			++Bytes;
+		Writer.Write(((0xFF00u >> Bytes) & 0xFF) | static_cast<uint32_t>(Frame >> (6 * (Bytes - 1))), 8);
+		for (unsigned int i = Bytes - 1; i-- > 0; )
+			Writer.Write(0x80 | static_cast<uint32_t>((Frame >> (6 * i)) & 0x3F), 8);
+	}
+
+	if (SizeCode == 7)
+		Writer.Write(Count - 1, 16);
+	if (RateCode == 12)
+		Writer.Write(m_Format.SampleRate / 1000, 8);
+	else if (RateCode == 13)
+		Writer.Write(m_Format.SampleRate, 16);
+	else if (RateCode == 14)
+		Writer.Write(m_Format.SampleRate / 10, 16);
+	Writer.Write(CRC8(Writer.GetData().data(), Writer.GetData().size()), 8);
+
+	// Subframes
+	std::vector<int32_t> Channel(Count);
+	for (unsigned int c = 0; c < m_Format.Channels; ++c) {
+		for (unsigned int i = 0; i < Count; ++i)
+			Channel[i] = pSamples[i * m_Format.Channels + c];
+		EncodeSubframe(Writer, Channel.data(), Count, m_Format.BitsPerSample, m_vWindow);
+	}
+
+	// Footer
+	Writer.Align();
+	std::vector<uint8_t> &Data = Writer.GetData();
+	const uint16_t CRC = CRC16(Data.data(), Data.size());
+	Data.push_back(static_cast<uint8_t>(CRC >> 8));
+	Data.push_back(static_cast<uint8_t>(CRC));
+	return std::move(Data);
+}
+
+std::vector<uint8_t> CFlacEncoder::MakeHeader(const stFlacFormat &Format, unsigned int BlockSize,
+	unsigned int MinFrame, unsigned int MaxFrame, uint64_t TotalSamples)
+{
+	CBitWriter Writer;
+	for (char c : {'f', 'L', 'a', 'C'})
+		Writer.Write(c, 8);
+
+	// Metadata block header, STREAMINFO is the last block
+	Writer.Write(1, 1);
+	Writer.Write(0, 7);
+	Writer.Write(34, 24);
+
+	Writer.Write(BlockSize, 16);
+	Writer.Write(BlockSize, 16);
+	Writer.Write(MinFrame, 24);
+	Writer.Write(MaxFrame, 24);
+	Writer.Write(Format.SampleRate, 20);
+	Writer.Write(Format.Channels - 1, 3);
+	Writer.Write(Format.BitsPerSample - 1, 5);
+	Writer.Write(static_cast<uint32_t>(TotalSamples >> 32), 4);
+	Writer.Write(static_cast<uint32_t>(TotalSamples), 32);
+	for (int i = 0; i < 16; ++i)		// MD5 signature, unset
+		Writer.Write(0, 8);
+
+	return std::move(Writer.GetData());
+}
+
+CFlacDecoder::CFlacDecoder(const stFlacFormat &Format) :
+	m_Format(Format)
+{
+}
+
+bool CFlacDecoder::DecodeFrame(const uint8_t *pData, size_t Size, std::vector<int32_t> &Samples) const
+{
+	CBitReader Reader {pData, Size};
+
+	if (Reader.Read(14) != 0x3FFE || Reader.Read(1) || Reader.Read(1))
+		return false;
+	const unsigned int SizeCode = Reader.Read(4);
+	const unsigned int RateCode = Reader.Read(4);
+	const unsigned int Assignment = Reader.Read(4);
+	const unsigned int SampleSizeCode = Reader.Read(3);
+	if (Reader.Read(1))
+		return false;
+
+	// Frame number, the value is not needed
+	const uint32_t Lead = Reader.Read(8);
+	unsigned int Extra = 0;
+	while (Extra < 7 && (Lead & (0x80 >> Extra)))
+		++Extra;
+	if (Extra == 1 || Extra == 8)
+		return false;
+	for (unsigned int i = 1; i < Extra; ++i)
+		if ((Reader.Read(8) & 0xC0) != 0x80)
+			return false;
+
+	unsigned int Count;
+	if (SizeCode == 1)
+		Count = 192;
+	else if (SizeCode >= 2 && SizeCode <= 5)
+		Count = 576u << (SizeCode - 2);
+	else if (SizeCode == 6)
+		Count = Reader.Read(8) + 1;
+	else if (SizeCode == 7)
+		Count = Reader.Read(16) + 1;
+	else if (SizeCode >= 8)
+		Count = 256u << (SizeCode - 8);
+	else
+		return false;
+
+	if (RateCode == 12)
+		Reader.Read(8);
+	else if (RateCode == 13 || RateCode == 14)
+		Reader.Read(16);
+	else if (RateCode == 15)
+		return false;
+
+	const size_t HeaderSize = Reader.GetBytePos();
+	if (Reader.HasError() || Reader.Read(8) != CRC8(pData, HeaderSize))
+		return false;
+
+	const unsigned int Channels = Assignment < 8 ? Assignment + 1 : 2;
+	if (Assignment > 10 || Channels != m_Format.Channels)
+		return false;
+	if (SampleSizeCode && SampleSizeCode != GetSampleSizeCode(m_Format.BitsPerSample))
+		return false;
+
+	std::vector<std::vector<int32_t>> Decoded(Channels, std::vector<int32_t>(Count));
+	for (unsigned int c = 0; c < Channels; ++c) {
+		const bool bSide = (Assignment == 8 && c == 1) || (Assignment == 9 && c == 0) || (Assignment == 10 && c == 1);
+		if (!DecodeSubframe(Reader, Decoded[c].data(), Count, m_Format.BitsPerSample + (bSide ? 1 : 0)))
+			return false;
+	}
+
+	// Stereo decorrelation
+	for (unsigned int i = 0; i < Count && Assignment >= 8; ++i) {
+		int32_t &a = Decoded[0][i];
+		int32_t &b = Decoded[1][i];
+		if (Assignment == 8)
+			b = a - b;
+		else if (Assignment == 9)
+			a += b;
+		else {
+			const int32_t Mid = static_cast<int32_t>((static_cast<uint32_t>(a) << 1) | (b & 1));
+			a = (Mid + b) >> 1;
+			b = (Mid - b) >> 1;
+		}
+	}
+
+	Reader.Align();
+	const size_t Body = Reader.GetBytePos();
+	if (Reader.HasError() || Body + 2 != Size || ((pData[Body] << 8) | pData[Body + 1]) != CRC16(pData, Body))
+		return false;
+
+	Samples.resize(size_t(Count) * Channels);
+	for (unsigned int i = 0; i < Count; ++i)
+		for (unsigned int c = 0; c < Channels; ++c)
+			Samples[i * Channels + c] = Decoded[c][i];
+	return true;
+}
@@ -0,0 +1,105 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*!
+	\brief Stream parameters shared by all frames of a FLAC stream.
+*/
+struct stFlacFormat {
+	unsigned int SampleRate;
+	unsigned int Channels;
+	unsigned int BitsPerSample;		// 8 to 24
+};
+
+/*!
+	\brief Encodes independent FLAC frames.
+	\details Every subframe is coded as a constant, verbatim, fixed or LPC subframe, whichever is
+	smallest, with the Rice parameters chosen per partition. Channels are coded independently. The
+	encoder has no state between frames, so frames can be encoded concurrently.
+*/
+class CFlacEncoder
+{
+public:
+	/*!	\brief The highest LPC order considered. */
+	static const unsigned int MAX_LPC_ORDER = 8;
+	/*!	\brief Precision of the quantized LPC coefficients in bits. */
+	static const unsigned int LPC_PRECISION = 14;
+	/*!	\brief The highest Rice partition order considered. */
+	static const unsigned int MAX_PARTITION_ORDER = 8;
+
+	/*!	\brief Constructs a frame encoder.
+		\param Format The stream format.
+		\param BlockSize The usual number of samples per frame, the LPC window is prepared for it.
+	*/
+	CFlacEncoder(const stFlacFormat &Format, unsigned int BlockSize);
+
+	/*!	\brief Encodes a single frame.
+		\param pSamples The interleaved samples, sign-extended to 32 bits.
+		\param Count The number of samples per channel, at most 65536.
+		\param Frame The frame number.
+		\return The encoded frame.
+	*/
+	std::vector<uint8_t> EncodeFrame(const int32_t *pSamples, unsigned int Count, uint64_t Frame) const;
+
+	/*!	\brief Creates the stream signature and the STREAMINFO metadata block.
+		\param Format The stream format.
+		\param BlockSize The number of samples per frame.
+		\param MinFrame The size of the smallest frame in bytes, 0 if unknown.
+		\param MaxFrame The size of the largest frame in bytes, 0 if unknown.
+		\param TotalSamples The number of samples per channel, 0 if unknown.
+	*/
+	static std::vector<uint8_t> MakeHeader(const stFlacFormat &Format, unsigned int BlockSize,
+		unsigned int MinFrame, unsigned int MaxFrame, uint64_t TotalSamples);
+
+private:
+	stFlacFormat m_Format;
+	std::vector<double> m_vWindow;		// Tukey window applied before the autocorrelation
+};
+
+/*!
+	\brief Decodes FLAC frames, used to verify the output of the encoder.
+	\details Supports every subframe type and channel assignment, but no variable block sizes.
+*/
+class CFlacDecoder
+{
+public:
+	explicit CFlacDecoder(const stFlacFormat &Format);
+
+	/*!	\brief Decodes a single frame.
+		\param pData The frame, including the header and the footer.
+		\param Size The size of the frame in bytes.
+		\param Samples Receives the interleaved samples.
+		\return Whether the frame is valid and matches the stream format.
+	*/
+	bool DecodeFrame(const uint8_t *pData, size_t Size, std::vector<int32_t> &Samples) const;
+
+private:
+	stFlacFormat m_Format;
+};
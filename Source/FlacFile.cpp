@@ -0,0 +1,199 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "FlacFile.h"
+#include <algorithm>
+
+CFlacFile::CFlacFile() :
+	m_Format(),
+	m_iShift(0),
+	m_bError(false),
+	m_iFramePos(0),
+	m_iFrameCount(0),
+	m_iTotalSamples(0),
+	m_iMinFrame(0),
+	m_iMaxFrame(0),
+	m_iMaxInFlight(0),
+	m_bStopping(false)
+{
+}
+
+CFlacFile::~CFlacFile()
+{
+	if (m_File.is_open())
+		CloseFile();
+}
+
+bool CFlacFile::OpenFile(const char *Filename, int SampleRate, int SampleSize, int Channels, bool bThreaded)
+{
+	if (SampleSize != 8 && SampleSize != 16 && SampleSize != 24)
+		return false;
+
+	m_Format = {static_cast<unsigned int>(SampleRate), static_cast<unsigned int>(Channels), static_cast<unsigned int>(SampleSize)};
+	m_iShift = SampleSize - 16;
+	m_pEncoder = std::make_unique<CFlacEncoder>(m_Format, BLOCK_SIZE);
+	m_pDecoder = std::make_unique<CFlacDecoder>(m_Format);
+	m_bError = false;
+	m_vFrame.resize(size_t(BLOCK_SIZE) * Channels);
+	m_iFramePos = 0;
+	m_iFrameCount = 0;
+	m_iTotalSamples = 0;
+	m_iMinFrame = UINT32_MAX;
+	m_iMaxFrame = 0;
+	m_bStopping = false;
+
+	m_File.open(Filename, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	if (!m_File)
+		return false;
+
+	// The header is rewritten with the stream length and frame sizes when the file is closed
+	const std::vector<uint8_t> Header = CFlacEncoder::MakeHeader(m_Format, BLOCK_SIZE, 0, 0, 0);
+	m_File.write(reinterpret_cast<const char *>(Header.data()), Header.size());
+	if (!m_File) {
+		m_File.close();
+		return false;
+	}
+
+	// One hardware thread is left to the emulation
+	if (bThreaded) {
+		const unsigned int Threads = std::min(std::max(std::thread::hardware_concurrency(), 2u) - 1, MAX_THREADS);
+		for (unsigned int i = 0; i < Threads; ++i)
+			m_vWorkers.emplace_back(&CFlacFile::WorkerThread, this);
+		m_iMaxInFlight = Threads * 4;
+	}
+
+	return true;
+}
+
+bool CFlacFile::CloseFile()
+{
+	if (m_iFramePos)
+		SubmitFrame();
+	WriteFinished(true);
+
+	{
+		std::lock_guard<std::mutex> Lock {m_Mutex};
+		m_bStopping = true;
+	}
+	m_Cond.notify_all();
+	for (auto &Worker : m_vWorkers)
+		Worker.join();
+	m_vWorkers.clear();
+
+	if (!m_iFrameCount)
+		m_iMinFrame = 0;
+	const std::vector<uint8_t> Header = CFlacEncoder::MakeHeader(m_Format, BLOCK_SIZE, m_iMinFrame, m_iMaxFrame, m_iTotalSamples);
+	m_File.seekp(0);
+	m_File.write(reinterpret_cast<const char *>(Header.data()), Header.size());
+	m_bError |= !m_File;
+	m_File.close();
+
+	return !m_bError;
+}
+
+void CFlacFile::WriteSamples(const int16_t *pSamples, unsigned int Count)
+{
+	const size_t FrameSize = m_vFrame.size();
+	for (unsigned int i = 0; i < Count; ++i) {
+		const int32_t Sample = pSamples[i];
+		m_vFrame[m_iFramePos] = m_iShift >= 0 ? Sample * (1 << m_iShift) : Sample >> -m_iShift;
+		if (++m_iFramePos == FrameSize)
+			SubmitFrame();
+	}
+}
+
+void CFlacFile::SubmitFrame()
+{
+	auto pJob = std::make_unique<stFrameJob>();
+	pJob->Samples.assign(m_vFrame.begin(), m_vFrame.begin() + m_iFramePos);
+	pJob->Frame = m_iFrameCount++;
+	pJob->bDone = false;
+	pJob->bVerified = false;
+	m_iTotalSamples += m_iFramePos / m_Format.Channels;
+	m_iFramePos = 0;
+
+	if (m_vWorkers.empty()) {
+		EncodeFrame(*pJob);
+		pJob->bDone = true;
+		m_vJobs.push_back(std::move(pJob));
+	}
+	else {
+		std::lock_guard<std::mutex> Lock {m_Mutex};
+		m_vQueue.push_back(pJob.get());
+		m_vJobs.push_back(std::move(pJob));
+		m_Cond.notify_all();
+	}
+
+	WriteFinished(false);
+}
+
+void CFlacFile::EncodeFrame(stFrameJob &Job) const
+{
+	const unsigned int Count = static_cast<unsigned int>(Job.Samples.size() / m_Format.Channels);
+	Job.Data = m_pEncoder->EncodeFrame(Job.Samples.data(), Count, Job.Frame);
+
+	// Round trip through the decoder
+	std::vector<int32_t> Decoded;
+	Job.bVerified = m_pDecoder->DecodeFrame(Job.Data.data(), Job.Data.size(), Decoded) && Decoded == Job.Samples;
+}
+
+void CFlacFile::WriteFinished(bool bAll)
+{
+	// Frames are written in order, the oldest one is waited for only if too many are pending
+	while (true) {
+		std::unique_ptr<stFrameJob> pJob;
+		{
+			std::unique_lock<std::mutex> Lock {m_Mutex};
+			if (m_vJobs.empty())
+				return;
+			if (bAll || m_vJobs.size() > m_iMaxInFlight)
+				m_Cond.wait(Lock, [this] { return m_vJobs.front()->bDone; });
+			else if (!m_vJobs.front()->bDone)
+				return;
+			pJob = std::move(m_vJobs.front());
+			m_vJobs.pop_front();
+		}
+
+		const unsigned int Size = static_cast<unsigned int>(pJob->Data.size());
+		m_File.write(reinterpret_cast<const char *>(pJob->Data.data()), Size);
+		m_bError |= !m_File || !pJob->bVerified;
+		m_iMinFrame = std::min(m_iMinFrame, Size);
+		m_iMaxFrame = std::max(m_iMaxFrame, Size);
+	}
+}
+
+void CFlacFile::WorkerThread()
+{
+	std::unique_lock<std::mutex> Lock {m_Mutex};
+	while (true) {
+		m_Cond.wait(Lock, [this] { return !m_vQueue.empty() || m_bStopping; });
+		if (m_vQueue.empty())
+			break;
+		stFrameJob *pJob = m_vQueue.front();
+		m_vQueue.pop_front();
+		Lock.unlock();
+		EncodeFrame(*pJob);
+		Lock.lock();
+		pJob->bDone = true;
+		m_Cond.notify_all();
+	}
+}
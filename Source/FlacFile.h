@@ -0,0 +1,108 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "AudioFile.h"
+#include "FlacCodec.h"
+
+/*!
+	\brief Streams rendered audio into a FLAC file.
+	\details Frames are encoded on a pool of worker threads as soon as they are complete and written
+	in order by the thread that supplies the samples, which only waits when too many frames are in
+	flight. Every frame is decoded again after encoding and compared against its input; a mismatch
+	makes CloseFile fail. Encoding and verifying take about as much processor time as emulating
+	the 2A03 alone, which the worker threads only hide when there is more than one hardware thread.
+*/
+class CFlacFile : public IAudioFile
+{
+public:
+	/*!	\brief The number of samples per channel in each frame. */
+	static const unsigned int BLOCK_SIZE = 4096;
+	/*!	\brief The largest number of encoder threads. */
+	static const unsigned int MAX_THREADS = 8;
+
+	CFlacFile();
+	~CFlacFile() override;
+
+	/*!	\brief Creates a FLAC file for streaming.
+		\param Filename The file name.
+		\param SampleRate The sample rate in Hz.
+		\param SampleSize The sample size in bits, 8, 16 or 24.
+		\param Channels The number of interleaved channels.
+		\param bThreaded Whether frames are encoded by worker threads.
+		\return Whether the file could be created.
+	*/
+	bool	OpenFile(const char *Filename, int SampleRate, int SampleSize, int Channels, bool bThreaded = true);
+	bool	CloseFile() override;
+	void	WriteSamples(const int16_t *pSamples, unsigned int Count) override;
+
+private:
+	struct stFrameJob {
+		std::vector<int32_t> Samples;
+		uint64_t Frame;
+		std::vector<uint8_t> Data;
+		bool bDone;
+		bool bVerified;
+	};
+
+	void	SubmitFrame();
+	void	EncodeFrame(stFrameJob &Job) const;
+	void	WriteFinished(bool bAll);
+	void	WorkerThread();
+
+private:
+	std::ofstream	m_File;
+	stFlacFormat	m_Format;
+	int				m_iShift;				// Conversion from 16-bit samples
+	std::unique_ptr<CFlacEncoder> m_pEncoder;
+	std::unique_ptr<CFlacDecoder> m_pDecoder;
+	bool			m_bError;
+
+	// Emulation thread state
+	std::vector<int32_t> m_vFrame;
+	size_t			m_iFramePos;
+	uint64_t		m_iFrameCount;
+	uint64_t		m_iTotalSamples;
+	unsigned int	m_iMinFrame;
+	unsigned int	m_iMaxFrame;
+
+	// Frames in the order of the file, and the frames not yet claimed by a worker
+	std::deque<std::unique_ptr<stFrameJob>> m_vJobs;
+	std::deque<stFrameJob *> m_vQueue;
+	size_t			m_iMaxInFlight;
+	std::vector<std::thread> m_vWorkers;
+	std::mutex		m_Mutex;
+	std::condition_variable m_Cond;
+	bool			m_bStopping;
+};
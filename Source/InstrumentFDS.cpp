@@ -29,7 +29,6 @@
 #include "SeqInstrument.h"		// // //
 #include "InstrumentFDS.h"		// // //
 #include "Chunk.h"
-#include "ChunkRenderText.h"		// // //
 #include "DocumentFile.h"
 
 // https://stackoverflow.com/a/14997413/2683842
@@ -293,8 +292,6 @@ bool CInstrumentFDS::LoadFile(CInstrumentFile *pFile, int iVersion)
 
 int CInstrumentFDS::Compile(CChunk *pChunk, int Index)
 {
-	CStringA str;
-
 	// Store wave
 //	int Table = pCompiler->AddWavetable(m_iSamples);
 //	int Table = 0;
@@ -314,8 +311,7 @@ int CInstrumentFDS::Compile(CChunk *pChunk, int Index)
 
 	for (int i = 0; i < SEQUENCE_COUNT; ++i)
 		if (Switch & (1 << i)) {
-			str.Format(CChunkRenderText::LABEL_SEQ_FDS, Index * 5 + i);
-			pChunk->StoreReference(str);
+			pChunk->StoreReference(CHUNK_LABEL_SEQ_FDS, Index * 5 + i);		// // //
 		}
 
 	// // // Store modulation table, two entries/byte
@@ -27,7 +27,6 @@
 #include "SeqInstrument.h"		// // //
 #include "InstrumentN163.h"		// // //
 #include "Chunk.h"
-#include "ChunkRenderText.h"		// // //
 
 // // // Default wave
 static const char TRIANGLE_WAVE[] = {
@@ -176,9 +175,7 @@ int CInstrumentN163::Compile(CChunk *pChunk, int Index)
 	StoredBytes += 2;
 
 	// Store reference to wave
-	CStringA waveLabel;
-	waveLabel.Format(CChunkRenderText::LABEL_WAVES, Index);
-	pChunk->StoreReference(waveLabel);
+	pChunk->StoreReference(CHUNK_LABEL_WAVES, Index);		// // //
 	StoredBytes += 2;
 	
 	return StoredBytes;
@@ -0,0 +1,237 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "LoudnessMeter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+const unsigned int MOMENTARY_STEPS = 4;			// 400 ms
+const unsigned int SHORT_TERM_STEPS = 30;		// 3 s
+const double ABSOLUTE_GATE = -70.;
+const double RELATIVE_GATE = -10.;
+const double LRA_RELATIVE_GATE = -20.;
+
+double Average(const std::vector<double> &Values, double Gate)
+{
+	double Sum = 0.;
+	size_t Count = 0;
+	for (double x : Values)
+		if (x > Gate) {
+			Sum += x;
+			++Count;
+		}
+	return Count ? Sum / Count : 0.;
+}
+
+double ToDecibels(double Value)
+{
+	return 20. * std::log10(Value);
+}
+
+} // namespace
+
+CLoudnessMeter::CLoudnessMeter(int SampleRate, int Channels) :
+	m_iChannels(Channels),
+	m_iStepLength(std::max(SampleRate / 10, 1)),
+	m_iStepPos(0),
+	m_vChannels(Channels, stChannelState { }),
+	m_iChannel(0),
+	m_fStepEnergy(0.),
+	m_vSteps(SHORT_TERM_STEPS),
+	m_iStepCount(0),
+	m_iSamples(0),
+	m_iSum(0),
+	m_iSamplePeak(0),
+	m_fTruePeak(0.),
+	m_iClipped(0)
+{
+	// K-weighting pre-filter, a high shelf
+	double K = std::tan(PI * 1681.974450955533 / SampleRate);
+	double Q = 0.7071752369554196;
+	const double Vh = std::pow(10., 3.999843853973347 / 20.);
+	const double Vb = std::pow(Vh, 0.4996667741545416);
+	double a0 = 1. + K / Q + K * K;
+	m_Filter[0] = {
+		(Vh + Vb * K / Q + K * K) / a0, 2. * (K * K - Vh) / a0, (Vh - Vb * K / Q + K * K) / a0,
+		2. * (K * K - 1.) / a0, (1. - K / Q + K * K) / a0,
+	};
+
+	// RLB weighting, a high pass
+	K = std::tan(PI * 38.13547087602444 / SampleRate);
+	Q = 0.5003270373238773;
+	a0 = 1. + K / Q + K * K;
+	m_Filter[1] = {1., -2., 1., 2. * (K * K - 1.) / a0, (1. - K / Q + K * K) / a0};
+
+	// Windowed sinc interpolator, each phase normalized to unity gain
+	for (int p = 0; p < PHASES; ++p) {
+		double Sum = 0.;
+		for (int j = 0; j < TAPS_PER_PHASE; ++j) {
+			const int n = j * PHASES + p;
+			const double t = (n - (PHASES * TAPS_PER_PHASE - 1) / 2.) / PHASES;
+			const double Window = .5 - .5 * std::cos(2. * PI * (n + .5) / (PHASES * TAPS_PER_PHASE));
+			Sum += m_fInterpolator[p][j] = std::sin(PI * t) / (PI * t) * Window;
+		}
+		for (double &x : m_fInterpolator[p])
+			x /= Sum;
+	}
+}
+
+void CLoudnessMeter::Process(const int16_t *pSamples, unsigned int Count)
+{
+	for (unsigned int i = 0; i < Count; ++i) {
+		const int Sample = pSamples[i];
+		const double x = Sample / 32768.;
+		stChannelState &State = m_vChannels[m_iChannel];
+
+		m_iSum += Sample;
+		m_iSamplePeak = std::max(m_iSamplePeak, std::abs(Sample));
+		if (Sample == INT16_MAX || Sample == INT16_MIN)
+			++m_iClipped;
+
+		// K-weighting, transposed direct form II
+		double y = x;
+		for (int s = 0; s < 2; ++s) {
+			const stBiquad &f = m_Filter[s];
+			const double Out = f.b0 * y + State.z1[s];
+			State.z1[s] = f.b1 * y - f.a1 * Out + State.z2[s];
+			State.z2[s] = f.b2 * y - f.a2 * Out;
+			y = Out;
+		}
+		m_fStepEnergy += y * y;
+
+		// True peak, the history is mirrored so that every window is contiguous
+		State.HistoryPos = (State.HistoryPos + TAPS_PER_PHASE - 1) % TAPS_PER_PHASE;
+		State.History[State.HistoryPos] = State.History[State.HistoryPos + TAPS_PER_PHASE] = x;
+		const double *pHistory = State.History + State.HistoryPos;
+		for (int p = 0; p < PHASES; ++p) {
+			double Acc = 0.;
+			for (int j = 0; j < TAPS_PER_PHASE; ++j)
+				Acc += m_fInterpolator[p][j] * pHistory[j];
+			m_fTruePeak = std::max(m_fTruePeak, std::abs(Acc));
+		}
+
+		if (++m_iChannel == m_iChannels) {
+			m_iChannel = 0;
+			++m_iSamples;
+			if (++m_iStepPos == m_iStepLength)
+				EndStep();
+		}
+	}
+}
+
+void CLoudnessMeter::EndStep()
+{
+	// The last step of a track may be shorter
+	m_vSteps[m_iStepCount++ % SHORT_TERM_STEPS] = m_fStepEnergy / m_iStepPos;
+	m_fStepEnergy = 0.;
+	m_iStepPos = 0;
+
+	// Gating blocks overlap by 75%, so a new one completes with every step
+	double Sum = 0.;
+	for (unsigned int i = 0; i < std::min(m_iStepCount, SHORT_TERM_STEPS); ++i) {
+		Sum += m_vSteps[(m_iStepCount - 1 - i) % SHORT_TERM_STEPS];
+		if (i + 1 == MOMENTARY_STEPS)
+			m_vBlocks.push_back(Sum / MOMENTARY_STEPS);
+	}
+	if (m_iStepCount >= SHORT_TERM_STEPS)
+		m_vShortTerm.push_back(Sum / SHORT_TERM_STEPS);
+}
+
+stLoudnessResult CLoudnessMeter::GetResult() const
+{
+	// The remaining samples are measured as one more step on a copy, so that analysis may go on
+	if (m_iStepPos) {
+		CLoudnessMeter Final {*this};
+		Final.EndStep();
+		return Final.GetResult();
+	}
+
+	stLoudnessResult Result { };
+	Result.Samples = m_iSamples;
+	Result.ClippedSamples = m_iClipped;
+	Result.SamplePeak = ToDecibels(m_iSamplePeak / 32768.);
+	Result.TruePeak = ToDecibels(std::max(m_fTruePeak, m_iSamplePeak / 32768.));
+	Result.DCOffset = m_iSamples ? m_iSum / 32768. / (double(m_iSamples) * m_iChannels) : 0.;
+
+	// Mean squares are gated directly, the gates are converted from LUFS
+	const double Absolute = std::pow(10., (ABSOLUTE_GATE + .691) / 10.);
+	const double Relative = Average(m_vBlocks, Absolute) * std::pow(10., RELATIVE_GATE / 10.);
+	Result.Integrated = ToLUFS(Average(m_vBlocks, std::max(Absolute, Relative)));
+
+	auto MaxMomentary = std::max_element(m_vBlocks.begin(), m_vBlocks.end());
+	Result.MaxMomentary = ToLUFS(MaxMomentary != m_vBlocks.end() ? *MaxMomentary : 0.);
+	auto MaxShortTerm = std::max_element(m_vShortTerm.begin(), m_vShortTerm.end());
+	Result.MaxShortTerm = ToLUFS(MaxShortTerm != m_vShortTerm.end() ? *MaxShortTerm : 0.);
+
+	// Loudness range from the distribution of the gated short-term loudness
+	const double Gate = std::max(Absolute, Average(m_vShortTerm, Absolute) * std::pow(10., LRA_RELATIVE_GATE / 10.));
+	std::vector<double> Gated;
+	for (double x : m_vShortTerm)
+		if (x > Gate)
+			Gated.push_back(x);
+	if (!Gated.empty()) {
+		std::sort(Gated.begin(), Gated.end());
+		const auto Percentile = [&Gated] (double p) { return Gated[static_cast<size_t>(p * (Gated.size() - 1) + .5)]; };
+		Result.LoudnessRange = ToLUFS(Percentile(.95)) - ToLUFS(Percentile(.10));
+	}
+
+	return Result;
+}
+
+nlohmann::json CLoudnessMeter::ToJSON(const stLoudnessResult &Result)
+{
+	// Infinite values of silent tracks are written as null
+	return {
+		{"samples", Result.Samples},
+		{"integrated_lufs", Result.Integrated},
+		{"loudness_range_lu", Result.LoudnessRange},
+		{"max_momentary_lufs", Result.MaxMomentary},
+		{"max_short_term_lufs", Result.MaxShortTerm},
+		{"sample_peak_dbfs", Result.SamplePeak},
+		{"true_peak_dbtp", Result.TruePeak},
+		{"dc_offset", Result.DCOffset},
+		{"clipped_samples", Result.ClippedSamples},
+	};
+}
+
+bool CLoudnessMeter::IsSilent(const stLoudnessResult &Result)
+{
+	return std::isinf(Result.SamplePeak);
+}
+
+std::string CLoudnessMeter::FormatLevel(double Value, const char *Unit)
+{
+	if (!std::isfinite(Value))
+		return "n/a";
+	char Buf[32];
+	std::snprintf(Buf, sizeof(Buf), "%.1f %s", Value, Unit);
+	return Buf;
+}
+
+double CLoudnessMeter::ToLUFS(double MeanSquare)
+{
+	return -.691 + 10. * std::log10(MeanSquare);
+}
@@ -0,0 +1,119 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "json/json.hpp"
+
+/*!
+	\brief Loudness and level statistics of a rendered track.
+	\details Loudness values are in LUFS and peaks in dBFS / dBTP relative to the 16-bit full scale.
+	Values of silent material are negative infinity.
+*/
+struct stLoudnessResult {
+	uint64_t Samples;				// Number of analyzed samples per channel
+	double Integrated;				// Gated integrated loudness
+	double LoudnessRange;			// Loudness range in LU
+	double MaxMomentary;			// Highest 400 ms loudness
+	double MaxShortTerm;			// Highest 3 s loudness
+	double SamplePeak;				// Highest sample magnitude in dBFS
+	double TruePeak;				// Highest 4x oversampled magnitude in dBTP
+	double DCOffset;				// Mean sample value relative to full scale
+	uint64_t ClippedSamples;		// Number of samples at either limit of the 16-bit range
+};
+
+/*!
+	\brief Measures loudness according to ITU-R BS.1770-4 and EBU R128 in a single pass.
+	\details The K-weighting filters are derived for the actual sample rate. Energies are summed
+	over 100 ms steps, from which the 400 ms momentary and 3 s short-term windows are formed;
+	only one mean square value per step is kept for the gating at the end of the track. True peak
+	is measured with a 48-tap polyphase interpolator as described in annex 2 of BS.1770.
+*/
+class CLoudnessMeter
+{
+public:
+	/*!	\brief Constructs a loudness meter.
+		\param SampleRate The sample rate in Hz.
+		\param Channels The number of interleaved channels, each weighted equally.
+	*/
+	CLoudnessMeter(int SampleRate, int Channels = 1);
+
+	/*!	\brief Analyzes a block of samples.
+		\param pSamples The interleaved samples.
+		\param Count The number of samples, counting each channel separately.
+	*/
+	void Process(const int16_t *pSamples, unsigned int Count);
+	/*!	\brief Computes the statistics of all samples analyzed so far, including the last
+		incomplete 100 ms step. */
+	stLoudnessResult GetResult() const;
+
+	/*!	\brief Converts a loudness result into a JSON object. */
+	static nlohmann::json ToJSON(const stLoudnessResult &Result);
+	/*!	\brief Returns whether every analyzed sample is zero. */
+	static bool IsSilent(const stLoudnessResult &Result);
+	/*!	\brief Formats a level with one decimal and a unit, or as "n/a" if it is negative infinity
+		because the material is silent, below the gate or too short to be measured. */
+	static std::string FormatLevel(double Value, const char *Unit);
+
+private:
+	struct stBiquad {
+		double b0, b1, b2, a1, a2;
+	};
+
+	struct stChannelState {
+		double z1[2], z2[2];		// K-weighting filter states
+		double History[24];			// Last inputs of the true peak interpolator, stored twice
+		unsigned int HistoryPos;
+	};
+
+	void EndStep();
+	static double ToLUFS(double MeanSquare);
+
+private:
+	static const int TAPS_PER_PHASE = 12;
+	static const int PHASES = 4;
+
+	int m_iChannels;
+	unsigned int m_iStepLength;		// Samples per channel in each 100 ms step
+	unsigned int m_iStepPos;
+	stBiquad m_Filter[2];
+	double m_fInterpolator[PHASES][TAPS_PER_PHASE];
+	std::vector<stChannelState> m_vChannels;
+	int m_iChannel;
+
+	double m_fStepEnergy;
+	std::vector<double> m_vSteps;			// Mean square of the last 30 steps
+	unsigned int m_iStepCount;
+	std::vector<double> m_vBlocks;			// Mean square of each 400 ms gating block
+	std::vector<double> m_vShortTerm;		// Mean square of each 3 s window
+
+	uint64_t m_iSamples;
+	int64_t m_iSum;
+	int m_iSamplePeak;
+	double m_fTruePeak;
+	uint64_t m_iClipped;
+};
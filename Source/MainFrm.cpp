@@ -62,6 +62,8 @@
 #include "TransposeDlg.h"	// // //
 #include "DPI.h"		// // //
 #include "HistoryFileDlg.h"
+#include "TraceLog.h"		// // //
+#include <fstream>
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -3341,6 +3343,20 @@ void CMainFrame::CheckAudioStatus()
 		return;
 	}
 
+	// // // Save the event trace after an underrun, at most once per timeout period
+	static DWORD TraceTimeout;
+	if (CTraceLog::PollDumpRequest() && TraceTimeout < GetTickCount()) {
+		TCHAR TempPath[MAX_PATH];
+		if (::GetTempPath(MAX_PATH, TempPath)) {
+			CString Path = TempPath;
+			Path.Append(_T("0CC-FamiTracker underrun.json"));
+			if (auto file = std::fstream {Path, std::ios_base::out})
+				if (CTraceLog::WriteJSON(file))
+					TRACE("Trace: Saved underrun trace to %s\n", (LPCTSTR)Path);
+		}
+		TraceTimeout = GetTickCount() + TIMEOUT;
+	}
+
 	// Wait for signals from the player thread
 	if (pSoundGen->GetSoundTimeout()) {
 		// No events from the audio pump
@@ -0,0 +1,387 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#include "stdafx.h"
+#include "ModuleGenerator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "FamiTrackerDoc.h"
+#include "TrackerChannel.h"
+#include "PatternNote.h"
+#include "Sequence.h"
+#include "SeqInstrument.h"
+#include "Instrument2A03.h"
+#include "InstrumentVRC7.h"
+#include "InstrumentFDS.h"
+#include "InstrumentN163.h"
+#include "DSample.h"
+#include "Groove.h"
+#include "APU/Types.h"
+
+namespace {
+
+// Sound chips with their own instrument type
+const unsigned char INSTRUMENT_CHIPS[] = {
+	SNDCHIP_NONE, SNDCHIP_VRC6, SNDCHIP_VRC7, SNDCHIP_FDS, SNDCHIP_N163, SNDCHIP_S5B,
+};
+
+inst_type_t GetInstrumentType(int Chip)
+{
+	switch (Chip) {
+	case SNDCHIP_NONE: case SNDCHIP_MMC5: return INST_2A03;
+	case SNDCHIP_VRC6: return INST_VRC6;
+	case SNDCHIP_VRC7: return INST_VRC7;
+	case SNDCHIP_FDS:  return INST_FDS;
+	case SNDCHIP_N163: return INST_N163;
+	case SNDCHIP_S5B:  return INST_S5B;
+	}
+	return INST_NONE;
+}
+
+// Effects placed in the effect columns, flow control is left out so that every frame remains reachable
+bool IsGeneratedEffect(effect_t Effect)
+{
+	switch (Effect) {
+	case EF_NONE: case EF_SPEED: case EF_JUMP: case EF_SKIP: case EF_HALT: case EF_GROOVE: case EF_PORTAOFF:
+		return false;
+	}
+	return true;
+}
+
+const int N163_WAVE_SIZE = 16;
+const int N163_WAVE_COUNT = 4;
+
+} // namespace
+
+CModuleGenerator::CModuleGenerator(const stGeneratorSettings &Settings) :
+	m_Settings(Settings),
+	m_Random(Settings.Seed)
+{
+	auto &s = m_Settings;
+	s.Tracks = std::min(std::max(s.Tracks, 1U), static_cast<unsigned>(MAX_TRACKS));
+	s.Frames = std::min(std::max(s.Frames, 1U), static_cast<unsigned>(MAX_FRAMES));
+	s.Rows = std::min(std::max(s.Rows, 1U), static_cast<unsigned>(MAX_PATTERN_LENGTH));
+	s.UniquePatterns = std::min(std::max(s.UniquePatterns, 1U), std::min(s.Frames, static_cast<unsigned>(MAX_PATTERN)));
+	s.NoteDensity = std::min(s.NoteDensity, 100U);
+	s.VolumeDensity = std::min(s.VolumeDensity, 100U);
+	s.EffectColumns = std::min(std::max(s.EffectColumns, 1U), static_cast<unsigned>(MAX_EFFECT_COLUMNS));
+	s.EffectDensity = std::min(s.EffectDensity, 100U);
+	s.Chips &= SNDCHIP_VRC6 | SNDCHIP_VRC7 | SNDCHIP_FDS | SNDCHIP_MMC5 | SNDCHIP_N163 | SNDCHIP_S5B;
+	s.N163Channels = std::min(std::max(s.N163Channels, 1U), 8U);
+	s.Instruments = std::min(s.Instruments, static_cast<unsigned>(MAX_INSTRUMENTS));
+	s.Samples = std::min(s.Samples, static_cast<unsigned>(MAX_DSAMPLES));
+	s.SampleSize = std::min(std::max(s.SampleSize, 1U), static_cast<unsigned>(CDSample::MAX_SIZE));
+	s.Grooves = std::min(s.Grooves, static_cast<unsigned>(MAX_GROOVE));
+	s.SpeedChanges = std::min(s.SpeedChanges, 100U);
+}
+
+void CModuleGenerator::Generate(CFamiTrackerDoc *pDoc)
+{
+	pDoc->SelectExpansionChip(m_Settings.Chips);
+	if (m_Settings.Chips & SNDCHIP_N163)
+		pDoc->SetNamcoChannels(m_Settings.N163Channels);
+
+	for (int i = 0, n = pDoc->GetChannelCount(); i < n; ++i) {
+		const CTrackerChannel *pChannel = pDoc->GetChannel(i);
+		m_Effects[i].clear();
+		for (int j = 0; j < EF_COUNT; ++j) {
+			const effect_t Effect = static_cast<effect_t>(j);
+			if (IsGeneratedEffect(Effect) && pChannel->IsEffectCompatible(Effect, 0))
+				m_Effects[i].push_back(Effect);
+		}
+	}
+
+	CreateSamples(pDoc);
+	CreateGrooves(pDoc);
+	CreateInstruments(pDoc);
+
+	for (unsigned int i = 0; i < m_Settings.Tracks; ++i) {
+		if (i > 0 && pDoc->AddTrack() == -1)
+			break;
+		CreateTrack(pDoc, i);
+	}
+}
+
+void CModuleGenerator::CreateSamples(CFamiTrackerDoc *pDoc)
+{
+	for (unsigned int i = 0; i < m_Settings.Samples; ++i) {
+		const unsigned int Size = m_Settings.SampleSize;
+		char *pData = new char[Size];
+		for (unsigned int j = 0; j < Size; ++j)
+			pData[j] = static_cast<char>(Random(0, 0xFF));
+		CDSample *pSample = new CDSample();
+		pSample->SetData(Size, pData);
+		char Name[CDSample::MAX_NAME_SIZE];
+		sprintf_s(Name, sizeof(Name), "Sample %02X", i);
+		pSample->SetName(Name);
+		pDoc->SetSample(i, pSample);
+	}
+}
+
+void CModuleGenerator::CreateGrooves(CFamiTrackerDoc *pDoc)
+{
+	m_iGrooves.clear();
+	for (unsigned int i = 0; i < m_Settings.Grooves; ++i) {
+		CGroove Groove;
+		const int Size = Random(1, MAX_GROOVE_SIZE);
+		Groove.SetSize(Size);
+		for (int j = 0; j < Size; ++j)
+			Groove.SetEntry(j, Random(1, 0x1F));
+		pDoc->SetGroove(i, &Groove);
+		m_iGrooves.push_back(i);
+	}
+}
+
+void CModuleGenerator::CreateInstruments(CFamiTrackerDoc *pDoc)
+{
+	std::vector<unsigned char> Chips;
+	for (const unsigned char Chip : INSTRUMENT_CHIPS)
+		if (Chip == SNDCHIP_NONE || (m_Settings.Chips & Chip))
+			Chips.push_back(Chip);
+
+	for (auto &x : m_iInstruments)
+		x.clear();
+
+	for (unsigned int i = 0; i < m_Settings.Instruments; ++i) {
+		const unsigned char Chip = Chips[i % Chips.size()];
+		char Name[CInstrument::INST_NAME_MAX];
+		sprintf_s(Name, sizeof(Name), "Instrument %02X", i);
+		const int Index = pDoc->AddInstrument(Name, Chip);
+		if (Index == INVALID_INSTRUMENT)
+			break;
+		auto pInst = pDoc->GetInstrument(Index);
+		const inst_type_t Type = pInst->GetType();
+		m_iInstruments[Type].push_back(Index);
+
+		if (auto pSeqInst = std::dynamic_pointer_cast<CSeqInstrument>(pInst)) {
+			const int SeqCount = Type == INST_FDS ? CInstrumentFDS::SEQUENCE_COUNT : SEQ_COUNT;
+			for (int j = 0; j < SeqCount; ++j) {
+				CSequence *pSeq = pSeqInst->GetSequence(j);
+				if (pSeq == nullptr)
+					continue;
+				const int Count = Random(1, MAX_SEQUENCE_ITEMS);
+				pSeq->SetItemCount(Count);
+				for (int k = 0; k < Count; ++k) {
+					int Value = 0;
+					switch (j) {
+					case SEQ_VOLUME:    Value = Random(0, Type == INST_FDS ? 0x1F : 0x0F); break;
+					case SEQ_ARPEGGIO:  Value = Random(-12, 12); break;
+					case SEQ_PITCH:     Value = Random(-16, 16); break;
+					case SEQ_HIPITCH:   Value = Random(-2, 2); break;
+					case SEQ_DUTYCYCLE:
+						Value = Random(0, Type == INST_2A03 ? 3 : Type == INST_N163 ? N163_WAVE_COUNT - 1 : 7); break;
+					}
+					pSeq->SetItem(k, Value);
+				}
+				pSeq->SetLoopPoint(Chance(50) ? Random(0, Count - 1) : -1);
+				pSeq->SetReleasePoint(Chance(25) ? Random(0, Count - 1) : -1);
+				if (Type != INST_FDS)
+					pSeqInst->SetSeqEnable(j, 1);
+			}
+		}
+
+		switch (Type) {
+		case INST_2A03:
+			if (m_Settings.Samples > 0) {
+				auto p2A03 = std::static_pointer_cast<CInstrument2A03>(pInst);
+				for (int o = 0; o < OCTAVE_RANGE; ++o) for (int n = 0; n < NOTE_RANGE; ++n) {
+					p2A03->SetSampleIndex(o, n, Random(1, m_Settings.Samples));
+					p2A03->SetSamplePitch(o, n, Random(0, 0x0F));
+					p2A03->SetSampleLoop(o, n, Chance(10));
+					p2A03->SetSampleDeltaValue(o, n, Chance(10) ? Random(0, 0x7F) : -1);
+				}
+			}
+			break;
+		case INST_VRC7: {
+			auto pVRC7 = std::static_pointer_cast<CInstrumentVRC7>(pInst);
+			pVRC7->SetPatch(Random(0, 15));
+			for (int j = 0; j < 8; ++j)
+				pVRC7->SetCustomReg(j, Random(0, 0xFF));
+		} break;
+		case INST_FDS: {
+			auto pFDS = std::static_pointer_cast<CInstrumentFDS>(pInst);
+			for (int j = 0; j < CInstrumentFDS::WAVE_SIZE; ++j)
+				pFDS->SetSample(j, Random(0, 0x3F));
+			for (int j = 0; j < CInstrumentFDS::MOD_SIZE; ++j)
+				pFDS->SetModulation(j, Random(0, 7));
+			pFDS->SetModulationSpeed(Random(0, 0xFFF));
+			pFDS->SetModulationDepth(Random(0, 0x3F));
+			pFDS->SetModulationDelay(Random(0, 0xFF));
+			pFDS->SetModulationEnable(Chance(50));
+		} break;
+		case INST_N163: {
+			auto pN163 = std::static_pointer_cast<CInstrumentN163>(pInst);
+			const int Space = (0x80 - m_Settings.N163Channels * 8) * 2;		// wave RAM left by the channel registers
+			pN163->SetWaveSize(N163_WAVE_SIZE);
+			pN163->SetWaveCount(N163_WAVE_COUNT);
+			pN163->SetWavePos(Random(0, (Space - N163_WAVE_SIZE) / 4) * 4);
+			for (int j = 0; j < N163_WAVE_COUNT; ++j)
+				for (int k = 0; k < N163_WAVE_SIZE; ++k)
+					pN163->SetSample(j, k, Random(0, 0x0F));
+		} break;
+		}
+	}
+}
+
+void CModuleGenerator::CreateTrack(CFamiTrackerDoc *pDoc, unsigned int Track)
+{
+	CString Title;
+	Title.Format(_T("Generated %u"), Track);
+	pDoc->SetTrackTitle(Track, Title);
+	pDoc->SetFrameCount(Track, m_Settings.Frames);
+	pDoc->SetPatternLength(Track, m_Settings.Rows);
+	if (!m_iGrooves.empty() && Chance(50)) {
+		pDoc->SetSongGroove(Track, true);
+		pDoc->SetSongSpeed(Track, m_iGrooves[Random(0, static_cast<int>(m_iGrooves.size() - 1))]);
+	}
+	else {
+		pDoc->SetSongGroove(Track, false);
+		pDoc->SetSongSpeed(Track, Random(1, pDoc->GetSpeedSplitPoint() - 1));
+	}
+	pDoc->SetSongTempo(Track, Random(pDoc->GetSpeedSplitPoint(), 0xFF));
+
+	const int Channels = pDoc->GetChannelCount();
+	for (int c = 0; c < Channels; ++c) {
+		pDoc->SetEffColumns(Track, c, m_Settings.EffectColumns - 1);
+		for (unsigned int f = 0; f < m_Settings.Frames; ++f)
+			pDoc->SetPatternAtFrame(Track, f, c, f % m_Settings.UniquePatterns);
+
+		const CTrackerChannel *pChannel = pDoc->GetChannel(c);
+		for (unsigned int p = 0; p < m_Settings.UniquePatterns; ++p)
+			for (unsigned int r = 0; r < m_Settings.Rows; ++r) {
+				stChanNote Note;
+				CreateNote(pDoc, c, Note);
+				for (unsigned int i = 0; i < m_Settings.EffectColumns; ++i)
+					if (Chance(m_Settings.EffectDensity))
+						CreateEffect(pChannel, c, Note, i);
+				if (c == 0 && r == 0 && Chance(m_Settings.SpeedChanges))
+					CreateSpeedChange(Note);
+				pDoc->SetDataAtPattern(Track, p, c, r, &Note);
+			}
+	}
+}
+
+void CModuleGenerator::CreateNote(const CFamiTrackerDoc *pDoc, int Channel, stChanNote &Note)
+{
+	if (Chance(m_Settings.NoteDensity)) {
+		if (Chance(5)) {
+			Note.Note = Random(RELEASE, ECHO);
+			if (Note.Note == ECHO)
+				Note.Octave = Random(0, 3);
+		}
+		else {
+			Note.Note = Random(NOTE_C, NOTE_B);
+			Note.Octave = Random(0, OCTAVE_RANGE - 1);
+			const auto &Instruments = m_iInstruments[GetInstrumentType(pDoc->GetChipType(Channel))];
+			if (!Instruments.empty())
+				Note.Instrument = Instruments[Random(0, static_cast<int>(Instruments.size() - 1))];
+		}
+	}
+	if (Chance(m_Settings.VolumeDensity))
+		Note.Vol = Random(0, MAX_VOLUME - 1);
+}
+
+void CModuleGenerator::CreateEffect(const CTrackerChannel *pChannel, int Channel, stChanNote &Note, int Column)
+{
+	const auto &Effects = m_Effects[Channel];
+	if (Effects.empty())
+		return;
+	const effect_t Effect = Effects[Random(0, static_cast<int>(Effects.size() - 1))];
+	for (int i = 0; i < 4; ++i) {		// parameters are drawn until one is valid for the effect
+		const int Param = Random(0, 0xFF);
+		if (pChannel->IsEffectCompatible(Effect, Param)) {
+			Note.EffNumber[Column] = Effect;
+			Note.EffParam[Column] = Param;
+			return;
+		}
+	}
+	Note.EffNumber[Column] = Effect;
+	Note.EffParam[Column] = 0;
+}
+
+void CModuleGenerator::CreateSpeedChange(stChanNote &Note)
+{
+	if (!m_iGrooves.empty() && Chance(25)) {
+		Note.EffNumber[0] = EF_GROOVE;
+		Note.EffParam[0] = m_iGrooves[Random(0, static_cast<int>(m_iGrooves.size() - 1))];
+	}
+	else {
+		Note.EffNumber[0] = EF_SPEED;
+		Note.EffParam[0] = Random(1, 0xFF);
+	}
+}
+
+int CModuleGenerator::Random(int Min, int Max)
+{
+	return std::uniform_int_distribution<int> {Min, Max}(m_Random);
+}
+
+bool CModuleGenerator::Chance(unsigned int Percent)
+{
+	return Random(0, 99) < static_cast<int>(Percent);
+}
+
+bool CModuleGenerator::ParseOption(stGeneratorSettings &Settings, const char *pOption)
+{
+	const char *pValue = std::strchr(pOption, '=');
+	if (pValue == nullptr)
+		return false;
+	const std::string Name(pOption, pValue);
+	const unsigned long Value = std::strtoul(pValue + 1, nullptr, 0);
+
+	const struct {
+		const char *Name;
+		unsigned int stGeneratorSettings::*Field;
+	} FIELDS[] = {
+		{"tracks",      &stGeneratorSettings::Tracks},
+		{"frames",      &stGeneratorSettings::Frames},
+		{"rows",        &stGeneratorSettings::Rows},
+		{"patterns",    &stGeneratorSettings::UniquePatterns},
+		{"notes",       &stGeneratorSettings::NoteDensity},
+		{"volumes",     &stGeneratorSettings::VolumeDensity},
+		{"columns",     &stGeneratorSettings::EffectColumns},
+		{"effects",     &stGeneratorSettings::EffectDensity},
+		{"n163",        &stGeneratorSettings::N163Channels},
+		{"instruments", &stGeneratorSettings::Instruments},
+		{"samples",     &stGeneratorSettings::Samples},
+		{"samplesize",  &stGeneratorSettings::SampleSize},
+		{"grooves",     &stGeneratorSettings::Grooves},
+		{"speed",       &stGeneratorSettings::SpeedChanges},
+	};
+
+	if (!_stricmp(Name.c_str(), "seed"))
+		Settings.Seed = static_cast<uint32_t>(Value);
+	else if (!_stricmp(Name.c_str(), "chips"))
+		Settings.Chips = static_cast<uint8_t>(Value);
+	else {
+		for (const auto &x : FIELDS)
+			if (!_stricmp(Name.c_str(), x.Name)) {
+				Settings.*x.Field = Value;
+				return true;
+			}
+		return false;
+	}
+	return true;
+}
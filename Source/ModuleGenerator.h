@@ -0,0 +1,104 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "FamiTrackerTypes.h"
+#include "Instrument.h"
+
+class CFamiTrackerDoc;
+class CTrackerChannel;
+class stChanNote;
+
+/*!
+	\brief Parameters of a synthetic module.
+	\details The defaults describe a worst-case module: every expansion chip with 8 N163 channels,
+	the maximum number of frames, rows, effect columns, instruments and DPCM samples, and frequent
+	speed and groove changes. Percentages are given in the range 0 to 100.
+*/
+struct stGeneratorSettings {
+	uint32_t Seed = 0;					// Seed of the random number generator
+	unsigned int Tracks = 1;			// Number of tracks
+	unsigned int Frames = 256;			// Number of frames per track
+	unsigned int Rows = 256;			// Pattern length
+	unsigned int UniquePatterns = 256;	// Number of distinct patterns per channel and track
+	unsigned int NoteDensity = 75;		// Chance of a note on each row
+	unsigned int VolumeDensity = 50;	// Chance of a volume column value on each row
+	unsigned int EffectColumns = 4;		// Number of effect columns in every channel
+	unsigned int EffectDensity = 100;	// Chance of an effect in each effect column
+	uint8_t Chips = 0x3F;				// Expansion chip flags
+	unsigned int N163Channels = 8;		// Number of N163 channels, if N163 is enabled
+	unsigned int Instruments = 64;		// Number of instruments
+	unsigned int Samples = 64;			// Number of DPCM samples
+	unsigned int SampleSize = 0xFF1;	// Size of each DPCM sample in bytes
+	unsigned int Grooves = 32;			// Number of grooves
+	unsigned int SpeedChanges = 50;		// Chance of a speed, tempo or groove change at the start of each frame
+};
+
+/*!
+	\brief Fills a document with deterministic pseudo-random content.
+	\details The same settings and seed always produce the same module, so generated modules can be
+	used to exercise and time the module loader, the compiler, the player and the text exporter on
+	inputs at the limits of the file format.
+*/
+class CModuleGenerator
+{
+public:
+	/*!	\brief Constructs the generator.
+		\param Settings The module parameters; values beyond the module limits are clamped.
+	*/
+	explicit CModuleGenerator(const stGeneratorSettings &Settings);
+
+	/*!	\brief Replaces the contents of a document with a generated module.
+		\param pDoc A document that has been initialized with OnNewDocument.
+	*/
+	void Generate(CFamiTrackerDoc *pDoc);
+
+	/*!	\brief Parses a setting given as "name=value".
+		\return Whether the option was recognized.
+	*/
+	static bool ParseOption(stGeneratorSettings &Settings, const char *pOption);
+
+private:
+	void CreateSamples(CFamiTrackerDoc *pDoc);
+	void CreateGrooves(CFamiTrackerDoc *pDoc);
+	void CreateInstruments(CFamiTrackerDoc *pDoc);
+	void CreateTrack(CFamiTrackerDoc *pDoc, unsigned int Track);
+	void CreateNote(const CFamiTrackerDoc *pDoc, int Channel, stChanNote &Note);
+	void CreateEffect(const CTrackerChannel *pChannel, int Channel, stChanNote &Note, int Column);
+	void CreateSpeedChange(stChanNote &Note);
+
+	int Random(int Min, int Max);
+	bool Chance(unsigned int Percent);
+
+private:
+	stGeneratorSettings m_Settings;
+	std::mt19937 m_Random;
+	std::vector<int> m_iInstruments[INST_S5B + 1];		// Generated instruments, indexed by instrument type
+	std::vector<effect_t> m_Effects[MAX_CHANNELS];		// Effects allowed in each channel
+	std::vector<int> m_iGrooves;
+};
@@ -0,0 +1,387 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#include "NSFPlayer.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include "APU/APU.h"
+#include "APU/Types.h"
+
+namespace {
+
+const uint16_t RETURN_ADDRESS = 0x5FF4;		// Unmapped, marks the return from INIT and PLAY
+const size_t NSF_HEADER_SIZE = 0x80;
+const size_t NES_HEADER_SIZE = 0x10;
+const size_t BANK_SIZE = 0x1000;
+const unsigned int DEFAULT_SPEED_NTSC = 16639;		// 60.1 Hz
+const unsigned int DEFAULT_SPEED_PAL = 19997;		// 50.0 Hz
+
+// Longest time a single call may take before the player gives up
+const unsigned int INIT_FRAMES_LIMIT = 60;
+const unsigned int PLAY_FRAMES_LIMIT = 10;
+
+// Chips that are written through the cartridge address space
+const uint8_t MAPPER_CHIPS = SNDCHIP_VRC6 | SNDCHIP_VRC7 | SNDCHIP_N163 | SNDCHIP_S5B;
+
+uint16_t ReadWord(const uint8_t *p) {
+	return p[0] | (p[1] << 8);
+}
+
+uint32_t ReadDWord(const uint8_t *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+} // namespace
+
+CNSFPlayer::CNSFPlayer() :
+	m_CPU(*this),
+	m_pAPU(nullptr),
+	m_bNES(false),
+	m_bBankswitched(false),
+	m_iLoadAddr(0x8000),
+	m_iInitAddr(0),
+	m_iPlayAddr(0),
+	m_iSongCount(0),
+	m_iChips(SNDCHIP_NONE),
+	m_iMachine(MACHINE_NTSC),
+	m_iPlaySpeed(DEFAULT_SPEED_NTSC),
+	m_bNMIEnabled(false),
+	m_bInFrame(false),
+	m_iFrameStart(0),
+	m_iFrameLength(0),
+	m_iTimeFed(0),
+	m_iLastFrameCycles(0),
+	m_iOverruns(0)
+{
+	memset(m_iRAM, 0, sizeof(m_iRAM));
+	memset(m_iWRAM, 0, sizeof(m_iWRAM));
+	memset(m_iPRG, 0, sizeof(m_iPRG));
+	memset(m_iInitBanks, 0, sizeof(m_iInitBanks));
+}
+
+bool CNSFPlayer::Load(const std::vector<uint8_t> &Data)
+{
+	if (Data.size() >= 4 && !memcmp(Data.data(), "NESM", 4))
+		return LoadNSF(Data);
+	if (Data.size() >= 4 && !memcmp(Data.data(), "NSFE", 4))
+		return LoadNSFe(Data);
+	if (Data.size() >= 4 && !memcmp(Data.data(), "NES\x1A", 4))
+		return LoadNES(Data);
+	return false;
+}
+
+bool CNSFPlayer::LoadFile(const char *pFile)
+{
+	std::ifstream File(pFile, std::ios::binary);
+	if (!File)
+		return false;
+	const std::vector<uint8_t> Data {std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>()};
+	return Load(Data);
+}
+
+bool CNSFPlayer::LoadNSF(const std::vector<uint8_t> &Data)
+{
+	if (Data.size() <= NSF_HEADER_SIZE)
+		return false;
+	const uint8_t *pHeader = Data.data();
+
+	m_bNES = false;
+	m_iSongCount = pHeader[0x06];
+	m_iLoadAddr = ReadWord(pHeader + 0x08);
+	m_iInitAddr = ReadWord(pHeader + 0x0A);
+	m_iPlayAddr = ReadWord(pHeader + 0x0C);
+	m_iMachine = (pHeader[0x7A] & 0x03) == 0x01 ? MACHINE_PAL : MACHINE_NTSC;
+	m_iPlaySpeed = ReadWord(pHeader + (m_iMachine == MACHINE_PAL ? 0x78 : 0x6E));
+	m_iChips = pHeader[0x7B];
+	memcpy(m_iInitBanks, pHeader + 0x70, sizeof(m_iInitBanks));
+	m_bBankswitched = std::any_of(std::begin(m_iInitBanks), std::end(m_iInitBanks), [] (uint8_t x) { return x != 0; });
+	if (!m_bBankswitched && m_iLoadAddr < 0x8000)
+		return false;
+
+	SetImage(pHeader + NSF_HEADER_SIZE, Data.size() - NSF_HEADER_SIZE, m_iLoadAddr);
+	return true;
+}
+
+bool CNSFPlayer::LoadNSFe(const std::vector<uint8_t> &Data)
+{
+	bool bInfo = false;
+	const uint8_t *pImage = nullptr;
+	size_t ImageSize = 0;
+
+	m_bNES = false;
+	m_iPlaySpeed = 0;
+	memset(m_iInitBanks, 0, sizeof(m_iInitBanks));
+	m_bBankswitched = false;
+
+	size_t Pos = 4;
+	while (Pos + 8 <= Data.size()) {
+		const uint32_t Size = ReadDWord(&Data[Pos]);
+		const uint8_t *pID = &Data[Pos + 4];
+		const uint8_t *pChunk = &Data[Pos + 8];
+		if (Size > Data.size() - Pos - 8)
+			return false;
+		Pos += 8 + Size;
+
+		if (!memcmp(pID, "INFO", 4) && Size >= 8) {
+			m_iLoadAddr = ReadWord(pChunk);
+			m_iInitAddr = ReadWord(pChunk + 2);
+			m_iPlayAddr = ReadWord(pChunk + 4);
+			m_iMachine = (pChunk[6] & 0x03) == 0x01 ? MACHINE_PAL : MACHINE_NTSC;
+			m_iChips = pChunk[7];
+			m_iSongCount = Size >= 9 ? pChunk[8] : 1;
+			// The exporter stores the NTSC play speed after the starting song
+			if (Size >= 12 && !m_iPlaySpeed)
+				m_iPlaySpeed = ReadWord(pChunk + 10);
+			bInfo = true;
+		}
+		else if (!memcmp(pID, "BANK", 4)) {
+			memcpy(m_iInitBanks, pChunk, std::min<size_t>(Size, sizeof(m_iInitBanks)));
+			m_bBankswitched = true;
+		}
+		else if (!memcmp(pID, "RATE", 4) && Size >= 2)
+			m_iPlaySpeed = ReadWord(pChunk + (m_iMachine == MACHINE_PAL && Size >= 4 ? 2 : 0));
+		else if (!memcmp(pID, "DATA", 4)) {
+			pImage = pChunk;
+			ImageSize = Size;
+		}
+		else if (!memcmp(pID, "NEND", 4))
+			break;
+	}
+
+	if (!bInfo || pImage == nullptr || (!m_bBankswitched && m_iLoadAddr < 0x8000))
+		return false;
+	if (!m_iPlaySpeed)
+		m_iPlaySpeed = m_iMachine == MACHINE_PAL ? DEFAULT_SPEED_PAL : DEFAULT_SPEED_NTSC;
+
+	SetImage(pImage, ImageSize, m_iLoadAddr);
+	return true;
+}
+
+bool CNSFPlayer::LoadNES(const std::vector<uint8_t> &Data)
+{
+	if (Data.size() < NES_HEADER_SIZE)
+		return false;
+	const uint8_t *pHeader = Data.data();
+
+	// Only NROM is supported, as written by the exporter
+	const unsigned int Mapper = (pHeader[6] >> 4) | (pHeader[7] & 0xF0);
+	const size_t PRGSize = pHeader[4] * 0x4000;
+	const size_t Offset = NES_HEADER_SIZE + ((pHeader[6] & 0x04) ? 0x200 : 0);
+	if (Mapper != 0 || (PRGSize != 0x4000 && PRGSize != 0x8000) || Data.size() < Offset + PRGSize)
+		return false;
+
+	m_bNES = true;
+	m_bBankswitched = false;
+	m_iSongCount = 1;
+	m_iChips = SNDCHIP_NONE;
+	m_iMachine = MACHINE_NTSC;
+	m_iPlaySpeed = DEFAULT_SPEED_NTSC;
+
+	// 16 kB images are mirrored
+	m_vImage.assign(0x8000, 0);
+	for (size_t i = 0; i < 0x8000; i += PRGSize)
+		std::copy_n(Data.begin() + Offset, PRGSize, m_vImage.begin() + i);
+	m_iLoadAddr = 0x8000;
+	return true;
+}
+
+void CNSFPlayer::SetImage(const uint8_t *pData, size_t Size, uint16_t LoadAddr)
+{
+	// Bank 0 begins at the 4 kB boundary below the load address
+	const size_t Padding = m_bBankswitched ? (LoadAddr & (BANK_SIZE - 1)) : (LoadAddr - 0x8000u);
+	m_vImage.assign(Padding, 0);
+	m_vImage.insert(m_vImage.end(), pData, pData + Size);
+	m_vImage.resize((m_vImage.size() + BANK_SIZE - 1) / BANK_SIZE * BANK_SIZE, 0);
+}
+
+void CNSFPlayer::SwitchBank(unsigned int Slot, uint8_t Bank)
+{
+	// Slots 0 - 7 are $8000 - $FFFF, FDS slots 8 and 9 are $6000 and $7000
+	uint8_t *pDest = Slot < 8 ? m_iPRG + Slot * BANK_SIZE : m_iWRAM + (Slot - 8) * BANK_SIZE;
+	const size_t Source = Bank * BANK_SIZE;
+	if (Source + BANK_SIZE <= m_vImage.size())
+		memcpy(pDest, &m_vImage[Source], BANK_SIZE);
+	else
+		memset(pDest, 0, BANK_SIZE);
+}
+
+unsigned int CNSFPlayer::GetSongCount() const
+{
+	return m_iSongCount;
+}
+
+uint8_t CNSFPlayer::GetExpansionChip() const
+{
+	return m_iChips;
+}
+
+int CNSFPlayer::GetMachine() const
+{
+	return m_iMachine;
+}
+
+int CNSFPlayer::GetFrameRate() const
+{
+	return m_iPlaySpeed ? (1000000 + m_iPlaySpeed / 2) / m_iPlaySpeed : CAPU::FRAME_RATE_NTSC;
+}
+
+bool CNSFPlayer::Init(CAPU *pAPU, unsigned int Song)
+{
+	m_pAPU = pAPU;
+	const uint32_t BaseFreq = m_iMachine == MACHINE_PAL ? CAPU::BASE_FREQ_PAL : CAPU::BASE_FREQ_NTSC;
+	m_iFrameLength = BaseFreq / GetFrameRate();
+	m_bInFrame = false;
+	m_bNMIEnabled = false;
+	m_iTimeFed = 0;
+	m_iOverruns = 0;
+
+	memset(m_iRAM, 0, sizeof(m_iRAM));
+	memset(m_iWRAM, 0, sizeof(m_iWRAM));
+	if (m_bBankswitched) {
+		for (unsigned int i = 0; i < 8; ++i)
+			SwitchBank(i, m_iInitBanks[i]);
+		if (m_iChips & SNDCHIP_FDS) {
+			SwitchBank(8, m_iInitBanks[6]);
+			SwitchBank(9, m_iInitBanks[7]);
+		}
+	}
+	else {
+		memset(m_iPRG, 0, sizeof(m_iPRG));
+		memcpy(m_iPRG, m_vImage.data(), std::min(m_vImage.size(), sizeof(m_iPRG)));
+	}
+
+	// DPCM samples are fetched from $C000 - $FFFF
+	m_pAPU->WriteSample(reinterpret_cast<const char*>(m_iPRG + 0x4000), 0x4000);
+
+	const uint64_t Limit = static_cast<uint64_t>(m_iFrameLength) * INIT_FRAMES_LIMIT;
+	if (m_bNES) {
+		m_CPU.Reset();
+		return m_CPU.RunUntil([&] { return m_bNMIEnabled; }, Limit);
+	}
+
+	for (uint16_t i = 0x4000; i < 0x4014; ++i)
+		m_pAPU->Write(i, 0x00);
+	m_pAPU->Write(0x4015, 0x00);
+	m_pAPU->Write(0x4015, 0x0F);
+	m_pAPU->Write(0x4017, 0x40);
+
+	m_CPU.SetA(static_cast<uint8_t>(Song));
+	m_CPU.SetX(m_iMachine == MACHINE_PAL ? 1 : 0);
+	m_CPU.SetY(0);
+	return m_CPU.Call(m_iInitAddr, RETURN_ADDRESS, Limit);
+}
+
+bool CNSFPlayer::RunFrame()
+{
+	m_iFrameStart = m_CPU.GetCycles();
+	m_iTimeFed = 0;
+	m_bInFrame = true;
+
+	const uint64_t Limit = static_cast<uint64_t>(m_iFrameLength) * PLAY_FRAMES_LIMIT;
+	const bool bReturned = m_bNES ? m_CPU.NMI(Limit) : m_CPU.Call(m_iPlayAddr, RETURN_ADDRESS, Limit);
+
+	m_iLastFrameCycles = static_cast<unsigned int>(m_CPU.GetCycles() - m_iFrameStart);
+	if (m_iLastFrameCycles > m_iFrameLength)
+		++m_iOverruns;
+
+	m_pAPU->AddTime(m_iFrameLength - m_iTimeFed);
+	m_pAPU->Process();
+	m_bInFrame = false;
+	m_iTimeFed = 0;
+
+	return bReturned;
+}
+
+unsigned int CNSFPlayer::GetFrameCycles() const
+{
+	return m_iLastFrameCycles;
+}
+
+unsigned int CNSFPlayer::GetOverrunCount() const
+{
+	return m_iOverruns;
+}
+
+void CNSFPlayer::SyncAPU()
+{
+	// Writes are placed at the cycle of their instruction; writes of a play routine that takes
+	// longer than a frame are placed at the end of the frame
+	if (!m_bInFrame)
+		return;
+	const uint64_t Elapsed = std::min<uint64_t>(m_CPU.GetCycles() - m_iFrameStart, m_iFrameLength - 1);
+	const uint32_t Time = static_cast<uint32_t>(Elapsed);
+	if (Time > m_iTimeFed) {
+		m_pAPU->AddTime(Time - m_iTimeFed);
+		m_iTimeFed = Time;
+	}
+}
+
+uint8_t CNSFPlayer::Read(uint16_t Address)
+{
+	if (Address < 0x2000)
+		return m_iRAM[Address & 0x7FF];
+	if (Address < 0x4000)
+		return (Address & 0x07) == 0x02 ? 0x80 : 0x00;		// PPUSTATUS always reports the vertical blank
+	if (Address < 0x6000) {
+		SyncAPU();
+		return m_pAPU->Read(Address);
+	}
+	if (Address < 0x8000)
+		return m_iWRAM[Address - 0x6000];
+	return m_iPRG[Address - 0x8000];
+}
+
+void CNSFPlayer::Write(uint16_t Address, uint8_t Value)
+{
+	if (Address < 0x2000)
+		m_iRAM[Address & 0x7FF] = Value;
+	else if (Address < 0x4000) {
+		if ((Address & 0x07) == 0x00)
+			m_bNMIEnabled = (Value & 0x80) != 0;
+	}
+	else if (Address >= 0x5FF8 && Address < 0x6000) {
+		if (m_bBankswitched)
+			SwitchBank(Address - 0x5FF8, Value);
+	}
+	else if (Address >= 0x5FF6 && Address < 0x5FF8) {
+		if (m_bBankswitched && (m_iChips & SNDCHIP_FDS))
+			SwitchBank(Address - 0x5FF6 + 8, Value);
+	}
+	else if (Address < 0x6000) {
+		SyncAPU();
+		m_pAPU->Write(Address, Value);
+	}
+	else if (Address < 0x8000)
+		m_iWRAM[Address - 0x6000] = Value;
+	else {
+		// The FDS BIOS area is not writable
+		if ((m_iChips & SNDCHIP_FDS) && Address < 0xE000)
+			m_iPRG[Address - 0x8000] = Value;
+		if (m_iChips & MAPPER_CHIPS) {
+			SyncAPU();
+			m_pAPU->Write(Address, Value);
+		}
+	}
+}
@@ -0,0 +1,124 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "CPU6502.h"
+
+class CAPU;
+
+/*!
+	\brief Plays NSF, NSFe and NROM iNES files on an emulated 2A03 CPU.
+	\details The player maps the file into the CPU address space, with NSF bankswitching through
+	$5FF8 - $5FFF and FDS RAM if required, and forwards every write to the sound registers of the
+	2A03 and the expansion chips to a CAPU instance, timed by the CPU cycle of the write. NSF files
+	are driven through their INIT and PLAY routines; iNES files are run from the reset vector until
+	they enable the NMI, which is then triggered once per frame.
+*/
+class CNSFPlayer : public ICPUBus
+{
+public:
+	CNSFPlayer();
+
+	/*!	\brief Loads a file, detecting its format from its contents.
+		\param Data The contents of an NSF, NSFe or iNES file.
+		\return Whether the file could be loaded.
+	*/
+	bool Load(const std::vector<uint8_t> &Data);
+	/*!	\brief Loads a file from the disk.
+		\param pFile The file name.
+		\return Whether the file could be loaded.
+	*/
+	bool LoadFile(const char *pFile);
+
+	unsigned int GetSongCount() const;
+	/*!	\brief Returns the expansion chip flags of the loaded file. */
+	uint8_t GetExpansionChip() const;
+	/*!	\brief Returns the region of the loaded file, one of the apu_machine_t values. */
+	int GetMachine() const;
+	/*!	\brief Returns the number of calls to the play routine per second. */
+	int GetFrameRate() const;
+
+	/*!	\brief Starts a song.
+		\details The APU must already be configured for the machine, frame rate and expansion
+		chips of the loaded file. Writes made by the init routine happen at the start of the
+		first frame.
+		\param pAPU The APU receiving the register writes.
+		\param Song The zero-based song index.
+		\return Whether the init routine returned.
+	*/
+	bool Init(CAPU *pAPU, unsigned int Song);
+	/*!	\brief Runs the play routine once, then advances the APU to the end of the frame.
+		\return Whether the play routine returned.
+	*/
+	bool RunFrame();
+
+	/*!	\brief Returns the number of CPU cycles taken by the play routine in the last frame. */
+	unsigned int GetFrameCycles() const;
+	/*!	\brief Returns the number of frames whose play routine took longer than the frame. */
+	unsigned int GetOverrunCount() const;
+
+	uint8_t Read(uint16_t Address) override;
+	void Write(uint16_t Address, uint8_t Value) override;
+
+private:
+	bool LoadNSF(const std::vector<uint8_t> &Data);
+	bool LoadNSFe(const std::vector<uint8_t> &Data);
+	bool LoadNES(const std::vector<uint8_t> &Data);
+	void SetImage(const uint8_t *pData, size_t Size, uint16_t LoadAddr);
+	void SwitchBank(unsigned int Slot, uint8_t Bank);
+	void SyncAPU();
+
+private:
+	CCPU6502 m_CPU;
+	CAPU *m_pAPU;
+
+	std::vector<uint8_t> m_vImage;		// File data, padded to the start of a 4 kB bank
+	uint8_t m_iRAM[0x800];
+	uint8_t m_iWRAM[0x2000];			// $6000 - $7FFF
+	uint8_t m_iPRG[0x8000];				// $8000 - $FFFF, copied from the image on bankswitching
+
+	bool m_bNES;
+	bool m_bBankswitched;
+	uint8_t m_iInitBanks[8];
+	uint16_t m_iLoadAddr;
+	uint16_t m_iInitAddr;
+	uint16_t m_iPlayAddr;
+	unsigned int m_iSongCount;
+	uint8_t m_iChips;
+	int m_iMachine;
+	unsigned int m_iPlaySpeed;			// Microseconds between calls to the play routine
+
+	bool m_bNMIEnabled;
+	bool m_bInFrame;
+	uint64_t m_iFrameStart;
+	uint32_t m_iFrameLength;
+	uint32_t m_iTimeFed;
+	unsigned int m_iLastFrameCycles;
+	unsigned int m_iOverruns;
+};
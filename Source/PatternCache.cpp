@@ -0,0 +1,66 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#include "stdafx.h"
+#include "PatternCache.h"
+
+void CPatternCache::Begin(const std::string &Context)
+{
+	if (Context != m_strContext) {
+		Clear();
+		m_strContext = Context;
+	}
+}
+
+const stCompiledPattern *CPatternCache::Find(const std::string &Key) const
+{
+	auto it = m_Entries.find(Key);
+	return it != m_Entries.end() ? &it->second.Pattern : nullptr;
+}
+
+void CPatternCache::Store(const std::string &Key, const stCompiledPattern &Pattern)
+{
+	auto it = m_Entries.find(Key);
+	if (it == m_Entries.end())
+		m_Entries.emplace(Key, stEntry {Pattern, true});
+	else
+		it->second.Used = true;
+}
+
+void CPatternCache::Finish()
+{
+	for (auto it = m_Entries.begin(); it != m_Entries.end(); ) {
+		if (it->second.Used) {
+			it->second.Used = false;
+			++it;
+		}
+		else
+			it = m_Entries.erase(it);
+	}
+}
+
+void CPatternCache::Clear()
+{
+	m_strContext.clear();
+	m_Entries.clear();
+}
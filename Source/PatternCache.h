@@ -0,0 +1,73 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*!
+	\brief Output of the pattern compiler for a single pattern.
+*/
+struct stCompiledPattern {
+	std::vector<char> Data;		// String stored in the NSF
+	uint64_t Hash;				// Hash of the uncompressed string
+	CString Log;				// Messages written while compiling
+};
+
+/*!
+	\brief Keeps the compiled patterns of the previous NSF export in this session.
+	\details Entries are keyed by the complete input of the pattern compiler, as serialized by
+	CPatternCompiler::GetPatternKey, so a pattern is only reused if compiling it again would give the
+	same result. Inputs shared by all patterns of an export, such as the instrument and sample
+	tables, are compared once in Begin. Find may be called from several threads at once, but not
+	concurrently with the other methods.
+*/
+class CPatternCache
+{
+public:
+	/*!	\brief Starts an export.
+		\param Context Inputs shared by all patterns, all entries are discarded if they changed. */
+	void Begin(const std::string &Context);
+	/*!	\brief Returns the pattern compiled from the same input, or nullptr if there is none. */
+	const stCompiledPattern *Find(const std::string &Key) const;
+	/*!	\brief Adds a compiled pattern, or keeps the existing entry of the same input. */
+	void Store(const std::string &Key, const stCompiledPattern &Pattern);
+	/*!	\brief Ends an export, discarding the entries it did not store. */
+	void Finish();
+	/*!	\brief Discards all entries. */
+	void Clear();
+
+private:
+	struct stEntry {
+		stCompiledPattern Pattern;
+		bool Used;
+	};
+
+	std::string m_strContext;
+	std::unordered_map<std::string, stEntry> m_Entries;
+};
@@ -21,6 +21,9 @@
 */
 
 #include <vector>
+#include <algorithm>		// // //
+#include <string>		// // //
+#include <unordered_map>		// // //
 #include "stdafx.h"
 #include "FamiTrackerDoc.h"
 #include "SeqInstrument.h"		// // //
@@ -55,6 +58,9 @@
 // Use single-byte instrument commands for instrument 0-15 (default on)
 #define PACKED_INST_CHANGE
 
+// // // Store repeated rows as loops, requires ft_cmd_expand in the NSF driver (default off)
+//#define LOOP_COMPRESSION
+
 // Command table
 enum command_t {
 	CMD_INSTRUMENT,
@@ -109,9 +115,91 @@ enum command_t {
 	CMD_EFF_S5B_ENV_RATE_HI,	// // //
 	CMD_EFF_S5B_ENV_RATE_LO,	// // //
 	CMD_EFF_S5B_NOISE,			// // // 050B
+
+	CMD_LOOP_POINT,				// // // ft_cmd_expand, not assembled into the drivers yet
+};
+
+// // // Loop command cost: command byte, loop count and body length
+const unsigned int LOOP_COMMAND_SIZE = 3;
+// Longest loop body and most repeats the loop command parameters can hold
+const unsigned int LOOP_MAX_LENGTH = 0xFF;
+const unsigned int LOOP_MAX_COUNT = 0x100;
+
+namespace {
+
+// // // Longest common extensions of a symbol string, from a suffix array and a sparse table over
+// its LCP array; building is O(n log n) and each query is O(1)
+class CCommonExtension
+{
+public:
+	explicit CCommonExtension(const std::vector<int> &Str) : m_vRank(Str.size())
+	{
+		const int n = Str.size();
+		if (!n)
+			return;
+
+		// Suffix array by prefix doubling
+		std::vector<int> SA(n), Rank(Str), Temp(n);
+		for (int i = 0; i < n; ++i)
+			SA[i] = i;
+		for (int k = 1; ; k <<= 1) {
+			const auto Key = [&] (int i) { return std::make_pair(Rank[i], i + k < n ? Rank[i + k] : -1); };
+			std::sort(SA.begin(), SA.end(), [&] (int a, int b) { return Key(a) < Key(b); });
+			Temp[SA[0]] = 0;
+			for (int i = 1; i < n; ++i)
+				Temp[SA[i]] = Temp[SA[i - 1]] + (Key(SA[i - 1]) < Key(SA[i]) ? 1 : 0);
+			Rank.swap(Temp);
+			if (Rank[SA[n - 1]] == n - 1)
+				break;
+		}
+		m_vRank = Rank;
+
+		// LCP array by Kasai's algorithm
+		std::vector<int> LCP(n, 0);
+		for (int i = 0, h = 0; i < n; ++i) {
+			if (m_vRank[i] > 0) {
+				const int j = SA[m_vRank[i] - 1];
+				while (i + h < n && j + h < n && Str[i + h] == Str[j + h])
+					++h;
+				LCP[m_vRank[i]] = h;
+				if (h > 0)
+					--h;
+			}
+			else
+				h = 0;
+		}
+
+		m_vTable.push_back(std::move(LCP));
+		for (int k = 1; (1 << k) <= n; ++k) {
+			const auto &Prev = m_vTable.back();
+			std::vector<int> Row(n - (1 << k) + 1);
+			for (size_t i = 0; i < Row.size(); ++i)
+				Row[i] = std::min(Prev[i], Prev[i + (1 << (k - 1))]);
+			m_vTable.push_back(std::move(Row));
+		}
+	}
+
+	// Length of the longest common prefix of the suffixes starting at a and b
+	int Get(int a, int b) const
+	{
+		if (a == b)
+			return m_vRank.size() - a;
+		int l = m_vRank[a], r = m_vRank[b];
+		if (l > r)
+			std::swap(l, r);
+		++l;
+		int k = 0;
+		while ((2 << k) <= r - l + 1)
+			++k;
+		return std::min(m_vTable[k][l], m_vTable[k][r - (1 << k) + 1]);
+	}
+
+private:
+	std::vector<int> m_vRank;
+	std::vector<std::vector<int>> m_vTable;
 };
 
-const unsigned char CMD_LOOP_POINT = 26;	// Currently unused
+} // namespace
 
 CPatternCompiler::CPatternCompiler(CFamiTrackerDoc *pDoc, unsigned int *pInstList, DPCM_List_t *pDPCMList, CCompilerLog *pLogger) :
 	m_pDocument(pDoc),
@@ -134,12 +222,13 @@ void CPatternCompiler::CompileData(int Track, int Pattern, int Channel)
 	stChanNote ChanNote;
 
 	// Global init
-	m_iHash = 0;
+	m_iHash = 0xCBF29CE484222325ULL;		// // //
 	m_iDuration = 0;
 	m_iCurrentDefaultDuration = 0xFF;
 
 	m_vData.clear();
 	m_vCompressedData.clear();
+	m_vRowEnds.clear();		// // //
 
 	// Local init
 	unsigned int iPatternLen = m_pDocument->GetPatternLength(Track);
@@ -656,7 +745,66 @@ void CPatternCompiler::CompileData(int Track, int Pattern, int Channel)
 
 	WriteDuration();
 
-//	OptimizeString();
+#ifdef LOOP_COMPRESSION
+	OptimizeString();		// // //
+#endif /* LOOP_COMPRESSION */
+}
+
+namespace {
+
+void AppendKey(std::string &Key, int Value)		// // //
+{
+	Key.append(reinterpret_cast<const char *>(&Value), sizeof(Value));
+}
+
+} // namespace
+
+void CPatternCompiler::GetContextKey(std::string &Key) const		// // //
+{
+	// Serializes the inputs shared by all patterns of an export
+	Key.clear();
+	AppendKey(Key, m_pDocument->GetExpansionChip());
+	AppendKey(Key, m_pDocument->GetNamcoChannels());
+	AppendKey(Key, m_pDocument->GetLinearPitch());
+	AppendKey(Key, m_pDocument->GetSpeedSplitPoint());
+	for (int i = 0; i < MAX_GROOVE; ++i) {
+		const CGroove *pGroove = m_pDocument->GetGroove(i);
+		AppendKey(Key, pGroove != NULL ? pGroove->GetSize() : -1);
+	}
+	for (int i = 0; i < MAX_INSTRUMENTS; ++i) {
+		AppendKey(Key, m_pInstrumentList[i]);
+		AppendKey(Key, m_pDocument->GetInstrumentType(i));
+	}
+	Key.append(reinterpret_cast<const char *>(*m_pDPCMList), sizeof(DPCM_List_t));
+}
+
+void CPatternCompiler::GetPatternKey(int Track, int Pattern, int Channel, std::string &Key) const		// // //
+{
+	// Serializes everything else CompileData reads, the pattern index appears in error messages
+	const CTrackerChannel *pTrackerChannel = m_pDocument->GetChannel(Channel);
+	const unsigned int Rows = m_pDocument->GetPatternLength(Track);
+
+	Key.clear();
+	AppendKey(Key, Pattern);
+	AppendKey(Key, Channel);
+	AppendKey(Key, pTrackerChannel->GetID());
+	AppendKey(Key, pTrackerChannel->GetChip());
+	AppendKey(Key, m_pDocument->GetSongTempo(Track));
+	AppendKey(Key, m_pDocument->GetEffColumns(Track, Channel));
+	AppendKey(Key, Rows);
+
+	for (unsigned int i = 0; i < Rows; ++i) {
+		stChanNote Note;
+		m_pDocument->GetDataAtPattern(Track, Pattern, Channel, i, &Note);
+		Key.push_back(Note.Note);
+		Key.push_back(Note.Octave);
+		Key.push_back(Note.Vol);
+		Key.push_back(Note.Instrument);
+		for (int j = 0; j < MAX_EFFECT_COLUMNS; ++j) {
+			Key.push_back(Note.EffNumber[j]);
+			Key.push_back(Note.EffParam[j]);
+		}
+	}
 }
 
 unsigned char CPatternCompiler::Command(int cmd) const
@@ -752,9 +900,7 @@ void CPatternCompiler::ScanNoteLengths(stSpacingInfo &Info, int Track, unsigned
 void CPatternCompiler::WriteData(unsigned char Value)
 {
 	m_vData.push_back(Value);
-	m_iHash += Value;				// Simple CRC-hash
-	m_iHash += (m_iHash << 10);
-	m_iHash ^= (m_iHash >> 6);
+	m_iHash = (m_iHash ^ Value) * 0x100000001B3ULL;		// // // 64-bit FNV-1a
 }
 
 void CPatternCompiler::AccumulateDuration()
@@ -771,146 +917,122 @@ void CPatternCompiler::WriteDuration()
 			WriteData(m_iDuration - 1);
 	}
 
+	if (m_iDuration > 0)		// // // The row entry ends after its duration
+		m_vRowEnds.push_back(m_vData.size());
+
 	m_iDuration = 0;
 }
 
-// Returns the size of the block at 'position' in the data array. A block is terminated by a note
-int CPatternCompiler::GetBlockSize(int Position)
+void CPatternCompiler::OptimizeString()		// // //
 {
-	unsigned int Pos = Position;
-
-	int iDuration = 1;
-
-	// Find if note duration optimization is on
-	for (int i = 0; i < Position; ++i) {
-		if (m_vData[i] == Command(CMD_SET_DURATION))
-			iDuration = 0;
-		else if (m_vData[i] == Command(CMD_RESET_DURATION))
-			iDuration = 1;
+	// Find repeated runs of row entries and compress them into loops:
+	//
+	// 80 00 2E 00 2E 00 2E 00 2E 00 2E 00 2E 00 ->
+	// 80 00 2E 00 (loop) 04 02
+	//
+	// Loops start and end on row entries, so the driver reads the same bytes in the same order
+	// as the uncompressed string. A loop command is read at most once per row, which bounds
+	// its cycle cost on every channel; among encodings of equal size the one reading the
+	// fewest loop commands is chosen.
+
+	// Split the string into row entries and give equal entries equal symbols
+	std::vector<unsigned int> Offset(1, 0);
+	for (unsigned int End : m_vRowEnds)
+		if (End > Offset.back())
+			Offset.push_back(End);
+	if (Offset.back() < m_vData.size())
+		Offset.push_back(m_vData.size());
+	const int Rows = Offset.size() - 1;
+
+	std::vector<int> Str(Rows), Reverse(Rows);
+	std::unordered_map<std::string, int> Symbols;
+	for (int i = 0; i < Rows; ++i) {
+		std::string Entry(m_vData.begin() + Offset[i], m_vData.begin() + Offset[i + 1]);
+		Str[i] = Symbols.emplace(std::move(Entry), static_cast<int>(Symbols.size())).first->second;
+		Reverse[Rows - 1 - i] = Str[i];
 	}
 
-	for (; Pos < m_vData.size(); Pos++) {
-		unsigned char data = m_vData[Pos];
-		if (data < 0x80) {		// Note
-			//int size = (Pos + 1 + iDuration) - Position;
-			int size = (Pos - Position);
-//			if (size > 1)
-//				return size - 1;
+	const CCommonExtension Forward(Str), Backward(Reverse);
+
+	// Find all runs: a run of period p covers one of the positions 0, p, 2p, ... and is found by
+	// extending the match of that position with the next period in both directions
+	struct stLoop {
+		int Period;
+		int Count;
+	};
+	std::vector<std::vector<stLoop>> Loops(Rows);
+
+	for (int p = 1; p * 2 <= Rows; ++p) {
+		int LastEnd = -1;
+		for (int q = 0; q + p < Rows; q += p) {
+			const int f = Forward.Get(q, q + p);
+			const int b = q ? Backward.Get(Rows - q, Rows - q - p) : 0;
+			if (b + f < p)
+				continue;
+			const int Start = q - std::min(b, q);
+			const int End = q + p + f;
+			if (End == LastEnd)
+				continue;
+			LastEnd = End;
+			// Runs of a shorter period make loops with a shorter body
+			bool Primitive = true;
+			for (int d = 1; d < p && Primitive; ++d)
+				if (p % d == 0 && Forward.Get(Start, Start + d) >= End - Start - d)
+					Primitive = false;
+			if (!Primitive)
+				continue;
+			for (int i = Start; i + p * 2 <= End; ++i) {
+				if (Offset[i + p] - Offset[i] > LOOP_MAX_LENGTH)
+					continue;
+				const int Count = std::min<int>((End - i) / p, LOOP_MAX_COUNT);
+				Loops[i].push_back({p, Count});
+			}
+		}
+	}
 
-			return size + 1 + iDuration;// (Pos + 1 + iDuration) - Position;
+	// Choose the smallest encoding from the end of the string
+	struct stCost {
+		unsigned int Size;
+		unsigned int Reads;		// Loop commands read by the driver
+		int Period;				// Loop taken at this row entry, 0 if the entry is copied
+		int Count;
+		bool operator<(const stCost &other) const {
+			return Size < other.Size || (Size == other.Size && Reads < other.Reads);
 		}
-		else if (data == Command(CMD_SET_DURATION))
-			iDuration = 0;
-		else if (data == Command(CMD_RESET_DURATION))
-			iDuration = 1;
-		else {
-			if (data < 0xE0 || data > 0xEF)
-				Pos++;				// Command, skip parameter
+	};
+	std::vector<stCost> Best(Rows + 1, stCost {0, 0, 0, 0});
+
+	for (int i = Rows - 1; i >= 0; --i) {
+		Best[i] = {Offset[i + 1] - Offset[i] + Best[i + 1].Size, Best[i + 1].Reads, 0, 0};
+		for (const auto &x : Loops[i]) {
+			const stCost &Next = Best[i + x.Period * x.Count];
+			const stCost Cost {Offset[i + x.Period] - Offset[i] + LOOP_COMMAND_SIZE + Next.Size,
+				x.Count + Next.Reads, x.Period, x.Count};
+			if (Cost < Best[i])
+				Best[i] = Cost;
 		}
-	//	Pos++;
 	}
 
-	// Error
-	return 1;
-}
-
-void CPatternCompiler::OptimizeString()
-{
-	// Try to optimize by finding repeating patterns and compress them into a loop (simple RLE)
-	//
-
-	//
-	// Ok, just figured this won't work without using loads of NES RAM so I'll
-	// probably put this on hold for a while
-	//
-
-	unsigned int i, j, k, l;
-	int matches, best_length, last_inst;
-	bool matched;
-
-	/*
-
-	80 00 2E 00 2E 00 2E 00 2E 00 2E 00 2E 00 ->
-	80 00 2E 00 FF 06 02
-
-	*/
-
-	// Always copy first 2 bytes
-//	memcpy(m_pCompressedData, m_pData, 2);
-//	m_iCompressedDataPointer += 2;
-
-	if (m_vData[0] == 0x80)
-		last_inst = m_vData[1];
-	else
-		last_inst = 0;
-
-	// Loop from start
-	for (i = 0; i < m_vData.size(); /*i += 2*/) {
-
-		int best_matches = 0;
-
-		// Instrument
-		if (m_vData[i] == 0x80)
-			last_inst = m_vData[i + 1];
-		else if (m_vData[i] >= 0xE0 && m_vData[i] <= 0xEF)
-			last_inst = m_vData[i & 0xF];
-
-		// Start checking from the first tuple
-		for (l = GetBlockSize(i); l < (m_vData.size() - i); /*l += 2*/) {
-			matches = 0;
-			// See how many following matches there are from this combination in a row
-			for (j = i + l; j <= m_vData.size(); j += l) {
-				matched = true;
-				// Compare one word
-				for (k = 0; k < l; k++) {
-					if (m_vData[i + k] != m_vData[j + k])
-						matched = false;
-				}
-				if (!matched)
-					break;
-				matches++;
-				/*
-				if ((j + l) <= m_iDataPointer) {
-					if (memcmp(m_pData + i, m_pData + j, l) == 0)
-						matches++;
-					else
-						break;
-				}
-				*/
-			}
-			// Save
-			if (matches > best_matches) {
-				best_matches = matches;
-				best_length = l;
-			}
-
-			l += GetBlockSize(i + l);
-		}
-		// Compress
-		if ((best_matches > 1 && best_length > 4) || best_matches > 2 /*&& (best_length > 2 && best_matches > 1)*/) {
-			// Include the first one
-			best_matches++;
-			int size = best_length * best_matches;
-			//
-			// Last known instrument must also be added
-			//
-			std::copy(m_vData.begin() + i, m_vData.begin() + i + best_length, m_vCompressedData.end());
-			// Define a loop point: 0xFF (number of loops) (number of bytes)
+	for (int i = 0; i < Rows; ) {
+		const stCost &Choice = Best[i];
+		if (Choice.Period) {
+			const unsigned int Length = Offset[i + Choice.Period] - Offset[i];
+			m_vCompressedData.insert(m_vCompressedData.end(), m_vData.begin() + Offset[i], m_vData.begin() + Offset[i] + Length);
+			// Define a loop point: command, number of repeats, number of bytes
 			m_vCompressedData.push_back(Command(CMD_LOOP_POINT));
-			m_vCompressedData.push_back(best_matches - 1);	// the nsf code sees one less
-			m_vCompressedData.push_back(best_length);
-			i += size;
+			m_vCompressedData.push_back(Choice.Count - 1);	// the nsf code sees one less
+			m_vCompressedData.push_back(Length);
+			i += Choice.Period * Choice.Count;
 		}
 		else {
 			// No loop
-			int size = GetBlockSize(i);
-			std::copy(m_vData.begin() + i, m_vData.begin() + i + size, m_vCompressedData.end());
-			i += size;
+			m_vCompressedData.insert(m_vCompressedData.end(), m_vData.begin() + Offset[i], m_vData.begin() + Offset[i + 1]);
+			++i;
 		}
 	}
-}	
+}
 
-unsigned int CPatternCompiler::GetHash() const
+uint64_t CPatternCompiler::GetHash() const		// // //
 {
 	return m_iHash;
 }
@@ -921,14 +1043,14 @@ void CPatternCompiler::Print(LPCTSTR text) const
 		m_pLogger->WriteLog(text);
 }
 
-bool CPatternCompiler::CompareData(const std::vector<char> &data) const
-{
-	return m_vData == data;
-}
-
 const std::vector<char> &CPatternCompiler::GetData() const
 {
+	// // // Returns the string stored in the NSF
+#ifdef LOOP_COMPRESSION
+	return m_vCompressedData;
+#else
 	return m_vData;
+#endif /* LOOP_COMPRESSION */
 }
 
 const std::vector<char> &CPatternCompiler::GetCompressedData() const
@@ -938,7 +1060,7 @@ const std::vector<char> &CPatternCompiler::GetCompressedData() const
 
 unsigned int CPatternCompiler::GetDataSize() const
 {
-	return m_vData.size();
+	return GetData().size();		// // //
 }
 
 unsigned int CPatternCompiler::GetCompressedDataSize() const
@@ -20,6 +20,9 @@
 
 #pragma once
 
+#include <cstdint>		// // //
+#include <string>		// // //
+
 class CFamiTrackerDoc;
 class CCompilerLog;
 
@@ -32,9 +35,12 @@ public:
 	~CPatternCompiler();
 
 	void			CompileData(int Track, int Pattern, int Channel);
+
+	// // // Inputs of the compiled data, for reusing it across exports
+	void			GetContextKey(std::string &Key) const;
+	void			GetPatternKey(int Track, int Pattern, int Channel, std::string &Key) const;
 	
-	unsigned int	GetHash() const;
-	bool			CompareData(const std::vector<char> &data) const;
+	uint64_t		GetHash() const;		// // //
 
 	const std::vector<char> &GetData() const;
 	const std::vector<char> &GetCompressedData() const;
@@ -58,7 +64,6 @@ private:
 	void			WriteDuration();
 	void			AccumulateDuration();
 	void			OptimizeString();
-	int				GetBlockSize(int Position);
 	void			ScanNoteLengths(stSpacingInfo &Info, int Track, unsigned int StartRow, int Pattern, int Channel);
 
 	// Debugging
@@ -67,11 +72,12 @@ private:
 private:
 	std::vector<char> m_vData;
 	std::vector<char> m_vCompressedData;
+	std::vector<unsigned int> m_vRowEnds;		// // // Offsets where each row entry ends
 
 	unsigned int	m_iDuration;
 	unsigned int	m_iCurrentDefaultDuration;
 	bool			m_bDSamplesAccessed[OCTAVE_RANGE * NOTE_RANGE]; // <- check the range, its not optimal right now
-	unsigned int	m_iHash;
+	uint64_t		m_iHash;		// // // FNV-1a hash of the compiled data
 	unsigned int	*m_pInstrumentList;
 
 	DPCM_List_t		*m_pDPCMList;
@@ -113,6 +113,15 @@ stChanNote *CPatternData::GetPatternData(unsigned int Channel, unsigned int Patt
 	return m_pPatternData[Channel][Pattern] + Row;
 }
 
+void CPatternData::GetNoteData(unsigned int Channel, unsigned int Pattern, unsigned int Row, stChanNote *pData) const		// // //
+{
+	// Unallocated patterns are read as empty without allocating them, so that reads are thread-safe
+	if (const stChanNote *pNote = GetPatternData(Channel, Pattern, Row))
+		memcpy(pData, pNote, sizeof(stChanNote));
+	else
+		*pData = stChanNote { };
+}
+
 void CPatternData::AllocatePattern(unsigned int Channel, unsigned int Pattern)
 {
 	// Allocate memory
@@ -54,6 +54,7 @@ public:
 	void ClearPattern(unsigned int Channel, unsigned int Pattern);
 
 	stChanNote *GetPatternData(unsigned int Channel, unsigned int Pattern, unsigned int Row);
+	void GetNoteData(unsigned int Channel, unsigned int Pattern, unsigned int Row, stChanNote *pData) const;		// // //
 
 	CString GetTitle() const;
 	unsigned int GetPatternLength() const;
@@ -24,6 +24,9 @@
 #include "FamiTrackerTypes.h"
 #include "APU/Types.h"
 #include "SoundGen.h"
+#include "StageTimer.h"		// // //
+#include "TraceLog.h"		// // //
+#include <fstream>
 
 
 // CPerformanceDlg dialog
@@ -47,6 +50,8 @@ void CPerformanceDlg::DoDataExchange(CDataExchange* pDX)
 BEGIN_MESSAGE_MAP(CPerformanceDlg, CDialog)
 	ON_WM_TIMER()
 	ON_BN_CLICKED(IDOK, OnBnClickedOk)
+	ON_BN_CLICKED(IDC_PERF_TRACE, OnBnClickedPerfTrace)
+	ON_BN_CLICKED(IDC_PERF_SAVE_TRACE, OnBnClickedPerfSaveTrace)
 END_MESSAGE_MAP()
 
 
@@ -59,6 +64,24 @@ BOOL CPerformanceDlg::OnInitDialog()
 	theApp.GetCPUUsage();
 	theApp.GetSoundGenerator()->GetFrameRate();
 
+	// // // Sound engine stage timings
+	CListCtrl *pList = static_cast<CListCtrl*>(GetDlgItem(IDC_PERF_STAGES));
+	pList->SetExtendedStyle(LVS_EX_FULLROWSELECT | LVS_EX_GRIDLINES);
+	CRect r;
+	pList->GetClientRect(&r);
+	const int w = r.Width() - ::GetSystemMetrics(SM_CXHSCROLL);
+	pList->InsertColumn(0, _T("Stage"), LVCFMT_LEFT, static_cast<int>(.32 * w));
+	pList->InsertColumn(1, _T("Calls"), LVCFMT_RIGHT, static_cast<int>(.12 * w));
+	pList->InsertColumn(2, _T("Min"), LVCFMT_RIGHT, static_cast<int>(.14 * w));
+	pList->InsertColumn(3, _T("Mean"), LVCFMT_RIGHT, static_cast<int>(.14 * w));
+	pList->InsertColumn(4, _T("P99"), LVCFMT_RIGHT, static_cast<int>(.14 * w));
+	pList->InsertColumn(5, _T("Max"), LVCFMT_RIGHT, static_cast<int>(.14 * w));
+	for (int i = 0; i < PERF_STAGE_COUNT; ++i)
+		pList->InsertItem(i, CStageTimer::GetStageName(static_cast<perf_stage_t>(i)));
+	CStageTimer::Clear();
+
+	CheckDlgButton(IDC_PERF_TRACE, CTraceLog::IsEnabled() ? BST_CHECKED : BST_UNCHECKED);		// // //
+
 	SetTimer(1, 1000, NULL);
 
 	return TRUE;  // return TRUE unless you set the focus to a control
@@ -85,6 +108,22 @@ void CPerformanceDlg::OnTimer(UINT_PTR nIDEvent)
 	pBar->SetRange(0, 100);
 	pBar->SetPos(Usage / 100);
 
+	// // // Histograms are collected once per timer tick
+	CListCtrl *pList = static_cast<CListCtrl*>(GetDlgItem(IDC_PERF_STAGES));
+	for (int i = 0; i < PERF_STAGE_COUNT; ++i) {
+		const stStageStats Stats = CStageTimer::Collect(static_cast<perf_stage_t>(i));
+		Text.Format(_T("%u"), Stats.Count);
+		pList->SetItemText(i, 1, Text);
+		Text.Format(_T("%.1f"), Stats.Min);
+		pList->SetItemText(i, 2, Text);
+		Text.Format(_T("%.1f"), Stats.Mean);
+		pList->SetItemText(i, 3, Text);
+		Text.Format(_T("%.1f"), Stats.P99);
+		pList->SetItemText(i, 4, Text);
+		Text.Format(_T("%.1f"), Stats.Max);
+		pList->SetItemText(i, 5, Text);
+	}
+
 	CDialog::OnTimer(nIDEvent);
 }
 
@@ -93,6 +132,25 @@ void CPerformanceDlg::OnBnClickedOk()
 	DestroyWindow();
 }
 
+void CPerformanceDlg::OnBnClickedPerfTrace()		// // //
+{
+	const bool Enable = IsDlgButtonChecked(IDC_PERF_TRACE) == BST_CHECKED;
+	if (Enable && !CTraceLog::IsEnabled())
+		CTraceLog::Clear();
+	CTraceLog::SetEnabled(Enable);
+}
+
+void CPerformanceDlg::OnBnClickedPerfSaveTrace()		// // //
+{
+	CFileDialog fileDialog {FALSE, _T("json"), _T("trace.json"), OFN_HIDEREADONLY | OFN_OVERWRITEPROMPT,
+		_T("Chrome trace files (*.json)|*.json|All files (*.*)|*.*||")};
+	if (fileDialog.DoModal() == IDOK) {
+		std::fstream file {fileDialog.GetPathName(), std::ios_base::out};
+		if (!file || !CTraceLog::WriteJSON(file))
+			AfxMessageBox(IDS_SAVE_ERROR, MB_ICONERROR);
+	}
+}
+
 BOOL CPerformanceDlg::DestroyWindow()
 {
 	KillTimer(1);
@@ -42,5 +42,7 @@ public:
 	virtual BOOL OnInitDialog();
 	afx_msg void OnTimer(UINT_PTR nIDEvent);
 	afx_msg void OnBnClickedOk();
+	afx_msg void OnBnClickedPerfTrace();		// // //
+	afx_msg void OnBnClickedPerfSaveTrace();
 	virtual BOOL DestroyWindow();
 };
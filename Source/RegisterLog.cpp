@@ -0,0 +1,209 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#include "RegisterLog.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include "APU/Types.h"
+
+namespace {
+
+const char LOG_MAGIC[8] = "0CCRLOG";
+const uint32_t LOG_VERSION = 1;
+const auto WRITER_INTERVAL = std::chrono::milliseconds {2};
+
+} // namespace
+
+CRegisterLogWriter::CRegisterLogWriter() :
+	m_pBuffer(new stRegisterLogRecord[CAPACITY]),
+	m_iHead(0),
+	m_iTail(0),
+	m_iDropped(0),
+	m_iSession(0),
+	m_bEnabled(false),
+	m_bRunning(false),
+	m_iCurrentSession(0),
+	m_iFrame(0),
+	m_iFrameCycle(0)
+{
+}
+
+CRegisterLogWriter::~CRegisterLogWriter()
+{
+	Close();
+}
+
+bool CRegisterLogWriter::Open(const char *pFile)
+{
+	Close();
+
+	m_File.open(pFile, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	if (!m_File)
+		return false;
+
+	stRegisterLogHeader Header = { };
+	std::memcpy(Header.Magic, LOG_MAGIC, sizeof(Header.Magic));
+	Header.Version = LOG_VERSION;
+	Header.RecordSize = sizeof(stRegisterLogRecord);
+	m_File.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+
+	// Records left over from a previous log are skipped
+	m_iTail.store(m_iHead.load(std::memory_order_acquire), std::memory_order_relaxed);
+	m_iDropped.store(0, std::memory_order_relaxed);
+	m_iSession.fetch_add(1, std::memory_order_relaxed);
+	m_bRunning.store(true, std::memory_order_relaxed);
+	m_Writer = std::thread {&CRegisterLogWriter::WriterThread, this};
+	m_bEnabled.store(true, std::memory_order_release);
+	return true;
+}
+
+void CRegisterLogWriter::Close()
+{
+	if (!m_Writer.joinable())
+		return;
+
+	m_bEnabled.store(false, std::memory_order_relaxed);
+	m_bRunning.store(false, std::memory_order_release);
+	m_Writer.join();
+
+	const uint32_t Dropped = m_iDropped.load(std::memory_order_relaxed);
+	m_File.seekp(offsetof(stRegisterLogHeader, Dropped));
+	m_File.write(reinterpret_cast<const char *>(&Dropped), sizeof(Dropped));
+	m_File.close();
+}
+
+bool CRegisterLogWriter::IsOpen() const
+{
+	return m_bEnabled.load(std::memory_order_relaxed);
+}
+
+void CRegisterLogWriter::OnWrite(uint16_t Address, uint8_t Value, uint32_t Cycle)
+{
+	if (!m_bEnabled.load(std::memory_order_acquire))
+		return;
+
+	const uint32_t Session = m_iSession.load(std::memory_order_relaxed);
+	if (Session != m_iCurrentSession) {
+		m_iCurrentSession = Session;
+		m_iFrame = 0;
+		m_iFrameCycle = 0;
+	}
+
+	const uint32_t Head = m_iHead.load(std::memory_order_relaxed);
+	if (Head - m_iTail.load(std::memory_order_acquire) >= CAPACITY) {
+		m_iDropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	m_pBuffer[Head % CAPACITY] = {m_iFrameCycle + Cycle, m_iFrame, Address, GetChip(Address), Value};
+	m_iHead.store(Head + 1, std::memory_order_release);
+}
+
+void CRegisterLogWriter::OnEndFrame(uint32_t Cycles, const int16_t *Buffer, uint32_t Size)
+{
+	if (!m_bEnabled.load(std::memory_order_relaxed) || m_iSession.load(std::memory_order_relaxed) != m_iCurrentSession)
+		return;
+	++m_iFrame;
+	m_iFrameCycle += Cycles;
+}
+
+uint8_t CRegisterLogWriter::GetChip(uint16_t Address)
+{
+	if (Address == 0x4023 || (Address >= 0x4040 && Address <= 0x409F))
+		return SNDCHIP_FDS;
+	if (Address == 0x4800 || Address == 0xF800)
+		return SNDCHIP_N163;
+	if (Address >= 0x5000 && Address <= 0x5015)
+		return SNDCHIP_MMC5;
+	if (Address == 0x9010 || Address == 0x9030)
+		return SNDCHIP_VRC7;
+	if (Address >= 0x9000 && Address <= 0xB002)
+		return SNDCHIP_VRC6;
+	if (Address == 0xC000 || Address == 0xE000)
+		return SNDCHIP_S5B;
+	return SNDCHIP_NONE;
+}
+
+void CRegisterLogWriter::WriterThread()
+{
+	while (true) {
+		// Read the flag before flushing so that every record written before Close is saved
+		const bool bRunning = m_bRunning.load(std::memory_order_acquire);
+		Flush();
+		if (!bRunning)
+			break;
+		std::this_thread::sleep_for(WRITER_INTERVAL);
+	}
+	m_File.flush();
+}
+
+void CRegisterLogWriter::Flush()
+{
+	const uint32_t Tail = m_iTail.load(std::memory_order_relaxed);
+	const uint32_t Head = m_iHead.load(std::memory_order_acquire);
+	const uint32_t Count = Head - Tail;
+	if (!Count)
+		return;
+
+	const uint32_t Begin = Tail % CAPACITY;
+	const uint32_t First = std::min(Count, CAPACITY - Begin);
+	m_File.write(reinterpret_cast<const char *>(&m_pBuffer[Begin]), First * sizeof(stRegisterLogRecord));
+	if (First < Count)
+		m_File.write(reinterpret_cast<const char *>(&m_pBuffer[0]), (Count - First) * sizeof(stRegisterLogRecord));
+
+	m_iTail.store(Head, std::memory_order_release);
+}
+
+bool CRegisterLogReader::Open(const char *pFile)
+{
+	m_File.open(pFile, std::ios_base::in | std::ios_base::binary);
+	if (!m_File.read(reinterpret_cast<char *>(&m_Header), sizeof(m_Header)))
+		return false;
+	return !std::memcmp(m_Header.Magic, LOG_MAGIC, sizeof(LOG_MAGIC)) &&
+		m_Header.Version == LOG_VERSION && m_Header.RecordSize == sizeof(stRegisterLogRecord);
+}
+
+const stRegisterLogHeader &CRegisterLogReader::GetHeader() const
+{
+	return m_Header;
+}
+
+bool CRegisterLogReader::Read(stRegisterLogRecord &Record)
+{
+	return static_cast<bool>(m_File.read(reinterpret_cast<char *>(&Record), sizeof(Record)));
+}
+
+const char *CRegisterLogReader::GetChipName(uint8_t Chip)
+{
+	switch (Chip) {
+	case SNDCHIP_NONE: return "2A03";
+	case SNDCHIP_VRC6: return "VRC6";
+	case SNDCHIP_VRC7: return "VRC7";
+	case SNDCHIP_FDS:  return "FDS";
+	case SNDCHIP_MMC5: return "MMC5";
+	case SNDCHIP_N163: return "N163";
+	case SNDCHIP_S5B:  return "5B";
+	}
+	return "?";
+}
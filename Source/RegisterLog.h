@@ -0,0 +1,137 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include "Common.h"
+
+/*!
+	\brief Header of a binary register log file.
+*/
+struct stRegisterLogHeader {
+	char Magic[8];				// "0CCRLOG" followed by a null character
+	uint32_t Version;
+	uint32_t RecordSize;		// Size of each record in bytes
+	uint32_t Dropped;			// Number of writes lost because the writer could not keep up
+	uint32_t Reserved;
+};
+
+/*!
+	\brief A single register write in a binary register log. Records are stored in native byte
+	order immediately after the header.
+*/
+struct stRegisterLogRecord {
+	uint64_t Cycle;				// CPU cycles since the log was opened
+	uint32_t Frame;				// Frame number since the log was opened
+	uint16_t Address;
+	uint8_t Chip;				// Sound chip flag, SNDCHIP_NONE for the 2A03
+	uint8_t Value;
+};
+
+static_assert(sizeof(stRegisterLogHeader) == 24, "Register log header must not contain padding");
+static_assert(sizeof(stRegisterLogRecord) == 16, "Register log record must not contain padding");
+
+/*!
+	\brief Records every register write of the emulation into a binary file.
+	\details The emulation thread only copies a fixed-size record into a lock-free single-producer
+	ring buffer; a background thread writes the records to the file. If the buffer overflows, the
+	surplus writes are counted in the file header instead of blocking the emulation thread. The
+	logger can be attached to the APU permanently, it does nothing while no log is open.
+*/
+class CRegisterLogWriter : public IRegisterCapture
+{
+public:
+	/*!	\brief The number of records kept in the ring buffer. */
+	static const unsigned int CAPACITY = 1u << 16;
+
+	CRegisterLogWriter();
+	~CRegisterLogWriter();
+
+	/*!	\brief Begins logging into a new file.
+		\param pFile The file name.
+		\return Whether the file could be created.
+	*/
+	bool Open(const char *pFile);
+	/*!	\brief Stops logging, writes all pending records and closes the file. */
+	void Close();
+	/*!	\brief Returns whether a log is open. */
+	bool IsOpen() const;
+
+	void OnWrite(uint16_t Address, uint8_t Value, uint32_t Cycle) override;
+	void OnEndFrame(uint32_t Cycles, const int16_t *Buffer, uint32_t Size) override;
+
+	/*!	\brief Returns the sound chip which owns a register address. */
+	static uint8_t GetChip(uint16_t Address);
+
+private:
+	void WriterThread();
+	void Flush();
+
+private:
+	std::unique_ptr<stRegisterLogRecord[]> m_pBuffer;
+	std::atomic<uint32_t> m_iHead;			// Written by the emulation thread
+	std::atomic<uint32_t> m_iTail;			// Written by the writer thread
+	std::atomic<uint32_t> m_iDropped;
+	std::atomic<uint32_t> m_iSession;		// Incremented every time a log is opened
+	std::atomic<bool> m_bEnabled;
+	std::atomic<bool> m_bRunning;
+
+	// Emulation thread state
+	uint32_t m_iCurrentSession;
+	uint32_t m_iFrame;
+	uint64_t m_iFrameCycle;
+
+	std::ofstream m_File;
+	std::thread m_Writer;
+};
+
+/*!
+	\brief Reads binary register log files.
+*/
+class CRegisterLogReader
+{
+public:
+	/*!	\brief Opens a log file and reads its header.
+		\return Whether the file is a register log of a supported version.
+	*/
+	bool Open(const char *pFile);
+	/*!	\brief Returns the header of the open log. */
+	const stRegisterLogHeader &GetHeader() const;
+	/*!	\brief Reads the next record.
+		\return Whether a record was read.
+	*/
+	bool Read(stRegisterLogRecord &Record);
+
+	/*!	\brief Returns the name of a sound chip as stored in a record. */
+	static const char *GetChipName(uint8_t Chip);
+
+private:
+	std::ifstream m_File;
+	stRegisterLogHeader m_Header;
+};
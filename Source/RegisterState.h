@@ -23,6 +23,7 @@
 
 #pragma once
 
+#include <cstdint>		// // //
 #include <unordered_map>
 
 /*!
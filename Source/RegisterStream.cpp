@@ -0,0 +1,251 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#include "RegisterStream.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+const uint64_t FNV_OFFSET = 0xCBF29CE484222325ULL;
+const uint64_t FNV_PRIME = 0x100000001B3ULL;
+
+// Tracks the address ports of the expansion chips so that each write can be attributed to a channel
+class CRegisterDecoder
+{
+public:
+	std::string GetChannel(uint16_t Address) const {
+		char Buf[32];
+		if (Address >= 0x4000 && Address <= 0x4013) {
+			static const char *const NAMES[] = {"Pulse 1", "Pulse 2", "Triangle", "Noise", "DPCM"};
+			return NAMES[(Address - 0x4000) >> 2];
+		}
+		if (Address == 0x4015 || Address == 0x4017)
+			return "2A03";
+		if (Address >= 0x4040 && Address <= 0x408A)
+			return "FDS";
+		if (Address >= 0x5000 && Address <= 0x5007)
+			return Address < 0x5004 ? "MMC5 Pulse 1" : "MMC5 Pulse 2";
+		if (Address >= 0x5010 && Address <= 0x5015)
+			return "MMC5";
+		if (Address >= 0x9000 && Address <= 0x9003)
+			return "VRC6 Pulse 1";
+		if (Address >= 0xA000 && Address <= 0xA002)
+			return "VRC6 Pulse 2";
+		if (Address >= 0xB000 && Address <= 0xB002)
+			return "VRC6 Sawtooth";
+		if (Address == 0x9010 || Address == 0xF800 || Address == 0xC000)
+			return "address port";
+		if (Address == 0x9030) {
+			if (m_iVRC7Address < 0x08)
+				return "VRC7 custom patch";
+			sprintf(Buf, "VRC7 FM %d", (m_iVRC7Address & 0x0F) + 1);
+			return Buf;
+		}
+		if (Address == 0x4800) {
+			const int Reg = m_iN163Address & 0x7F;
+			if (Reg < 0x40)
+				return "N163 wave RAM";
+			sprintf(Buf, "N163 %d", 8 - ((Reg - 0x40) >> 3));
+			return Buf;
+		}
+		if (Address == 0xE000) {
+			if (m_iS5BAddress < 0x06 || (m_iS5BAddress >= 0x08 && m_iS5BAddress <= 0x0A)) {
+				sprintf(Buf, "5B %c", 'A' + (m_iS5BAddress < 0x06 ? m_iS5BAddress >> 1 : m_iS5BAddress - 0x08));
+				return Buf;
+			}
+			return "5B";
+		}
+		return "unknown";
+	}
+
+	void Update(uint16_t Address, uint8_t Value) {
+		switch (Address) {
+		case 0x9010: m_iVRC7Address = Value; break;
+		case 0xF800: m_iN163Address = Value; break;
+		case 0xC000: m_iS5BAddress = Value & 0x0F; break;
+		case 0x4800:
+			if (m_iN163Address & 0x80)
+				m_iN163Address = 0x80 | ((m_iN163Address + 1) & 0x7F);
+			break;
+		}
+	}
+
+private:
+	uint8_t m_iVRC7Address = 0;
+	uint8_t m_iN163Address = 0;
+	uint8_t m_iS5BAddress = 0;
+};
+
+std::string FormatWrite(const stRegisterWrite &Write)
+{
+	char Buf[32];
+	sprintf(Buf, "$%04X = $%02X @ %u", Write.Address, Write.Value, Write.Cycle);
+	return Buf;
+}
+
+} // namespace
+
+void CRegisterStream::OnWrite(uint16_t Address, uint8_t Value, uint32_t Cycle)
+{
+	m_PendingWrites.push_back({Cycle, Address, Value});
+}
+
+void CRegisterStream::OnEndFrame(uint32_t Cycles, const int16_t *Buffer, uint32_t Size)
+{
+	uint64_t Hash = FNV_OFFSET;
+	const uint8_t *pData = reinterpret_cast<const uint8_t *>(Buffer);
+	for (uint32_t i = 0; i < Size * sizeof(int16_t); ++i)
+		Hash = (Hash ^ pData[i]) * FNV_PRIME;
+
+	m_Frames.push_back({std::move(m_PendingWrites), Hash});
+	m_PendingWrites.clear();
+}
+
+void CRegisterStream::OnSongEnd()
+{
+	m_bFinished = true;
+}
+
+void CRegisterStream::Clear()
+{
+	m_Frames.clear();
+	m_PendingWrites.clear();
+	m_bFinished = false;
+}
+
+const std::vector<stStreamFrame> &CRegisterStream::GetFrames() const
+{
+	return m_Frames;
+}
+
+bool CRegisterStream::IsFinished() const
+{
+	return m_bFinished;
+}
+
+void CRegisterStream::Save(std::ostream &Stream) const
+{
+	char Buf[64];
+	sprintf(Buf, "frames %u\n", static_cast<unsigned>(m_Frames.size()));
+	Stream << Buf;
+	for (const auto &Frame : m_Frames) {
+		sprintf(Buf, "f %016llX\n", static_cast<unsigned long long>(Frame.AudioHash));
+		Stream << Buf;
+		for (const auto &Write : Frame.Writes) {
+			sprintf(Buf, "%u %04X %02X\n", Write.Cycle, Write.Address, Write.Value);
+			Stream << Buf;
+		}
+	}
+	Stream << "end\n";
+}
+
+bool CRegisterStream::Load(std::istream &Stream)
+{
+	Clear();
+
+	std::string Token;
+	unsigned int Count;
+	if (!(Stream >> Token) || Token != "frames" || !(Stream >> Count))
+		return false;
+	m_Frames.reserve(Count);
+
+	while (Stream >> Token) {
+		if (Token == "end")
+			return m_Frames.size() == Count;
+		if (Token == "f") {
+			unsigned long long Hash;
+			if (!(Stream >> std::hex >> Hash >> std::dec))
+				return false;
+			m_Frames.push_back({{}, Hash});
+			continue;
+		}
+		if (m_Frames.empty())
+			return false;
+		char *pEnd;
+		const unsigned long Cycle = std::strtoul(Token.c_str(), &pEnd, 10);
+		unsigned int Address, Value;
+		if (*pEnd || !(Stream >> std::hex >> Address >> Value >> std::dec))
+			return false;
+		m_Frames.back().Writes.push_back({static_cast<uint32_t>(Cycle), static_cast<uint16_t>(Address), static_cast<uint8_t>(Value)});
+	}
+
+	return false;
+}
+
+stStreamDivergence CRegisterStream::Compare(const CRegisterStream &Expected, const CRegisterStream &Actual, bool CompareAudio)
+{
+	stStreamDivergence Result;
+	CRegisterDecoder Decoder;
+	char Buf[128];
+
+	const auto &e = Expected.GetFrames();
+	const auto &a = Actual.GetFrames();
+	const size_t Frames = std::min(e.size(), a.size());
+
+	for (size_t i = 0; i < Frames; ++i) {
+		const auto &ew = e[i].Writes;
+		const auto &aw = a[i].Writes;
+		const size_t Writes = std::min(ew.size(), aw.size());
+
+		for (size_t j = 0; j < Writes; ++j) {
+			if (ew[j].Address != aw[j].Address || ew[j].Value != aw[j].Value || ew[j].Cycle != aw[j].Cycle) {
+				Result.Diverged = true;
+				Result.Frame = i;
+				Result.Channel = Decoder.GetChannel(ew[j].Address);
+				Result.Description = "write " + std::to_string(j) + ": expected " + FormatWrite(ew[j]) + ", got " + FormatWrite(aw[j]);
+				return Result;
+			}
+			Decoder.Update(ew[j].Address, ew[j].Value);
+		}
+
+		if (ew.size() != aw.size()) {
+			const auto &Extra = ew.size() > aw.size() ? ew[Writes] : aw[Writes];
+			Result.Diverged = true;
+			Result.Frame = i;
+			Result.Channel = Decoder.GetChannel(Extra.Address);
+			sprintf(Buf, "expected %u writes, got %u; first unmatched write ",
+				static_cast<unsigned>(ew.size()), static_cast<unsigned>(aw.size()));
+			Result.Description = Buf + FormatWrite(Extra);
+			return Result;
+		}
+
+		if (CompareAudio && e[i].AudioHash != a[i].AudioHash) {
+			Result.Diverged = true;
+			Result.Frame = i;
+			Result.Description = "audio differs";
+			return Result;
+		}
+	}
+
+	if (e.size() != a.size()) {
+		Result.Diverged = true;
+		Result.Frame = Frames;
+		sprintf(Buf, "expected %u frames, got %u", static_cast<unsigned>(e.size()), static_cast<unsigned>(a.size()));
+		Result.Description = Buf;
+	}
+
+	return Result;
+}
@@ -0,0 +1,99 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "Common.h"
+
+/*!
+	\brief A single register write captured from the emulation.
+*/
+struct stRegisterWrite {
+	uint32_t Cycle;		// CPU cycles since the start of the frame
+	uint16_t Address;
+	uint8_t Value;
+};
+
+/*!
+	\brief Register writes and the audio hash of a single frame.
+*/
+struct stStreamFrame {
+	std::vector<stRegisterWrite> Writes;
+	uint64_t AudioHash;		// FNV-1a hash of the samples produced by the frame
+};
+
+/*!
+	\brief Location of the first difference between two register streams.
+*/
+struct stStreamDivergence {
+	bool Diverged = false;
+	unsigned int Frame = 0;		// Frame index of the difference
+	std::string Channel;		// Channel or chip owning the register, if the difference is a register write
+	std::string Description;	// Human-readable description of the difference
+};
+
+/*!
+	\brief Records the register writes and the per-frame audio of an emulation run.
+	\details A stream is filled from the sound thread through the IRegisterCapture interface, and
+	may only be read after the run has finished. Streams are stored as text so that golden files
+	remain readable and small enough to keep under version control.
+*/
+class CRegisterStream : public IRegisterCapture
+{
+public:
+	void OnWrite(uint16_t Address, uint8_t Value, uint32_t Cycle) override;
+	void OnEndFrame(uint32_t Cycles, const int16_t *Buffer, uint32_t Size) override;
+	void OnSongEnd() override;
+
+	/*!	\brief Removes all captured frames. */
+	void Clear();
+	/*!	\brief Returns the captured frames. */
+	const std::vector<stStreamFrame> &GetFrames() const;
+	/*!	\brief Returns whether the rendered part of the song has ended. Can be called from any thread. */
+	bool IsFinished() const;
+
+	/*!	\brief Writes the stream in text form. */
+	void Save(std::ostream &Stream) const;
+	/*!	\brief Reads a stream written by Save.
+		\return Whether the stream was read successfully.
+	*/
+	bool Load(std::istream &Stream);
+
+	/*!	\brief Finds the first difference between two streams.
+		\param Expected The reference stream.
+		\param Actual The stream under test.
+		\param CompareAudio Whether the audio hashes are compared; register writes are always compared.
+	*/
+	static stStreamDivergence Compare(const CRegisterStream &Expected, const CRegisterStream &Actual, bool CompareAudio);
+
+private:
+	std::vector<stStreamFrame> m_Frames;
+	std::vector<stRegisterWrite> m_PendingWrites;
+	std::atomic<bool> m_bFinished {false};
+};
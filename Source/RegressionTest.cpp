@@ -0,0 +1,171 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#include "stdafx.h"
+#include "RegressionTest.h"
+#include <fstream>
+#include <string>
+#include "FamiTracker.h"
+#include "FamiTrackerDoc.h"
+#include "SoundGen.h"
+#include "Settings.h"
+#include "RegisterStream.h"
+
+namespace {
+
+const char GOLDEN_HEADER[] = "0cc-regression";
+const int GOLDEN_VERSION = 1;
+const DWORD RENDER_START_TIMEOUT = 5000;		// Milliseconds to wait for the sound thread to begin rendering
+
+} // namespace
+
+CRegressionTest::CRegressionTest(const CString &GoldenPath, bool bUpdate, FILE *pReport) :
+	m_strGoldenPath(GoldenPath),
+	m_bUpdate(bUpdate),
+	m_pReport(pReport),
+	m_iFailures(0)
+{
+}
+
+bool CRegressionTest::RunModule(const CString &Path)
+{
+	const DWORD StartTime = GetTickCount();
+
+	CFamiTrackerDoc *pDoc = static_cast<CFamiTrackerDoc*>(theApp.OpenDocumentFile(Path));
+	if (pDoc == NULL || !pDoc->IsFileLoaded()) {
+		fprintf(m_pReport, "FAIL %s: unable to open module\n", (LPCTSTR)Path);
+		++m_iFailures;
+		return false;
+	}
+
+	const int SampleRate = theApp.GetSettings()->Sound.iSampleRate;
+	const CString GoldenFile = GetGoldenFile(Path);
+
+	if (m_bUpdate) {
+		std::fstream File {GoldenFile, std::ios_base::out};
+		File << GOLDEN_HEADER << ' ' << GOLDEN_VERSION << '\n';
+		File << "rate " << SampleRate << '\n';
+		File << "tracks " << pDoc->GetTrackCount() << '\n';
+		CRegisterStream Stream;
+		for (unsigned int i = 0; i < pDoc->GetTrackCount(); ++i) {
+			if (!Render(i, DEFAULT_FRAMES, Stream)) {
+				fprintf(m_pReport, "FAIL %s: unable to render track %u\n", (LPCTSTR)Path, i + 1);
+				++m_iFailures;
+				return false;
+			}
+			File << "track " << i << ' ' << DEFAULT_FRAMES << '\n';
+			Stream.Save(File);
+		}
+		if (!File) {
+			fprintf(m_pReport, "FAIL %s: unable to write %s\n", (LPCTSTR)Path, (LPCTSTR)GoldenFile);
+			++m_iFailures;
+			return false;
+		}
+		fprintf(m_pReport, "UPDATED %s (%.1f s)\n", (LPCTSTR)Path, (GetTickCount() - StartTime) / 1000.);
+		return true;
+	}
+
+	std::fstream File {GoldenFile, std::ios_base::in};
+	std::string Token;
+	int Version = 0, GoldenRate = 0;
+	unsigned int Tracks = 0;
+	if (!File || !(File >> Token >> Version) || Token != GOLDEN_HEADER || Version != GOLDEN_VERSION ||
+		!(File >> Token >> GoldenRate) || Token != "rate" || !(File >> Token >> Tracks) || Token != "tracks") {
+		fprintf(m_pReport, "FAIL %s: missing or invalid golden file %s\n", (LPCTSTR)Path, (LPCTSTR)GoldenFile);
+		++m_iFailures;
+		return false;
+	}
+
+	const bool CompareAudio = GoldenRate == SampleRate;
+	if (!CompareAudio)
+		fprintf(m_pReport, "NOTE %s: golden file uses %i Hz, audio is not compared\n", (LPCTSTR)Path, GoldenRate);
+	if (Tracks != pDoc->GetTrackCount()) {
+		fprintf(m_pReport, "FAIL %s: expected %u tracks, got %u\n", (LPCTSTR)Path, Tracks, pDoc->GetTrackCount());
+		++m_iFailures;
+		return false;
+	}
+
+	CRegisterStream Expected, Actual;
+	for (unsigned int i = 0; i < Tracks; ++i) {
+		unsigned int Track, Frames;
+		if (!(File >> Token >> Track >> Frames) || Token != "track" || Track != i || !Expected.Load(File)) {
+			fprintf(m_pReport, "FAIL %s: invalid golden file %s\n", (LPCTSTR)Path, (LPCTSTR)GoldenFile);
+			++m_iFailures;
+			return false;
+		}
+		if (!Render(i, Frames, Actual)) {
+			fprintf(m_pReport, "FAIL %s: unable to render track %u\n", (LPCTSTR)Path, i + 1);
+			++m_iFailures;
+			return false;
+		}
+		const stStreamDivergence Result = CRegisterStream::Compare(Expected, Actual, CompareAudio);
+		if (Result.Diverged) {
+			fprintf(m_pReport, "FAIL %s: track %u, frame %u, %s%s%s\n", (LPCTSTR)Path, i + 1, Result.Frame,
+				Result.Channel.c_str(), Result.Channel.empty() ? "" : ", ", Result.Description.c_str());
+			++m_iFailures;
+			return false;
+		}
+	}
+
+	fprintf(m_pReport, "PASS %s (%.1f s)\n", (LPCTSTR)Path, (GetTickCount() - StartTime) / 1000.);
+	return true;
+}
+
+int CRegressionTest::GetFailureCount() const
+{
+	return m_iFailures;
+}
+
+bool CRegressionTest::Render(unsigned int Track, unsigned int Frames, CRegisterStream &Stream) const
+{
+	CSoundGen *pSoundGen = theApp.GetSoundGenerator();
+	Stream.Clear();
+	pSoundGen->RenderToCapture(&Stream, Frames, Track);
+
+	// The sound thread starts rendering after it has received the message, and the stream is
+	// notified once all frames have been rendered
+	const DWORD Start = GetTickCount();
+	while (true) {
+		MSG msg;
+		while (::PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+			::TranslateMessage(&msg);
+			::DispatchMessage(&msg);
+		}
+		if (Stream.IsFinished()) {
+			if (!pSoundGen->IsRendering())
+				return true;
+		}
+		else if (!pSoundGen->IsRendering() && GetTickCount() - Start > RENDER_START_TIMEOUT)
+			return false;
+		Sleep(1);
+	}
+}
+
+CString CRegressionTest::GetGoldenFile(const CString &Path) const
+{
+	CString Name = Path.Mid(Path.ReverseFind(_T('\\')) + 1);
+	CString Folder = m_strGoldenPath;
+	if (!Folder.IsEmpty() && Folder.Right(1) != _T("\\"))
+		Folder += _T("\\");
+	return Folder + Name + _T(".golden");
+}
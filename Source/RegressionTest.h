@@ -0,0 +1,70 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#pragma once
+
+#include <cstdio>
+
+class CRegisterStream;
+
+/*!
+	\brief Plays modules through the sound engine and compares the resulting register writes and
+	audio against stored golden files.
+	\details Each module is loaded into the active document and every track is rendered for a fixed
+	number of frames with a CRegisterStream attached to the APU. The golden file of a module is
+	stored in the golden directory under the module's file name with the extension .golden. The
+	audio hashes depend on the sample rate and mixer settings, so only the register writes are
+	compared if the sample rate differs from the one used to create the golden file.
+*/
+class CRegressionTest
+{
+public:
+	/*!	\brief Constructs the test.
+		\param GoldenPath The directory containing the golden files.
+		\param bUpdate Whether the golden files are rewritten instead of compared.
+		\param pReport The file receiving the report.
+	*/
+	CRegressionTest(const CString &GoldenPath, bool bUpdate, FILE *pReport);
+
+	/*!	\brief Runs the test on a single module.
+		\return Whether the module matches its golden file, or the golden file was written.
+	*/
+	bool RunModule(const CString &Path);
+
+	/*!	\brief Returns the number of modules that failed the test. */
+	int GetFailureCount() const;
+
+public:
+	static const unsigned int DEFAULT_FRAMES = 600;		// Number of frames rendered for new golden files
+
+private:
+	bool Render(unsigned int Track, unsigned int Frames, CRegisterStream &Stream) const;
+	CString GetGoldenFile(const CString &Path) const;
+
+private:
+	CString m_strGoldenPath;
+	bool m_bUpdate;
+	FILE *m_pReport;
+	int m_iFailures;
+};
@@ -0,0 +1,343 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "RenderCache.h"
+#include <iterator>
+#include "APU/APU.h"
+
+namespace {
+
+const uint64_t FNV_OFFSET = 0xCBF29CE484222325ULL;
+const uint64_t FNV_PRIME = 0x100000001B3ULL;
+
+uint64_t HashBytes(uint64_t Hash, const void *pData, size_t Size)
+{
+	const uint8_t *pBytes = static_cast<const uint8_t *>(pData);
+	for (size_t i = 0; i < Size; ++i)
+		Hash = (Hash ^ pBytes[i]) * FNV_PRIME;
+	return Hash;
+}
+
+template <typename T>
+uint64_t HashValue(uint64_t Hash, const T &Value)
+{
+	return HashBytes(Hash, &Value, sizeof(Value));
+}
+
+} // namespace
+
+CRenderCache::CRenderCache(unsigned Interval, size_t MaxSamples) :
+	m_iInterval(Interval ? Interval : 1),
+	m_iMaxSamples(MaxSamples),
+	m_iFrameHash(FNV_OFFSET)
+{
+}
+
+void CRenderCache::Begin(CAPU *pAPU)
+{
+	m_pAPU = pAPU;
+	m_Current = stRecord { };
+	m_Events.clear();
+	m_PendingFrames.clear();
+	m_iFrameHash = FNV_OFFSET;
+	m_iCheckpointFrame = 0;
+	m_iAudioRead = 0;
+	m_iReusedFrames = 0;
+	m_iEmulatedFrames = 0;
+	m_bDiverged = false;
+	m_bReplaying = false;
+	m_bOverflow = false;
+	m_bUncached = false;
+
+	m_pAPU->SaveSettings(m_Current.Settings);
+	auto it = m_Previous.Checkpoints.find(0);
+	m_bSynced = it != m_Previous.Checkpoints.end() && m_Previous.Settings == m_Current.Settings;
+	if (m_bSynced)
+		m_pAPU->LoadState(it->second);
+	else
+		m_Previous = stRecord { };
+
+	std::vector<uint8_t> State;
+	m_pAPU->SaveState(State);
+	m_Current.Checkpoints.emplace(0, std::move(State));
+	m_pAPU->SetSkipEmulation(m_bSynced);
+}
+
+size_t CRenderCache::Update(const int16_t *&pSamples)
+{
+	if (m_bDiverged)
+		Resume();
+	if (m_bOverflow && !m_bUncached)
+		StopCaching();
+
+	if (m_bUncached) {
+		// Only the audio that has not been read yet is kept
+		m_Current.Audio.erase(m_Current.Audio.begin(), m_Current.Audio.begin() + m_iAudioRead);
+		m_iAudioRead = 0;
+	}
+	// Checkpoints are only taken between frames, when the writes of the next frame have not begun
+	else if (m_PendingFrames.size() >= m_iInterval && m_Events.size() == m_PendingFrames.back().EventEnd)
+		Checkpoint();
+
+	pSamples = m_Current.Audio.data() + m_iAudioRead;
+	const size_t Size = m_Current.Audio.size() - m_iAudioRead;
+	m_iAudioRead = m_Current.Audio.size();
+	return Size;
+}
+
+void CRenderCache::Finish()
+{
+	if (!m_pAPU)
+		return;
+
+	if (m_bSynced)
+		Resume();
+	if (m_bOverflow && !m_bUncached)
+		StopCaching();
+	m_pAPU->SetSkipEmulation(false);
+	m_pAPU = nullptr;
+
+	m_Previous = std::move(m_Current);
+	m_Current = stRecord { };
+	m_Events.clear();
+	m_PendingFrames.clear();
+}
+
+void CRenderCache::Clear()
+{
+	m_bOverflow = false;
+	m_bUncached = false;
+	m_Previous = stRecord { };
+	m_Current = stRecord { };
+	m_Events.clear();
+	m_PendingFrames.clear();
+	m_Samples.clear();
+}
+
+unsigned CRenderCache::GetReusedFrames() const
+{
+	return m_iReusedFrames;
+}
+
+unsigned CRenderCache::GetEmulatedFrames() const
+{
+	return m_iEmulatedFrames;
+}
+
+void CRenderCache::OnWrite(uint16_t Address, uint8_t Value, uint32_t Cycle)
+{
+	AddEvent({EVENT_WRITE, Address, Value, Cycle, 0});
+}
+
+void CRenderCache::OnEndFrame(uint32_t Cycles, const int16_t *Buffer, uint32_t Size)
+{
+	if (m_bReplaying) {
+		// Only the frames that have not been written yet are kept
+		const size_t Frame = m_iReplayFrame++;
+		if (Frame == m_Current.Frames.size())
+			AddFrame(m_PendingFrames[Frame - m_iCheckpointFrame].Hash, Buffer, Size);
+		return;
+	}
+	if (!m_pAPU)
+		return;
+	if (m_bUncached) {
+		m_Current.Audio.insert(m_Current.Audio.end(), Buffer, Buffer + Size);
+		++m_iEmulatedFrames;
+		return;
+	}
+
+	const uint64_t Hash = HashValue(m_iFrameHash, Cycles);
+	m_iFrameHash = FNV_OFFSET;
+	m_PendingFrames.push_back({Hash, Cycles, m_Events.size()});
+
+	if (!m_bSynced)
+		AddFrame(Hash, Buffer, Size);
+	else if (!m_bDiverged) {
+		// The APU cannot be restored from inside its own frame, this is left to Update
+		const size_t Frame = m_Current.Frames.size();
+		if (Frame < m_Previous.Frames.size() && m_Previous.Frames[Frame].Hash == Hash)
+			ReuseFrame(m_Previous.Frames[Frame]);
+		else
+			m_bDiverged = true;
+	}
+}
+
+void CRenderCache::OnSampleMemory(const char *pData, int Size)
+{
+	if (!m_pAPU || m_bReplaying || m_bUncached)
+		return;
+	if (Size < 0 || !pData)
+		Size = 0;
+
+	const uint64_t Key = HashValue(HashBytes(FNV_OFFSET, pData, Size), Size);
+	if (m_Samples.find(Key) == m_Samples.end())
+		m_Samples.emplace(Key, std::vector<char>(pData, pData + Size));
+	AddEvent({EVENT_SAMPLE, 0, 0, m_pAPU->GetFrameCycles(), Key});
+}
+
+void CRenderCache::OnClearSample()
+{
+	if (m_pAPU && !m_bReplaying)
+		AddEvent({EVENT_CLEAR_SAMPLE, 0, 0, m_pAPU->GetFrameCycles(), 0});
+}
+
+void CRenderCache::OnReset()
+{
+	if (m_pAPU && !m_bReplaying)
+		AddEvent({EVENT_RESET, 0, 0, m_pAPU->GetFrameCycles(), 0});
+}
+
+void CRenderCache::OnProcess(uint32_t Cycle)
+{
+	// The output depends on how the emulated time is divided, so replays follow the same slices
+	AddEvent({EVENT_PROCESS, 0, 0, Cycle, 0});
+}
+
+void CRenderCache::AddEvent(const stEvent &Event)
+{
+	if (!m_pAPU || m_bReplaying || m_bUncached)
+		return;
+
+	m_Events.push_back(Event);
+	uint64_t Hash = m_iFrameHash;
+	Hash = HashValue(Hash, Event.Type);
+	Hash = HashValue(Hash, Event.Address);
+	Hash = HashValue(Hash, Event.Value);
+	Hash = HashValue(Hash, Event.Cycle);
+	m_iFrameHash = HashValue(Hash, Event.Sample);
+}
+
+void CRenderCache::AddFrame(uint64_t Hash, const int16_t *Buffer, size_t Size)
+{
+	m_Current.Frames.push_back({Hash, m_Current.Audio.size(), Size});
+	m_Current.Audio.insert(m_Current.Audio.end(), Buffer, Buffer + Size);
+	++m_iEmulatedFrames;
+	m_bOverflow |= m_Current.Audio.size() > m_iMaxSamples;
+}
+
+void CRenderCache::ReuseFrame(const stFrame &Frame)
+{
+	const auto Begin = m_Previous.Audio.begin() + Frame.Offset;
+	m_Current.Frames.push_back({Frame.Hash, m_Current.Audio.size(), Frame.Size});
+	m_Current.Audio.insert(m_Current.Audio.end(), Begin, Begin + Frame.Size);
+	++m_iReusedFrames;
+	if (m_Current.Audio.size() > m_iMaxSamples) {
+		// The emulation must be restored before frames can be passed on without being stored
+		m_bOverflow = true;
+		m_bDiverged = true;
+	}
+}
+
+void CRenderCache::Checkpoint()
+{
+	const size_t Frame = m_iCheckpointFrame + m_PendingFrames.size();
+	auto it = m_Previous.Checkpoints.find(Frame);
+
+	if (m_bSynced) {
+		if (it != m_Previous.Checkpoints.end())
+			m_Current.Checkpoints.emplace(Frame, std::move(it->second));
+		else
+			Resume();		// the previous render ended here
+	}
+	if (!m_bSynced) {
+		std::vector<uint8_t> State;
+		m_pAPU->SaveState(State);
+		if (it != m_Previous.Checkpoints.end() && it->second == State) {
+			m_bSynced = true;
+			m_pAPU->SetSkipEmulation(true);
+		}
+		m_Current.Checkpoints.emplace(Frame, std::move(State));
+	}
+
+	m_Events.clear();
+	m_PendingFrames.clear();
+	m_iCheckpointFrame = Frame;
+}
+
+void CRenderCache::Resume()
+{
+	// Restores the exact state of the APU by emulating all events since the last checkpoint
+	const uint32_t Cycles = m_pAPU->GetFrameCycles();
+	m_bReplaying = true;
+	m_pAPU->SetSkipEmulation(false);
+	m_pAPU->LoadState(m_Current.Checkpoints.at(m_iCheckpointFrame));
+	m_iReplayFrame = m_iCheckpointFrame;
+
+	uint32_t Pos = 0;
+	size_t Event = 0;
+	for (const auto &Frame : m_PendingFrames) {
+		for (; Event < Frame.EventEnd; ++Event)
+			Pos = Replay(m_Events[Event], Pos);
+		m_pAPU->AddTime(Frame.Cycles - Pos);
+		m_pAPU->Process();
+		Pos = 0;
+	}
+	for (; Event < m_Events.size(); ++Event)
+		Pos = Replay(m_Events[Event], Pos);
+	m_pAPU->AddTime(Cycles - Pos);
+	m_pAPU->Process();
+
+	m_bReplaying = false;
+	m_bSynced = false;
+	m_bDiverged = false;
+}
+
+void CRenderCache::StopCaching()
+{
+	// The APU is in its exact emulated state here, the stored renders are no longer needed. The
+	// initial state is kept, so that the next render still begins from the same state
+	m_bUncached = true;
+	m_Previous = stRecord { };
+	m_Current.Checkpoints.erase(std::next(m_Current.Checkpoints.begin()), m_Current.Checkpoints.end());
+	m_Current.Frames.clear();
+	m_Current.Audio.erase(m_Current.Audio.begin(), m_Current.Audio.begin() + m_iAudioRead);
+	m_Current.Audio.shrink_to_fit();
+	m_iAudioRead = 0;
+	m_Events.clear();
+	m_PendingFrames.clear();
+}
+
+uint32_t CRenderCache::Replay(const stEvent &Event, uint32_t Pos)
+{
+	m_pAPU->AddTime(Event.Cycle - Pos);
+	m_pAPU->Process();
+
+	switch (Event.Type) {
+	case EVENT_PROCESS:
+		break;
+	case EVENT_WRITE:
+		m_pAPU->Write(Event.Address, Event.Value);
+		break;
+	case EVENT_SAMPLE: {
+		const auto &Data = m_Samples.at(Event.Sample);
+		m_pAPU->WriteSample(Data.data(), static_cast<int>(Data.size()));
+		break;
+	}
+	case EVENT_CLEAR_SAMPLE:
+		m_pAPU->ClearSample();
+		break;
+	case EVENT_RESET:
+		m_pAPU->Reset();
+		return 0;
+	}
+	return Event.Cycle;
+}
@@ -0,0 +1,152 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "Common.h"
+
+class CAPU;
+
+/*!
+	\brief Reuses the audio of the previous render for the frames whose register writes did not change.
+	\details The cache is attached to the APU as its register capture during a file render. The
+	tracker engine always runs, but while the writes of each frame match those of the previous render
+	the sound chips are not emulated and the stored audio is returned instead. The complete emulation
+	state is saved every few frames; at the first frame that differs the APU is restored from the
+	last of these checkpoints and the writes since then are replayed, and once a later checkpoint is
+	equal to the one of the previous render, the stored audio is used again.
+
+	The audio of both renders is kept in memory. Once a render is longer than the size limit, the
+	remaining frames are emulated without being stored and only the initial state of the render is
+	kept for the next one.
+*/
+class CRenderCache : public IRegisterCapture
+{
+public:
+	/*!	\param Interval Number of frames between two emulation checkpoints.
+		\param MaxSamples Number of samples of a render that may be stored. */
+	explicit CRenderCache(unsigned Interval = 32, size_t MaxSamples = 1 << 24);
+
+	/*!	\brief Starts a render on an APU that has just been reset and uses this cache as its capture.
+		\details If the previous render used the same settings, its initial state is restored so that
+		the chip state not cleared by a reset does not prevent the audio from being reused. */
+	void Begin(CAPU *pAPU);
+	/*!	\brief Called after each frame of the APU has been run.
+		\param pSamples Receives the samples that became available since the last call.
+		\return The number of available samples.
+	*/
+	size_t Update(const int16_t *&pSamples);
+	/*!	\brief Ends the render, leaving the APU in its exact emulated state.
+		\details The render becomes the reference for the next one, even if it was stopped early. */
+	void Finish();
+	/*!	\brief Discards all stored renders. */
+	void Clear();
+
+	/*!	\brief Returns the number of frames of the last render taken from the render before it. */
+	unsigned GetReusedFrames() const;
+	/*!	\brief Returns the number of frames of the last render that were emulated. */
+	unsigned GetEmulatedFrames() const;
+
+	void OnWrite(uint16_t Address, uint8_t Value, uint32_t Cycle) override;
+	void OnEndFrame(uint32_t Cycles, const int16_t *Buffer, uint32_t Size) override;
+	void OnSampleMemory(const char *pData, int Size) override;
+	void OnClearSample() override;
+	void OnReset() override;
+	void OnProcess(uint32_t Cycle) override;
+
+private:
+	enum event_t : uint8_t {
+		EVENT_PROCESS,
+		EVENT_WRITE,
+		EVENT_SAMPLE,
+		EVENT_CLEAR_SAMPLE,
+		EVENT_RESET,
+	};
+
+	struct stEvent {
+		event_t Type;
+		uint16_t Address;
+		uint8_t Value;
+		uint32_t Cycle;
+		uint64_t Sample;		// Key of the sample memory contents
+	};
+
+	struct stPendingFrame {
+		uint64_t Hash;
+		uint32_t Cycles;
+		size_t EventEnd;		// One past the last event of the frame
+	};
+
+	struct stFrame {
+		uint64_t Hash;		// Hash of the register writes and the length of the frame
+		size_t Offset;		// Position of the audio
+		size_t Size;
+	};
+
+	struct stRecord {
+		std::vector<uint8_t> Settings;
+		std::map<size_t, std::vector<uint8_t>> Checkpoints;		// APU state at the start of a frame, by frame index
+		std::vector<stFrame> Frames;
+		std::vector<int16_t> Audio;
+	};
+
+	void AddEvent(const stEvent &Event);
+	void AddFrame(uint64_t Hash, const int16_t *Buffer, size_t Size);
+	void ReuseFrame(const stFrame &Frame);
+	void Checkpoint();
+	void Resume();
+	void StopCaching();
+	uint32_t Replay(const stEvent &Event, uint32_t Pos);
+
+private:
+	const unsigned m_iInterval;
+	const size_t m_iMaxSamples;
+	CAPU *m_pAPU = nullptr;
+
+	stRecord m_Previous;
+	stRecord m_Current;
+
+	bool m_bSynced = false;				// The state is equal to that of the previous render
+	bool m_bDiverged = false;			// A frame differed while synced, the APU must be restored
+	bool m_bReplaying = false;
+	bool m_bOverflow = false;			// The render exceeded the size limit
+	bool m_bUncached = false;			// Frames are emulated and passed on without being stored
+
+	std::vector<stEvent> m_Events;					// Events since the last checkpoint
+	std::vector<stPendingFrame> m_PendingFrames;	// Frames since the last checkpoint
+	uint64_t m_iFrameHash;							// Hash of the events in the current frame
+
+	size_t m_iCheckpointFrame = 0;		// Index of the first frame after the last checkpoint
+	size_t m_iReplayFrame = 0;
+	size_t m_iAudioRead = 0;
+	unsigned m_iReusedFrames = 0;
+	unsigned m_iEmulatedFrames = 0;
+
+	std::unordered_map<uint64_t, std::vector<char>> m_Samples;		// Sample memory contents by hash
+};
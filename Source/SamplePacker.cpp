@@ -0,0 +1,206 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#include "SamplePacker.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+unsigned int GetPlayedSize(unsigned int Size)
+{
+	// The length register holds the size divided by 16, one extra byte is always read
+	return Size ? ((Size >> 4) << 4) + 1 : 0;
+}
+
+bool FitsInWindow(unsigned int Used, unsigned int Size, unsigned int WindowSize)
+{
+	// The played size may exceed the stored size by one byte, a sample never ends at the window end
+	return Used + Size < WindowSize;
+}
+
+} // namespace
+
+void CSamplePacker::Clear()
+{
+	m_vSamples.clear();
+	m_vStored.clear();
+	m_iWindowCount = 0;
+}
+
+int CSamplePacker::AddSample(const char *pData, unsigned int Size)
+{
+	const int Index = m_vSamples.size();
+	m_vSamples.push_back({pData, Size, Index, 0, {0, 0}});
+	return Index;
+}
+
+void CSamplePacker::Merge()
+{
+	std::vector<int> Order(m_vSamples.size());
+	for (size_t i = 0; i < Order.size(); ++i)
+		Order[i] = i;
+	std::stable_sort(Order.begin(), Order.end(), [this] (int a, int b) {
+		return m_vSamples[a].Size > m_vSamples[b].Size;
+	});
+
+	// Longer samples are stored first, so that every shorter sample is compared against them
+	std::vector<int> Stored;
+	for (int i : Order) {
+		stSample &Sample = m_vSamples[i];
+		Sample.Source = i;
+		Sample.Offset = 0;
+		if (!Sample.Size)
+			continue;
+
+		// The byte read after a sample whose size is a multiple of 16 lies outside its data, it
+		// already depends on what is stored after the sample and is not compared
+		const unsigned int Compared = std::min(GetPlayedSize(Sample.Size), Sample.Size);
+		for (int s : Stored) {
+			const stSample &Source = m_vSamples[s];
+			for (unsigned int Offset = 0; Offset + Sample.Size <= Source.Size; Offset += 0x40)
+				if (!memcmp(Source.pData + Offset, Sample.pData, Compared)) {
+					Sample.Source = s;
+					Sample.Offset = Offset;
+					break;
+				}
+			if (Sample.Source != i)
+				break;
+		}
+		if (Sample.Source == i)
+			Stored.push_back(i);
+	}
+}
+
+void CSamplePacker::Pack(unsigned int WindowSize)
+{
+	m_vStored.clear();
+	for (size_t i = 0; i < m_vSamples.size(); ++i)
+		if (m_vSamples[i].Source == static_cast<int>(i) && m_vSamples[i].Size > 0)
+			m_vStored.push_back(i);
+
+	std::vector<unsigned int> Used;
+	if (WindowSize == 0) {
+		Used.push_back(0);
+		for (int i : m_vStored) {
+			m_vSamples[i].Location = {0, Used[0]};
+			Used[0] += GetAlignedSize(m_vSamples[i].Size);
+		}
+	}
+	else {
+		// First-fit-decreasing, each sample is smaller than a window
+		std::vector<int> Order(m_vStored);
+		std::stable_sort(Order.begin(), Order.end(), [this] (int a, int b) {
+			return m_vSamples[a].Size > m_vSamples[b].Size;
+		});
+		for (int i : Order) {
+			const unsigned int Size = m_vSamples[i].Size;
+			unsigned int w = 0;
+			while (w < Used.size() && !FitsInWindow(Used[w], Size, WindowSize))
+				++w;
+			if (w == Used.size())
+				Used.push_back(0);
+			m_vSamples[i].Location.Window = w;
+			Used[w] += GetAlignedSize(Size);
+		}
+
+		// A sample never fits in the remaining space of an earlier window, so storing the windows
+		// one after another in the order the samples were placed reproduces the assignment
+		m_vStored = Order;
+		std::stable_sort(m_vStored.begin(), m_vStored.end(), [this] (int a, int b) {
+			return m_vSamples[a].Location.Window < m_vSamples[b].Location.Window;
+		});
+		std::fill(Used.begin(), Used.end(), 0);
+		for (int i : m_vStored) {
+			stSampleLocation &Location = m_vSamples[i].Location;
+			Location.Offset = Used[Location.Window];
+			Used[Location.Window] += GetAlignedSize(m_vSamples[i].Size);
+		}
+	}
+	m_iWindowCount = Used.size();
+
+	// Shared samples point into their source
+	for (stSample &Sample : m_vSamples) {
+		const stSample &Source = m_vSamples[Sample.Source];
+		Sample.Location = {Source.Location.Window, Source.Location.Offset + Sample.Offset};
+	}
+}
+
+const std::vector<int> &CSamplePacker::GetStoredSamples() const
+{
+	return m_vStored;
+}
+
+stSampleLocation CSamplePacker::GetLocation(int Index) const
+{
+	return m_vSamples[Index].Location;
+}
+
+unsigned int CSamplePacker::GetWindowCount() const
+{
+	return m_iWindowCount;
+}
+
+unsigned int CSamplePacker::GetStoredSize() const
+{
+	unsigned int Size = 0;
+	for (int i : m_vStored)
+		Size += GetAlignedSize(m_vSamples[i].Size);
+	return Size;
+}
+
+int CSamplePacker::GetSharedCount() const
+{
+	int Count = 0;
+	for (size_t i = 0; i < m_vSamples.size(); ++i)
+		if (m_vSamples[i].Source != static_cast<int>(i))
+			++Count;
+	return Count;
+}
+
+unsigned int CSamplePacker::GetSequentialSize() const
+{
+	unsigned int Size = 0;
+	for (const stSample &Sample : m_vSamples)
+		Size += GetAlignedSize(Sample.Size);
+	return Size;
+}
+
+unsigned int CSamplePacker::GetSequentialWindowCount(unsigned int WindowSize) const
+{
+	unsigned int Windows = 1;
+	unsigned int Used = 0;
+	for (const stSample &Sample : m_vSamples) {
+		if (!FitsInWindow(Used, Sample.Size, WindowSize)) {
+			++Windows;
+			Used = 0;
+		}
+		Used += GetAlignedSize(Sample.Size);
+	}
+	return Windows;
+}
+
+unsigned int CSamplePacker::GetAlignedSize(unsigned int Size)
+{
+	return Size + ((0x40 - (Size & 0x3F)) & 0x3F);
+}
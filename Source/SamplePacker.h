@@ -0,0 +1,92 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#pragma once
+
+#include <vector>
+
+/*!
+	\brief A location of DPCM sample data.
+*/
+struct stSampleLocation {
+	unsigned int Window;		// Index of the DPCM bank window
+	unsigned int Offset;		// Offset from the beginning of the window, a multiple of 64
+};
+
+/*!
+	\brief Lays out the DPCM samples of an exported module.
+	\details A sample that is identical to another sample, or to the data at any 64-byte aligned
+	offset of a longer sample, is not stored and points into the other sample instead, since the
+	hardware only reads the sample length rounded down to 16 bytes plus one. The remaining samples
+	are assigned to bank windows by first-fit-decreasing.
+*/
+class CSamplePacker
+{
+public:
+	/*!	\brief Removes all samples. */
+	void Clear();
+	/*!	\brief Adds a sample.
+		\param pData Pointer to the sample data, which must remain valid until the packer is cleared.
+		\param Size Size of the sample in bytes.
+		\return The index of the sample. */
+	int AddSample(const char *pData, unsigned int Size);
+
+	/*!	\brief Finds samples that can share the data of other samples. */
+	void Merge();
+	/*!	\brief Assigns the stored samples to windows.
+		\param WindowSize Size of each window, or 0 to store all samples contiguously in one window. */
+	void Pack(unsigned int WindowSize);
+
+	/*!	\brief Returns the indices of the samples to be stored, in the order they are stored. Each
+		window begins with the first sample that does not fit in the previous window. */
+	const std::vector<int> &GetStoredSamples() const;
+	/*!	\brief Returns the location of a sample. */
+	stSampleLocation GetLocation(int Index) const;
+	/*!	\brief Returns the number of windows used. */
+	unsigned int GetWindowCount() const;
+	/*!	\brief Returns the total size of the stored samples, including alignment. */
+	unsigned int GetStoredSize() const;
+	/*!	\brief Returns the number of samples sharing the data of another sample. */
+	int GetSharedCount() const;
+	/*!	\brief Returns the total size of all samples if each is stored in the order it was added. */
+	unsigned int GetSequentialSize() const;
+	/*!	\brief Returns the number of windows used if all samples are stored in the order they were added. */
+	unsigned int GetSequentialWindowCount(unsigned int WindowSize) const;
+
+	/*!	\brief Returns the size of a sample including the padding up to the next 64-byte boundary. */
+	static unsigned int GetAlignedSize(unsigned int Size);
+
+private:
+	struct stSample {
+		const char *pData;
+		unsigned int Size;
+		int Source;				// Index of the sample storing the data
+		unsigned int Offset;	// Offset into the data of the source sample
+		stSampleLocation Location;
+	};
+
+	std::vector<stSample> m_vSamples;
+	std::vector<int> m_vStored;
+	unsigned int m_iWindowCount = 0;
+};
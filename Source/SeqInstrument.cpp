@@ -32,7 +32,6 @@
 #include "OldSequence.h"		// // //
 #include "SeqInstrument.h"
 #include "Chunk.h"
-#include "ChunkRenderText.h"
 
 /*
  * Base class for instruments using sequences
@@ -186,14 +185,14 @@ int CSeqInstrument::Compile(CChunk *pChunk, int Index)
 {
 	int StoredBytes = 0;
 
-	const char *label = nullptr;		// // //
+	chunk_label_t label = CHUNK_LABEL_NONE;		// // //
 	switch (GetType()) {
-	case INST_2A03: pChunk->StoreByte(0);  label = CChunkRenderText::LABEL_SEQ_2A03; break;
-	case INST_VRC6: pChunk->StoreByte(4);  label = CChunkRenderText::LABEL_SEQ_VRC6; break;
-	case INST_N163: pChunk->StoreByte(9);  label = CChunkRenderText::LABEL_SEQ_N163; break;
-	case INST_S5B:  pChunk->StoreByte(10); label = CChunkRenderText::LABEL_SEQ_S5B;  break;
+	case INST_2A03: pChunk->StoreByte(0);  label = CHUNK_LABEL_SEQ_2A03; break;
+	case INST_VRC6: pChunk->StoreByte(4);  label = CHUNK_LABEL_SEQ_VRC6; break;
+	case INST_N163: pChunk->StoreByte(9);  label = CHUNK_LABEL_SEQ_N163; break;
+	case INST_S5B:  pChunk->StoreByte(10); label = CHUNK_LABEL_SEQ_S5B;  break;
 	}
-	ASSERT(label != nullptr);
+	ASSERT(label != CHUNK_LABEL_NONE);
 
 	int ModSwitch = 0;
 	for (unsigned i = 0; i < SEQ_COUNT; ++i) {
@@ -206,9 +205,7 @@ int CSeqInstrument::Compile(CChunk *pChunk, int Index)
 	
 	for (unsigned i = 0; i < SEQ_COUNT; ++i) {
 		if (ModSwitch & (1 << i)) {
-			CStringA str;
-			str.Format(label, GetSeqIndex(i) * SEQ_COUNT + i);
-			pChunk->StoreReference(str);
+			pChunk->StoreReference(label, GetSeqIndex(i) * SEQ_COUNT + i);		// // //
 			StoredBytes += 2;
 		}
 	}
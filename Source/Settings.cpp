@@ -151,6 +151,7 @@ void CSettings::SetupSettings()
 	SETTING_INT("Sound", "Treble filter freq", 12000, &Sound.iTrebleFilter);
 	SETTING_INT("Sound", "Treble filter damping", 24, &Sound.iTrebleDamping);
 	SETTING_INT("Sound", "Volume", 100, &Sound.iMixVolume);
+	SETTING_INT("Sound", "Render sample size", 16, &Sound.iRenderSampleSize);		// // //
 
 	// Midi
 	SETTING_INT("MIDI", "Device", 0, &Midi.iMidiDevice);
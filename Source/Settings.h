@@ -155,6 +155,7 @@ public:
 		int		iTrebleFilter;
 		int		iTrebleDamping;
 		int		iMixVolume;
+		int		iRenderSampleSize;		// // // 8, 16 or 24-bit PCM, 32 for float, all with 16-bit precision
 	} Sound;
 
 	struct {
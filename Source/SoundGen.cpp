@@ -31,6 +31,7 @@
 //
 
 #include "stdafx.h"
+#include <fstream>		// // //
 #include "FamiTracker.h"
 #include "FTMComponentInterface.h"		// // //
 #include "ChannelState.h"		// // //
@@ -40,6 +41,8 @@
 #include "MainFrm.h"
 #include "DirectSound.h"
 #include "WaveFile.h"		// // //
+#include "FlacFile.h"		// // //
+#include "LoudnessMeter.h"		// // //
 #include "APU/APU.h"
 #include "ChannelHandler.h"
 #include "ChannelsN163.h" // N163 channel count
@@ -51,6 +54,11 @@
 #include "MIDI.h"
 #include "ChannelFactory.h"		// // // test
 #include "DetuneTable.h"		// // //
+#include "StageTimer.h"		// // //
+#include "RegisterLog.h"		// // //
+#include "RenderCache.h"		// // //
+#include "ExportVerifier.h"		// // //
+#include "DriverProfiler.h"		// // //
 
 // 1kHz test tone
 //#define AUDIO_TEST
@@ -64,9 +72,6 @@
 // Write a file with the volume table
 //#define WRITE_VOLUME_FILE
 
-// // // Log VGM output (experimental)
-//#define WRITE_VGM
-
 // Enable audio dithering
 //#define DITHERING
 
@@ -79,6 +84,31 @@ const double CSoundGen::OLD_VIBRATO_DEPTH[] = {
 	1.0, 1.0, 2.0, 3.0, 4.0, 7.0, 8.0, 15.0, 16.0, 31.0, 32.0, 63.0, 64.0, 127.0, 128.0, 255.0
 };
 
+namespace {
+
+// // // Export verification request, passed to the player thread
+struct stVerifyJob {
+	CStringA File;
+	unsigned int Song;
+	std::shared_ptr<const CRegisterSnapshotLog> pReference;		// Owned by the job, which may outlive the caller
+	stVerifyResult Result;
+	CEvent Done;
+};
+
+// // // Driver profiling request, passed to the player thread
+struct stProfileJob {
+	CStringA File;
+	unsigned int Song;
+	std::shared_ptr<const CSongPositionLog> pReference;		// Owned by the job, which may outlive the caller
+	stDriverProfile Result;
+	CEvent Done;
+};
+
+const DWORD VERIFY_TIMEOUT_MS = 120000;		// Milliseconds to wait for a verification job
+const DWORD RENDER_START_TIMEOUT = 5000;		// // // Milliseconds to wait for the sound thread to begin rendering
+
+} // namespace
+
 IMPLEMENT_DYNCREATE(CSoundGen, CWinThread)
 
 BEGIN_MESSAGE_MAP(CSoundGen, CWinThread)
@@ -94,6 +124,8 @@ BEGIN_MESSAGE_MAP(CSoundGen, CWinThread)
 	ON_THREAD_MESSAGE(WM_USER_CLOSE_SOUND, OnCloseSound)
 	ON_THREAD_MESSAGE(WM_USER_SET_CHIP, OnSetChip)
 	ON_THREAD_MESSAGE(WM_USER_REMOVE_DOCUMENT, OnRemoveDocument)
+	ON_THREAD_MESSAGE(WM_USER_VERIFY_EXPORT, OnVerifyExport)		// // //
+	ON_THREAD_MESSAGE(WM_USER_PROFILE_EXPORT, OnProfileExport)		// // //
 END_MESSAGE_MAP()
 
 #ifdef DITHERING
@@ -108,9 +140,18 @@ CSoundGen::CSoundGen() :
 	m_pDSoundChannel(NULL),
 	m_pAccumBuffer(NULL),
 	m_iGraphBuffer(NULL),
+	m_iGraphBufferPtr(0),		// // //
+	m_iGraphDecimation(1),
+	m_iGraphAccum(0),
+	m_iGraphAccumCount(0),
 	m_pDocument(NULL),
 	m_pTrackerView(NULL),
 	m_bRendering(false),
+	m_bRenderFailed(false),		// // //
+	m_pRegisterCapture(nullptr),		// // //
+	m_pRegisterLog(new CRegisterLogWriter()),		// // //
+	m_pRenderCache(new CRenderCache()),		// // //
+	m_iRenderLoopRow(-1),		// // //
 	m_bPlaying(false),
 	m_bHaltRequest(false),
 	m_bDoHalt(false),		// // //
@@ -133,7 +174,6 @@ CSoundGen::CSoundGen() :
 	m_iPlayTrack(0),
 	m_iPlayTicks(0),
 	m_iConsumedCycles(0),
-	m_iRegisterStream(),		// // //
 	m_bBufferUnderrun(false),
 	m_bAudioClipping(false),
 	m_iClipCounter(0),
@@ -147,6 +187,7 @@ CSoundGen::CSoundGen() :
 
 	// Create APU
 	m_pAPU = new CAPU(this);		// // //
+	m_pAPU->SetRegisterCapture(m_pRegisterLog.get());		// // //
 
 	// Create all kinds of channels
 	CreateChannels();
@@ -742,15 +783,19 @@ bool CSoundGen::ResetAudioDevice()
 	SAFE_RELEASE_ARRAY(m_pAccumBuffer);
 	m_pAccumBuffer = new char[m_iBufSizeBytes];
 
-	// Sample graph buffer
+	// // // Sample graph buffer, decimated so that the visualizer load does not grow with the sample rate
+	m_iGraphDecimation = (SampleRate - 1) / GRAPH_RATE_MAX + 1;
+	m_iGraphBufferPtr = 0;
+	m_iGraphAccum = 0;
+	m_iGraphAccumCount = 0;
 	SAFE_RELEASE_ARRAY(m_iGraphBuffer);
-	m_iGraphBuffer = new short[m_iBufSizeSamples];
+	m_iGraphBuffer = new short[m_iBufSizeSamples / m_iGraphDecimation + 1];
 
 	// Sample graph rate
 	m_csVisualizerWndLock.Lock();
 
 	if (m_pVisualizerWnd)
-		m_pVisualizerWnd->SetSampleRate(SampleRate);
+		m_pVisualizerWnd->SetSampleRate(SampleRate / m_iGraphDecimation);
 
 	m_csVisualizerWndLock.Unlock();
 
@@ -825,6 +870,9 @@ void CSoundGen::ResetBuffer()
 	ASSERT(GetCurrentThreadId() == m_nThreadID);
 
 	m_iBufferPtr = 0;
+	m_iGraphBufferPtr = 0;		// // //
+	m_iGraphAccum = 0;
+	m_iGraphAccumCount = 0;
 
 	if (m_pDSoundChannel)
 		m_pDSoundChannel->ClearBuffer();
@@ -842,6 +890,12 @@ void CSoundGen::FlushBuffer(int16_t *pBuffer, uint32_t Size)
 	if (!m_pDSoundChannel)
 		return;
 
+	// // // File renders are written from the render cache once the frame is complete
+	if (m_bRendering && m_pAudioFile)
+		return;
+
+	CStageScope Timer {PERF_FILL_BUFFER};		// // //
+
 	if (m_iSampleSize == 8)
 		FillBuffer<uint8_t, 8>(pBuffer, Size);
 	else
@@ -865,6 +919,7 @@ void CSoundGen::FillBuffer(int16_t *pBuffer, uint32_t Size)
 	const int SAMPLE_MAX = 32768;
 
 	T *pConversionBuffer = (T*)m_pAccumBuffer;
+	const bool bGraph = !m_bRendering;		// // // the visualizer is not drawn while rendering
 
 	for (uint32_t i = 0; i < Size; ++i) {
 		int16_t Sample = pBuffer[i];
@@ -893,7 +948,14 @@ void CSoundGen::FillBuffer(int16_t *pBuffer, uint32_t Size)
 		ASSERT(m_iBufferPtr < m_iBufSizeSamples);
 
 		// Visualizer
-		m_iGraphBuffer[m_iBufferPtr] = (short)Sample;
+		if (bGraph) {		// // //
+			m_iGraphAccum += Sample;
+			if (++m_iGraphAccumCount == m_iGraphDecimation) {
+				m_iGraphBuffer[m_iGraphBufferPtr++] = (short)(m_iGraphAccum / (int)m_iGraphDecimation);
+				m_iGraphAccum = 0;
+				m_iGraphAccumCount = 0;
+			}
+		}
 
 		// Convert sample and store in temp buffer
 #ifdef DITHERING
@@ -918,10 +980,11 @@ void CSoundGen::FillBuffer(int16_t *pBuffer, uint32_t Size)
 
 bool CSoundGen::PlayBuffer()
 {
+	CStageScope Timer {PERF_PLAY_BUFFER};		// // //
+
 	if (m_bRendering) {
 		// Output to file
-		ASSERT(m_pWaveFile);		// // //
-		m_pWaveFile->WriteWave(m_pAccumBuffer, m_iBufSizeBytes);
+		// // // wave files are written from FlushBuffer, only register captures get here
 		m_iBufferPtr = 0;
 	}
 	else {
@@ -929,20 +992,28 @@ bool CSoundGen::PlayBuffer()
 		DWORD dwEvent;
 
 		// Wait for a buffer event
-		while ((dwEvent = m_pDSoundChannel->WaitForSyncEvent(AUDIO_TIMEOUT)) != BUFFER_IN_SYNC) {
-			switch (dwEvent) {
-				case BUFFER_TIMEOUT:
-					// Buffer timeout
-					m_bBufferTimeout = true;
-				case BUFFER_CUSTOM_EVENT:
-					// Custom event, quit
-					m_iBufferPtr = 0;
-					return false;
-				case BUFFER_OUT_OF_SYNC:
-					// Buffer underrun detected
-					m_iAudioUnderruns++;
-					m_bBufferUnderrun = true;
-					break;
+		{		// // // Only the wait is traced
+			CTraceScope Trace {"WaitForSyncEvent"};		// // //
+			while ((dwEvent = m_pDSoundChannel->WaitForSyncEvent(AUDIO_TIMEOUT)) != BUFFER_IN_SYNC) {
+				switch (dwEvent) {
+					case BUFFER_TIMEOUT:
+						// Buffer timeout
+						m_bBufferTimeout = true;
+					case BUFFER_CUSTOM_EVENT:
+						// Custom event, quit
+						m_iBufferPtr = 0;
+						m_iGraphBufferPtr = 0;		// // //
+						m_iGraphAccum = 0;
+						m_iGraphAccumCount = 0;
+						return false;
+					case BUFFER_OUT_OF_SYNC:
+						// Buffer underrun detected
+						m_iAudioUnderruns++;
+						m_bBufferUnderrun = true;
+						CTraceLog::RecordInstant("Buffer underrun");		// // //
+						CTraceLog::RequestDump();
+						break;
+				}
 			}
 		}
 
@@ -953,12 +1024,15 @@ bool CSoundGen::PlayBuffer()
 		m_csVisualizerWndLock.Lock();
 
 		if (m_pVisualizerWnd)
-			m_pVisualizerWnd->FlushSamples(m_iGraphBuffer, m_iBufSizeSamples);
+			m_pVisualizerWnd->FlushSamples(m_iGraphBuffer, m_iGraphBufferPtr);		// // //
 
 		m_csVisualizerWndLock.Unlock();
 
 		// Reset buffer position
 		m_iBufferPtr = 0;
+		m_iGraphBufferPtr = 0;		// // // drop partial groups so that every block has the same size
+		m_iGraphAccum = 0;
+		m_iGraphAccumCount = 0;
 		m_bBufferTimeout = false;
 	}
 
@@ -1096,10 +1170,6 @@ void CSoundGen::BeginPlayer(play_mode_t Mode, int Track)
 
 	memset(m_bFramePlayed, false, sizeof(bool) * MAX_FRAMES);
 
-#ifdef WRITE_VGM		// // //
-	std::queue<int>().swap(m_iRegisterStream);
-#endif
-
 	{		// // // 050B
 		m_iRowTickCount = 0;
 
@@ -1111,6 +1181,8 @@ void CSoundGen::BeginPlayer(play_mode_t Mode, int Track)
 	}
 
 	ResetTempo();
+	if (m_bRendering && m_pRegisterCapture)		// // //
+		m_pRegisterCapture->OnSongStart();
 	ResetAPU();
 
 	MakeSilent();
@@ -1291,77 +1363,6 @@ void CSoundGen::HaltPlayer()
 		m_pTrackerView->PostMessage(WM_USER_PLAYER, m_iPlayFrame, m_iPlayRow);
 		m_pInstRecorder->StopRecording(m_pTrackerView);		// // //
 	}
-
-#ifdef WRITE_VGM		// // //
-	CFile vgm("test.vgm", CFile::modeCreate | CFile::modeWrite | CFile::typeBinary);
-	int c = 0;
-	for (int i = 0; i < 0x100; ++i)
-		vgm.Write(&c, 1);
-	int Delay = 0;
-	int DelayTotal = 0;
-	const long long VGM_SAMPLE_RATE = 44100;
-
-	while (!m_iRegisterStream.empty()) { // TODO: move this to a separate thread
-		int Val = m_iRegisterStream.front();
-		m_iRegisterStream.pop();
-		if (Val == 0x62) {
-			++Delay;
-			++DelayTotal;
-		}
-		else {
-			if (Delay) {
-				int Samples = static_cast<int>(VGM_SAMPLE_RATE * Delay / m_iFrameRate);
-				while (Samples > 0xFFFF) {
-					Samples -= 0xFFFF;
-					c = 0xFFFF61;
-					vgm.Write(&c, 3);
-				}
-				if (Samples == static_cast<int>(VGM_SAMPLE_RATE / CAPU::FRAME_RATE_NTSC)) { // 735
-					c = 0x62;
-					vgm.Write(&c, 1);
-				}
-				else if (Samples == static_cast<int>(VGM_SAMPLE_RATE / CAPU::FRAME_RATE_PAL)) { // 882
-					c = 0x63;
-					vgm.Write(&c, 1);
-				}
-				else {
-					c = 0x61 | (Samples << 8);
-					vgm.Write(&c, 3);
-				}
-				Delay = 0;
-			}
-			vgm.Write(&Val, 1);
-			Val = m_iRegisterStream.front();
-			m_iRegisterStream.pop();
-			vgm.Write(&Val, 1);
-			Val = m_iRegisterStream.front();
-			m_iRegisterStream.pop();
-			vgm.Write(&Val, 1);
-		}
-	}
-	c = 0x66;
-	vgm.Write(&c, 1);
-
-	vgm.Seek(0, CFile::begin);
-	char Header[256] = {'V', 'g', 'm', ' '};
-	*reinterpret_cast<int*>(Header + 0x04) = static_cast<int>(vgm.GetLength()) - 4;
-	*reinterpret_cast<int*>(Header + 0x08) = 0x161;
-	*reinterpret_cast<int*>(Header + 0x18) = static_cast<int>(VGM_SAMPLE_RATE * DelayTotal / m_iFrameRate);
-	*reinterpret_cast<int*>(Header + 0x24) = m_iFrameRate;
-	*reinterpret_cast<int*>(Header + 0x34) = 0xCC;
-	*reinterpret_cast<int*>(Header + 0x84) = CAPU::BASE_FREQ_NTSC;
-	if (m_pDocument) { // TODO: do this in BeginPlayer
-		if (m_pDocument->ExpansionEnabled(SNDCHIP_FDS))
-			*reinterpret_cast<int*>(Header + 0x84) |= 0x80000000;
-		if (m_pDocument->ExpansionEnabled(SNDCHIP_S5B)) {
-			*reinterpret_cast<int*>(Header + 0x74) = CAPU::BASE_FREQ_NTSC / 2;
-			*reinterpret_cast<int*>(Header + 0x78) = 0x0110;
-		}
-	}
-	
-	vgm.Write(Header, 256);
-	vgm.Close();
-#endif
 }
 
 void CSoundGen::ResetAPU()
@@ -1375,11 +1376,6 @@ void CSoundGen::ResetAPU()
 	// Enable all channels
 	m_pAPU->Write(0x4015, 0x0F);
 	m_pAPU->Write(0x4017, 0x00);
-	
-	// // // for VGM
-	WriteRegister(0x4015, 0x0F);
-	WriteRegister(0x4017, 0x00);
-	WriteRegister(0x4023, 0x02); // FDS enable
 
 	// MMC5
 	m_pAPU->Write(0x5015, 0x03);
@@ -1525,6 +1521,8 @@ void CSoundGen::RunFrame()
 	ASSERT(m_pDocument != NULL);
 	ASSERT(m_pTrackerView != NULL);
 
+	CStageScope Timer {PERF_RUN_FRAME};		// // //
+
 	// View callback
 	m_pTrackerView->PlayerTick();
 
@@ -1534,13 +1532,25 @@ void CSoundGen::RunFrame()
 
 		if (m_bRendering) {
 			if (m_iRenderEndWhen == SONG_TIME_LIMIT) {
-				if (m_iPlayTicks > (unsigned int)m_iRenderEndParam)
-					m_bRequestRenderStop = m_bHaltRequest = true;		// // //
+				if (m_iPlayTicks > (unsigned int)m_iRenderEndParam && !m_bRequestRenderStop) {		// // //
+					m_bRequestRenderStop = m_bHaltRequest = true;
+					if (m_pRegisterCapture)
+						m_pRegisterCapture->OnSongEnd();
+				}
 			}
 			else if (m_iRenderEndWhen == SONG_LOOP_LIMIT) {
 				//if (m_iFramesPlayed >= m_iRenderEndParam)
-				if (m_iRowsPlayed >= m_iRenderEndParam && m_iTempoAccum <= 0)		// // //
+				if (m_iRowsPlayed >= m_iRenderEndParam && m_iTempoAccum <= 0) {		// // //
 					m_bRequestRenderStop = m_bHaltRequest = true;
+					if (m_pRegisterCapture)
+						m_pRegisterCapture->OnSongEnd();
+				}
+			}
+			// // // The loop point is reached when the first row of the repeated part is about to be read
+			if (m_iRenderLoopRow != -1 && m_iTempoAccum <= 0 && m_iRowsPlayed == static_cast<unsigned int>(m_iRenderLoopRow)) {
+				m_iRenderLoopRow = -1;
+				if (m_pRegisterCapture && !m_bRequestRenderStop)
+					m_pRegisterCapture->OnLoopPoint();
 			}
 		}
 
@@ -1771,7 +1781,7 @@ void CSoundGen::EvaluateGlobalEffects(stChanNote *NoteData, int EffColumns)
 
 // File rendering functions
 
-bool CSoundGen::RenderToFile(LPTSTR pFile, render_end_t SongEndType, int SongEndParam, int Track)
+bool CSoundGen::RenderToFile(LPCTSTR pFile, render_end_t SongEndType, int SongEndParam, int Track)
 {
 	// Called from main thread
 	ASSERT(GetCurrentThreadId() == theApp.m_nThreadID);
@@ -1788,6 +1798,7 @@ bool CSoundGen::RenderToFile(LPTSTR pFile, render_end_t SongEndType, int SongEnd
 	m_iRenderTrack = Track;
 	m_iRenderRowCount = 0;
 	m_iRenderRow = 0;
+	m_iRenderLoopRow = -1;		// // //
 
 	if (m_iRenderEndWhen == SONG_TIME_LIMIT) {
 		// This variable is stored in seconds, convert to frames
@@ -1798,19 +1809,110 @@ bool CSoundGen::RenderToFile(LPTSTR pFile, render_end_t SongEndType, int SongEnd
 		m_iRenderRowCount = m_iRenderEndParam;
 	}
 
-	m_pWaveFile = std::make_unique<CWaveFile>();
-	// Unfortunately, destructor doesn't cleanup object. Only CloseFile() does.
-	if (!m_pWaveFile ||
-		!m_pWaveFile->OpenFile(pFile, theApp.GetSettings()->Sound.iSampleRate, theApp.GetSettings()->Sound.iSampleSize, 1)) {
+	// // // The output format follows the file extension, FLAC has no floating point samples
+	const int SampleRate = theApp.GetSettings()->Sound.iSampleRate;
+	const int SampleSize = theApp.GetSettings()->Sound.iRenderSampleSize;
+	bool bOpened;
+	if (CString(pFile).Right(5).CompareNoCase(_T(".flac")) == 0) {
+		auto pFlacFile = std::make_unique<CFlacFile>();
+		bOpened = pFlacFile->OpenFile(pFile, SampleRate, std::min(SampleSize, 24), 1);
+		m_pAudioFile = std::move(pFlacFile);
+	}
+	else {
+		auto pWaveFile = std::make_unique<CWaveFile>();
+		bOpened = pWaveFile->OpenFile(pFile, SampleRate, SampleSize, 1);
+		m_pAudioFile = std::move(pWaveFile);
+	}
+	if (!bOpened) {
+		m_pAudioFile.reset();
 		AfxMessageBox(IDS_FILE_OPEN_ERROR);
 		return false;
 	}
-	else
-		PostThreadMessage(WM_USER_START_RENDER, 0, 0);
+
+	m_strRenderFile = pFile;		// // //
+	m_pLoudnessMeter = std::make_unique<CLoudnessMeter>(theApp.GetSettings()->Sound.iSampleRate);
+	{
+		CSingleLock l(&m_csLoudnessLock, TRUE);		// // //
+		m_pLoudnessResult.reset();
+	}
+	m_bRenderFailed = false;
+	PostThreadMessage(WM_USER_START_RENDER, 0, 0);
 
 	return true;
 }
 
+void CSoundGen::RenderToCapture(IRegisterCapture *pCapture, unsigned int Frames, int Track)		// // //
+{
+	// Called from main thread, renders a fixed number of frames without writing audio to a file
+	ASSERT(GetCurrentThreadId() == theApp.m_nThreadID);
+	ASSERT(m_pDocument != NULL);
+
+	if (IsPlaying()) {
+		m_bHaltRequest = true;
+		WaitForStop();
+	}
+
+	m_iRenderEndWhen = SONG_TIME_LIMIT;
+	m_iRenderEndParam = Frames;
+	m_iRenderTrack = Track;
+	m_iRenderRowCount = 0;
+	m_iRenderRow = 0;
+	m_iRenderLoopRow = -1;
+
+	m_pAudioFile.reset();
+	m_pRegisterCapture = pCapture;
+	PostThreadMessage(WM_USER_START_RENDER, 0, 0);
+}
+
+void CSoundGen::RenderSongToCapture(IRegisterCapture *pCapture, int Track)		// // //
+{
+	// Called from main thread, renders the song once up to the point where it starts repeating
+	ASSERT(GetCurrentThreadId() == theApp.m_nThreadID);
+	ASSERT(m_pDocument != NULL);
+
+	if (IsPlaying()) {
+		m_bHaltRequest = true;
+		WaitForStop();
+	}
+
+	const unsigned int Rows = m_pDocument->ScanActualLength(Track, 1);
+	const unsigned int LoopRows = m_pDocument->ScanActualLength(Track, 2) - Rows;
+
+	m_iRenderEndWhen = SONG_LOOP_LIMIT;
+	m_iRenderEndParam = Rows;
+	m_iRenderTrack = Track;
+	m_iRenderRowCount = Rows;
+	m_iRenderRow = 0;
+	m_iRenderLoopRow = LoopRows > 0 ? Rows - LoopRows : -1;
+
+	m_pAudioFile.reset();
+	m_pRegisterCapture = pCapture;
+	PostThreadMessage(WM_USER_START_RENDER, 0, 0);
+}
+
+bool CSoundGen::RenderSongToLog(CRegisterSnapshotLog &Log, int Track)		// // //
+{
+	// Called from main thread, renders the song like RenderSongToCapture and processes messages
+	// until the sound thread has stopped rendering
+	RenderSongToCapture(&Log, Track);
+
+	const DWORD Start = GetTickCount();
+	while (true) {
+		MSG msg;
+		while (::PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+			::TranslateMessage(&msg);
+			::DispatchMessage(&msg);
+		}
+		if (Log.IsSongFinished()) {
+			if (!IsRendering())
+				return true;
+		}
+		else if (!IsRendering() && GetTickCount() - Start > RENDER_START_TIMEOUT)
+			return false;
+		Sleep(1);
+	}
+}
+
 void CSoundGen::StopRendering()
 {
 	// Called from player thread
@@ -1820,14 +1922,36 @@ void CSoundGen::StopRendering()
 	if (!IsRendering())
 		return;
 
+	// // // Detach the capture first, it may be destroyed as soon as rendering has stopped
+	if (m_pRegisterCapture) {
+		m_pAPU->SetRegisterCapture(m_pRegisterLog.get());
+		m_pRegisterCapture = nullptr;
+	}
+
+	if (m_pAudioFile) {		// // //
+		m_pRenderCache->Finish();
+		m_pAPU->SetRegisterCapture(m_pRegisterLog.get());
+		// A failed write or FLAC verification leaves an unusable file behind
+		m_bRenderFailed = !m_pAudioFile->CloseFile();
+		m_pAudioFile.reset();
+		if (m_bRenderFailed)
+			DeleteFile(m_strRenderFile);
+
+		// The result must be available before the render is reported as finished
+		auto pResult = std::make_unique<stLoudnessResult>(m_pLoudnessMeter->GetResult());
+		m_pLoudnessMeter.reset();
+		if (!m_bRenderFailed)
+			WriteLoudnessSidecar(*pResult);
+		CSingleLock l(&m_csLoudnessLock, TRUE);
+		m_pLoudnessResult = std::move(pResult);
+	}
+
 	m_bPlaying = false;
 	m_bRendering = false;
 	m_bStoppingRender = false;		// // //
 	m_bRequestRenderStop = false;		// // //
 	m_iPlayFrame = 0;
 	m_iPlayRow = 0;
-	m_pWaveFile->CloseFile();		// // //
-	m_pWaveFile.reset();
 
 	ResetBuffer();
 	ResetAPU();		// // //
@@ -1848,6 +1972,99 @@ bool CSoundGen::IsRendering() const
 	return m_bRendering;
 }
 
+bool CSoundGen::HasRenderFailed() const		// // //
+{
+	return m_bRenderFailed;
+}
+
+bool CSoundGen::GetRenderLoudness(stLoudnessResult &Result) const		// // //
+{
+	// Published by the player thread when the file has been closed
+	CSingleLock l(&m_csLoudnessLock, TRUE);
+	if (!m_pLoudnessResult)
+		return false;
+	Result = *m_pLoudnessResult;
+	return true;
+}
+
+void CSoundGen::WriteLoudnessSidecar(const stLoudnessResult &Result) const		// // //
+{
+	// Stored next to the wave file, replacing its extension
+	CString Path = m_strRenderFile;
+	const int Dot = Path.ReverseFind(_T('.'));
+	if (Dot > Path.ReverseFind(_T('\\')))
+		Path.Truncate(Dot);
+	Path.Append(_T(".loudness.json"));
+
+	nlohmann::json Sidecar = CLoudnessMeter::ToJSON(Result);
+	Sidecar["file"] = CStringA(m_strRenderFile.Mid(m_strRenderFile.ReverseFind(_T('\\')) + 1)).GetString();
+	Sidecar["track"] = m_iRenderTrack + 1;
+	Sidecar["sample_rate"] = theApp.GetSettings()->Sound.iSampleRate;
+
+	std::ofstream File {Path.GetString(), std::ios_base::out | std::ios_base::trunc};
+	File << Sidecar.dump(1, '\t') << '\n';
+}
+
+bool CSoundGen::OpenRegisterLog(LPCTSTR pFile)		// // //
+{
+	return m_pRegisterLog->Open(CStringA(pFile));
+}
+
+void CSoundGen::CloseRegisterLog()		// // //
+{
+	m_pRegisterLog->Close();
+}
+
+bool CSoundGen::IsRegisterLogOpen() const		// // //
+{
+	return m_pRegisterLog->IsOpen();
+}
+
+stVerifyResult CSoundGen::VerifyExport(LPCTSTR lpszFileName, unsigned int Song, std::shared_ptr<const CRegisterSnapshotLog> pReference)		// // //
+{
+	// Called from main thread, the export is played in the player thread since the chip
+	// emulation must not run in two threads at once
+	ASSERT(GetCurrentThreadId() == theApp.m_nThreadID);
+	ASSERT(!IsRendering());
+
+	// The player thread holds its own reference to the job, so that the job and the reference
+	// log stay valid if it is still running when the wait times out
+	auto pJob = std::make_shared<stVerifyJob>();
+	pJob->File = lpszFileName;
+	pJob->Song = Song;
+	pJob->pReference = std::move(pReference);
+	PostThreadMessage(WM_USER_VERIFY_EXPORT, 0, reinterpret_cast<LPARAM>(new std::shared_ptr<stVerifyJob>(pJob)));
+
+	if (::WaitForSingleObject(pJob->Done.m_hObject, VERIFY_TIMEOUT_MS) != WAIT_OBJECT_0) {
+		stVerifyResult Result = { };
+		Result.Status = VERIFY_TIMEOUT;
+		return Result;
+	}
+
+	return pJob->Result;
+}
+
+stDriverProfile CSoundGen::ProfileExport(LPCTSTR lpszFileName, unsigned int Song, std::shared_ptr<const CSongPositionLog> pReference)		// // //
+{
+	// Called from main thread, runs in the player thread for the same reasons as VerifyExport
+	ASSERT(GetCurrentThreadId() == theApp.m_nThreadID);
+	ASSERT(!IsRendering());
+
+	auto pJob = std::make_shared<stProfileJob>();
+	pJob->File = lpszFileName;
+	pJob->Song = Song;
+	pJob->pReference = std::move(pReference);
+	PostThreadMessage(WM_USER_PROFILE_EXPORT, 0, reinterpret_cast<LPARAM>(new std::shared_ptr<stProfileJob>(pJob)));
+
+	if (::WaitForSingleObject(pJob->Done.m_hObject, VERIFY_TIMEOUT_MS) != WAIT_OBJECT_0) {
+		stDriverProfile Result = { };
+		Result.Status = VERIFY_TIMEOUT;
+		return Result;
+	}
+
+	return pJob->Result;
+}
+
 bool CSoundGen::IsBackgroundTask() const
 {
 	return m_bRendering;
@@ -1915,6 +2132,8 @@ BOOL CSoundGen::InitInstance()
 	if (m_pDSound == NULL)
 		return FALSE;
 
+	CTraceLog::SetThreadName("Sound");		// // //
+
 	// Set running flag
 	m_bRunning = true;
 
@@ -1979,6 +2198,8 @@ BOOL CSoundGen::OnIdle(LONG lCount)
 
 	++m_iFrameCounter;
 
+	CTraceScope Trace {"Sound frame"};		// // //
+
 	// Access the document object, skip if access wasn't granted to avoid gaps in audio playback
 	if (m_pDocument->LockDocument(0)) {
 
@@ -1999,10 +2220,21 @@ BOOL CSoundGen::OnIdle(LONG lCount)
 		// Unlock document
 		m_pDocument->UnlockDocument();
 	}
+	else
+		CTraceLog::RecordInstant("LockDocument miss");		// // //
 
 	// Update APU registers
 	UpdateAPU();
 
+	if (m_bRendering && m_pAudioFile) {		// // // write the frame, reused from the previous render if unchanged
+		const int16_t *pSamples = nullptr;
+		const size_t Size = m_pRenderCache->Update(pSamples);
+		if (Size) {
+			m_pAudioFile->WriteSamples(pSamples, static_cast<unsigned int>(Size));
+			m_pLoudnessMeter->Process(pSamples, static_cast<unsigned int>(Size));
+		}
+	}
+
 	if (IsPlaying()) {		// // //
 		int Channel = m_pInstRecorder->GetRecordChannel();
 		if (Channel != -1 && m_pChannels[Channel] != nullptr)		// // //
@@ -2042,6 +2274,8 @@ BOOL CSoundGen::OnIdle(LONG lCount)
 
 void CSoundGen::PlayChannelNotes()
 {
+	CStageScope Timer {PERF_PLAY_CHANNEL_NOTES};		// // //
+
 	// Read notes
 	for (int i = 0; i < CHANNELS; ++i) {		// // //
 		int Index = m_pTrackerChannels[i]->GetID();
@@ -2090,6 +2324,8 @@ void CSoundGen::UpdatePlayer()
 
 void CSoundGen::UpdateChannels()
 {
+	CStageScope Timer {PERF_UPDATE_CHANNELS};		// // //
+
 	// Update channels
 	for (int i = 0; i < CHANNELS; ++i) {
 		if (m_pChannels[i] != NULL) {
@@ -2103,6 +2339,8 @@ void CSoundGen::UpdateChannels()
 
 void CSoundGen::UpdateAPU()
 {
+	CStageScope Timer {PERF_UPDATE_APU};		// // //
+
 	// Write to APU registers
 	// Copy wave changed flag
 	m_bInternalWaveChanged = m_bWaveChanged;
@@ -2126,11 +2364,6 @@ void CSoundGen::UpdateAPU()
 					m_pAPU->Process();
 				}
 			}
-		#ifdef WRITE_VGM		// // //
-			if (m_bPlaying)
-				m_iRegisterStream.push(0x62);		// // //
-		#endif
-
 			// Finish the audio frame
 			if (m_iConsumedCycles > m_iUpdateCycles) {
 				throw std::runtime_error("overflowed vblank!");
@@ -2142,11 +2375,6 @@ void CSoundGen::UpdateAPU()
 	}
 
 	m_iConsumedCycles = 0;
-
-#ifdef LOGGING
-	if (m_bPlaying)
-		m_pAPU->Log();
-#endif
 }
 
 // End of overloaded functions
@@ -2193,6 +2421,12 @@ void CSoundGen::OnStartRender(WPARAM wParam, LPARAM lParam)
 	m_bRequestRenderStop = false;
 	m_bStoppingRender = false;		// // //
 	m_bRendering = true;
+	if (m_pAudioFile) {		// // //
+		m_pAPU->SetRegisterCapture(m_pRenderCache.get());
+		m_pRenderCache->Begin(m_pAPU);
+	}
+	else
+		m_pAPU->SetRegisterCapture(m_pRegisterCapture);		// // //
 	m_iDelayedStart = 5;	// Wait 5 frames until player starts
 	m_iDelayedEnd = 5;
 }
@@ -2248,9 +2482,35 @@ void CSoundGen::OnRemoveDocument(WPARAM wParam, LPARAM lParam)
 	//if (*m_pDumpInstrument)		// // //
 	//	(*m_pDumpInstrument)->Release();
 	m_pInstRecorder->ResetRecordCache();
+	m_pRenderCache->Clear();		// // //
 	TRACE("SoundGen: Document removed\n");
 }
 
+void CSoundGen::OnVerifyExport(WPARAM wParam, LPARAM lParam)		// // //
+{
+	const std::unique_ptr<std::shared_ptr<stVerifyJob>> pHandle {reinterpret_cast<std::shared_ptr<stVerifyJob>*>(lParam)};
+	stVerifyJob *pJob = pHandle->get();
+	const CExportVerifier Verifier {theApp.GetSettings()->Sound.iSampleRate};
+	pJob->Result = Verifier.Verify(pJob->File, pJob->Song, *pJob->pReference);
+
+	// The verifier shares some of the chip emulation state
+	ResetAPU();
+
+	pJob->Done.SetEvent();
+}
+
+void CSoundGen::OnProfileExport(WPARAM wParam, LPARAM lParam)		// // //
+{
+	const std::unique_ptr<std::shared_ptr<stProfileJob>> pHandle {reinterpret_cast<std::shared_ptr<stProfileJob>*>(lParam)};
+	stProfileJob *pJob = pHandle->get();
+	const CDriverProfiler Profiler {theApp.GetSettings()->Sound.iSampleRate};
+	pJob->Result = Profiler.Profile(pJob->File, pJob->Song, *pJob->pReference);
+
+	ResetAPU();
+
+	pJob->Done.SetEvent();
+}
+
 void CSoundGen::RegisterKeyState(int Channel, int Note)
 {
 	if (m_pTrackerView != NULL)
@@ -2288,6 +2548,11 @@ void CSoundGen::ReadPatternRow()
 	}
 	if (m_bDoHalt) {		// // //
 		m_bHaltRequest = true;
+		if (m_bRendering && !m_bRequestRenderStop) {		// // // the song ends here, stop rendering
+			m_bRequestRenderStop = true;
+			if (m_pRegisterCapture)
+				m_pRegisterCapture->OnSongEnd();
+		}
 	}
 }
 
@@ -2420,44 +2685,6 @@ int CSoundGen::GetQueueFrame() const
 	return m_iQueuedFrame;
 }
 
-// Verification
-
-void CSoundGen::WriteRegister(uint16_t Reg, uint8_t Value)
-{
-#ifdef WRITE_VGM		// // //
-	static int S5B_Port = 0; // TODO: elevate to full object status
-	if (Reg >= 0x4000U && Reg <= 0x401FU) {
-		m_iRegisterStream.push(0xB4);
-		m_iRegisterStream.push(Reg & 0x1F);
-		m_iRegisterStream.push(Value);
-	}
-
-	else if (Reg >= 0x4040U && Reg <= 0x407FU) {
-		m_iRegisterStream.push(0xB4);
-		m_iRegisterStream.push(Reg & 0x7F);
-		m_iRegisterStream.push(Value);
-	}
-	else if (Reg >= 0x4080U && Reg <= 0x409EU) {
-		m_iRegisterStream.push(0xB4);
-		m_iRegisterStream.push((Reg & 0x1F) | 0x20);
-		m_iRegisterStream.push(Value);
-	}
-	else if (Reg == 0x4023U) {
-		m_iRegisterStream.push(0xB4);
-		m_iRegisterStream.push(0x3F);
-		m_iRegisterStream.push(Value);
-	}
-
-	else if (Reg == 0xC000)
-		S5B_Port = Value;
-	else if (Reg == 0xE000) {
-		m_iRegisterStream.push(0xA0);
-		m_iRegisterStream.push(S5B_Port);
-		m_iRegisterStream.push(Value);
-	}
-#endif
-}
-
 CFTMComponentInterface *CSoundGen::GetDocumentInterface() const
 {
 	return static_cast<CFTMComponentInterface*>(m_pDocument);
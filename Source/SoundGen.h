@@ -27,7 +27,6 @@
 //
 
 #include <afxmt.h>		// Synchronization objects
-#include <queue>		// // //
 #include "Common.h"
 
 #include <memory>
@@ -49,6 +48,7 @@ enum {
 	WM_USER_CLOSE_SOUND,
 	WM_USER_SET_CHIP,
 	WM_USER_VERIFY_EXPORT,
+	WM_USER_PROFILE_EXPORT,
 	WM_USER_REMOVE_DOCUMENT
 };
 
@@ -80,13 +80,21 @@ class CSequence;		// // //
 class CAPU;
 class CDSound;
 class CDSoundChannel;
-class CWaveFile;		// // //
+class IAudioFile;		// // //
+class CLoudnessMeter;		// // //
+struct stLoudnessResult;		// // //
 class CVisualizerWnd;
 class CDSample;
 class CTrackerChannel;
 class CFTMComponentInterface;		// // //
 class CInstrumentRecorder;		// // //
 class CRegisterState;		// // //
+class CRegisterLogWriter;		// // //
+class CRegisterSnapshotLog;		// // //
+class CRenderCache;		// // //
+struct stVerifyResult;		// // //
+class CSongPositionLog;		// // //
+struct stDriverProfile;		// // //
 
 // CSoundGen
 
@@ -169,12 +177,26 @@ public:
 	int			 GetChannelVolume(int Channel) const;		// // //
 
 	// Rendering
-	bool		 RenderToFile(LPTSTR pFile, render_end_t SongEndType, int SongEndParam, int Track);
+	bool		 RenderToFile(LPCTSTR pFile, render_end_t SongEndType, int SongEndParam, int Track);
+	void		 RenderToCapture(IRegisterCapture *pCapture, unsigned int Frames, int Track);		// // //
+	void		 RenderSongToCapture(IRegisterCapture *pCapture, int Track);		// // //
+	bool		 RenderSongToLog(CRegisterSnapshotLog &Log, int Track);		// // // Waits for the render to finish
 	void		 StopRendering();
 	void		 GetRenderStat(int &Frame, int &Time, bool &Done, int &FramesToRender, int &Row, int &RowCount) const;
 	bool		 IsRendering() const;	
+	bool		 HasRenderFailed() const;		// // //
+	bool		 GetRenderLoudness(stLoudnessResult &Result) const;		// // //
 	bool		 IsBackgroundTask() const;
 
+	// // // Register logging
+	bool		 OpenRegisterLog(LPCTSTR pFile);
+	void		 CloseRegisterLog();
+	bool		 IsRegisterLogOpen() const;
+
+	// // // Export verification
+	stVerifyResult VerifyExport(LPCTSTR lpszFileName, unsigned int Song, std::shared_ptr<const CRegisterSnapshotLog> pReference);
+	stDriverProfile ProfileExport(LPCTSTR lpszFileName, unsigned int Song, std::shared_ptr<const CSongPositionLog> pReference);		// // //
+
 	// Sample previewing
 	void		 PreviewSample(const CDSample *pSample, int Offset, int Pitch);		// // //
 	void		 CancelPreviewSample();
@@ -198,8 +220,6 @@ public:
 	bool		HasWaveChanged() const;
 	void		ResetWaveChanged();
 
-	void		WriteRegister(uint16_t Reg, uint8_t Value);
-
 	void		RegisterKeyState(int Channel, int Note);
 	void		SetNamcoMixing(bool bLinear);			// // //
 
@@ -250,6 +270,7 @@ private:
 	void		CloseAudio();
 	template<class T, int SHIFT> void FillBuffer(int16_t *pBuffer, uint32_t Size);
 	bool		PlayBuffer();
+	void		WriteLoudnessSidecar(const stLoudnessResult &Result) const;		// // //
 
 	// Player
 	void		UpdateChannels();
@@ -282,6 +303,7 @@ public:
 	static const double OLD_VIBRATO_DEPTH[];
 
 	static const int AUDIO_TIMEOUT = 2000;		// 2s buffer timeout
+	static const unsigned int GRAPH_RATE_MAX = 48000;		// // // Highest sample rate sent to the visualizer
 
 	//
 	// Private variables
@@ -308,6 +330,7 @@ private:
 private:
 	mutable CCriticalSection m_csAPULock;		// // //
 	mutable CCriticalSection m_csVisualizerWndLock;
+	mutable CCriticalSection m_csLoudnessLock;		// // //
 
 	// Handles
 	HANDLE				m_hInterruptEvent;					// Used to interrupt sound buffer syncing
@@ -320,6 +343,10 @@ private:
 	unsigned int		m_iBufferPtr;						// This will point in samples
 	char				*m_pAccumBuffer;
 	short				*m_iGraphBuffer;
+	unsigned int		m_iGraphBufferPtr;					// // // Fill pos in visualizer buffer
+	unsigned int		m_iGraphDecimation;					// // // Output samples per visualizer sample
+	int					m_iGraphAccum;						// // //
+	unsigned int		m_iGraphAccumCount;					// // //
 	int					m_iAudioUnderruns;					// Keep track of underruns to inform user
 	bool				m_bBufferTimeout;
 	bool				m_bBufferUnderrun;
@@ -378,6 +405,7 @@ private:
 	int					m_iRenderTrack;
 	unsigned int		m_iRenderRowCount;
 	int					m_iRenderRow;
+	int					m_iRenderLoopRow;					// // // row count at the loop point of a captured song, -1 if none
 
 	int					m_iTempoDecrement;
 	int					m_iTempoRemainder;
@@ -388,9 +416,14 @@ private:
 	int					m_iBPMCacheTicks[AVERAGE_BPM_SIZE];
 	int					m_iBPMCachePosition;
 
-	std::queue<int>		m_iRegisterStream;					// // // vgm export
-
-	std::unique_ptr<CWaveFile> m_pWaveFile;
+	std::unique_ptr<IAudioFile> m_pAudioFile;			// // // wave or FLAC file being rendered
+	CString				m_strRenderFile;					// // //
+	bool				m_bRenderFailed;					// // // the last rendered file could not be written
+	std::unique_ptr<CLoudnessMeter> m_pLoudnessMeter;	// // // analyzes the rendered audio
+	std::unique_ptr<stLoudnessResult> m_pLoudnessResult;	// // // analysis of the last render, guarded by m_csLoudnessLock
+	IRegisterCapture	*m_pRegisterCapture;				// // // register stream capture while rendering
+	std::unique_ptr<CRegisterLogWriter> m_pRegisterLog;	// // // binary register log, attached to the APU outside of captures
+	std::unique_ptr<CRenderCache> m_pRenderCache;		// // // audio of the last file render, reused by the next one
 
 	// FDS & N163 waves
 	volatile bool		m_bWaveChanged;
@@ -432,4 +465,6 @@ public:
 	afx_msg void OnCloseSound(WPARAM wParam, LPARAM lParam);
 	afx_msg void OnSetChip(WPARAM wParam, LPARAM lParam);
 	afx_msg void OnRemoveDocument(WPARAM wParam, LPARAM lParam);
+	afx_msg void OnVerifyExport(WPARAM wParam, LPARAM lParam);		// // //
+	afx_msg void OnProfileExport(WPARAM wParam, LPARAM lParam);		// // //
 };
@@ -23,9 +23,7 @@
 #include "stdafx.h"
 #include "res/resource.h"
 #include "SpeedDlg.h"
-
-const int RATE_MIN = 16;		// // //
-const int RATE_MAX = 400;
+#include "FamiTrackerTypes.h"		// // //
 
 // CSpeedDlg dialog
 
@@ -23,8 +23,6 @@
 #pragma once
 #include "res/resource.h"
 
-extern const int RATE_MIN;
-
 // CSpeedDlg dialog
 
 class CSpeedDlg : public CDialog
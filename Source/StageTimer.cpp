@@ -0,0 +1,197 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#include "StageTimer.h"
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// Each octave of nanoseconds is divided into this many histogram buckets
+const int SUB_BUCKET_BITS = 2;
+const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+const int OCTAVES = 40;
+const int BUCKET_COUNT = OCTAVES * SUB_BUCKETS;
+
+struct stStageAccum {
+	uint32_t Count = 0;
+	uint64_t Total = 0;
+	uint64_t Min = std::numeric_limits<uint64_t>::max();
+	uint64_t Max = 0;
+	uint32_t Bucket[BUCKET_COUNT] = { };
+};
+
+// Every recording thread owns one of these; its lock is only contended while it is being collected
+struct stThreadAccum {
+	std::mutex Lock;
+	stStageAccum Stage[PERF_STAGE_COUNT];
+};
+
+std::atomic<bool> Enabled {true};
+std::mutex RegistryLock;
+std::vector<std::shared_ptr<stThreadAccum>> Registry;		// also keeps the data of exited threads until collected
+
+stThreadAccum &GetThreadAccum() {
+	thread_local const std::shared_ptr<stThreadAccum> pAccum = [] {
+		auto p = std::make_shared<stThreadAccum>();
+		std::lock_guard<std::mutex> Lock {RegistryLock};
+		Registry.push_back(p);
+		return p;
+	}();
+	return *pAccum;
+}
+
+const char *const STAGE_NAMES[] = {
+	"RunFrame",
+	"PlayChannelNotes",
+	"UpdateChannels",
+	"UpdateAPU",
+	"CAPU::Process",
+	"CAPU::EndFrame",
+	"CMixer::FinishBuffer",
+	"FillBuffer",
+	"PlayBuffer",
+};
+
+static_assert(sizeof(STAGE_NAMES) / sizeof(*STAGE_NAMES) == PERF_STAGE_COUNT, "Missing stage name");
+
+int GetBucketIndex(uint64_t Value)
+{
+	if (Value < SUB_BUCKETS)
+		return static_cast<int>(Value);
+	int Msb = 0;
+	for (uint64_t x = Value; x >>= 1; )
+		++Msb;
+	int Index = (Msb - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + static_cast<int>((Value >> (Msb - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+	return Index < BUCKET_COUNT ? Index : BUCKET_COUNT - 1;
+}
+
+uint64_t GetBucketLimit(int Index)		// exclusive upper bound
+{
+	++Index;
+	if (Index < SUB_BUCKETS)
+		return static_cast<uint64_t>(Index);
+	int Msb = Index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+	return static_cast<uint64_t>(SUB_BUCKETS + Index % SUB_BUCKETS) << (Msb - SUB_BUCKET_BITS);
+}
+
+} // namespace
+
+void CStageTimer::SetEnabled(bool Enable)
+{
+	Enabled.store(Enable, std::memory_order_relaxed);
+}
+
+bool CStageTimer::IsEnabled()
+{
+	return Enabled.load(std::memory_order_relaxed);
+}
+
+void CStageTimer::Record(perf_stage_t Stage, uint64_t Nanoseconds)
+{
+	stThreadAccum &t = GetThreadAccum();
+	std::lock_guard<std::mutex> Lock {t.Lock};
+	stStageAccum &a = t.Stage[Stage];
+	++a.Count;
+	a.Total += Nanoseconds;
+	++a.Bucket[GetBucketIndex(Nanoseconds)];
+	if (Nanoseconds < a.Min)
+		a.Min = Nanoseconds;
+	if (Nanoseconds > a.Max)
+		a.Max = Nanoseconds;
+}
+
+stStageStats CStageTimer::Collect(perf_stage_t Stage)
+{
+	stStageAccum Merged;
+	{
+		std::lock_guard<std::mutex> Lock {RegistryLock};
+		for (auto it = Registry.begin(); it != Registry.end(); ) {
+			stThreadAccum &t = **it;
+			bool Empty = true;
+			{
+				std::lock_guard<std::mutex> ThreadLock {t.Lock};
+				stStageAccum &a = t.Stage[Stage];
+				Merged.Count += a.Count;
+				Merged.Total += a.Total;
+				if (a.Min < Merged.Min)
+					Merged.Min = a.Min;
+				if (a.Max > Merged.Max)
+					Merged.Max = a.Max;
+				for (int i = 0; i < BUCKET_COUNT; ++i)
+					Merged.Bucket[i] += a.Bucket[i];
+				a = stStageAccum { };
+				for (const auto &x : t.Stage)
+					if (x.Count)
+						Empty = false;
+			}
+			// Drop threads which have exited once all of their data is collected
+			if (Empty && it->use_count() == 1)
+				it = Registry.erase(it);
+			else
+				++it;
+		}
+	}
+
+	const uint32_t Count = Merged.Count;
+	const uint64_t Total = Merged.Total;
+	const uint64_t Min = Merged.Min;
+	const uint64_t Max = Merged.Max;
+	const uint32_t *Hist = Merged.Bucket;
+
+	stStageStats Stats = { };
+	if (!Count)
+		return Stats;
+
+	uint64_t P99 = Max;
+	const uint64_t Target = (static_cast<uint64_t>(Count) * 99 + 99) / 100;
+	uint64_t Sum = 0;
+	for (int i = 0; i < BUCKET_COUNT; ++i)
+		if ((Sum += Hist[i]) >= Target) {
+			P99 = GetBucketLimit(i);
+			break;
+		}
+	if (P99 > Max)
+		P99 = Max;
+
+	Stats.Count = Count;
+	Stats.Min = Min / 1000.;
+	Stats.Mean = static_cast<double>(Total) / Count / 1000.;
+	Stats.P99 = P99 / 1000.;
+	Stats.Max = Max / 1000.;
+	return Stats;
+}
+
+void CStageTimer::Clear()
+{
+	for (int i = 0; i < PERF_STAGE_COUNT; ++i)
+		Collect(static_cast<perf_stage_t>(i));
+}
+
+const char *CStageTimer::GetStageName(perf_stage_t Stage)
+{
+	return Stage < PERF_STAGE_COUNT ? STAGE_NAMES[Stage] : "";
+}
@@ -0,0 +1,126 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#pragma once
+
+#include <cstdint>
+#include "TraceLog.h"		// // //
+
+/*!
+	\brief Sound engine stages measured by the stage timers. Timings are inclusive, so a stage
+	called from inside another stage (e.g. CAPU::EndFrame from CAPU::Process) is counted in both.
+*/
+enum perf_stage_t {
+	PERF_RUN_FRAME,
+	PERF_PLAY_CHANNEL_NOTES,
+	PERF_UPDATE_CHANNELS,
+	PERF_UPDATE_APU,
+	PERF_APU_PROCESS,
+	PERF_APU_END_FRAME,
+	PERF_MIXER_FINISH_BUFFER,
+	PERF_FILL_BUFFER,
+	PERF_PLAY_BUFFER,
+	PERF_STAGE_COUNT
+};
+
+/*!
+	\brief Timing summary of a single stage since the last collection. All times are in
+	microseconds; the 99th percentile is the upper bound of its histogram bucket.
+*/
+struct stStageStats {
+	unsigned int Count;
+	double Min;
+	double Mean;
+	double P99;
+	double Max;
+};
+
+/*!
+	\brief Accumulator of per-stage execution time histograms.
+	\details Every thread records samples into its own accumulator, whose lock is only contended
+	while another thread collects the results; collection merges the accumulators of all threads
+	and resets them. None of these methods depend on the user interface, so render benchmarks can
+	read the same statistics.
+*/
+class CStageTimer
+{
+public:
+	/*!	\brief Enables or disables all stage timers. Timers are enabled by default. */
+	static void SetEnabled(bool Enable);
+	/*!	\brief Returns whether the stage timers are enabled. */
+	static bool IsEnabled();
+
+	/*!	\brief Adds a single execution time sample.
+		\param Stage The measured stage.
+		\param Nanoseconds The execution time in nanoseconds.
+	*/
+	static void Record(perf_stage_t Stage, uint64_t Nanoseconds);
+
+	/*!	\brief Obtains the statistics of a stage and resets its accumulator.
+		\param Stage The stage to collect.
+		\return The timing summary since the last collection.
+	*/
+	static stStageStats Collect(perf_stage_t Stage);
+
+	/*!	\brief Resets the accumulators of all stages. */
+	static void Clear();
+
+	/*!	\brief Returns a human-readable name of a stage. */
+	static const char *GetStageName(perf_stage_t Stage);
+};
+
+/*!
+	\brief Measures the lifetime of the object as one sample of a given stage. The sample is
+	also recorded as a trace event if tracing is enabled.
+*/
+class CStageScope
+{
+public:
+	explicit CStageScope(perf_stage_t Stage) :
+		m_iStage(Stage), m_bActive(CStageTimer::IsEnabled()), m_bTrace(CTraceLog::IsEnabled())
+	{
+		if (m_bActive || m_bTrace)
+			m_iStart = CTraceLog::GetTimestamp();
+	}
+
+	~CStageScope()
+	{
+		if (m_bActive || m_bTrace) {
+			const uint64_t End = CTraceLog::GetTimestamp();
+			if (m_bActive)
+				CStageTimer::Record(m_iStage, End - m_iStart);
+			if (m_bTrace)
+				CTraceLog::RecordComplete(CStageTimer::GetStageName(m_iStage), m_iStart, End);
+		}
+	}
+
+	CStageScope(const CStageScope &) = delete;
+	CStageScope &operator=(const CStageScope &) = delete;
+
+private:
+	perf_stage_t m_iStage;
+	bool m_bActive;
+	bool m_bTrace;
+	uint64_t m_iStart = 0;
+};
@@ -0,0 +1,206 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#include "TraceLog.h"
+#include <atomic>
+#include <chrono>
+#include <ostream>
+
+namespace {
+
+const uint64_t INDEX_MASK = CTraceLog::CAPACITY - 1;
+const unsigned int MAX_THREADS = 32;
+
+static_assert((CTraceLog::CAPACITY & INDEX_MASK) == 0, "Trace capacity must be a power of two");
+
+// Every field is atomic so that the dumping thread may read a slot while it is being
+// overwritten; the sequence number tells whether the read is consistent
+struct stTraceSlot {
+	std::atomic<uint64_t> Sequence {0};		// 0 = empty, odd = being written, even = 2 * (index + 1)
+	std::atomic<const char *> Name {nullptr};
+	std::atomic<uint64_t> Start {0};
+	std::atomic<uint64_t> Duration {0};
+	std::atomic<uint32_t> Thread {0};
+	std::atomic<char> Phase {0};
+};
+
+struct stTraceEvent {
+	const char *Name;
+	uint64_t Start;
+	uint64_t Duration;
+	uint32_t Thread;
+	char Phase;
+};
+
+std::atomic<bool> Enabled {false};
+std::atomic<bool> DumpRequested {false};
+std::atomic<uint64_t> Head {0};
+std::atomic<uint32_t> ThreadCount {0};
+std::atomic<const char *> ThreadNames[MAX_THREADS] = { };
+stTraceSlot Slots[CTraceLog::CAPACITY];
+
+const std::chrono::steady_clock::time_point Epoch = std::chrono::steady_clock::now();
+
+uint32_t GetThreadIndex() {
+	thread_local const uint32_t Index = ThreadCount.fetch_add(1, std::memory_order_relaxed) + 1;
+	return Index;
+}
+
+void Record(const char *Name, uint64_t Start, uint64_t Duration, char Phase) {
+	const uint64_t Index = Head.fetch_add(1, std::memory_order_relaxed);
+	stTraceSlot &Slot = Slots[Index & INDEX_MASK];
+	Slot.Sequence.store(Index * 2 + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	Slot.Name.store(Name, std::memory_order_relaxed);
+	Slot.Start.store(Start, std::memory_order_relaxed);
+	Slot.Duration.store(Duration, std::memory_order_relaxed);
+	Slot.Thread.store(GetThreadIndex(), std::memory_order_relaxed);
+	Slot.Phase.store(Phase, std::memory_order_relaxed);
+	Slot.Sequence.store(Index * 2 + 2, std::memory_order_release);
+}
+
+bool ReadSlot(uint64_t Index, stTraceEvent &Event) {
+	const stTraceSlot &Slot = Slots[Index & INDEX_MASK];
+	const uint64_t Seq = Index * 2 + 2;
+	if (Slot.Sequence.load(std::memory_order_acquire) != Seq)
+		return false;
+	Event.Name = Slot.Name.load(std::memory_order_relaxed);
+	Event.Start = Slot.Start.load(std::memory_order_relaxed);
+	Event.Duration = Slot.Duration.load(std::memory_order_relaxed);
+	Event.Thread = Slot.Thread.load(std::memory_order_relaxed);
+	Event.Phase = Slot.Phase.load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return Slot.Sequence.load(std::memory_order_relaxed) == Seq && Event.Name != nullptr;
+}
+
+void WriteString(std::ostream &os, const char *Str) {
+	os << '"';
+	for (; *Str; ++Str) {
+		const unsigned char ch = static_cast<unsigned char>(*Str);
+		if (ch == '"' || ch == '\\')
+			os << '\\' << *Str;
+		else if (ch >= 0x20)
+			os << *Str;
+	}
+	os << '"';
+}
+
+void WriteMicroseconds(std::ostream &os, uint64_t Nanoseconds) {
+	const uint64_t Frac = Nanoseconds % 1000;
+	os << Nanoseconds / 1000 << '.' << static_cast<char>('0' + Frac / 100)
+		<< static_cast<char>('0' + Frac / 10 % 10) << static_cast<char>('0' + Frac % 10);
+}
+
+} // namespace
+
+void CTraceLog::SetEnabled(bool Enable)
+{
+	Enabled.store(Enable, std::memory_order_relaxed);
+}
+
+bool CTraceLog::IsEnabled()
+{
+	return Enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t CTraceLog::GetTimestamp()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - Epoch).count());
+}
+
+void CTraceLog::SetThreadName(const char *Name)
+{
+	const uint32_t Index = GetThreadIndex();
+	if (Index < MAX_THREADS)
+		ThreadNames[Index].store(Name, std::memory_order_relaxed);
+}
+
+void CTraceLog::RecordComplete(const char *Name, uint64_t Start, uint64_t End)
+{
+	if (IsEnabled())
+		Record(Name, Start, End > Start ? End - Start : 0, 'X');
+}
+
+void CTraceLog::RecordInstant(const char *Name)
+{
+	if (IsEnabled())
+		Record(Name, GetTimestamp(), 0, 'i');
+}
+
+void CTraceLog::RequestDump()
+{
+	if (IsEnabled())
+		DumpRequested.store(true, std::memory_order_relaxed);
+}
+
+bool CTraceLog::PollDumpRequest()
+{
+	return DumpRequested.exchange(false, std::memory_order_relaxed);
+}
+
+void CTraceLog::Clear()
+{
+	// events recorded concurrently may survive, since their sequence numbers are still valid
+	for (auto &Slot : Slots)
+		Slot.Sequence.store(0, std::memory_order_relaxed);
+}
+
+bool CTraceLog::WriteJSON(std::ostream &os)
+{
+	const uint64_t End = Head.load(std::memory_order_acquire);
+	const uint64_t Begin = End > CAPACITY ? End - CAPACITY : 0;
+
+	os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	bool First = true;
+
+	const uint32_t Threads = ThreadCount.load(std::memory_order_relaxed);
+	for (uint32_t i = 1; i <= Threads && i < MAX_THREADS; ++i)
+		if (const char *Name = ThreadNames[i].load(std::memory_order_relaxed)) {
+			os << (First ? "\n" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << i << ",\"args\":{\"name\":";
+			WriteString(os, Name);
+			os << "}}";
+			First = false;
+		}
+
+	stTraceEvent Event;
+	for (uint64_t i = Begin; i < End; ++i) {
+		if (!ReadSlot(i, Event))
+			continue;
+		os << (First ? "\n" : ",\n") << "{\"ph\":\"" << Event.Phase << "\",\"name\":";
+		WriteString(os, Event.Name);
+		os << ",\"pid\":1,\"tid\":" << Event.Thread << ",\"ts\":";
+		WriteMicroseconds(os, Event.Start);
+		if (Event.Phase == 'X') {
+			os << ",\"dur\":";
+			WriteMicroseconds(os, Event.Duration);
+		}
+		else
+			os << ",\"s\":\"t\"";
+		os << '}';
+		First = false;
+	}
+
+	os << "\n]}\n";
+	return static_cast<bool>(os);
+}
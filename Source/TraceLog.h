@@ -0,0 +1,103 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+
+/*!
+	\brief Opt-in event tracer for the sound, visualizer and user interface threads.
+	\details Events are stored in a fixed-size ring buffer which keeps only the most recent
+	events; recording an event never allocates or blocks. Event and thread names must point to
+	strings with static storage duration, such as string literals. The buffer can be written in
+	the Chrome trace event format, which can be opened by chrome://tracing or Perfetto.
+*/
+class CTraceLog
+{
+public:
+	/*!	\brief The number of events kept in the ring buffer. */
+	static const unsigned int CAPACITY = 1u << 16;
+
+	/*!	\brief Enables or disables event recording. Tracing is disabled by default. */
+	static void SetEnabled(bool Enable);
+	/*!	\brief Returns whether event recording is enabled. */
+	static bool IsEnabled();
+
+	/*!	\brief Returns the current trace time in nanoseconds. */
+	static uint64_t GetTimestamp();
+
+	/*!	\brief Names the calling thread in the trace output. */
+	static void SetThreadName(const char *Name);
+
+	/*!	\brief Records an event that spans a duration on the calling thread.
+		\param Name The event name.
+		\param Start The trace time at the start of the event.
+		\param End The trace time at the end of the event.
+	*/
+	static void RecordComplete(const char *Name, uint64_t Start, uint64_t End);
+	/*!	\brief Records an event that occurs at the current time on the calling thread.
+		\param Name The event name.
+	*/
+	static void RecordInstant(const char *Name);
+
+	/*!	\brief Asks the user interface to save the trace as soon as possible. */
+	static void RequestDump();
+	/*!	\brief Returns whether a dump has been requested since the last call, and clears the request. */
+	static bool PollDumpRequest();
+
+	/*!	\brief Removes all recorded events. */
+	static void Clear();
+	/*!	\brief Writes all recorded events in the Chrome trace event format.
+		\param os The output stream.
+		\return Whether the stream is still valid after writing.
+	*/
+	static bool WriteJSON(std::ostream &os);
+};
+
+/*!
+	\brief Records the lifetime of the object as one complete trace event.
+*/
+class CTraceScope
+{
+public:
+	explicit CTraceScope(const char *Name) :
+		m_pName(Name), m_bActive(CTraceLog::IsEnabled()), m_iStart(m_bActive ? CTraceLog::GetTimestamp() : 0)
+	{
+	}
+
+	~CTraceScope()
+	{
+		if (m_bActive)
+			CTraceLog::RecordComplete(m_pName, m_iStart, CTraceLog::GetTimestamp());
+	}
+
+	CTraceScope(const CTraceScope &) = delete;
+	CTraceScope &operator=(const CTraceScope &) = delete;
+
+private:
+	const char *m_pName;
+	bool m_bActive;
+	uint64_t m_iStart;
+};
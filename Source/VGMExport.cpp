@@ -0,0 +1,152 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#include "stdafx.h"
+#include "VGMExport.h"
+#include <string>
+#include "FamiTracker.h"
+#include "FamiTrackerDoc.h"
+#include "Compiler.h"
+#include "SoundGen.h"
+#include "VGMWriter.h"
+#include "APU/APU.h"
+#include "version.h"
+
+namespace {
+
+const DWORD RENDER_START_TIMEOUT = 5000;		// Milliseconds to wait for the sound thread to begin rendering
+
+std::wstring ToWide(const CString &str) {
+	return std::wstring {CStringW(str)};
+}
+
+} // namespace
+
+CVGMExport::CVGMExport(CFamiTrackerDoc *pDoc, CCompilerLog *pLogger) :
+	m_pDocument(pDoc),
+	m_pLogger(pLogger)
+{
+}
+
+CVGMExport::~CVGMExport()
+{
+	SAFE_RELEASE(m_pLogger);
+}
+
+bool CVGMExport::Export(LPCTSTR lpszFileName, unsigned int Track)
+{
+	const bool bPAL = m_pDocument->GetMachine() == PAL;
+	const uint8_t Chips = m_pDocument->GetExpansionChip();
+
+	CVGMWriter Writer;
+	if (!Writer.Open(CStringA(lpszFileName), Chips, bPAL ? CAPU::BASE_FREQ_PAL : CAPU::BASE_FREQ_NTSC,
+		bPAL ? CAPU::FRAME_RATE_PAL : CAPU::FRAME_RATE_NTSC)) {
+		Print(_T("Error: Could not open output file\r\n"));
+		return false;
+	}
+
+	Writer.SetTag(VGM_TAG_TRACK, ToWide(m_pDocument->GetTrackTitle(Track)));
+	Writer.SetTag(VGM_TAG_GAME, ToWide(m_pDocument->GetSongName()));
+	Writer.SetTag(VGM_TAG_SYSTEM, L"NES/Famicom");
+	Writer.SetTag(VGM_TAG_AUTHOR, ToWide(m_pDocument->GetSongArtist()));
+	Writer.SetTag(VGM_TAG_CONVERTER, ToWide(CString(APP_NAME_VERSION)));
+	Writer.SetTag(VGM_TAG_NOTES, ToWide(m_pDocument->GetSongCopyright()));
+
+	const DWORD StartTime = GetTickCount();
+	if (!Render(Track, Writer)) {
+		Writer.Close();
+		Print(_T("Error: The sound generator did not start rendering\r\n"));
+		return false;
+	}
+	if (!Writer.Close()) {
+		Print(_T("Error: Could not write output file\r\n"));
+		return false;
+	}
+
+	CString str;
+	str.Format(_T("Track %u: %.1f s, loop %.1f s, %u bytes, rendered in %.1f s\r\n"), Track + 1,
+		static_cast<double>(Writer.GetTotalSamples()) / CVGMWriter::SAMPLE_RATE,
+		static_cast<double>(Writer.GetLoopSamples()) / CVGMWriter::SAMPLE_RATE,
+		Writer.GetFileSize(), (GetTickCount() - StartTime) / 1000.);
+	Print(str);
+	if (Writer.GetSkippedWrites()) {
+		str.Format(_T("Warning: %u writes to VRC6, N163 or MMC5 PCM registers have no VGM equivalent and were skipped\r\n"),
+			Writer.GetSkippedWrites());
+		Print(str);
+	}
+	return true;
+}
+
+bool CVGMExport::ExportAll(LPCTSTR lpszFileName)
+{
+	const unsigned int Tracks = m_pDocument->GetTrackCount();
+	if (Tracks == 1)
+		return Export(lpszFileName, 0);
+
+	CString Base = lpszFileName;
+	CString Ext = _T(".vgm");
+	const int Pos = Base.ReverseFind(_T('.'));
+	if (Pos > Base.ReverseFind(_T('\\'))) {
+		Ext = Base.Mid(Pos);
+		Base = Base.Left(Pos);
+	}
+
+	bool bSuccess = true;
+	for (unsigned int i = 0; i < Tracks; ++i) {
+		CString Name;
+		Name.Format(_T("%s - %02u%s"), (LPCTSTR)Base, i + 1, (LPCTSTR)Ext);
+		bSuccess &= Export(Name, i);
+	}
+	return bSuccess;
+}
+
+bool CVGMExport::Render(unsigned int Track, CVGMWriter &Writer) const
+{
+	CSoundGen *pSoundGen = theApp.GetSoundGenerator();
+	pSoundGen->RenderSongToCapture(&Writer, Track);
+
+	// The sound thread starts rendering after it has received the message, short songs may be
+	// finished before the first check
+	const DWORD Start = GetTickCount();
+	while (true) {
+		MSG msg;
+		while (::PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
+			::TranslateMessage(&msg);
+			::DispatchMessage(&msg);
+		}
+		if (Writer.IsSongFinished()) {
+			if (!pSoundGen->IsRendering())
+				return true;
+		}
+		else if (!pSoundGen->IsRendering() && GetTickCount() - Start > RENDER_START_TIMEOUT)
+			return false;
+		Sleep(1);
+	}
+}
+
+void CVGMExport::Print(const CString &text) const
+{
+	if (m_pLogger != NULL)
+		m_pLogger->WriteLog(text);
+}
@@ -0,0 +1,67 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#pragma once
+
+class CFamiTrackerDoc;
+class CCompilerLog;
+class CVGMWriter;
+
+/*!
+	\brief Exports the tracks of the active document as VGM files.
+	\details Each track is rendered once through the sound engine up to the point where it starts
+	repeating, with a CVGMWriter attached to the APU. The loop point of the file is placed where the
+	repeated part begins. Tracks ending with a Cxx effect do not loop.
+*/
+class CVGMExport
+{
+public:
+	/*!	\brief Constructor of the VGM exporter.
+		\param pDoc The document, which must be the one used by the sound generator.
+		\param pLogger The export log, owned by the exporter. May be NULL.
+	*/
+	CVGMExport(CFamiTrackerDoc *pDoc, CCompilerLog *pLogger);
+	~CVGMExport();
+
+	/*!	\brief Exports a single track.
+		\param lpszFileName The output file name.
+		\param Track The track index.
+		\return Whether the file was written.
+	*/
+	bool Export(LPCTSTR lpszFileName, unsigned int Track);
+	/*!	\brief Exports all tracks. If the module contains several tracks, the track number is
+		appended to the name of each file.
+		\param lpszFileName The output file name.
+		\return Whether all files were written.
+	*/
+	bool ExportAll(LPCTSTR lpszFileName);
+
+private:
+	bool Render(unsigned int Track, CVGMWriter &Writer) const;
+	void Print(const CString &text) const;
+
+private:
+	CFamiTrackerDoc *m_pDocument;
+	CCompilerLog *m_pLogger;
+};
@@ -0,0 +1,440 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#include "VGMWriter.h"
+#include <algorithm>
+#include <vector>
+#include "APU/Types.h"
+
+namespace {
+
+const uint32_t VGM_VERSION = 0x171;
+const uint32_t VGM_HEADER_SIZE = 0x100;
+const uint32_t GD3_VERSION = 0x100;
+
+const uint32_t YM2413_CLOCK = 3579545;
+const uint32_t VRC7_MODE = 0x80000000;		// YM2413 clock flag
+const uint32_t FDS_ENABLE = 0x80000000;		// NES APU clock flag
+const uint32_t DUAL_CHIP = 0x40000000;
+const uint8_t AY_TYPE_YM2149 = 0x10;
+const uint8_t AY_FLAG_LEGACY = 0x01;
+
+const uint8_t CMD_AY8910 = 0xA0;
+const uint8_t CMD_YM2413 = 0x51;
+const uint8_t CMD_NES_APU = 0xB4;
+const uint8_t CMD_WAIT = 0x61;
+const uint8_t CMD_WAIT_NTSC = 0x62;		// 735 samples
+const uint8_t CMD_WAIT_PAL = 0x63;		// 882 samples
+const uint8_t CMD_END = 0x66;
+const uint8_t CMD_DATA_BLOCK = 0x67;
+const uint8_t CMD_WAIT_SHORT = 0x70;	// 1 to 16 samples
+const uint8_t DATA_NES_RAM = 0xC2;
+
+const uint8_t NES_SECOND_CHIP = 0x80;
+const unsigned int DPCM_AREA_SIZE = 0x4000;
+const unsigned int DPCM_ALIGNMENT = 0x40;
+
+void Put32(uint8_t *pBuf, uint32_t Value) {
+	for (int i = 0; i < 4; ++i)
+		pBuf[i] = static_cast<uint8_t>(Value >> (i * 8));
+}
+
+// Returns the single-byte wait command for a number of samples, or 0 if there is none
+uint8_t GetShortWait(uint32_t Samples) {
+	if (Samples >= 1 && Samples <= 16)
+		return CMD_WAIT_SHORT + Samples - 1;
+	if (Samples == 735)
+		return CMD_WAIT_NTSC;
+	if (Samples == 882)
+		return CMD_WAIT_PAL;
+	return 0;
+}
+
+// Whether a write to a NES APU register can be omitted if it does not change the value
+bool IsNESCacheable(uint8_t Reg, uint8_t Value) {
+	switch (Reg & ~NES_SECOND_CHIP) {
+	case 0x00: case 0x02: case 0x04: case 0x06: case 0x08: case 0x0A: case 0x0C: case 0x0E:
+	case 0x10: case 0x12: case 0x13:
+	case 0x22: case 0x26: case 0x29: case 0x2A:		// FDS pitch, modulation pitch, wave control, envelope speed
+		return true;
+	case 0x01: case 0x05:		// Sweep writes only have side effects if the sweep unit is enabled
+		return !(Value & 0x80);
+	case 0x15:					// DPCM is restarted by writing to $4015
+		return (Reg & NES_SECOND_CHIP) != 0;
+	case 0x20: case 0x24:		// FDS envelope writes only have side effects in envelope mode
+		return (Value & 0x80) != 0;
+	}
+	return false;
+}
+
+} // namespace
+
+CVGMWriter::CVGMWriter() :
+	m_iChips(SNDCHIP_NONE),
+	m_iClock(0),
+	m_iFrameRate(0),
+	m_bActive(false),
+	m_bFinished(false),
+	m_iOffset(0),
+	m_iCycles(0),
+	m_iSamples(0),
+	m_iLoopOffset(0),
+	m_iLoopSamples(0),
+	m_iSkippedWrites(0),
+	m_iVRC7Port(0),
+	m_iS5BPort(0),
+	m_pSample(nullptr),
+	m_iSampleSize(0),
+	m_iSampleTop(0),
+	m_iSampleAddress(0)
+{
+	ResetCache();
+}
+
+CVGMWriter::~CVGMWriter()
+{
+	Close();
+}
+
+bool CVGMWriter::Open(const char *pFile, uint8_t Chips, uint32_t Clock, uint32_t FrameRate)
+{
+	m_File.open(pFile, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	if (!m_File)
+		return false;
+
+	m_iChips = Chips;
+	m_iClock = Clock;
+	m_iFrameRate = FrameRate;
+	m_iOffset = 0;
+	m_iCycles = 0;
+	m_iSamples = 0;
+	m_iLoopOffset = 0;
+	m_iLoopSamples = 0;
+	m_iSkippedWrites = 0;
+
+	// The header is written when the file is closed
+	const uint8_t Header[VGM_HEADER_SIZE] = { };
+	WriteBytes(Header, sizeof(Header));
+	return static_cast<bool>(m_File);
+}
+
+void CVGMWriter::SetTag(vgm_tag_t Tag, const std::wstring &Text)
+{
+	m_strTags[Tag] = Text;
+}
+
+bool CVGMWriter::Close()
+{
+	if (!m_File.is_open())
+		return false;
+
+	if (m_bActive)
+		OnSongEnd();
+	const uint8_t End = CMD_END;
+	WriteBytes(&End, 1);
+	const uint32_t GD3Offset = m_iOffset;
+	WriteGD3();
+	WriteHeader(GD3Offset);
+
+	const bool bSuccess = static_cast<bool>(m_File);
+	m_File.close();
+	return bSuccess;
+}
+
+uint64_t CVGMWriter::GetTotalSamples() const
+{
+	return m_iSamples;
+}
+
+uint64_t CVGMWriter::GetLoopSamples() const
+{
+	return m_iLoopOffset ? m_iSamples - m_iLoopSamples : 0;
+}
+
+uint32_t CVGMWriter::GetFileSize() const
+{
+	return m_iOffset;
+}
+
+unsigned int CVGMWriter::GetSkippedWrites() const
+{
+	return m_iSkippedWrites;
+}
+
+bool CVGMWriter::IsSongFinished() const
+{
+	return m_bFinished.load(std::memory_order_acquire);
+}
+
+void CVGMWriter::OnWrite(uint16_t Address, uint8_t Value, uint32_t Cycle)
+{
+	if (!m_bActive)
+		return;
+
+	if (Address >= 0x4000 && Address <= 0x401F) {
+		if (Address == 0x4012)		// Offsets past the end of the sample area must not wrap around to its start
+			Value = static_cast<uint8_t>(std::min(Value + m_iSampleAddress, 0xFF));
+		WriteNES(Address & 0x1F, Value);
+	}
+	else if ((m_iChips & SNDCHIP_FDS) && Address >= 0x4040 && Address <= 0x407F)
+		WriteNES(static_cast<uint8_t>(Address - 0x4000), Value);
+	else if ((m_iChips & SNDCHIP_FDS) && Address >= 0x4080 && Address <= 0x409E)
+		WriteNES(static_cast<uint8_t>(Address - 0x4080 + 0x20), Value);
+	else if ((m_iChips & SNDCHIP_MMC5) && ((Address >= 0x5000 && Address <= 0x5007) || Address == 0x5015))
+		WriteNES(NES_SECOND_CHIP | (Address & 0x1F), Value);
+	else if ((m_iChips & SNDCHIP_VRC7) && Address == 0x9010)
+		m_iVRC7Port = Value & 0x3F;
+	else if ((m_iChips & SNDCHIP_VRC7) && Address == 0x9030)
+		WriteYM2413(m_iVRC7Port, Value);
+	else if ((m_iChips & SNDCHIP_S5B) && Address == 0xC000)
+		m_iS5BPort = Value & 0x0F;
+	else if ((m_iChips & SNDCHIP_S5B) && Address == 0xE000)
+		WriteAY8910(m_iS5BPort, Value);
+	else
+		++m_iSkippedWrites;
+}
+
+void CVGMWriter::OnEndFrame(uint32_t Cycles, const int16_t *Buffer, uint32_t Size)
+{
+	if (m_bActive)
+		m_iCycles += Cycles;
+}
+
+void CVGMWriter::OnSampleMemory(const char *pData, int Size)
+{
+	if (!m_bActive)
+		return;
+
+	m_pSample = pData;
+	m_iSampleSize = Size;
+	MapSample();
+}
+
+void CVGMWriter::OnSongStart()
+{
+	m_bActive = true;
+	m_bFinished.store(false, std::memory_order_relaxed);
+	m_iCycles = 0;
+	m_iSamples = 0;
+	m_pSample = nullptr;
+	ResetCache();
+
+	if (m_iChips & SNDCHIP_FDS)
+		WriteNES(0x3F, 0x02);		// Enable FDS sound registers through $4023
+	if (m_iChips & SNDCHIP_MMC5) {
+		// The MMC5 has no sweep units, disable those of the second APU so that low notes are not muted
+		WriteNES(NES_SECOND_CHIP | 0x01, 0x08);
+		WriteNES(NES_SECOND_CHIP | 0x05, 0x08);
+	}
+}
+
+void CVGMWriter::OnLoopPoint()
+{
+	if (!m_bActive)
+		return;
+
+	WriteWait();
+	m_iLoopOffset = m_iOffset;
+	m_iLoopSamples = m_iSamples;
+
+	// The looped part must not depend on register values or samples written before it
+	ResetCache();
+	if (m_pSample)
+		MapSample();
+}
+
+void CVGMWriter::OnSongEnd()
+{
+	if (!m_bActive)
+		return;
+
+	WriteWait();
+	m_bActive = false;
+	m_bFinished.store(true, std::memory_order_release);
+}
+
+void CVGMWriter::MapSample()
+{
+	// Samples stay in the sample area until it is full, $4012 writes are relocated to them
+	auto it = m_SampleLocation.find(m_pSample);
+	if (it == m_SampleLocation.end() || it->second.Size != m_iSampleSize) {
+		if (m_iSampleTop + m_iSampleSize > DPCM_AREA_SIZE) {
+			m_SampleLocation.clear();
+			m_iSampleTop = 0;
+		}
+		const unsigned int Base = m_iSampleTop;
+		m_iSampleTop += (m_iSampleSize + DPCM_ALIGNMENT - 1) & ~(DPCM_ALIGNMENT - 1);
+		it = m_SampleLocation.insert_or_assign(m_pSample, stSampleLocation {m_iSampleSize, Base}).first;		// a different size replaces the old location
+
+		WriteWait();
+		uint8_t Block[9] = {CMD_DATA_BLOCK, CMD_END, DATA_NES_RAM};
+		Put32(Block + 3, m_iSampleSize + 2);
+		Block[7] = static_cast<uint8_t>(Base & 0xFF);
+		Block[8] = static_cast<uint8_t>((0xC000 + Base) >> 8);
+		WriteBytes(Block, sizeof(Block));
+		WriteBytes(m_pSample, m_iSampleSize);
+	}
+	m_iSampleAddress = static_cast<uint8_t>(it->second.Base / DPCM_ALIGNMENT);
+}
+
+void CVGMWriter::WriteNES(uint8_t Reg, uint8_t Value)
+{
+	const bool bWaveRAM = (Reg & ~NES_SECOND_CHIP) >= 0x40;
+	const bool bCacheable = bWaveRAM ? m_iNESCache[0x29] != -1 && (m_iNESCache[0x29] & 0x80) : IsNESCacheable(Reg, Value);		// wave RAM is writable if $4089.7 is set
+	if (bCacheable && m_iNESCache[Reg] == Value)
+		return;
+	m_iNESCache[Reg] = bCacheable ? Value : -1;
+	WriteCommand(CMD_NES_APU, Reg, Value);
+}
+
+void CVGMWriter::WriteYM2413(uint8_t Reg, uint8_t Value)
+{
+	if (m_iYM2413Cache[Reg] == Value)
+		return;
+	m_iYM2413Cache[Reg] = Value;
+	WriteCommand(CMD_YM2413, Reg, Value);
+}
+
+void CVGMWriter::WriteAY8910(uint8_t Reg, uint8_t Value)
+{
+	if (Reg != 0x0D) {		// Writing the envelope shape restarts the envelope
+		if (m_iAY8910Cache[Reg] == Value)
+			return;
+		m_iAY8910Cache[Reg] = Value;
+	}
+	WriteCommand(CMD_AY8910, Reg, Value);
+}
+
+void CVGMWriter::WriteCommand(uint8_t Command, uint8_t Reg, uint8_t Value)
+{
+	WriteWait();
+	const uint8_t Buf[] = {Command, Reg, Value};
+	WriteBytes(Buf, sizeof(Buf));
+}
+
+void CVGMWriter::WriteWait()
+{
+	// Waits are only written before a command, so that consecutive frames without writes are merged
+	const uint64_t Target = m_iCycles * SAMPLE_RATE / m_iClock;
+	uint64_t Samples = Target - m_iSamples;
+	m_iSamples = Target;
+
+	const uint8_t Long[] = {CMD_WAIT, 0xFF, 0xFF};
+	while (Samples > 0xFFFF) {
+		WriteBytes(Long, sizeof(Long));
+		Samples -= 0xFFFF;
+	}
+	if (!Samples)
+		return;
+
+	// Use one or two single-byte commands if possible, otherwise a 3-byte wait
+	if (const uint8_t Cmd = GetShortWait(static_cast<uint32_t>(Samples))) {
+		WriteBytes(&Cmd, 1);
+		return;
+	}
+	for (const uint32_t First : {882u, 735u, 16u}) {
+		if (Samples <= First)
+			continue;
+		if (const uint8_t Cmd = GetShortWait(static_cast<uint32_t>(Samples - First))) {
+			const uint8_t Buf[] = {GetShortWait(First), Cmd};
+			WriteBytes(Buf, sizeof(Buf));
+			return;
+		}
+	}
+	const uint8_t Buf[] = {CMD_WAIT, static_cast<uint8_t>(Samples & 0xFF), static_cast<uint8_t>(Samples >> 8)};
+	WriteBytes(Buf, sizeof(Buf));
+}
+
+void CVGMWriter::WriteBytes(const void *pData, uint32_t Size)
+{
+	m_File.write(static_cast<const char *>(pData), Size);
+	m_iOffset += Size;
+}
+
+void CVGMWriter::WriteGD3()
+{
+	// English and Japanese names of the track, game, system and author, followed by the date,
+	// the converter and the notes
+	const vgm_tag_t ORDER[] = {
+		VGM_TAG_TRACK, VGM_TAG_COUNT, VGM_TAG_GAME, VGM_TAG_COUNT, VGM_TAG_SYSTEM, VGM_TAG_COUNT,
+		VGM_TAG_AUTHOR, VGM_TAG_COUNT, VGM_TAG_DATE, VGM_TAG_CONVERTER, VGM_TAG_NOTES,
+	};
+
+	std::vector<uint8_t> Strings;
+	for (const auto Tag : ORDER) {
+		if (Tag != VGM_TAG_COUNT)
+			for (const wchar_t c : m_strTags[Tag]) {
+				Strings.push_back(static_cast<uint8_t>(c & 0xFF));
+				Strings.push_back(static_cast<uint8_t>((c >> 8) & 0xFF));
+			}
+		Strings.push_back(0);
+		Strings.push_back(0);
+	}
+
+	uint8_t Header[12] = {'G', 'd', '3', ' '};
+	Put32(Header + 4, GD3_VERSION);
+	Put32(Header + 8, static_cast<uint32_t>(Strings.size()));
+	WriteBytes(Header, sizeof(Header));
+	WriteBytes(Strings.data(), static_cast<uint32_t>(Strings.size()));
+}
+
+void CVGMWriter::WriteHeader(uint32_t GD3Offset)
+{
+	uint8_t Header[VGM_HEADER_SIZE] = {'V', 'g', 'm', ' '};
+	Put32(Header + 0x04, m_iOffset - 0x04);
+	Put32(Header + 0x08, VGM_VERSION);
+	if (m_iChips & SNDCHIP_VRC7)
+		Put32(Header + 0x10, YM2413_CLOCK | VRC7_MODE);
+	Put32(Header + 0x14, GD3Offset - 0x14);
+	Put32(Header + 0x18, static_cast<uint32_t>(GetTotalSamples()));
+	if (m_iLoopOffset) {
+		Put32(Header + 0x1C, m_iLoopOffset - 0x1C);
+		Put32(Header + 0x20, static_cast<uint32_t>(GetLoopSamples()));
+	}
+	Put32(Header + 0x24, m_iFrameRate);
+	Put32(Header + 0x34, VGM_HEADER_SIZE - 0x34);
+	if (m_iChips & SNDCHIP_S5B) {
+		Put32(Header + 0x74, m_iClock / 2);		// The 5B divides its input clock by 2
+		Header[0x78] = AY_TYPE_YM2149;
+		Header[0x79] = AY_FLAG_LEGACY;
+	}
+	uint32_t NESClock = m_iClock;
+	if (m_iChips & SNDCHIP_FDS)
+		NESClock |= FDS_ENABLE;
+	if (m_iChips & SNDCHIP_MMC5)
+		NESClock |= DUAL_CHIP;
+	Put32(Header + 0x84, NESClock);
+
+	m_File.seekp(0);
+	m_File.write(reinterpret_cast<const char *>(Header), sizeof(Header));
+}
+
+void CVGMWriter::ResetCache()
+{
+	m_iNESCache.fill(-1);
+	m_iYM2413Cache.fill(-1);
+	m_iAY8910Cache.fill(-1);
+	m_SampleLocation.clear();
+	m_iSampleTop = 0;
+	m_iSampleAddress = 0;
+}
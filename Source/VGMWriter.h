@@ -0,0 +1,148 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include "Common.h"
+
+/*!
+	\brief GD3 tag fields of a VGM file.
+*/
+enum vgm_tag_t {
+	VGM_TAG_TRACK,
+	VGM_TAG_GAME,
+	VGM_TAG_SYSTEM,
+	VGM_TAG_AUTHOR,
+	VGM_TAG_DATE,
+	VGM_TAG_CONVERTER,
+	VGM_TAG_NOTES,
+	VGM_TAG_COUNT
+};
+
+/*!
+	\brief Writes the register stream of a rendered song into a VGM 1.71 file.
+	\details Commands are written to the file as the song is rendered. All writes of a frame are
+	placed at the start of the frame, so the only waits are those between frames; consecutive waits
+	are merged and encoded with the fewest bytes. Writes which leave a register unchanged and have
+	no side effects are dropped.
+
+	The 2A03 and FDS map to the NES APU, the MMC5 pulse channels to a second NES APU, the VRC7 to a
+	YM2413 in VRC7 mode and the 5B to a YM2149. DPCM samples are uploaded as RAM data blocks. The
+	VRC6, N163 and MMC5 PCM have no VGM equivalent; their writes are counted and skipped.
+*/
+class CVGMWriter : public IRegisterCapture
+{
+public:
+	/*!	\brief The sample rate of all VGM files. */
+	static const uint32_t SAMPLE_RATE = 44100;
+
+	CVGMWriter();
+	~CVGMWriter();
+
+	/*!	\brief Creates a VGM file.
+		\param pFile The file name.
+		\param Chips The expansion chips enabled in the module.
+		\param Clock The 2A03 clock rate in Hz.
+		\param FrameRate The refresh rate of the machine, 60 for NTSC or 50 for PAL.
+		\return Whether the file could be created.
+	*/
+	bool Open(const char *pFile, uint8_t Chips, uint32_t Clock, uint32_t FrameRate);
+	/*!	\brief Sets a GD3 tag field. */
+	void SetTag(vgm_tag_t Tag, const std::wstring &Text);
+	/*!	\brief Finishes the command stream, writes the GD3 tag and the header, and closes the file.
+		\return Whether the file was written successfully.
+	*/
+	bool Close();
+
+	/*!	\brief Returns the length of the song in samples. */
+	uint64_t GetTotalSamples() const;
+	/*!	\brief Returns the length of the looped part in samples, 0 if the song does not loop. */
+	uint64_t GetLoopSamples() const;
+	/*!	\brief Returns the size of the file in bytes. */
+	uint32_t GetFileSize() const;
+	/*!	\brief Returns the number of register writes which could not be represented. */
+	unsigned int GetSkippedWrites() const;
+	/*!	\brief Returns whether the end of the song has been reached. May be called from any thread. */
+	bool IsSongFinished() const;
+
+	void OnWrite(uint16_t Address, uint8_t Value, uint32_t Cycle) override;
+	void OnEndFrame(uint32_t Cycles, const int16_t *Buffer, uint32_t Size) override;
+	void OnSampleMemory(const char *pData, int Size) override;
+	void OnSongStart() override;
+	void OnLoopPoint() override;
+	void OnSongEnd() override;
+
+private:
+	void WriteNES(uint8_t Reg, uint8_t Value);
+	void WriteYM2413(uint8_t Reg, uint8_t Value);
+	void WriteAY8910(uint8_t Reg, uint8_t Value);
+	void WriteCommand(uint8_t Command, uint8_t Reg, uint8_t Value);
+	void WriteWait();
+	void WriteBytes(const void *pData, uint32_t Size);
+	void MapSample();
+	void WriteGD3();
+	void WriteHeader(uint32_t GD3Offset);
+	void ResetCache();
+
+private:
+	struct stSampleLocation {
+		int Size;
+		unsigned int Base;
+	};
+
+	std::ofstream m_File;
+	uint8_t m_iChips;
+	uint32_t m_iClock;
+	uint32_t m_iFrameRate;
+	std::array<std::wstring, VGM_TAG_COUNT> m_strTags;
+
+	bool m_bActive;
+	std::atomic<bool> m_bFinished;
+	uint32_t m_iOffset;					// Current position in the file
+	uint64_t m_iCycles;					// Cycles since the start of the song
+	uint64_t m_iSamples;				// Samples covered by the written waits
+	uint32_t m_iLoopOffset;				// File position of the loop point, 0 if none
+	uint64_t m_iLoopSamples;
+	unsigned int m_iSkippedWrites;
+
+	// Last written register values, -1 if unknown
+	std::array<int, 0x100> m_iNESCache;
+	std::array<int, 0x40> m_iYM2413Cache;
+	std::array<int, 0x10> m_iAY8910Cache;
+	uint8_t m_iVRC7Port;
+	uint8_t m_iS5BPort;
+
+	// DPCM samples currently held in the 16 kB sample area
+	std::map<const char *, stSampleLocation> m_SampleLocation;
+	const char *m_pSample;				// The sample which is currently mapped at $C000
+	int m_iSampleSize;
+	unsigned int m_iSampleTop;
+	uint8_t m_iSampleAddress;			// $4012 value of the mapped sample
+};
@@ -24,6 +24,7 @@
 #include "VisualizerScope.h"
 #include "VisualizerSpectrum.h"
 #include "VisualizerStatic.h"
+#include "TraceLog.h"		// // //
 
 // Thread entry helper
 
@@ -135,6 +136,7 @@ UINT CVisualizerWnd::ThreadProc()
 	m_bThreadRunning = true;
 
 	TRACE("Visualizer: Started thread (0x%04x)\n", nThreadID);
+	CTraceLog::SetThreadName("Visualizer");		// // //
 
 	while (::WaitForSingleObject(m_hNewSamples, INFINITE) == WAIT_OBJECT_0 && m_bThreadRunning) {
 
@@ -153,6 +155,7 @@ UINT CVisualizerWnd::ThreadProc()
 		m_csBufferSelect.Unlock();
 
 		// Draw
+		CTraceScope Trace {"Visualizer draw"};		// // //
 		m_csBuffer.Lock();
 
 		CDC *pDC = GetDC();
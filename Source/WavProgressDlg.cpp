@@ -25,6 +25,7 @@
 #include "FamiTrackerTypes.h"
 #include "APU\Types.h"
 #include "SoundGen.h"
+#include "LoudnessMeter.h"		// // //
 #include "WavProgressDlg.h"
 
 
@@ -93,7 +94,7 @@ BOOL CWavProgressDlg::OnInitDialog()
 	AfxFormatString1(FileStr, IDS_WAVE_PROGRESS_FILE_FORMAT, m_sFile);
 	SetDlgItemText(IDC_PROGRESS_FILE, FileStr);
 
-	if (!pSoundGen->RenderToFile(m_sFile.GetBuffer(), m_iSongEndType, m_iSongEndParam, m_iTrack))
+	if (!pSoundGen->RenderToFile(m_sFile, m_iSongEndType, m_iSongEndParam, m_iTrack))
 		EndDialog(0);
 
 	m_dwStartTime = GetTickCount();
@@ -162,6 +163,22 @@ void CWavProgressDlg::OnTimer(UINT_PTR nIDEvent)
 		SetWindowText(title);
 		pProgressBar->SetPos(100);
 		KillTimer(0);
+
+		// // // Loudness analysis of the rendered file
+		stLoudnessResult Loudness;
+		if (pSoundGen->HasRenderFailed())
+			SetDlgItemText(IDC_LOUDNESS, CString(MAKEINTRESOURCE(IDS_WAVE_EXPORT_FAILED)));
+		else if (pSoundGen->GetRenderLoudness(Loudness)) {
+			if (CLoudnessMeter::IsSilent(Loudness))
+				Text = _T("The rendered audio is silent.");
+			else
+				Text.Format(_T("Integrated: %s, range: %.1f LU, max short-term: %s\n")
+							_T("True peak: %s, DC offset: %.4f, clipped samples: %llu"),
+							CLoudnessMeter::FormatLevel(Loudness.Integrated, "LUFS").c_str(), Loudness.LoudnessRange,
+							CLoudnessMeter::FormatLevel(Loudness.MaxShortTerm, "LUFS").c_str(),
+							CLoudnessMeter::FormatLevel(Loudness.TruePeak, "dBTP").c_str(), Loudness.DCOffset, Loudness.ClippedSamples);
+			SetDlgItemText(IDC_LOUDNESS, Text);
+		}
 	}
 
 	CDialog::OnTimer(nIDEvent);
@@ -19,87 +19,265 @@
 */
 
 #include "WaveFile.h"
+#include <algorithm>
+#include <cstring>
 
-bool CWaveFile::OpenFile(LPTSTR Filename, int SampleRate, int SampleSize, int Channels)
-{
-	// Open a wave file for streaming
-	//
-
-	int nError;
+namespace {
 
-	WaveFormat.wf.wFormatTag	  = WAVE_FORMAT_PCM;
-	WaveFormat.wf.nChannels		  = Channels;
-	WaveFormat.wf.nSamplesPerSec  = SampleRate;
-	WaveFormat.wf.nBlockAlign	  = (SampleSize / 8) * Channels;
-	WaveFormat.wf.nAvgBytesPerSec = SampleRate * (SampleSize / 8) * Channels;
-	WaveFormat.wBitsPerSample	  = SampleSize;
+const uint16_t WAVE_FORMAT_PCM_TAG = 0x0001;
+const uint16_t WAVE_FORMAT_IEEE_FLOAT_TAG = 0x0003;
+const uint32_t DS64_SIZE = 28;					// RIFF size, data size, sample count and table length
+const size_t HEADER_MAX = 96;
+const uint64_t RIFF_SIZE_MAX = 0xFFFFFFFFu;
 
-	hmmioOut = mmioOpen(Filename, NULL, MMIO_ALLOCBUF | MMIO_READWRITE | MMIO_CREATE);
+char *PutTag(char *p, const char *Tag)
+{
+	std::memcpy(p, Tag, 4);
+	return p + 4;
+}
 
-	ckOutRIFF.fccType = mmioFOURCC('W', 'A', 'V', 'E');
-	ckOutRIFF.cksize  = 0;
+char *PutLE(char *p, uint64_t Value, int Bytes)
+{
+	for (int i = 0; i < Bytes; ++i)
+		*p++ = static_cast<char>(Value >> (i * 8));
+	return p;
+}
 
-	nError = mmioCreateChunk(hmmioOut, &ckOutRIFF, MMIO_CREATERIFF);
+} // namespace
 
-	if (nError != MMSYSERR_NOERROR)
-		return false;
+CWaveFile::CWaveFile() :
+	m_iSampleRate(0),
+	m_iSampleSize(0),
+	m_iChannels(0),
+	m_iBytesPerSample(0),
+	m_iDataSize(0),
+	m_bError(false),
+	m_iBlockBytes(0),
+	m_iBlockUsed(),
+	m_iFillPos(0),
+	m_iProduced(0),
+	m_iWritten(0),
+	m_bStopping(false)
+{
+}
 
-	ckOut.ckid	 = mmioFOURCC('f', 'm', 't', ' ');     
-	ckOut.cksize = sizeof(PCMWAVEFORMAT);
+CWaveFile::~CWaveFile()
+{
+	if (m_File.is_open())
+		CloseFile();
+}
 
-	nError = mmioCreateChunk(hmmioOut, &ckOut, 0);
+bool CWaveFile::OpenFile(const char *Filename, int SampleRate, int SampleSize, int Channels, bool bThreaded)
+{
+	// Open a wave file for streaming
+	//
 
-	if (nError != MMSYSERR_NOERROR)
+	if (SampleSize != 8 && SampleSize != 16 && SampleSize != 24 && SampleSize != 32)
 		return false;
 
-	mmioWrite(hmmioOut, (HPSTR)&WaveFormat, sizeof(PCMWAVEFORMAT));
-	mmioAscend(hmmioOut, &ckOut, 0);
-
-	ckOut.ckid	 = mmioFOURCC('d', 'a', 't', 'a');
-	ckOut.cksize = 0;
+	m_iSampleRate = SampleRate;
+	m_iSampleSize = SampleSize;
+	m_iChannels = Channels;
+	m_iBytesPerSample = SampleSize / 8;
+	m_iDataSize = 0;
+	m_bError = false;
+	m_iFillPos = 0;
+	m_iProduced = 0;
+	m_iWritten = 0;
+	m_bStopping = false;
 
-	nError = mmioCreateChunk(hmmioOut, &ckOut, 0);
+	// Blocks always hold whole sample frames, the stream buffer is bypassed
+	m_iBlockBytes = size_t(BLOCK_SAMPLES) * m_iBytesPerSample;
+	m_pBlocks.reset(new char[m_iBlockBytes * BLOCK_COUNT]);
+	m_File.rdbuf()->pubsetbuf(nullptr, 0);
+	m_File.open(Filename, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	if (!m_File)
+		return false;
 
-	if (nError != MMSYSERR_NOERROR)
+	// Write a provisional header so that an interrupted render still leaves a readable file
+	char Header[HEADER_MAX];
+	m_File.write(Header, MakeHeader(Header, 0));
+	if (!m_File) {
+		m_File.close();
 		return false;
+	}
 
-	mmioGetInfo(hmmioOut, &mmioinfoOut, 0);	
+	if (bThreaded)
+		m_Writer = std::thread {&CWaveFile::WriterThread, this};
 
 	return true;
 }
 
-void CWaveFile::CloseFile()
+bool CWaveFile::CloseFile()
 {
 	// Close the file
 	//
 
-	mmioinfoOut.dwFlags |= MMIO_DIRTY;
-	mmioSetInfo(hmmioOut, &mmioinfoOut, 0);
+	if (m_iFillPos)
+		SubmitBlock();
 
-	mmioAscend(hmmioOut, &ckOut, 0);
-	mmioAscend(hmmioOut, &ckOutRIFF, 0);
+	if (m_Writer.joinable()) {
+		{
+			std::lock_guard<std::mutex> Lock {m_Mutex};
+			m_bStopping = true;
+		}
+		m_Cond.notify_all();
+		m_Writer.join();
+	}
+
+	// Chunks must have an even size
+	if (m_iDataSize & 1)
+		WriteBlock("", 1);
 
-	mmioSeek(hmmioOut, 0, SEEK_SET); 
-	mmioDescend(hmmioOut, &ckOutRIFF, NULL, 0);
+	char Header[HEADER_MAX];
+	const size_t Size = MakeHeader(Header, m_iDataSize);
+	m_File.seekp(0);
+	m_File.write(Header, Size);
+	m_bError |= !m_File;
+	m_File.close();
+	m_pBlocks.reset();
 
-	mmioClose(hmmioOut, 0);
+	return !m_bError;
 }
 
-void CWaveFile::WriteWave(char *Data, int Size)
+void CWaveFile::WriteSamples(const int16_t *pSamples, unsigned int Count)
 {
 	// Save data to the file
 	//
 
-	int cT;
-	
-	for (cT = 0; cT < Size; cT++) {
-		if (mmioinfoOut.pchNext == mmioinfoOut.pchEndWrite) { 
-			mmioinfoOut.dwFlags |= MMIO_DIRTY; 
-			mmioAdvance(hmmioOut, &mmioinfoOut, MMIO_WRITE);
+	while (Count) {
+		const unsigned int Samples = std::min(Count, BLOCK_SAMPLES - static_cast<unsigned int>(m_iFillPos));
+		char *pOut = m_pBlocks.get() + (m_iProduced % BLOCK_COUNT) * m_iBlockBytes + m_iFillPos * m_iBytesPerSample;
+
+		switch (m_iSampleSize) {
+		case 8:
+			for (unsigned int i = 0; i < Samples; ++i)
+				*pOut++ = static_cast<char>((pSamples[i] >> 8) ^ 0x80);
+			break;
+		case 16:
+			for (unsigned int i = 0; i < Samples; ++i)
+				pOut = PutLE(pOut, static_cast<uint16_t>(pSamples[i]), 2);
+			break;
+		case 24:
+			for (unsigned int i = 0; i < Samples; ++i) {
+				*pOut++ = 0;
+				pOut = PutLE(pOut, static_cast<uint16_t>(pSamples[i]), 2);
+			}
+			break;
+		case 32:
+			for (unsigned int i = 0; i < Samples; ++i) {
+				const float Sample = pSamples[i] * (1.0f / 32768.0f);
+				std::memcpy(pOut, &Sample, sizeof(Sample));
+				pOut += sizeof(Sample);
+			}
+			break;
 		}
 
-		*((BYTE*)mmioinfoOut.pchNext) = *((BYTE*)Data + cT); 
-		mmioinfoOut.pchNext++;
+		pSamples += Samples;
+		Count -= Samples;
+		m_iFillPos += Samples;
+		if (m_iFillPos == BLOCK_SAMPLES)
+			SubmitBlock();
 	}
 }
 
+uint64_t CWaveFile::GetDataSize() const
+{
+	return m_iDataSize + m_iFillPos * m_iBytesPerSample;
+}
+
+size_t CWaveFile::MakeHeader(char *pHeader, uint64_t DataSize) const
+{
+	const bool bFloat = m_iSampleSize == 32;
+	const uint32_t FormatSize = bFloat ? 18 : 16;
+	const uint32_t BlockAlign = m_iBytesPerSample * m_iChannels;
+	const uint64_t Frames = BlockAlign ? DataSize / BlockAlign : 0;
+
+	const size_t HeaderSize = 12 + (8 + DS64_SIZE) + (8 + FormatSize) + (bFloat ? 12 : 0) + 8;
+	const uint64_t RiffSize = HeaderSize - 8 + DataSize + (DataSize & 1);
+	const bool bRF64 = RiffSize > RIFF_SIZE_MAX;
+
+	char *p = pHeader;
+	p = PutTag(p, bRF64 ? "RF64" : "RIFF");
+	p = PutLE(p, bRF64 ? RIFF_SIZE_MAX : RiffSize, 4);
+	p = PutTag(p, "WAVE");
+
+	// The ds64 chunk replaces the JUNK chunk once the file outgrows 32-bit sizes
+	p = PutTag(p, bRF64 ? "ds64" : "JUNK");
+	p = PutLE(p, DS64_SIZE, 4);
+	if (bRF64) {
+		p = PutLE(p, RiffSize, 8);
+		p = PutLE(p, DataSize, 8);
+		p = PutLE(p, Frames, 8);
+		p = PutLE(p, 0, 4);
+	}
+	else {
+		std::memset(p, 0, DS64_SIZE);
+		p += DS64_SIZE;
+	}
+
+	p = PutTag(p, "fmt ");
+	p = PutLE(p, FormatSize, 4);
+	p = PutLE(p, bFloat ? WAVE_FORMAT_IEEE_FLOAT_TAG : WAVE_FORMAT_PCM_TAG, 2);
+	p = PutLE(p, m_iChannels, 2);
+	p = PutLE(p, m_iSampleRate, 4);
+	p = PutLE(p, uint64_t(m_iSampleRate) * BlockAlign, 4);
+	p = PutLE(p, BlockAlign, 2);
+	p = PutLE(p, m_iSampleSize, 2);
+
+	if (bFloat) {
+		p = PutLE(p, 0, 2);
+		// Non-PCM formats require a fact chunk
+		p = PutTag(p, "fact");
+		p = PutLE(p, 4, 4);
+		p = PutLE(p, bRF64 ? RIFF_SIZE_MAX : Frames, 4);
+	}
+
+	p = PutTag(p, "data");
+	p = PutLE(p, bRF64 ? RIFF_SIZE_MAX : DataSize, 4);
+
+	return p - pHeader;
+}
+
+void CWaveFile::SubmitBlock()
+{
+	const size_t Used = m_iFillPos * m_iBytesPerSample;
+	m_iBlockUsed[m_iProduced % BLOCK_COUNT] = Used;
+	m_iDataSize += Used;
+	m_iFillPos = 0;
+
+	if (!m_Writer.joinable()) {
+		WriteBlock(m_pBlocks.get() + (m_iProduced % BLOCK_COUNT) * m_iBlockBytes, Used);
+		++m_iProduced;
+		++m_iWritten;
+		return;
+	}
+
+	// Hand the block over and wait only if every block is still in flight
+	std::unique_lock<std::mutex> Lock {m_Mutex};
+	++m_iProduced;
+	m_Cond.notify_all();
+	m_Cond.wait(Lock, [this] { return m_iProduced - m_iWritten < BLOCK_COUNT; });
+}
+
+void CWaveFile::WriteBlock(const char *pData, size_t Size)
+{
+	m_File.write(pData, Size);
+	m_bError |= !m_File;
+}
+
+void CWaveFile::WriterThread()
+{
+	std::unique_lock<std::mutex> Lock {m_Mutex};
+	while (true) {
+		m_Cond.wait(Lock, [this] { return m_iWritten < m_iProduced || m_bStopping; });
+		if (m_iWritten == m_iProduced)
+			break;
+		const size_t Index = m_iWritten % BLOCK_COUNT;
+		Lock.unlock();
+		WriteBlock(m_pBlocks.get() + Index * m_iBlockBytes, m_iBlockUsed[Index]);
+		Lock.lock();
+		++m_iWritten;
+		m_Cond.notify_all();
+	}
+}
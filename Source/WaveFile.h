@@ -18,24 +18,78 @@
 ** must bear this legend.
 */
 
-#pragma once
 
 
-#include "stdafx.h"		// // //
-#include <mmsystem.h>
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "AudioFile.h"
 
-class CWaveFile
+/*!
+	\brief Streams rendered audio into a RIFF wave file.
+	\details Samples are converted directly into large output blocks which are written to the file
+	in one call each, optionally from a dedicated I/O thread so that the emulation never waits for
+	the disk unless all blocks are in flight. Supports 8, 16 and 24-bit PCM as well as 32-bit float.
+	The samples always come from the 16-bit mixer output, so 24-bit samples are padded with zeros
+	and float samples are the 16-bit values divided by 32768; no precision is gained.
+	Files whose data exceeds the 4 GiB limit of RIFF are turned into RF64 files when closed, using
+	the space of a JUNK chunk reserved in the header.
+*/
+class CWaveFile : public IAudioFile
 {
-	public:
-		bool	OpenFile(LPTSTR Filename, int SampleRate, int SampleSize, int Channels);
-		void	CloseFile();
-		void	WriteWave(char *Data, int Size);
+public:
+	/*!	\brief The number of samples held by each output block. */
+	static const unsigned int BLOCK_SAMPLES = 1u << 18;
+	/*!	\brief The number of output blocks used by the I/O thread. */
+	static const unsigned int BLOCK_COUNT = 4;
 
-	private:
-		PCMWAVEFORMAT	WaveFormat;
-		MMCKINFO		ckOutRIFF, ckOut;
-		MMIOINFO		mmioinfoOut;
-		HMMIO			hmmioOut;
+	CWaveFile();
+	~CWaveFile() override;
 
-};
+	/*!	\brief Creates a wave file for streaming.
+		\param Filename The file name.
+		\param SampleRate The sample rate in Hz.
+		\param SampleSize The sample size in bits, 8, 16 or 24 for integer PCM or 32 for IEEE float.
+		\param Channels The number of interleaved channels.
+		\param bThreaded Whether blocks are written by a dedicated I/O thread.
+		\return Whether the file could be created.
+	*/
+	bool	OpenFile(const char *Filename, int SampleRate, int SampleSize, int Channels, bool bThreaded = true);
+	bool	CloseFile() override;
+	void	WriteSamples(const int16_t *pSamples, unsigned int Count) override;
+	/*!	\brief Returns the number of bytes of sample data written so far. */
+	uint64_t GetDataSize() const;
 
+private:
+	size_t	MakeHeader(char *pHeader, uint64_t DataSize) const;
+	void	SubmitBlock();
+	void	WriteBlock(const char *pData, size_t Size);
+	void	WriterThread();
+
+private:
+	std::ofstream	m_File;
+	int				m_iSampleRate;
+	int				m_iSampleSize;
+	int				m_iChannels;
+	unsigned int	m_iBytesPerSample;
+	uint64_t		m_iDataSize;
+	bool			m_bError;
+
+	// Output blocks, filled by the emulation thread and written in order
+	std::unique_ptr<char[]> m_pBlocks;
+	size_t			m_iBlockBytes;
+	size_t			m_iBlockUsed[BLOCK_COUNT];
+	size_t			m_iFillPos;
+	uint64_t		m_iProduced;			// Blocks handed to the writer
+	uint64_t		m_iWritten;				// Blocks written by the writer
+
+	std::thread		m_Writer;
+	std::mutex		m_Mutex;
+	std::condition_variable m_Cond;
+	bool			m_bStopping;
+};
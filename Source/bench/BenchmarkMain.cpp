@@ -0,0 +1,166 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+// Headless benchmark program for the sound emulation core. Run the main program with
+// /benchmark for document and export timings, which depend on MFC.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "EmulationBenchmark.h"
+#include "RegisterLog.h"
+#include "WaveFile.h"		// // //
+#include "FlacFile.h"		// // //
+#include "APU/APU.h"
+#include "APU/Types.h"
+#include "version.h"
+
+namespace {
+
+void PrintUsage(const char *Name) {
+	std::fprintf(stderr,
+		"Usage: %s [-seconds N] [-rate N] [-o FILE] [-log FILE] [-files DIR]\n"
+		"  -seconds N  emulated seconds per chip combination (default 60)\n"
+		"  -rate N     output sample rate (default 44100)\n"
+		"  -o FILE     write the JSON report to FILE instead of the standard output\n"
+		"  -log FILE   write a binary register log of all runs to FILE\n"
+		"  -files DIR  also render the 2A03 run into wave and FLAC files in DIR\n", Name);
+}
+
+// // // Renders the 2A03 alone, the cheapest combination to emulate, without a file and into
+// each audio file format the way the sound generator does, and measures the overhead
+nlohmann::json RunFiles(CEmulationBenchmark &Benchmark, int SampleRate, const std::string &Dir) {
+	using clock_t = std::chrono::steady_clock;
+
+	const stEmulationResult Base = Benchmark.Run("none", SNDCHIP_NONE);
+	std::fprintf(stderr, "%-5s %8.1fx realtime\n", Base.Name, Base.EmulatedSeconds / Base.WallSeconds);
+	nlohmann::json Results = nlohmann::json::array();
+	Results.push_back(CEmulationBenchmark::ToJSON(Base));
+
+	const auto RunFile = [&] (const char *Name, IAudioFile &File) {
+		Benchmark.SetAudioFile(&File);
+		stEmulationResult Result = Benchmark.Run(Name, SNDCHIP_NONE);
+		Benchmark.SetAudioFile(nullptr);
+		const auto Start = clock_t::now();
+		const bool Closed = File.CloseFile();
+		const double CloseSeconds = std::chrono::duration<double>(clock_t::now() - Start).count();
+
+		const double Total = Result.WallSeconds + CloseSeconds;
+		std::fprintf(stderr, "%-5s %8.1fx realtime, %+.1f%% (%+.1f%% on the emulation thread)\n", Name,
+			Result.EmulatedSeconds / Total, (Total / Base.WallSeconds - 1.) * 100.,
+			(Result.WallSeconds / Base.WallSeconds - 1.) * 100.);
+		if (!Closed)
+			std::fprintf(stderr, "Error: unable to write the %s file\n", Name);
+
+		nlohmann::json j = CEmulationBenchmark::ToJSON(Result);
+		j["close_seconds"] = CloseSeconds;
+		j["overhead"] = Total / Base.WallSeconds - 1.;
+		Results.push_back(j);
+	};
+
+	CWaveFile Wave;
+	if (Wave.OpenFile((Dir + "/bench.wav").c_str(), SampleRate, 16, 1))
+		RunFile("wav", Wave);
+	else
+		std::fprintf(stderr, "Error: unable to create the wave file\n");
+	CFlacFile Flac;
+	if (Flac.OpenFile((Dir + "/bench.flac").c_str(), SampleRate, 16, 1))
+		RunFile("flac", Flac);
+	else
+		std::fprintf(stderr, "Error: unable to create the FLAC file\n");
+
+	return Results;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+	int Seconds = 60;
+	int SampleRate = 44100;
+	const char *Output = nullptr;
+	const char *LogFile = nullptr;
+	const char *FileDir = nullptr;		// // //
+
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "-seconds") && i + 1 < argc)
+			Seconds = std::atoi(argv[++i]);
+		else if (!std::strcmp(argv[i], "-rate") && i + 1 < argc)
+			SampleRate = std::atoi(argv[++i]);
+		else if (!std::strcmp(argv[i], "-o") && i + 1 < argc)
+			Output = argv[++i];
+		else if (!std::strcmp(argv[i], "-log") && i + 1 < argc)
+			LogFile = argv[++i];
+		else if (!std::strcmp(argv[i], "-files") && i + 1 < argc)		// // //
+			FileDir = argv[++i];
+		else {
+			PrintUsage(argv[0]);
+			return 1;
+		}
+	}
+	if (Seconds <= 0 || SampleRate < 11025 || SampleRate > 192000) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	CEmulationBenchmark Benchmark {SampleRate, static_cast<unsigned int>(Seconds * CAPU::FRAME_RATE_NTSC)};
+	CRegisterLogWriter Logger;
+	if (LogFile) {
+		if (!Logger.Open(LogFile)) {
+			std::fprintf(stderr, "Error: unable to write %s\n", LogFile);
+			return 1;
+		}
+		Benchmark.SetRegisterCapture(&Logger);
+	}
+	nlohmann::json Emulation = nlohmann::json::array();
+	for (const auto &x : Benchmark.RunAll()) {
+		std::fprintf(stderr, "%-5s %8.1fx realtime\n", x.Name, x.EmulatedSeconds / x.WallSeconds);
+		Emulation.push_back(CEmulationBenchmark::ToJSON(x));
+	}
+	Logger.Close();
+	Benchmark.SetRegisterCapture(nullptr);		// // //
+
+	nlohmann::json Report = {
+		{"version", APP_NAME_VERSION},
+		{"sample_rate", SampleRate},
+		{"emulation", Emulation},
+	};
+	if (FileDir)		// // //
+		Report["files"] = RunFiles(Benchmark, SampleRate, FileDir);
+
+	if (Output) {
+		std::ofstream File {Output};
+		if (!(File << Report.dump(1, '\t') << std::endl)) {
+			std::fprintf(stderr, "Error: unable to write %s\n", Output);
+			return 1;
+		}
+	}
+	else
+		std::cout << Report.dump(1, '\t') << std::endl;
+
+	return 0;
+}
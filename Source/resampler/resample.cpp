@@ -88,7 +88,8 @@ namespace jarh
 //
 //------------------------------------------------------------------------
 resample_base::resample_base(const sinc &s)
- : flags_(goodbit), sinc_(s)
+ : flags_(goodbit), sinc_(s), cutoff_(0.f), ratio_(0.f), invratio_(0.f), sincstep_(0.f),
+   idx_(0), subidx_(0.f), remainsamples_(0.f), notend_(false)		// // // init() compares against these
 {
 }
 //------------------------------------------------------------------------
@@ -24,6 +24,8 @@
 
 #pragma once
 
+#ifndef FT_HEADLESS		// // // sound emulation core only, used by the benchmark program
+
 #define _CRTDBG_MAPALLOC
 #define NOMINMAX
 
@@ -73,6 +75,8 @@
 
 #include <afxole.h>        // MFC OLE support
 
+#endif // FT_HEADLESS
+
 // Releasing pointers
 #define SAFE_RELEASE(p) \
 	if (p != NULL) { \
@@ -93,7 +97,12 @@
 #undef TRACE
 #endif
 
-#ifdef _DEBUG
+#ifdef FT_HEADLESS		// // //
+#include <cassert>
+#define ASSERT(x) assert(x)
+#define AfxDebugBreak() assert(false)
+#define TRACE(...) ((void)0)
+#elif defined(_DEBUG)
 #define new DEBUG_NEW
 template <typename... T>
 bool _trace(TCHAR *format, T... args)
@@ -0,0 +1,105 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+
+// Tests for CLoudnessMeter, the loudness analysis of rendered files.
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "LoudnessMeter.h"
+
+namespace {
+
+int Failures = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		++Failures; \
+	} \
+} while (false)
+
+const int SAMPLE_RATE = 48000;
+const double PI = 3.14159265358979323846;
+
+// A 997 Hz sine at -20 dBFS reads -23.0 LUFS, the K-weighting is nearly flat there
+std::vector<int16_t> MakeTone(unsigned int Samples)
+{
+	std::vector<int16_t> Data(Samples);
+	for (unsigned int i = 0; i < Samples; ++i)
+		Data[i] = static_cast<int16_t>(std::lround(3276.8 * std::sin(2. * PI * 997. * i / SAMPLE_RATE)));
+	return Data;
+}
+
+stLoudnessResult Measure(const std::vector<int16_t> &Data)
+{
+	CLoudnessMeter Meter {SAMPLE_RATE};
+	Meter.Process(Data.data(), static_cast<unsigned int>(Data.size()));
+	return Meter.GetResult();
+}
+
+void TestPartialStep()
+{
+	// 350 ms only form a gating block if the last 50 ms are measured
+	const stLoudnessResult Result = Measure(MakeTone(SAMPLE_RATE * 35 / 100));
+	CHECK(Result.Samples == SAMPLE_RATE * 35 / 100);
+	CHECK(std::isfinite(Result.Integrated));
+	CHECK(std::abs(Result.Integrated + 23.) < .3);
+	CHECK(!CLoudnessMeter::IsSilent(Result));
+}
+
+void TestOngoing()
+{
+	// Reading the result does not end the current step
+	const std::vector<int16_t> Tone = MakeTone(SAMPLE_RATE);
+	CLoudnessMeter Meter {SAMPLE_RATE};
+	Meter.Process(Tone.data(), SAMPLE_RATE * 35 / 100);
+	Meter.GetResult();
+	Meter.Process(Tone.data() + SAMPLE_RATE * 35 / 100, SAMPLE_RATE * 65 / 100);
+	const stLoudnessResult Result = Meter.GetResult();
+	CHECK(Result.Samples == SAMPLE_RATE);
+	CHECK(Result.Integrated == Measure(Tone).Integrated);
+}
+
+void TestSilence()
+{
+	const stLoudnessResult Result = Measure(std::vector<int16_t>(SAMPLE_RATE * 5));
+	CHECK(CLoudnessMeter::IsSilent(Result));
+	CHECK(CLoudnessMeter::FormatLevel(Result.Integrated, "LUFS") == "n/a");
+	CHECK(CLoudnessMeter::FormatLevel(Result.TruePeak, "dBTP") == "n/a");
+	CHECK(CLoudnessMeter::FormatLevel(-23.04, "LUFS") == "-23.0 LUFS");
+}
+
+} // namespace
+
+int main()
+{
+	TestPartialStep();
+	TestOngoing();
+	TestSilence();
+	if (Failures)
+		std::fprintf(stderr, "%d check(s) failed\n", Failures);
+	return Failures ? 1 : 0;
+}
@@ -0,0 +1,214 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+// Tests for CRenderCache: a render that reuses audio from the previous one must be bit-identical
+// to plain emulation.
+
+#include <cstdio>
+#include <vector>
+#include "RenderCache.h"
+#include "APU/APU.h"
+#include "APU/Types.h"
+
+namespace {
+
+int Failures = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		++Failures; \
+	} \
+} while (false)
+
+const int SAMPLE_RATE = 44100;
+const uint8_t CHIPS = SNDCHIP_VRC6 | SNDCHIP_VRC7 | SNDCHIP_N163;
+const unsigned int FRAMES = 600;
+const unsigned int CHANGE_BEGIN = 300;		// Frames that differ in the changed song
+const unsigned int CHANGE_END = 310;
+const uint32_t FRAME_CYCLES = CAPU::BASE_FREQ_NTSC / CAPU::FRAME_RATE_NTSC;
+
+class CAudioBuffer : public IAudioCallback
+{
+public:
+	void FlushBuffer(int16_t *Buffer, uint32_t Size) override {
+		if (m_bKeep)
+			m_Samples.insert(m_Samples.end(), Buffer, Buffer + Size);
+	}
+	explicit CAudioBuffer(bool bKeep) : m_bKeep(bKeep) {
+	}
+	std::vector<int16_t> m_Samples;
+private:
+	bool m_bKeep;
+};
+
+std::vector<char> MakeDPCM()
+{
+	std::vector<char> Sample(0x101);
+	for (size_t i = 0; i < Sample.size(); ++i)
+		Sample[i] = static_cast<char>(i * 0x9D >> 2);
+	return Sample;
+}
+
+const std::vector<char> DPCM = MakeDPCM();
+
+void SetupAPU(CAPU &APU)
+{
+	APU.SetupSound(SAMPLE_RATE, 1, MACHINE_NTSC);
+	APU.SetupMixer(30, 12000, 24, 100);
+	APU.SetExternalSound(CHIPS);
+}
+
+void WriteSong(CAPU &APU, unsigned int Frame, bool bChanged)
+{
+	const bool bAltered = bChanged && Frame >= CHANGE_BEGIN && Frame < CHANGE_END;
+	const unsigned int Pitch = 0x100 + ((Frame / 8) * 37 & 0xFF) + (bAltered ? 0x40 : 0);
+
+	if (Frame == 0) {
+		APU.Write(0x4015, 0x0F);
+		APU.Write(0x4000, 0xBF);
+		APU.Write(0x4008, 0xFF);
+		APU.Write(0x400C, 0x3C);
+		APU.Write(0x9000, 0x7F);
+		APU.Write(0x9010, 0x30);
+		APU.Write(0x9030, 0x12);
+		APU.Write(0xF800, 0x7F);
+		APU.Write(0x4800, 0x70);
+	}
+	APU.Write(0x4002, Pitch & 0xFF);
+	APU.Write(0x4003, (Pitch >> 8) | 0x08);
+	APU.AddTime(150);
+	APU.Process();
+	APU.Write(0x400A, (Pitch >> 1) & 0xFF);
+	APU.Write(0x400B, (Pitch >> 9) | 0x08);
+	APU.Write(0x400E, Frame & 0x0F);
+	APU.Write(0x400F, 0x08);
+	if (Frame % 64 == 0) {
+		APU.WriteSample(DPCM.data(), static_cast<int>(DPCM.size()));
+		APU.Write(0x4010, 0x0F);
+		APU.Write(0x4012, 0x00);
+		APU.Write(0x4013, 0x10);
+		APU.Write(0x4015, 0x1F);
+	}
+	APU.AddTime(250);
+	APU.Process();
+	APU.Write(0x9001, Pitch & 0xFF);
+	APU.Write(0x9002, 0x80 | (Pitch >> 8));
+	APU.Write(0x9010, 0x10);
+	APU.Write(0x9030, Pitch & 0xFF);
+	APU.Write(0x9010, 0x20);
+	APU.Write(0x9030, 0x30 | ((Pitch >> 8) & 0x01) | (Frame % 32 < 24 ? 0x10 : 0));
+	APU.AddTime(250);
+	APU.Process();
+	APU.Write(0xF800, 0x78);
+	APU.Write(0x4800, (Pitch << 4) & 0xFF);
+	APU.Write(0xF800, 0x7C);
+	APU.Write(0x4800, 0xE0);
+	APU.AddTime(FRAME_CYCLES - 650);
+	APU.Process();
+}
+
+std::vector<int16_t> RenderPlain(bool bChanged)
+{
+	CAudioBuffer Audio {true};
+	CAPU APU {&Audio};
+	SetupAPU(APU);
+	APU.Reset();
+	for (unsigned int i = 0; i < FRAMES; ++i)
+		WriteSong(APU, i, bChanged);
+	return Audio.m_Samples;
+}
+
+std::vector<int16_t> RenderCached(CAPU &APU, CRenderCache &Cache, bool bChanged)
+{
+	// Follows CSoundGen, which collects the audio of the cache after every frame
+	std::vector<int16_t> Samples;
+	APU.Reset();
+	APU.SetRegisterCapture(&Cache);
+	Cache.Begin(&APU);
+	for (unsigned int i = 0; i < FRAMES; ++i) {
+		WriteSong(APU, i, bChanged);
+		const int16_t *pSamples = nullptr;
+		const size_t Size = Cache.Update(pSamples);
+		Samples.insert(Samples.end(), pSamples, pSamples + Size);
+	}
+	Cache.Finish();
+	APU.SetRegisterCapture(nullptr);
+	return Samples;
+}
+
+void TestRerender(const std::vector<int16_t> &Original, const std::vector<int16_t> &Changed)
+{
+	CAudioBuffer Audio {false};
+	CAPU APU {&Audio};
+	SetupAPU(APU);
+	CRenderCache Cache;
+
+	CHECK(RenderCached(APU, Cache, false) == Original);
+	CHECK(Cache.GetReusedFrames() == 0);
+
+	// Unchanged song, no frame has to be emulated
+	CHECK(RenderCached(APU, Cache, false) == Original);
+	CHECK(Cache.GetEmulatedFrames() == 0);
+
+	// The frames before the change are reused; the oscillator phases differ after it, so the rest
+	// of the song is emulated
+	CHECK(RenderCached(APU, Cache, true) == Changed);
+	CHECK(Cache.GetReusedFrames() >= CHANGE_BEGIN - 32);
+	CHECK(Cache.GetEmulatedFrames() > 0);
+
+	CHECK(RenderCached(APU, Cache, false) == Original);
+	CHECK(Cache.GetReusedFrames() >= CHANGE_BEGIN - 32);
+}
+
+void TestSizeLimit(const std::vector<int16_t> &Original, const std::vector<int16_t> &Changed)
+{
+	// Renders longer than the limit are passed on without being stored
+	CAudioBuffer Audio {false};
+	CAPU APU {&Audio};
+	SetupAPU(APU);
+	CRenderCache Cache {32, Original.size() / 2};
+
+	CHECK(RenderCached(APU, Cache, false) == Original);
+	CHECK(RenderCached(APU, Cache, true) == Changed);
+	CHECK(Cache.GetReusedFrames() == 0);
+	CHECK(RenderCached(APU, Cache, false) == Original);
+	CHECK(Cache.GetReusedFrames() == 0);
+}
+
+} // namespace
+
+int main()
+{
+	const std::vector<int16_t> Original = RenderPlain(false);
+	const std::vector<int16_t> Changed = RenderPlain(true);
+	CHECK(!Original.empty());
+	CHECK(Original != Changed);
+
+	TestRerender(Original, Changed);
+	TestSizeLimit(Original, Changed);
+	if (Failures)
+		std::fprintf(stderr, "%d check(s) failed\n", Failures);
+	return Failures ? 1 : 0;
+}
@@ -0,0 +1,144 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+// Tests for CSamplePacker, the DPCM sample layout of exported modules.
+
+#include <cstdio>
+#include <vector>
+#include "SamplePacker.h"
+
+namespace {
+
+int Failures = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		++Failures; \
+	} \
+} while (false)
+
+// Samples are allocated with their exact size, as CDSample does, so that a read past the end
+// is detected by memory checkers
+std::vector<char> MakeSample(unsigned int Size, unsigned int Seed)
+{
+	std::vector<char> Data(Size);
+	for (unsigned int i = 0; i < Size; ++i)
+		Data[i] = static_cast<char>((i * 31 + Seed * 17 + (i >> 3)) & 0xFF);
+	return Data;
+}
+
+std::vector<char> Slice(const std::vector<char> &Data, unsigned int Offset, unsigned int Size)
+{
+	return std::vector<char>(Data.begin() + Offset, Data.begin() + Offset + Size);
+}
+
+void TestIdentical()
+{
+	// Sizes that are a multiple of 16 play one byte past their data
+	const std::vector<char> A = MakeSample(0x40, 1);
+	const std::vector<char> B = A;
+	CSamplePacker Packer;
+	Packer.AddSample(A.data(), A.size());
+	Packer.AddSample(B.data(), B.size());
+	Packer.Merge();
+	Packer.Pack(0);
+	CHECK(Packer.GetSharedCount() == 1);
+	CHECK(Packer.GetStoredSamples().size() == 1);
+	CHECK(Packer.GetLocation(1).Offset == Packer.GetLocation(0).Offset);
+	CHECK(Packer.GetStoredSize() == 0x40);
+}
+
+void TestPrefix()
+{
+	const std::vector<char> Long = MakeSample(0x95, 2);
+	const std::vector<char> Head = Slice(Long, 0, 0x31);		// plays 0x31 bytes
+	const std::vector<char> Tail = Slice(Long, 0x40, 0x50);		// ends at the source end
+	const std::vector<char> Odd = Slice(Long, 0x20, 0x21);		// not 64-byte aligned
+	CSamplePacker Packer;
+	Packer.AddSample(Head.data(), Head.size());
+	Packer.AddSample(Long.data(), Long.size());
+	Packer.AddSample(Tail.data(), Tail.size());
+	Packer.AddSample(Odd.data(), Odd.size());
+	Packer.Merge();
+	Packer.Pack(0);
+	CHECK(Packer.GetSharedCount() == 2);
+	CHECK(Packer.GetLocation(0).Offset == Packer.GetLocation(1).Offset);
+	CHECK(Packer.GetLocation(2).Offset == Packer.GetLocation(1).Offset + 0x40);
+	CHECK(Packer.GetStoredSamples().size() == 2);
+}
+
+void TestUnplayedBytes()
+{
+	// Only the played length of 0x21 bytes has to match
+	const std::vector<char> A = MakeSample(0x2F, 3);
+	std::vector<char> B = Slice(A, 0, 0x2F);
+	B.back() ^= 0x55;
+	std::vector<char> C = Slice(A, 0, 0x2F);
+	C[0x20] ^= 0x55;
+	CSamplePacker Packer;
+	Packer.AddSample(A.data(), A.size());
+	Packer.AddSample(B.data(), B.size());
+	Packer.AddSample(C.data(), C.size());
+	Packer.Merge();
+	Packer.Pack(0);
+	CHECK(Packer.GetSharedCount() == 1);
+	CHECK(Packer.GetLocation(1).Offset == Packer.GetLocation(0).Offset);
+	CHECK(Packer.GetLocation(2).Offset != Packer.GetLocation(0).Offset);
+}
+
+void TestWindows()
+{
+	// No sample may end at the end of a window, the played size of these samples is one byte more
+	const unsigned int WindowSize = 0x3000;
+	std::vector<std::vector<char>> Samples;
+	for (unsigned int i = 0; i < 12; ++i)
+		Samples.push_back(MakeSample(0x400 * (1 + i % 4), 10 + i));
+	CSamplePacker Packer;
+	for (const auto &Sample : Samples)
+		Packer.AddSample(Sample.data(), Sample.size());
+	Packer.Merge();
+	Packer.Pack(WindowSize);
+	CHECK(Packer.GetSharedCount() == 0);
+	CHECK(Packer.GetWindowCount() <= Packer.GetSequentialWindowCount(WindowSize));
+	for (size_t i = 0; i < Samples.size(); ++i) {
+		const stSampleLocation Location = Packer.GetLocation(i);
+		CHECK(Location.Window < Packer.GetWindowCount());
+		CHECK(Location.Offset % 0x40 == 0);
+		CHECK(Location.Offset + Samples[i].size() + 1 <= WindowSize);
+	}
+}
+
+} // namespace
+
+int main()
+{
+	TestIdentical();
+	TestPrefix();
+	TestUnplayedBytes();
+	TestWindows();
+	if (Failures)
+		std::fprintf(stderr, "%d check(s) failed\n", Failures);
+	return Failures ? 1 : 0;
+}
@@ -0,0 +1,114 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2016 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful, 
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU 
+** Library General Public License for more details.  To obtain a 
+** copy of the GNU Library General Public License, write to the Free 
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+
+// Command line tool for binary register logs written by CRegisterLogWriter, which are created by
+// running the main program with /log or the benchmark with -log.
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include "RegisterLog.h"
+
+namespace {
+
+void PrintUsage(const char *Name) {
+	std::fprintf(stderr,
+		"Usage: %s dump FILE\n"
+		"       %s diff [-notiming] FILE1 FILE2\n"
+		"  dump       print every register write of a log\n"
+		"  diff       find the first register write that differs between two logs\n"
+		"  -notiming  compare addresses and values only\n", Name, Name);
+}
+
+bool OpenLog(CRegisterLogReader &Reader, const char *pFile) {
+	if (Reader.Open(pFile))
+		return true;
+	std::fprintf(stderr, "Error: %s is not a register log\n", pFile);
+	return false;
+}
+
+void PrintRecord(const char *Prefix, const stRegisterLogRecord &Record) {
+	std::printf("%sframe %6" PRIu32 "  cycle %12" PRIu64 "  %-4s $%04X = $%02X\n", Prefix,
+		Record.Frame, Record.Cycle, CRegisterLogReader::GetChipName(Record.Chip), Record.Address, Record.Value);
+}
+
+int Dump(const char *pFile) {
+	CRegisterLogReader Reader;
+	if (!OpenLog(Reader, pFile))
+		return 1;
+
+	stRegisterLogRecord Record;
+	uint64_t Count = 0;
+	while (Reader.Read(Record)) {
+		PrintRecord("", Record);
+		++Count;
+	}
+	std::printf("%" PRIu64 " writes, %" PRIu32 " dropped\n", Count, Reader.GetHeader().Dropped);
+	return 0;
+}
+
+int Diff(const char *pFile1, const char *pFile2, bool bTiming) {
+	CRegisterLogReader Reader1, Reader2;
+	if (!OpenLog(Reader1, pFile1) || !OpenLog(Reader2, pFile2))
+		return 1;
+	if (Reader1.GetHeader().Dropped || Reader2.GetHeader().Dropped)
+		std::fprintf(stderr, "Warning: writes were dropped while logging, the logs may differ spuriously\n");
+
+	stRegisterLogRecord r1, r2;
+	for (uint64_t i = 0; ; ++i) {
+		const bool b1 = Reader1.Read(r1);
+		const bool b2 = Reader2.Read(r2);
+		if (!b1 && !b2) {
+			std::printf("Logs are identical, %" PRIu64 " writes\n", i);
+			return 0;
+		}
+		if (b1 != b2) {
+			std::printf("Write %" PRIu64 ": %s ends first\n", i, b1 ? pFile2 : pFile1);
+			PrintRecord(b1 ? "< " : "> ", b1 ? r1 : r2);
+			return 1;
+		}
+		if (r1.Address != r2.Address || r1.Value != r2.Value ||
+			(bTiming && (r1.Cycle != r2.Cycle || r1.Frame != r2.Frame))) {
+			std::printf("Write %" PRIu64 " differs:\n", i);
+			PrintRecord("< ", r1);
+			PrintRecord("> ", r2);
+			return 1;
+		}
+	}
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+	if (argc == 3 && !std::strcmp(argv[1], "dump"))
+		return Dump(argv[2]);
+	if (argc == 4 && !std::strcmp(argv[1], "diff"))
+		return Diff(argv[2], argv[3], true);
+	if (argc == 5 && !std::strcmp(argv[1], "diff") && !std::strcmp(argv[2], "-notiming"))
+		return Diff(argv[3], argv[4], false);
+
+	PrintUsage(argv[0]);
+	return 1;
+}
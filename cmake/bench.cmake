@@ -0,0 +1,51 @@
+# Headless benchmark program. Only the sound emulation core is built, so MFC is not required
+# and the program also runs on other platforms.
+
+add_executable(j0CC-benchmark
+        Source/APU/2A03.cpp
+        Source/APU/APU.CPP
+        Source/APU/DPCM.CPP
+        Source/APU/emu2413.c
+        Source/APU/FDS.CPP
+        Source/APU/FDSSound.cpp
+        Source/APU/Mixer.cpp
+        Source/APU/MMC5.CPP
+        Source/APU/N163.CPP
+        Source/APU/Noise.cpp
+        Source/APU/S5B.cpp
+        Source/APU/SoundChip.cpp
+        Source/APU/Square.cpp
+        Source/APU/Triangle.cpp
+        Source/APU/VRC6.CPP
+        Source/APU/VRC7.cpp
+        Source/Blip_Buffer/Blip_Buffer.cpp
+        Source/bench/BenchmarkMain.cpp
+        Source/EmulationBenchmark.cpp
+        Source/EmulationBenchmark.h
+        Source/FlacCodec.cpp
+        Source/FlacFile.cpp
+        Source/RegisterLog.cpp
+        Source/RegisterState.cpp
+        Source/resampler/resample.cpp
+        Source/resampler/sinc.cpp
+        Source/StageTimer.cpp
+        Source/TraceLog.cpp
+        Source/WaveFile.cpp
+        )
+
+# .CPP files are not recognized as C++ sources on case-sensitive platforms
+set_source_files_properties(
+        Source/APU/APU.CPP
+        Source/APU/DPCM.CPP
+        Source/APU/FDS.CPP
+        Source/APU/MMC5.CPP
+        Source/APU/N163.CPP
+        Source/APU/VRC6.CPP
+        PROPERTIES LANGUAGE CXX)
+
+target_include_directories(j0CC-benchmark PRIVATE . Source)
+target_compile_definitions(j0CC-benchmark PRIVATE FT_HEADLESS)
+target_compile_features(j0CC-benchmark PRIVATE cxx_std_17)
+
+find_package(Threads REQUIRED)
+target_link_libraries(j0CC-benchmark PRIVATE Threads::Threads)
@@ -54,6 +54,7 @@ add_executable(${PROJECT_NAME}
         Source/APU/SoundChip.h
         Source/APU/Square.cpp
         Source/APU/Square.h
+        Source/APU/StateArchive.h
         Source/APU/Triangle.cpp
         Source/APU/Triangle.h
         Source/APU/Types.h
@@ -91,6 +92,11 @@ add_executable(${PROJECT_NAME}
         Source/Action.cpp
         Source/Action.h
         Source/array_view.h
+        Source/AsmWriter.cpp
+        Source/AsmWriter.h
+        Source/AudioFile.h
+        Source/BankPacker.cpp
+        Source/BankPacker.h
         Source/Bookmark.cpp
         Source/Bookmark.h
         Source/BookmarkCollection.cpp
@@ -160,6 +166,8 @@ add_executable(${PROJECT_NAME}
         Source/ConfigWindow.h
         Source/ControlPanelDlg.cpp
         Source/ControlPanelDlg.h
+        Source/CPU6502.cpp
+        Source/CPU6502.h
         Source/CreateWaveDlg.cpp
         Source/CreateWaveDlg.h
         Source/CustomControls.cpp
@@ -186,14 +194,20 @@ add_executable(${PROJECT_NAME}
         Source/DPI.cpp
         Source/DPI.h
         Source/Driver.h
+        Source/DriverProfiler.cpp
+        Source/DriverProfiler.h
         Source/DSample.cpp
         Source/DSample.h
         Source/DSampleManager.cpp
         Source/DSampleManager.h
+        Source/EmulationBenchmark.cpp
+        Source/EmulationBenchmark.h
         Source/Exception.cpp
         Source/Exception.h
         Source/ExportDialog.cpp
         Source/ExportDialog.h
+        Source/ExportVerifier.cpp
+        Source/ExportVerifier.h
         Source/Factory.h
         Source/FamiTracker.cpp
         Source/FamiTracker.h
@@ -206,6 +220,10 @@ add_executable(${PROJECT_NAME}
         Source/FamiTrackerViewMessage.h
         Source/FindDlg.cpp
         Source/FindDlg.h
+        Source/FlacCodec.cpp
+        Source/FlacCodec.h
+        Source/FlacFile.cpp
+        Source/FlacFile.h
         Source/FrameAction.cpp
         Source/FrameAction.h
         Source/FrameEditor.cpp
@@ -271,6 +289,8 @@ add_executable(${PROJECT_NAME}
         Source/InstrumentVRC7.cpp
         Source/InstrumentVRC7.h
         Source/IntRange.h
+        Source/LoudnessMeter.cpp
+        Source/LoudnessMeter.h
         Source/MainFrm.cpp
         Source/MainFrm.h
         Source/MIDI.cpp
@@ -279,6 +299,8 @@ add_executable(${PROJECT_NAME}
         Source/ModSequenceEditor.h
         Source/ModuleException.cpp
         Source/ModuleException.h
+        Source/ModuleGenerator.cpp
+        Source/ModuleGenerator.h
         Source/ModuleImportDlg.cpp
         Source/ModuleImportDlg.h
         Source/ModulePropertiesDlg.cpp
@@ -287,11 +309,15 @@ add_executable(${PROJECT_NAME}
         Source/NoNotifyEdit.h
         Source/NoteQueue.cpp
         Source/NoteQueue.h
+        Source/NSFPlayer.cpp
+        Source/NSFPlayer.h
         Source/NumConv.h
         Source/OldSequence.cpp
         Source/OldSequence.h
         Source/PatternAction.cpp
         Source/PatternAction.h
+        Source/PatternCache.cpp
+        Source/PatternCache.h
         Source/PatternCompiler.cpp
         Source/PatternCompiler.h
         Source/PatternComponent.cpp
@@ -310,12 +336,22 @@ add_executable(${PROJECT_NAME}
         Source/PerformanceDlg.h
         Source/RecordSettingsDlg.cpp
         Source/RecordSettingsDlg.h
+        Source/RegisterLog.cpp
+        Source/RegisterLog.h
         Source/RegisterState.cpp
         Source/RegisterState.h
+        Source/RegisterStream.cpp
+        Source/RegisterStream.h
+        Source/RegressionTest.cpp
+        Source/RegressionTest.h
+        Source/RenderCache.cpp
+        Source/RenderCache.h
         Source/SampleEditorDlg.cpp
         Source/SampleEditorDlg.h
         Source/SampleEditorView.cpp
         Source/SampleEditorView.h
+        Source/SamplePacker.cpp
+        Source/SamplePacker.h
         Source/SeqInstHandler.cpp
         Source/SeqInstHandler.h
         Source/SeqInstHandler2A03Pulse.cpp
@@ -355,6 +391,8 @@ add_executable(${PROJECT_NAME}
         Source/SpeedDlg.h
         Source/SplitKeyboardDlg.cpp
         Source/SplitKeyboardDlg.h
+        Source/StageTimer.cpp
+        Source/StageTimer.h
         Source/stdafx.cpp
         Source/stdafx.h
         Source/StretchDlg.cpp
@@ -364,10 +402,16 @@ add_executable(${PROJECT_NAME}
         Source/TextExporter.cpp
         Source/TextExporter.h
         Source/to_sv.h
+        Source/TraceLog.cpp
+        Source/TraceLog.h
         Source/TrackerChannel.cpp
         Source/TrackerChannel.h
         Source/TransposeDlg.cpp
         Source/TransposeDlg.h
+        Source/VGMExport.cpp
+        Source/VGMExport.h
+        Source/VGMWriter.cpp
+        Source/VGMWriter.h
         Source/VisualizerBase.cpp
         Source/VisualizerBase.h
         Source/VisualizerScope.cpp
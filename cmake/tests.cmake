@@ -0,0 +1,66 @@
+# Headless unit tests, run with ctest. Only code that does not require MFC is tested.
+
+add_executable(j0CC-test-samplepacker
+        Source/SamplePacker.cpp
+        Source/SamplePacker.h
+        Source/tests/SamplePackerTest.cpp
+        )
+
+target_include_directories(j0CC-test-samplepacker PRIVATE . Source)
+target_compile_features(j0CC-test-samplepacker PRIVATE cxx_std_17)
+add_test(NAME SamplePacker COMMAND j0CC-test-samplepacker)
+
+add_executable(j0CC-test-loudnessmeter
+        Source/LoudnessMeter.cpp
+        Source/LoudnessMeter.h
+        Source/tests/LoudnessMeterTest.cpp
+        )
+
+target_include_directories(j0CC-test-loudnessmeter PRIVATE . Source)
+target_compile_features(j0CC-test-loudnessmeter PRIVATE cxx_std_17)
+add_test(NAME LoudnessMeter COMMAND j0CC-test-loudnessmeter)
+
+# Re-renders through CRenderCache against plain emulation
+add_executable(j0CC-test-rendercache
+        Source/APU/2A03.cpp
+        Source/APU/APU.CPP
+        Source/APU/DPCM.CPP
+        Source/APU/emu2413.c
+        Source/APU/FDS.CPP
+        Source/APU/FDSSound.cpp
+        Source/APU/Mixer.cpp
+        Source/APU/MMC5.CPP
+        Source/APU/N163.CPP
+        Source/APU/Noise.cpp
+        Source/APU/S5B.cpp
+        Source/APU/SoundChip.cpp
+        Source/APU/Square.cpp
+        Source/APU/Triangle.cpp
+        Source/APU/VRC6.CPP
+        Source/APU/VRC7.cpp
+        Source/Blip_Buffer/Blip_Buffer.cpp
+        Source/RegisterLog.cpp
+        Source/RegisterState.cpp
+        Source/RenderCache.cpp
+        Source/RenderCache.h
+        Source/StageTimer.cpp
+        Source/TraceLog.cpp
+        Source/tests/RenderCacheTest.cpp
+        )
+
+# .CPP files are not recognized as C++ sources on case-sensitive platforms
+set_source_files_properties(
+        Source/APU/APU.CPP
+        Source/APU/DPCM.CPP
+        Source/APU/FDS.CPP
+        Source/APU/MMC5.CPP
+        Source/APU/N163.CPP
+        Source/APU/VRC6.CPP
+        PROPERTIES LANGUAGE CXX)
+
+target_include_directories(j0CC-test-rendercache PRIVATE . Source)
+target_compile_definitions(j0CC-test-rendercache PRIVATE FT_HEADLESS)
+target_compile_features(j0CC-test-rendercache PRIVATE cxx_std_17)
+find_package(Threads REQUIRED)
+target_link_libraries(j0CC-test-rendercache PRIVATE Threads::Threads)
+add_test(NAME RenderCache COMMAND j0CC-test-rendercache)
@@ -0,0 +1,15 @@
+# Headless command line tools that do not require MFC.
+
+find_package(Threads REQUIRED)
+
+# Binary register log dumper and comparer
+add_executable(j0CC-reglog
+        Source/RegisterLog.cpp
+        Source/RegisterLog.h
+        Source/tools/RegisterLogTool.cpp
+        )
+
+target_include_directories(j0CC-reglog PRIVATE . Source)
+target_compile_definitions(j0CC-reglog PRIVATE FT_HEADLESS)
+target_compile_features(j0CC-reglog PRIVATE cxx_std_17)
+target_link_libraries(j0CC-reglog PRIVATE Threads::Threads)
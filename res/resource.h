@@ -203,6 +203,8 @@
 #define IDS_MIDI_MESSAGE_OFF            317
 #define IDI_RIGHT                       317
 #define IDS_WAVE_PROGRESS_ROW_FORMAT    318
+#define IDS_FILTER_FLAC                 319
+#define IDS_WAVE_EXPORT_FAILED          320
 #define IDR_SEQUENCE_POPUP              319
 #define IDD_STRETCH                     323
 #define IDD_BOOKMARKS                   324
@@ -598,6 +600,12 @@
 #define IDC_N163_OFFSET_EDIT            1463
 #define IDC_N163_OFFSET_DB              1464
 #define IDC_FONT_PERCENT                1465
+#define IDC_PERF_STAGES                 1466
+#define IDC_PERF_TRACE                  1467
+#define IDC_PERF_SAVE_TRACE             1468
+#define IDC_SAMPLE_FORMAT               1469
+#define IDC_LOUDNESS                    1470
+#define IDC_PROFILE                     1471
 #define IDS_FIND_BEGIN                  9001
 #define IDS_FIND_END                    9002
 #define ID_TRACKER_PLAY                 32771
@@ -759,7 +767,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        358
 #define _APS_NEXT_COMMAND_VALUE         33200
-#define _APS_NEXT_CONTROL_VALUE         1466
+#define _APS_NEXT_CONTROL_VALUE         1472
 #define _APS_NEXT_SYMED_VALUE           179
 #endif
 #endif